@@ -0,0 +1,875 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "branch.hh"
+#include "simd.hh"
+
+namespace dtl::art {
+
+    // Adaptive radix tree over fixed-length binary keys (flow keys, addresses encoded big-endian so that byte order
+    // is numeric order), after Leis et al.: inner nodes of 4, 16, 48 or 256 children grow as they fill, paths are
+    // compressed into per-node prefixes, and leaves hold the whole key and value. Iteration visits keys in
+    // lexicographic order, which makes range and prefix scans ("all flows from 10.1.0.0/16") a bounded walk.
+    //
+    // Concurrency follows optimistic lock coupling: each inner node carries a version word (bit 1 locked, bit 0
+    // obsolete). Readers never write shared memory; they note versions on the way down and restart if one changed.
+    // Writers lock only the one or two nodes they modify, and build any new leaf or node before locking, so that a
+    // failed allocation leaves nothing locked. Leaves are immutable (updates publish a new leaf), and nodes and
+    // leaves replaced under readers are retired rather than freed: collect() frees them once the owner knows no
+    // reader is still inside the tree. Nodes are not shrunk on erase.
+    //
+    // That reclamation relies on quiescence the tree cannot see for itself: the owner has to establish that every
+    // reader has left (between batches, or through its own epochs) before calling collect(). A reader that stays
+    // inside (a long scan, a thread descheduled mid-lookup) therefore holds back all reclamation, and retired
+    // memory grows without bound for as long as it does. Where readers can stall, dtl::hazard pins only the
+    // pointers a reader actually holds, at the cost of a protected load per step.
+
+    template<std::size_t Length, typename Value>
+    class tree {
+
+        static_assert(Length > 0 && Length < 256, "prefix lengths are stored in a byte");
+        static_assert(std::is_trivially_copyable<Value>::value);
+
+    public:
+
+        using key_type = std::array<std::uint8_t, Length>;
+        using value_type = Value;
+
+    private:
+
+        enum class kind : std::uint8_t { node4, node16, node48, node256 };
+
+        struct leaf {
+
+            key_type key;
+            Value value;
+
+        }; // struct tree::leaf
+
+        struct node {
+
+            std::atomic<std::uint64_t> version{0};
+            kind type;
+            std::uint8_t prefix_length = 0;
+            std::uint16_t count = 0;
+            std::uint8_t prefix[Length];
+
+            inline explicit node(kind type) noexcept : type(type) {}
+
+        }; // struct tree::node
+
+        struct node4 : node {
+
+            std::uint8_t keys[4] = {};
+            std::atomic<std::uintptr_t> children[4] = {};
+
+            inline node4() noexcept : node(kind::node4) {}
+
+        }; // struct tree::node4
+
+        struct node16 : node {
+
+            alignas(16) std::uint8_t keys[16] = {};
+            std::atomic<std::uintptr_t> children[16] = {};
+
+            inline node16() noexcept : node(kind::node16) {}
+
+        }; // struct tree::node16
+
+        struct node48 : node {
+
+            std::uint8_t index[256] = {};        // slot + 1, zero when absent
+            std::atomic<std::uintptr_t> children[48] = {};
+
+            inline node48() noexcept : node(kind::node48) {}
+
+        }; // struct tree::node48
+
+        struct node256 : node {
+
+            std::atomic<std::uintptr_t> children[256] = {};
+
+            inline node256() noexcept : node(kind::node256) {}
+
+        }; // struct tree::node256
+
+        // Child words hold either an inner node or a leaf tagged in the low bit.
+
+        inline static bool is_leaf(std::uintptr_t child) noexcept { return child & 1; }
+        inline static leaf * as_leaf(std::uintptr_t child) noexcept { return reinterpret_cast<leaf *>(child & ~std::uintptr_t(1)); }
+        inline static node * as_node(std::uintptr_t child) noexcept { return reinterpret_cast<node *>(child); }
+        inline static std::uintptr_t tag(leaf * l) noexcept { return reinterpret_cast<std::uintptr_t>(l) | 1; }
+        inline static std::uintptr_t tag(node * n) noexcept { return reinterpret_cast<std::uintptr_t>(n); }
+
+        // Version word protocol.
+
+        constexpr static std::uint64_t obsolete = 1;
+        constexpr static std::uint64_t locked = 2;
+
+        inline static bool
+        read_lock(
+            const node * n,
+            std::uint64_t & version
+            ) noexcept {
+
+            version = n->version.load(std::memory_order_acquire);
+            return !(version & (locked | obsolete));
+
+        } // tree::read_lock()
+
+        // True when nothing was written to the node since `version` was read; reads made in between are then valid.
+        inline static bool
+        validate(
+            const node * n,
+            std::uint64_t version
+            ) noexcept {
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return n->version.load(std::memory_order_relaxed) == version;
+
+        } // tree::validate()
+
+        inline static bool
+        upgrade(
+            node * n,
+            std::uint64_t version
+            ) noexcept {
+
+            return n->version.compare_exchange_strong(version, version + locked, std::memory_order_acquire);
+
+        } // tree::upgrade()
+
+        inline static void
+        write_unlock(
+            node * n
+            ) noexcept {
+
+            n->version.fetch_add(locked, std::memory_order_release);
+
+        } // tree::write_unlock()
+
+        inline static void
+        write_unlock_obsolete(
+            node * n
+            ) noexcept {
+
+            n->version.fetch_add(locked | obsolete, std::memory_order_release);
+
+        } // tree::write_unlock_obsolete()
+
+        // Node operations; readers call them between read_lock() and validate(), writers under the write lock.
+
+        inline static std::atomic<std::uintptr_t> *
+        slot(
+            node * n,
+            std::uint8_t byte
+            ) noexcept {
+
+            switch (n->type) {
+            case kind::node4: {
+                auto * x = static_cast<node4 *>(n);
+                for (std::size_t i = 0; i < 4 && i < x->count; ++i) {
+                    if (x->keys[i] == byte) return &x->children[i];
+                }
+                return nullptr;
+            }
+            case kind::node16: {
+                auto * x = static_cast<node16 *>(n);
+                using v16 = simd::vec<std::uint8_t, 16>;
+                auto hits = simd::movemask(simd::eq(v16::load(x->keys), v16::broadcast(byte)));
+                std::uint32_t count = x->count;
+                hits &= (count >= 16) ? 0xffff : (1u << count) - 1;
+                return hits ? &x->children[__builtin_ctzll(hits)] : nullptr;
+            }
+            case kind::node48: {
+                auto * x = static_cast<node48 *>(n);
+                auto i = x->index[byte];
+                return (i && i <= 48) ? &x->children[i - 1] : nullptr;
+            }
+            default:
+                return &static_cast<node256 *>(n)->children[byte];
+            }
+
+        } // tree::slot()
+
+        inline static std::uintptr_t
+        child(
+            node * n,
+            std::uint8_t byte
+            ) noexcept {
+
+            auto * s = slot(n, byte);
+            return s ? s->load(std::memory_order_acquire) : 0;
+
+        } // tree::child()
+
+        inline static bool
+        full(
+            const node * n
+            ) noexcept {
+
+            switch (n->type) {
+            case kind::node4: return n->count == 4;
+            case kind::node16: return n->count == 16;
+            case kind::node48: return n->count == 48;
+            default: return false;
+            }
+
+        } // tree::full()
+
+        // Adds a child for a byte not present; the node must have room.
+        inline static void
+        add(
+            node * n,
+            std::uint8_t byte,
+            std::uintptr_t c
+            ) noexcept {
+
+            switch (n->type) {
+            case kind::node4:
+            case kind::node16: {
+                std::uint8_t * keys;
+                std::atomic<std::uintptr_t> * children;
+                if (n->type == kind::node4) {
+                    keys = static_cast<node4 *>(n)->keys;
+                    children = static_cast<node4 *>(n)->children;
+                } else {
+                    keys = static_cast<node16 *>(n)->keys;
+                    children = static_cast<node16 *>(n)->children;
+                }
+                std::size_t at = 0;
+                while (at < n->count && keys[at] < byte) ++at;
+                for (std::size_t i = n->count; i > at; --i) {
+                    keys[i] = keys[i - 1];
+                    children[i].store(children[i - 1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                }
+                keys[at] = byte;
+                children[at].store(c, std::memory_order_release);
+                break;
+            }
+            case kind::node48: {
+                auto * x = static_cast<node48 *>(n);
+                std::size_t free = 0;
+                while (x->children[free].load(std::memory_order_relaxed)) ++free;
+                x->children[free].store(c, std::memory_order_release);
+                x->index[byte] = static_cast<std::uint8_t>(free + 1);
+                break;
+            }
+            default:
+                static_cast<node256 *>(n)->children[byte].store(c, std::memory_order_release);
+                break;
+            }
+            ++n->count;
+
+        } // tree::add()
+
+        inline static void
+        remove(
+            node * n,
+            std::uint8_t byte
+            ) noexcept {
+
+            switch (n->type) {
+            case kind::node4:
+            case kind::node16: {
+                std::uint8_t * keys;
+                std::atomic<std::uintptr_t> * children;
+                if (n->type == kind::node4) {
+                    keys = static_cast<node4 *>(n)->keys;
+                    children = static_cast<node4 *>(n)->children;
+                } else {
+                    keys = static_cast<node16 *>(n)->keys;
+                    children = static_cast<node16 *>(n)->children;
+                }
+                std::size_t at = 0;
+                while (keys[at] != byte) ++at;
+                for (std::size_t i = at + 1; i < n->count; ++i) {
+                    keys[i - 1] = keys[i];
+                    children[i - 1].store(children[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                }
+                children[n->count - 1].store(0, std::memory_order_relaxed);
+                break;
+            }
+            case kind::node48: {
+                auto * x = static_cast<node48 *>(n);
+                x->children[x->index[byte] - 1].store(0, std::memory_order_relaxed);
+                x->index[byte] = 0;
+                break;
+            }
+            default:
+                static_cast<node256 *>(n)->children[byte].store(0, std::memory_order_relaxed);
+                break;
+            }
+            --n->count;
+
+        } // tree::remove()
+
+        // Visits children in byte order as visitor(byte, child); stops early when the visitor returns false.
+        template<typename Visitor>
+        inline static bool
+        children(
+            node * n,
+            Visitor && visitor
+            ) {
+
+            switch (n->type) {
+            case kind::node4:
+            case kind::node16: {
+                const std::uint8_t * keys;
+                std::atomic<std::uintptr_t> * slots;
+                std::size_t capacity;
+                if (n->type == kind::node4) {
+                    keys = static_cast<node4 *>(n)->keys;
+                    slots = static_cast<node4 *>(n)->children;
+                    capacity = 4;
+                } else {
+                    keys = static_cast<node16 *>(n)->keys;
+                    slots = static_cast<node16 *>(n)->children;
+                    capacity = 16;
+                }
+                for (std::size_t i = 0; i < capacity && i < n->count; ++i) {
+                    if (!visitor(keys[i], slots[i].load(std::memory_order_acquire))) return false;
+                }
+                return true;
+            }
+            case kind::node48: {
+                auto * x = static_cast<node48 *>(n);
+                for (unsigned b = 0; b < 256; ++b) {
+                    auto i = x->index[b];
+                    if (i && !visitor(std::uint8_t(b), x->children[(i - 1) % 48].load(std::memory_order_acquire))) return false;
+                }
+                return true;
+            }
+            default: {
+                auto * x = static_cast<node256 *>(n);
+                for (unsigned b = 0; b < 256; ++b) {
+                    auto c = x->children[b].load(std::memory_order_acquire);
+                    if (c && !visitor(std::uint8_t(b), c)) return false;
+                }
+                return true;
+            }
+            }
+
+        } // tree::children()
+
+        // A new node4 holding two children under distinct bytes, below a compressed prefix.
+        inline static node4 *
+        fork(
+            const std::uint8_t * prefix,
+            std::size_t length,
+            std::uint8_t a,
+            std::uintptr_t first,
+            std::uint8_t b,
+            std::uintptr_t second
+            ) noexcept(false) {
+
+            auto * n = new node4();
+            n->prefix_length = static_cast<std::uint8_t>(length);
+            std::memcpy(n->prefix, prefix, length);
+            if (b < a) {
+                std::swap(a, b);
+                std::swap(first, second);
+            }
+            n->keys[0] = a;
+            n->keys[1] = b;
+            n->children[0].store(first, std::memory_order_relaxed);
+            n->children[1].store(second, std::memory_order_relaxed);
+            n->count = 2;
+            return n;
+
+        } // tree::fork()
+
+        // Copy of a full node into the next size up.
+        inline static node *
+        grow(
+            node * n
+            ) noexcept(false) {
+
+            node * bigger;
+            switch (n->type) {
+            case kind::node4: bigger = new node16(); break;
+            case kind::node16: bigger = new node48(); break;
+            default: bigger = new node256(); break;
+            }
+            bigger->prefix_length = n->prefix_length;
+            std::memcpy(bigger->prefix, n->prefix, n->prefix_length);
+            children(n, [&](std::uint8_t byte, std::uintptr_t c) {
+                add(bigger, byte, c);
+                return true;
+            });
+            return bigger;
+
+        } // tree::grow()
+
+        inline static void
+        destroy(
+            std::uintptr_t c
+            ) noexcept {
+
+            if (!c) return;
+            if (is_leaf(c)) {
+                delete as_leaf(c);
+                return;
+            }
+            auto * n = as_node(c);
+            children(n, [](std::uint8_t, std::uintptr_t grandchild) {
+                destroy(grandchild);
+                return true;
+            });
+            free(n);
+
+        } // tree::destroy()
+
+        inline static void
+        free(
+            node * n
+            ) noexcept {
+
+            switch (n->type) {
+            case kind::node4: delete static_cast<node4 *>(n); break;
+            case kind::node16: delete static_cast<node16 *>(n); break;
+            case kind::node48: delete static_cast<node48 *>(n); break;
+            default: delete static_cast<node256 *>(n); break;
+            }
+
+        } // tree::free()
+
+        // The root is a node256 with an empty prefix: it never grows or splits, so it never has to be replaced.
+        node256 root;
+        std::atomic<std::size_t> count{0};
+
+        std::mutex retiring;
+        std::vector<std::uintptr_t> retired;
+
+        inline void
+        retire(
+            std::uintptr_t c
+            ) noexcept(false) {
+
+            std::lock_guard<std::mutex> guard(retiring);
+            retired.push_back(c);
+
+        } // tree::retire()
+
+        enum class outcome { restart, done, stopped };
+
+        // One optimistic attempt at an ordered walk of the keys in [low, high], starting after `low` when `after`
+        // is set. `above` and `below` record that the path so far already sorts strictly after low or before high,
+        // so that only the subtrees along the two bounds compare bytes. On a restart the caller resumes after the
+        // last key visited.
+        template<typename Visitor>
+        inline static outcome
+        walk(
+            node * n,
+            std::size_t depth,
+            bool above,
+            bool below,
+            key_type & path,
+            const key_type & low,
+            const key_type & high,
+            bool after,
+            key_type & last,
+            bool & visited,
+            Visitor & visitor
+            ) {
+
+            std::uint64_t version;
+            if (!read_lock(n, version)) return outcome::restart;
+
+            std::uint8_t prefix_length = n->prefix_length;
+            if (prefix_length >= Length - depth) return outcome::restart;
+            std::memcpy(path.data() + depth, n->prefix, prefix_length);
+            if (!validate(n, version)) return outcome::restart;
+
+            int to_low = above ? 1 : std::memcmp(path.data() + depth, low.data() + depth, prefix_length);
+            int to_high = below ? -1 : std::memcmp(path.data() + depth, high.data() + depth, prefix_length);
+            if (to_low < 0) return outcome::done;
+            if (to_high > 0) return outcome::stopped;
+            depth += prefix_length;
+
+            auto result = outcome::done;
+            children(n, [&](std::uint8_t byte, std::uintptr_t c) {
+                if (!to_low && byte < low[depth]) return true;
+                if (!to_high && byte > high[depth]) {
+                    result = outcome::stopped;
+                    return false;
+                }
+                if (!validate(n, version)) {
+                    result = outcome::restart;
+                    return false;
+                }
+                bool child_above = to_low > 0 || byte > low[depth];
+                bool child_below = to_high < 0 || byte < high[depth];
+                path[depth] = byte;
+
+                if (!is_leaf(c)) {
+                    auto r = walk(as_node(c), depth + 1, child_above, child_below, path, low, high, after, last,
+                                  visited, visitor);
+                    if (r != outcome::done) {
+                        result = r;
+                        return false;
+                    }
+                    return true;
+                }
+
+                auto * l = as_leaf(c);
+                if (!child_above && (l->key < low || (after && l->key == low))) return true;
+                if (!child_below && high < l->key) {
+                    result = outcome::stopped;
+                    return false;
+                }
+                last = l->key;
+                visited = true;
+                if (!visitor(static_cast<const key_type &>(l->key), static_cast<const Value &>(l->value))) {
+                    result = outcome::stopped;
+                    return false;
+                }
+                return true;
+            });
+            return result;
+
+        } // tree::walk()
+
+        // Number of leading bytes of the node's prefix matching the key from `depth`. A prefix can never reach the
+        // last key byte, which also bounds what a reader racing with a writer may compare.
+        inline static std::size_t
+        matching(
+            const node * n,
+            const key_type & key,
+            std::size_t depth
+            ) noexcept {
+
+            std::size_t i = 0;
+            std::size_t length = n->prefix_length;
+            if (length > Length - depth - 1) length = Length - depth - 1;
+            while (i < length && n->prefix[i] == key[depth + i]) ++i;
+            return i;
+
+        } // tree::matching()
+
+        inline outcome
+        try_insert(
+            const key_type & key,
+            const Value & value,
+            bool & added
+            ) noexcept(false) {
+
+            node * parent = nullptr;
+            std::uint64_t parent_version = 0;
+            std::uint8_t parent_byte = 0;
+            node * n = &root;
+            std::uint64_t version;
+            std::size_t depth = 0;
+
+            if (!read_lock(n, version)) return outcome::restart;
+
+            for (;;) {
+                auto matched = matching(n, key, depth);
+                if (matched < n->prefix_length) {
+                    // Split the compressed path: a new node4 takes the common part and both branches. Both are
+                    // built from the optimistic read before locking, which the upgrades then confirm.
+                    std::unique_ptr<leaf> l(new leaf{ key, value });
+                    std::unique_ptr<node4> split(
+                        fork(n->prefix, matched, n->prefix[matched], tag(n), key[depth + matched], tag(l.get())));
+                    if (!upgrade(parent, parent_version)) return outcome::restart;
+                    if (!upgrade(n, version)) {
+                        write_unlock(parent);
+                        return outcome::restart;
+                    }
+                    l.release();
+
+                    auto rest = n->prefix_length - matched - 1;
+                    std::memmove(n->prefix, n->prefix + matched + 1, rest);
+                    n->prefix_length = static_cast<std::uint8_t>(rest);
+
+                    slot(parent, parent_byte)->store(tag(split.release()), std::memory_order_release);
+                    write_unlock(n);
+                    write_unlock(parent);
+                    added = true;
+                    return outcome::done;
+                }
+                depth += n->prefix_length;
+
+                auto byte = key[depth];
+                auto c = child(n, byte);
+                if (!validate(n, version)) return outcome::restart;
+
+                if (!c) {
+                    std::unique_ptr<leaf> l(new leaf{ key, value });
+                    if (full(n)) {
+                        // Copied from the optimistic read; a failed upgrade means it may be torn, and it is dropped.
+                        auto * bigger = grow(n);
+                        if (!upgrade(parent, parent_version)) {
+                            free(bigger);
+                            return outcome::restart;
+                        }
+                        if (!upgrade(n, version)) {
+                            write_unlock(parent);
+                            free(bigger);
+                            return outcome::restart;
+                        }
+                        add(bigger, byte, tag(l.release()));
+                        slot(parent, parent_byte)->store(tag(bigger), std::memory_order_release);
+                        write_unlock_obsolete(n);
+                        write_unlock(parent);
+                        retire(tag(n));
+                    } else {
+                        if (!upgrade(n, version)) return outcome::restart;
+                        if (parent && !validate(parent, parent_version)) {
+                            write_unlock(n);
+                            return outcome::restart;
+                        }
+                        add(n, byte, tag(l.release()));
+                        write_unlock(n);
+                    }
+                    added = true;
+                    return outcome::done;
+                }
+
+                if (parent && !validate(parent, parent_version)) return outcome::restart;
+
+                if (is_leaf(c)) {
+                    std::unique_ptr<leaf> l(new leaf{ key, value });
+                    auto * existing = as_leaf(c);
+                    std::unique_ptr<node4> split;
+                    if (existing->key != key) {
+                        // Two keys under one byte: push both down into a node4 holding their common run.
+                        auto from = depth + 1, at = from;
+                        while (existing->key[at] == key[at]) ++at;
+                        split.reset(fork(key.data() + from, at - from, existing->key[at], c, key[at], tag(l.get())));
+                    }
+                    if (!upgrade(n, version)) return outcome::restart;
+                    if (!split) {
+                        slot(n, byte)->store(tag(l.release()), std::memory_order_release);
+                        write_unlock(n);
+                        retire(c);
+                        added = false;
+                        return outcome::done;
+                    }
+                    l.release();
+                    slot(n, byte)->store(tag(split.release()), std::memory_order_release);
+                    write_unlock(n);
+                    added = true;
+                    return outcome::done;
+                }
+
+                parent = n;
+                parent_version = version;
+                parent_byte = byte;
+                n = as_node(c);
+                if (!read_lock(n, version)) return outcome::restart;
+                if (!validate(parent, parent_version)) return outcome::restart;
+                depth += 1;
+            }
+
+        } // tree::try_insert()
+
+        inline outcome
+        try_erase(
+            const key_type & key,
+            bool & erased
+            ) noexcept(false) {
+
+            node * n = &root;
+            std::uint64_t version;
+            std::size_t depth = 0;
+
+            if (!read_lock(n, version)) return outcome::restart;
+
+            for (;;) {
+                if (matching(n, key, depth) < n->prefix_length) {
+                    if (!validate(n, version)) return outcome::restart;
+                    erased = false;
+                    return outcome::done;
+                }
+                depth += n->prefix_length;
+
+                auto byte = key[depth];
+                auto c = child(n, byte);
+                if (!validate(n, version)) return outcome::restart;
+
+                if (!c || (is_leaf(c) && as_leaf(c)->key != key)) {
+                    erased = false;
+                    return outcome::done;
+                }
+                if (is_leaf(c)) {
+                    if (!upgrade(n, version)) return outcome::restart;
+                    remove(n, byte);
+                    write_unlock(n);
+                    retire(c);
+                    erased = true;
+                    return outcome::done;
+                }
+
+                auto * next = as_node(c);
+                std::uint64_t next_version;
+                if (!read_lock(next, next_version)) return outcome::restart;
+                if (!validate(n, version)) return outcome::restart;
+                n = next;
+                version = next_version;
+                depth += 1;
+            }
+
+        } // tree::try_erase()
+
+    public:
+
+        tree() = default;
+
+        tree(const tree &) = delete;
+        tree & operator=(const tree &) = delete;
+
+        inline
+        ~tree() noexcept {
+
+            for (auto & c : root.children) destroy(c.load(std::memory_order_relaxed));
+            collect();
+
+        } // tree::~tree()
+
+        inline std::optional<Value>
+        find(
+            const key_type & key
+            ) const noexcept {
+
+            for (;;) {
+                node * n = const_cast<node256 *>(&root);
+                std::uint64_t version;
+                std::size_t depth = 0;
+                if (!read_lock(n, version)) continue;
+
+                for (;;) {
+                    if (matching(n, key, depth) < n->prefix_length) {
+                        if (!validate(n, version)) break;
+                        return std::nullopt;
+                    }
+                    depth += n->prefix_length;
+
+                    auto c = child(n, key[depth]);
+                    if (!validate(n, version)) break;
+
+                    if (!c) return std::nullopt;
+                    if (is_leaf(c)) {
+                        auto * l = as_leaf(c);
+                        if (l->key != key) return std::nullopt;
+                        return l->value;
+                    }
+
+                    auto * next = as_node(c);
+                    std::uint64_t next_version;
+                    if (!read_lock(next, next_version) || !validate(n, version)) break;
+                    n = next;
+                    version = next_version;
+                    depth += 1;
+                }
+            }
+
+        } // tree::find()
+
+        // Inserts or replaces; true when the key was not present before.
+        inline bool
+        insert(
+            const key_type & key,
+            const Value & value
+            ) noexcept(false) {
+
+            bool added = false;
+            while (try_insert(key, value, added) == outcome::restart) {}
+            if (added) count.fetch_add(1, std::memory_order_relaxed);
+            return added;
+
+        } // tree::insert()
+
+        inline bool
+        erase(
+            const key_type & key
+            ) noexcept(false) {
+
+            bool erased = false;
+            while (try_erase(key, erased) == outcome::restart) {}
+            if (erased) count.fetch_sub(1, std::memory_order_relaxed);
+            return erased;
+
+        } // tree::erase()
+
+        inline std::size_t
+        size() const noexcept {
+
+            return count.load(std::memory_order_relaxed);
+
+        } // tree::size()
+
+        // Visits the keys in [low, high] in order as visitor(key, value) -> bool, stopping when it returns false.
+        // Under concurrent writers each key is visited at most once; keys inserted or erased during the scan may
+        // or may not be seen.
+        template<typename Visitor>
+        inline void
+        scan(
+            const key_type & low,
+            const key_type & high,
+            Visitor && visitor
+            ) const {
+
+            key_type from = low, last{}, path{};
+            bool after = false;
+            for (;;) {
+                bool visited = false;
+                auto r = walk(const_cast<node256 *>(&root), 0, false, false, path, from, high, after, last, visited, visitor);
+                if (r != outcome::restart) return;
+                if (visited) {
+                    from = last;
+                    after = true;
+                }
+            }
+
+        } // tree::scan()
+
+        // Visits every key starting with the first `length` bytes of `prefix`, in order.
+        template<typename Visitor>
+        inline void
+        scan_prefix(
+            const std::uint8_t * prefix,
+            std::size_t length,
+            Visitor && visitor
+            ) const {
+
+            key_type low, high;
+            low.fill(0x00);
+            high.fill(0xff);
+            std::memcpy(low.data(), prefix, length);
+            std::memcpy(high.data(), prefix, length);
+            scan(low, high, visitor);
+
+        } // tree::scan_prefix()
+
+        // Frees nodes and leaves replaced or erased so far. Only safe while no reader or writer is inside the tree
+        // (e.g. between batches, or after the owner's epoch has advanced past every reader); see the quiescence
+        // note at the top of this file.
+        inline void
+        collect() noexcept {
+
+            std::vector<std::uintptr_t> garbage;
+            {
+                std::lock_guard<std::mutex> guard(retiring);
+                garbage.swap(retired);
+            }
+            for (auto c : garbage) {
+                if (is_leaf(c)) delete as_leaf(c);
+                else free(as_node(c));
+            }
+
+        } // tree::collect()
+
+    }; // class dtl::art::tree
+
+} // namespace dtl::art
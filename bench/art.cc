@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+#include "art.hh"
+#include "bench.hh"
+
+using namespace dtl;
+
+// A million random 64-bit keys: inserts, point lookups in random order and short range scans, art::tree against
+// std::map.
+
+namespace {
+
+    std::array<std::uint8_t, 8>
+    encode(
+        std::uint64_t x
+        ) {
+
+        std::array<std::uint8_t, 8> k;
+        for (int i = 0; i < 8; ++i) k[i] = static_cast<std::uint8_t>(x >> (56 - 8 * i));
+        return k;
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    const auto n = bench::scaled(1 << 20);
+    std::mt19937_64 rng(1);
+    std::vector<std::uint64_t> keys(n);
+    for (auto & k : keys) k = rng();
+
+    art::tree<8, std::uint64_t> t;
+    std::map<std::uint64_t, std::uint64_t> m;
+    bench::report("std::map  insert", bench::measure(n, [&] {
+        m.clear();
+        for (auto k : keys) m.emplace(k, k);
+    }, 1));
+    bench::report("art::tree insert", bench::measure(n, [&] {
+        for (auto k : keys) t.insert(encode(k), k);
+    }, 1));
+
+    std::shuffle(keys.begin(), keys.end(), rng);
+    bench::report("std::map  find", bench::measure(n, [&] {
+        for (auto k : keys) bench::keep(m.find(k)->second);
+    }));
+    bench::report("art::tree find", bench::measure(n, [&] {
+        for (auto k : keys) bench::keep(*t.find(encode(k)));
+    }));
+
+    // About 16 keys per scan.
+    constexpr std::uint64_t width = std::uint64_t(1) << 48;
+    const std::size_t scans = n / 16;
+    bench::report("std::map  scan (per key)", bench::measure(scans * 16, [&] {
+        for (std::size_t i = 0; i < scans; ++i) {
+            auto low = keys[i];
+            for (auto at = m.lower_bound(low); at != m.end() && at->first - low <= width; ++at) bench::keep(at->second);
+        }
+    }));
+    bench::report("art::tree scan (per key)", bench::measure(scans * 16, [&] {
+        for (std::size_t i = 0; i < scans; ++i) {
+            auto low = keys[i], high = (low > ~width) ? ~std::uint64_t(0) : low + width;
+            t.scan(encode(low), encode(high), [](const auto &, const std::uint64_t & v) {
+                bench::keep(v);
+                return true;
+            });
+        }
+    }));
+
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+
+// Minimal timing for the benchmarks: each measurement runs its body several times and keeps the fastest run, which
+// is the least disturbed by the rest of the machine. DTL_BENCH_SCALE in the environment multiplies every
+// benchmark's work, for longer (steadier) or shorter (smoke-test) runs.
+
+namespace dtl::bench {
+
+    // Keeps the compiler from discarding a computed value or hoisting the work producing it out of the loop.
+    template<typename T>
+    inline static void
+    keep(
+        const T & value
+        ) noexcept {
+
+        asm volatile("" : : "r,m"(value) : "memory");
+
+    } // bench::keep()
+
+    inline static double
+    scale() noexcept {
+
+        static const double factor = [] {
+            auto * value = std::getenv("DTL_BENCH_SCALE");
+            auto parsed = value ? std::atof(value) : 1.0;
+            return parsed > 0 ? parsed : 1.0;
+        }();
+        return factor;
+
+    } // bench::scale()
+
+    inline static std::size_t
+    scaled(
+        std::size_t count
+        ) noexcept {
+
+        return std::max<std::size_t>(1, static_cast<std::size_t>(static_cast<double>(count) * scale()));
+
+    } // bench::scaled()
+
+    // Nanoseconds per item of the fastest of `runs` calls to body(), each of which processes `items` items.
+    template<typename Body>
+    inline static double
+    measure(
+        std::size_t items,
+        Body && body,
+        unsigned runs = 5
+        ) {
+
+        auto best = std::numeric_limits<double>::infinity();
+        for (unsigned r = 0; r < runs; ++r) {
+            auto start = std::chrono::steady_clock::now();
+            body();
+            std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count() / static_cast<double>(items));
+        }
+        return best;
+
+    } // bench::measure()
+
+    inline static void
+    report(
+        const char * name,
+        double ns_per_item
+        ) noexcept {
+
+        std::printf("%-48s %10.2f ns %12.2f M/s\n", name, ns_per_item, 1e3 / ns_per_item);
+
+    } // bench::report()
+
+    // As above, with the throughput of `bytes` bytes per item.
+    inline static void
+    report(
+        const char * name,
+        double ns_per_item,
+        std::size_t bytes
+        ) noexcept {
+
+        std::printf("%-48s %10.2f ns %10.2f GB/s\n", name, ns_per_item, static_cast<double>(bytes) / ns_per_item);
+
+    } // bench::report(..., bytes)
+
+    // As above, as items per nanosecond of the named unit (draws, samples) where several fit in a nanosecond.
+    inline static void
+    report(
+        const char * name,
+        double ns_per_item,
+        const char * unit
+        ) noexcept {
+
+        std::printf("%-48s %10.3f ns %9.2f %s/ns\n", name, ns_per_item, 1 / ns_per_item, unit);
+
+    } // bench::report(..., unit)
+
+} // namespace dtl::bench
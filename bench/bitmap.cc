@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include "bitmap.hh"
+#include "bench.hh"
+
+using namespace dtl;
+
+// ID allocation over millions of IDs: fill the space, free a random fraction of it, then time allocating the
+// freed IDs back, against a std::vector<bool> searched linearly from the last allocation (the usual next-fit
+// loop). The sparser the free IDs, the longer the linear search.
+
+namespace {
+
+    constexpr std::size_t ids = std::size_t(1) << 22;
+
+    std::vector<std::size_t>
+    victims(
+        std::size_t one_in
+        ) {
+
+        std::vector<std::size_t> chosen;
+        std::mt19937_64 rng(1);
+        for (std::size_t i = 0; i < ids; ++i) {
+            if (rng() % one_in == 0) chosen.push_back(i);
+        }
+        std::shuffle(chosen.begin(), chosen.end(), rng);
+        return chosen;
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    for (std::size_t one_in : { 10, 1000 }) {
+        const auto freed = victims(one_in);
+        const auto n = freed.size();
+        char label[32];
+        std::snprintf(label, sizeof(label), "1 in %-4zu free  ", one_in);
+        const std::string prefix = label;
+
+        {
+            std::vector<bool> used(ids, true);
+            std::size_t cursor = 0;
+            bench::report((prefix + "vector<bool> next-fit  allocate").c_str(), bench::measure(n, [&] {
+                for (auto i : freed) used[i] = false;
+                for (std::size_t k = 0; k < n; ++k) {
+                    while (used[cursor]) cursor = (cursor + 1 == ids) ? 0 : cursor + 1;
+                    used[cursor] = true;
+                }
+            }));
+        }
+
+        {
+            bitmap::hierarchical h(ids);
+            std::vector<std::size_t> out(ids);
+            h.allocate(ids, out.data());
+            bench::report((prefix + "hierarchical           allocate").c_str(), bench::measure(n, [&] {
+                for (auto i : freed) h.release(i);
+                for (std::size_t k = 0; k < n; ++k) bench::keep(h.allocate());
+            }));
+            bench::report((prefix + "hierarchical           allocate(64)").c_str(), bench::measure(n, [&] {
+                for (auto i : freed) h.release(i);
+                for (std::size_t k = 0; k < n; k += 64) h.allocate(std::min<std::size_t>(64, n - k), out.data());
+            }));
+        }
+
+        {
+            bitmap::atomic a(ids);
+            std::vector<std::size_t> out(ids);
+            a.allocate(ids, out.data());
+            bench::report((prefix + "atomic                 allocate").c_str(), bench::measure(n, [&] {
+                for (auto i : freed) a.release(i);
+                for (std::size_t k = 0; k < n; ++k) bench::keep(a.allocate());
+            }));
+            bench::report((prefix + "atomic                 allocate(64)").c_str(), bench::measure(n, [&] {
+                for (auto i : freed) a.release(i);
+                for (std::size_t k = 0; k < n; k += 64) a.allocate(std::min<std::size_t>(64, n - k), out.data());
+            }));
+        }
+    }
+
+}
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "bench.hh"
+#include "cache.hh"
+
+using namespace dtl;
+
+// Zipf-distributed lookups over a million keys with a 10,000-entry cache, each miss followed by an insert: hit
+// ratio, then the cost per lookup from one and from eight threads, for cache::sharded and a mutex-protected LRU
+// (std::list plus std::unordered_map).
+
+namespace {
+
+    class zipf {
+
+        std::vector<double> cdf;
+
+    public:
+
+        zipf(
+            std::size_t n,
+            double s
+            ) : cdf(n) {
+
+            double sum = 0;
+            for (std::size_t i = 0; i < n; ++i) cdf[i] = sum += 1 / std::pow(double(i + 1), s);
+            for (auto & c : cdf) c /= sum;
+
+        }
+
+        template<typename Random>
+        std::uint64_t
+        operator()(
+            Random & rng
+            ) {
+
+            auto u = std::uniform_real_distribution<>(0, 1)(rng);
+            return static_cast<std::uint64_t>(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+
+        }
+
+    }; // class zipf
+
+    class lru {
+
+        std::mutex lock;
+        std::size_t capacity;
+        std::list<std::pair<std::uint64_t, std::uint64_t>> order;
+        std::unordered_map<std::uint64_t, decltype(order)::iterator> index;
+
+    public:
+
+        explicit lru(std::size_t capacity) : capacity(capacity) {}
+
+        bool
+        find(
+            std::uint64_t key
+            ) {
+
+            std::lock_guard<std::mutex> guard(lock);
+            auto at = index.find(key);
+            if (at == index.end()) return false;
+            order.splice(order.begin(), order, at->second);
+            return true;
+
+        }
+
+        void
+        insert(
+            std::uint64_t key,
+            std::uint64_t value
+            ) {
+
+            std::lock_guard<std::mutex> guard(lock);
+            if (index.count(key)) return;
+            order.emplace_front(key, value);
+            index[key] = order.begin();
+            if (order.size() > capacity) {
+                index.erase(order.back().first);
+                order.pop_back();
+            }
+
+        }
+
+    }; // class lru
+
+    template<typename Cache>
+    double
+    hit_ratio(
+        Cache & cache,
+        const std::vector<std::uint64_t> & trace
+        ) {
+
+        std::size_t hits = 0;
+        for (auto k : trace) {
+            if (cache.find(k)) ++hits; else cache.insert(k, k);
+        }
+        return double(hits) / double(trace.size());
+
+    }
+
+    template<typename Cache>
+    double
+    threaded(
+        Cache & cache,
+        const std::vector<std::uint64_t> & trace,
+        unsigned threads
+        ) {
+
+        return bench::measure(trace.size(), [&] {
+            std::vector<std::thread> workers;
+            for (unsigned t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t] {
+                    for (auto i = t; i < trace.size(); i += threads) {
+                        if (!cache.find(trace[i])) cache.insert(trace[i], trace[i]);
+                    }
+                });
+            }
+            for (auto & w : workers) w.join();
+        }, 3);
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    constexpr std::size_t capacity = 10000;
+
+    for (double s : { 0.8, 1.0, 1.2 }) {
+        zipf z(1000000, s);
+        std::mt19937_64 rng(5);
+        std::vector<std::uint64_t> trace(bench::scaled(1 << 21));
+        for (auto & k : trace) k = z(rng) * 0x9e3779b97f4a7c15ull;     // scatter popular keys
+
+        cache::sharded<std::uint64_t, std::uint64_t> sharded(capacity, 16);
+        lru reference(capacity);
+        std::printf("zipf %.1f  hit ratio  sharded %.3f  lru %.3f\n", s, hit_ratio(sharded, trace),
+                    hit_ratio(reference, trace));
+
+        for (unsigned threads : { 1, 8 }) {
+            char label[64];
+            cache::sharded<std::uint64_t, std::uint64_t> c(capacity);
+            lru l(capacity);
+            std::snprintf(label, sizeof(label), "zipf %.1f  %u thread(s)  sharded", s, threads);
+            bench::report(label, threaded(c, trace, threads));
+            std::snprintf(label, sizeof(label), "zipf %.1f  %u thread(s)  lru", s, threads);
+            bench::report(label, threaded(l, trace, threads));
+        }
+    }
+
+}
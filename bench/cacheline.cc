@@ -0,0 +1,56 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "cacheline.hh"
+#include "bench.hh"
+
+using namespace dtl;
+
+// Threads incrementing their own counter, with the counters packed together (false sharing), each on its own
+// line(s) through padded<T>, and per CPU. The difference grows with the number of cores the threads run on.
+
+namespace {
+
+    template<typename Counter>
+    double
+    run(
+        unsigned threads,
+        std::size_t increments,
+        Counter && counter
+        ) {
+
+        return bench::measure(threads * increments, [&] {
+            std::vector<std::thread> pool;
+            for (unsigned t = 0; t < threads; ++t) {
+                pool.emplace_back([&, t] {
+                    for (std::size_t i = 0; i < increments; ++i) counter(t).fetch_add(1, std::memory_order_relaxed);
+                });
+            }
+            for (auto & p : pool) p.join();
+        }, 3);
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    const auto increments = bench::scaled(10000000);
+    const auto cores = std::max(2u, std::thread::hardware_concurrency());
+    char name[64];
+
+    for (unsigned threads = 1; threads <= cores; threads *= 2) {
+        std::atomic<long> packed[64] = {};
+        cacheline::padded<std::atomic<long>> padded[64];
+        cacheline::per_cpu<std::atomic<long>> per_cpu;
+
+        std::snprintf(name, sizeof(name), "%2u threads  packed", threads);
+        bench::report(name, run(threads, increments, [&](unsigned t) -> auto & { return packed[t]; }));
+        std::snprintf(name, sizeof(name), "%2u threads  padded", threads);
+        bench::report(name, run(threads, increments, [&](unsigned t) -> auto & { return *padded[t]; }));
+        std::snprintf(name, sizeof(name), "%2u threads  per_cpu", threads);
+        bench::report(name, run(threads, increments, [&](unsigned) -> auto & { return per_cpu.local(); }));
+    }
+
+}
@@ -0,0 +1,92 @@
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "bench.hh"
+#include "dns.hh"
+
+using namespace dtl;
+
+// Blocklist lookups against a million listed domains, half of the queries hitting a listed suffix three labels up
+// and half missing: dns::suffixes against std::unordered_set<std::string> probed once per suffix, the obvious
+// implementation. Then whole query packets, parsed and looked up.
+
+namespace {
+
+    std::string
+    lower(
+        std::string_view s
+        ) {
+
+        std::string out(s);
+        for (auto & c : out) c = static_cast<char>((c >= 'A' && c <= 'Z') ? c + 32 : c);
+        return out;
+
+    }
+
+    // Every suffix of the name, from the whole name down to the last label.
+    bool
+    listed(
+        const std::unordered_set<std::string> & set,
+        std::string_view dotted
+        ) {
+
+        for (;;) {
+            if (set.count(lower(dotted))) return true;
+            auto dot = dotted.find('.');
+            if (dot == std::string_view::npos) return false;
+            dotted.remove_prefix(dot + 1);
+        }
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    std::mt19937_64 rng(1);
+    std::vector<std::string> domains;
+    for (int i = 0; i < 1000000; ++i) {
+        domains.push_back("d" + std::to_string(rng() % 100000000) + (i % 3 ? ".com" : ".ads.example.net"));
+    }
+    std::vector<std::pair<std::string_view, std::uint32_t>> entries;
+    for (std::size_t i = 0; i < domains.size(); ++i) entries.push_back({ domains[i], std::uint32_t(i) });
+    const auto set = dns::suffixes::compile(entries);
+    const std::unordered_set<std::string> strings(domains.begin(), domains.end());
+
+    const auto count = bench::scaled(1 << 20);
+    std::vector<std::string> queries;
+    for (std::size_t i = 0; i < count; ++i) {
+        queries.push_back(i % 2 ? "www.a.b." + domains[rng() % domains.size()]
+                                : "www.cdn" + std::to_string(rng()) + ".example.com");
+    }
+
+    bench::report("dns::suffixes               query", bench::measure(count, [&] {
+        for (auto & q : queries) bench::keep(set.find(q));
+    }));
+    bench::report("unordered_set<string>       query", bench::measure(count, [&] {
+        for (auto & q : queries) bench::keep(listed(strings, q));
+    }));
+
+    std::vector<std::vector<std::uint8_t>> packets;
+    for (std::size_t i = 0; i < count; ++i) {
+        std::vector<std::uint8_t> p = { 1, 2, 1, 0, 0, 1, 0, 0, 0, 0, 0, 0 };
+        auto & q = queries[i];
+        for (std::size_t at = 0; at < q.size();) {
+            auto dot = std::min(q.find('.', at), q.size());
+            p.push_back(static_cast<std::uint8_t>(dot - at));
+            p.insert(p.end(), q.begin() + at, q.begin() + dot);
+            at = dot + 1;
+        }
+        p.insert(p.end(), { 0, 0, 1, 0, 1 });
+        packets.push_back(std::move(p));
+    }
+    bench::report("message::parse + suffixes   packet", bench::measure(count, [&] {
+        for (auto & p : packets) {
+            auto m = dns::message::parse(p.data(), p.size());
+            m->questions([&](const dns::question & q) { bench::keep(set.find(q.name)); });
+        }
+    }));
+
+}
@@ -0,0 +1,94 @@
+#include <cstdio>
+#include <random>
+#include <string>
+#include "bench.hh"
+#include "encoding.hh"
+
+using namespace dtl;
+
+// Encoding and validation throughput over 1 MB buffers, in GB/s of binary input (or of text for UTF-8): base64
+// and hex both ways, and UTF-8 validation of ASCII and of mixed text, against byte-at-a-time loops (snprintf hex
+// and a straightforward UTF-8 decoder). Build with DTL_SIMD_SCALAR to compare with the library's scalar loops.
+
+namespace {
+
+    bool
+    naive_utf8(
+        const std::string & s
+        ) {
+
+        for (std::size_t i = 0; i < s.size();) {
+            unsigned c = std::uint8_t(s[i]), cp;
+            std::size_t n;
+            if (c < 0x80) {
+                ++i;
+                continue;
+            } else if ((c & 0xe0) == 0xc0) {
+                n = 2;
+                cp = c & 0x1f;
+            } else if ((c & 0xf0) == 0xe0) {
+                n = 3;
+                cp = c & 0x0f;
+            } else if ((c & 0xf8) == 0xf0) {
+                n = 4;
+                cp = c & 0x07;
+            } else {
+                return false;
+            }
+            if (i + n > s.size()) return false;
+            for (std::size_t k = 1; k < n; ++k) {
+                if ((std::uint8_t(s[i + k]) & 0xc0) != 0x80) return false;
+                cp = cp << 6 | (std::uint8_t(s[i + k]) & 0x3f);
+            }
+            if ((n == 2 && cp < 0x80) || (n == 3 && cp < 0x800) || (n == 4 && cp < 0x10000)) return false;
+            if (cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff)) return false;
+            i += n;
+        }
+        return true;
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    constexpr std::size_t size = 1 << 20;
+    const auto rounds = bench::scaled(64);
+    std::mt19937_64 rng(1);
+    std::string data(size, 0);
+    for (auto & c : data) c = static_cast<char>(rng());
+    std::string text(encoding::base64::encoded_size(size), 0), back(size, 0), hex(2 * size, 0);
+
+    bench::report("base64 encode", bench::measure(rounds, [&] {
+        for (std::size_t r = 0; r < rounds; ++r) bench::keep(encoding::base64::encode(data.data(), size, text.data()));
+    }), size);
+    bench::report("base64 decode", bench::measure(rounds, [&] {
+        for (std::size_t r = 0; r < rounds; ++r) bench::keep(*encoding::base64::decode(text.data(), text.size(), back.data()));
+    }), size);
+    bench::report("hex encode", bench::measure(rounds, [&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            encoding::hex::encode(data.data(), size, hex.data());
+            bench::keep(hex[0]);
+        }
+    }), size);
+    bench::report("hex decode", bench::measure(rounds, [&] {
+        for (std::size_t r = 0; r < rounds; ++r) bench::keep(encoding::hex::decode(hex.data(), hex.size(), back.data()));
+    }), size);
+    bench::report("snprintf hex encode", bench::measure(1, [&] {
+        for (std::size_t i = 0; i < size; ++i) std::snprintf(&hex[2 * i], 3, "%02x", std::uint8_t(data[i]));
+    }, 3), size);
+
+    std::string ascii(size, 'a'), mixed;
+    while (mixed.size() < size) mixed += "h\xc3\xa9llo w\xe2\x82\xac rld \xf0\x9f\x98\x80 ";
+    bench::report("utf8::valid ascii", bench::measure(rounds, [&] {
+        for (std::size_t r = 0; r < rounds; ++r) bench::keep(encoding::utf8::valid(ascii));
+    }), ascii.size());
+    bench::report("utf8::valid mixed", bench::measure(rounds, [&] {
+        for (std::size_t r = 0; r < rounds; ++r) bench::keep(encoding::utf8::valid(mixed));
+    }), mixed.size());
+    bench::report("byte-at-a-time utf8 mixed", bench::measure(rounds, [&] {
+        for (std::size_t r = 0; r < rounds; ++r) bench::keep(naive_utf8(mixed));
+    }), mixed.size());
+
+}
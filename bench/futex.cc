@@ -0,0 +1,93 @@
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "bench.hh"
+#include "futex.hh"
+
+using namespace dtl;
+
+// Wakeup latency: two threads pass a token back and forth, each sleeping until the other hands it over, so a
+// round trip is two wakeups. futex::event and raw futex wait/wake against std::condition_variable under a mutex.
+// Then the notifier's cost when nobody waits, which is what a producer pays on every push.
+
+namespace {
+
+    template<typename Pass, typename Await>
+    void
+    ping_pong(
+        std::size_t rounds,
+        Pass && pass,
+        Await && await
+        ) {
+
+        std::thread other([&] {
+            for (std::uint32_t i = 1; i <= rounds; ++i) {
+                await(0, 2 * i - 1);
+                pass(1, 2 * i);
+            }
+        });
+        for (std::uint32_t i = 1; i <= rounds; ++i) {
+            pass(0, 2 * i - 1);
+            await(1, 2 * i);
+        }
+        other.join();
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    const auto rounds = bench::scaled(1 << 15);
+
+    futex::event events[2];
+    std::atomic<std::uint32_t> tokens[2] = { {0}, {0} };
+    bench::report("futex::event          round trip", bench::measure(rounds, [&] {
+        tokens[0] = tokens[1] = 0;
+        ping_pong(rounds, [&](int side, std::uint32_t value) {
+            tokens[side].store(value);
+            events[side].notify_one();
+        }, [&](int side, std::uint32_t value) {
+            events[side].await([&] { return tokens[side].load() >= value; });
+        });
+    }, 3));
+
+    futex::word words[2] = { {0}, {0} };
+    bench::report("futex::wait/wake      round trip", bench::measure(rounds, [&] {
+        words[0] = words[1] = 0;
+        ping_pong(rounds, [&](int side, std::uint32_t value) {
+            words[side].store(value);
+            futex::wake(words[side], 1);
+        }, [&](int side, std::uint32_t value) {
+            for (std::uint32_t seen; (seen = words[side].load()) < value;) futex::wait(words[side], seen);
+        });
+    }, 3));
+
+    std::mutex mutexes[2];
+    std::condition_variable conditions[2];
+    std::uint32_t values[2] = { 0, 0 };
+    bench::report("std::condition_variable round trip", bench::measure(rounds, [&] {
+        values[0] = values[1] = 0;
+        ping_pong(rounds, [&](int side, std::uint32_t value) {
+            {
+                std::lock_guard<std::mutex> g(mutexes[side]);
+                values[side] = value;
+            }
+            conditions[side].notify_one();
+        }, [&](int side, std::uint32_t value) {
+            std::unique_lock<std::mutex> g(mutexes[side]);
+            conditions[side].wait(g, [&] { return values[side] >= value; });
+        });
+    }, 3));
+
+    const auto notifies = bench::scaled(1 << 24);
+    bench::report("futex::event          notify, no waiter", bench::measure(notifies, [&] {
+        for (std::size_t i = 0; i < notifies; ++i) events[0].notify_one();
+    }));
+    bench::report("std::condition_variable notify, no waiter", bench::measure(notifies, [&] {
+        for (std::size_t i = 0; i < notifies; ++i) conditions[0].notify_one();
+    }));
+
+}
@@ -0,0 +1,110 @@
+#include <functional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "bench.hh"
+#include "hash.hh"
+#include "hashtable.hh"
+
+using namespace dtl;
+
+// Speed against safety. First hashes/s for messages of 8 to 1500 bytes (a u64 key, a flow tuple, a domain name,
+// a cache line, a URL, a packet) under SipHash-2-4, SipHash-1-3 and the AES hash, one at a time and batched, with
+// the unkeyed std::hash of a string_view for reference. Then what the keyed hashes buy: inserts/s into a
+// hashtable::table of keys crafted by inverting the tables' mix() so that std::hash puts all of them in one chain,
+// against the same keys under sip<> and aes<>. Build with DTL_SIMD_SCALAR for the scalar batches.
+
+namespace {
+
+    // Inverse of hash::mix(), which is all an attacker needs against an unkeyed hash.
+    std::uint64_t
+    unmix(
+        std::uint64_t h
+        ) {
+
+        auto xorshift = [](std::uint64_t x) { return x ^ (x >> 33); };
+        h = xorshift(h);
+        h *= 0x9cb4b2f8129337dbull;
+        h = xorshift(h);
+        h *= 0x4f74430c22a54005ull;
+        return xorshift(h);
+
+    }
+
+    template<typename Hash>
+    void
+    flood(
+        const char * name,
+        const std::vector<std::uint64_t> & keys
+        ) {
+
+        bench::report(name, bench::measure(keys.size(), [&] {
+            hashtable::table<std::uint64_t, std::uint64_t, Hash> table;
+            for (std::size_t i = 0; i < keys.size(); ++i) table.insert(keys[i], i);
+            bench::keep(table.find(keys[0]));
+        }, 3));
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    constexpr std::size_t batch = 64;
+    const auto rounds = bench::scaled(4096);
+    std::mt19937_64 rng(1);
+    const hash::key k{ rng(), rng() };
+
+    for (std::size_t size : { 8, 13, 37, 64, 256, 1500 }) {
+        std::vector<std::string> messages(batch);
+        std::vector<const void *> pointers;
+        for (auto & m : messages) {
+            for (std::size_t i = 0; i < size; ++i) m += static_cast<char>(rng());
+            pointers.push_back(m.data());
+        }
+        std::vector<std::uint64_t> out(batch);
+        const auto items = rounds * batch;
+        auto label = [&](const char * name) { return std::string(name) + " " + std::to_string(size) + " B"; };
+
+        auto single = [&](const char * name, auto && h) {
+            bench::report(label(name).c_str(), bench::measure(items, [&] {
+                std::uint64_t sum = 0;
+                for (std::size_t r = 0; r < rounds; ++r) {
+                    for (auto * p : pointers) sum += h(p);
+                }
+                bench::keep(sum);
+            }));
+        };
+        auto batched = [&](const char * name, auto && h) {
+            bench::report(label(name).c_str(), bench::measure(items, [&] {
+                for (std::size_t r = 0; r < rounds; ++r) {
+                    h();
+                    bench::keep(out[r % batch]);
+                }
+            }));
+        };
+
+        single("siphash24        ", [&](const void * p) { return hash::siphash24(k, p, size); });
+        single("siphash13        ", [&](const void * p) { return hash::siphash13(k, p, size); });
+        single("aeshash          ", [&](const void * p) { return hash::aeshash(k, p, size); });
+        single("std::hash        ", [&](const void * p) {
+            return std::hash<std::string_view>{}(std::string_view(static_cast<const char *>(p), size));
+        });
+        batched("siphash24 batched", [&] { hash::siphash24(k, pointers.data(), size, out.data(), batch); });
+        batched("siphash13 batched", [&] { hash::siphash13(k, pointers.data(), size, out.data(), batch); });
+        batched("aeshash batched  ", [&] { hash::aeshash(k, pointers.data(), size, out.data(), batch); });
+    }
+
+    std::vector<std::uint64_t> crafted, random;
+    for (std::uint64_t i = 0; i < bench::scaled(1 << 14); ++i) {
+        crafted.push_back(unmix(i << 16));
+        random.push_back(rng());
+    }
+    flood<std::hash<std::uint64_t>>("std::hash  insert random ", random);
+    flood<std::hash<std::uint64_t>>("std::hash  insert crafted", crafted);
+    flood<hash::sip<std::uint64_t>>("sip<>      insert crafted", crafted);
+    flood<hash::aes<std::uint64_t>>("aes<>      insert crafted", crafted);
+
+}
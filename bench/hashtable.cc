@@ -0,0 +1,59 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+#include "bench.hh"
+#include "hashtable.hh"
+
+using namespace dtl;
+
+// Insert latency percentiles while a table grows from 1024 buckets to millions of entries: hashtable::table
+// spreads each resize over the following writes, std::unordered_map rehashes everything in the insert that
+// crosses its load factor. Then lookup cost in the grown tables.
+
+namespace {
+
+    template<typename Insert>
+    void
+    percentiles(
+        const char * name,
+        std::size_t n,
+        Insert && insert
+        ) {
+
+        std::vector<double> ns(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            insert(i);
+            ns[i] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        }
+        std::sort(ns.begin(), ns.end());
+        std::printf("%-28s insert ns  p50 %6.0f  p99 %6.0f  p99.9 %8.0f  max %10.0f\n", name, ns[n / 2],
+                    ns[n * 99 / 100], ns[n * 999 / 1000], ns[n - 1]);
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    const auto n = bench::scaled(1 << 22);
+    auto key = [](std::size_t i) { return std::uint64_t(i) * 0x9e3779b97f4a7c15ull; };
+
+    hashtable::table<std::uint64_t, std::uint64_t> table(1024);
+    std::unordered_map<std::uint64_t, std::uint64_t> map;
+    map.reserve(1024);
+
+    percentiles("hashtable::table", n, [&](std::size_t i) { table.insert(key(i), i); });
+    percentiles("std::unordered_map", n, [&](std::size_t i) { map.emplace(key(i), i); });
+
+    bench::report("hashtable::table    find", bench::measure(n, [&] {
+        for (std::size_t i = 0; i < n; ++i) bench::keep(*table.find(key(i)));
+    }));
+    bench::report("std::unordered_map  find", bench::measure(n, [&] {
+        for (std::size_t i = 0; i < n; ++i) bench::keep(map.find(key(i))->second);
+    }));
+
+}
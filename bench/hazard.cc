@@ -0,0 +1,114 @@
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include "bench.hh"
+#include "hazard.hh"
+
+using namespace dtl;
+
+// Read-side cost of dereferencing a shared pointer safely: hazard::domain's protect/clear against a std::mutex,
+// a std::shared_mutex, and a minimal epoch scheme (announce the global epoch, full fence, clear on exit) as found
+// in most epoch-based reclamation. Then the writer's cost per replaced node, retire and amortized scans included,
+// with three readers protecting the current node.
+
+namespace {
+
+    struct node {
+
+        std::uint64_t value;
+
+    }; // struct node
+
+    // The read side of epoch-based reclamation: the fence keeps the announcement ahead of the pointer load.
+    struct epochs {
+
+        std::atomic<std::uint64_t> global{1};
+        alignas(64) std::atomic<std::uint64_t> announced{0};
+
+        inline void
+        enter() noexcept {
+
+            announced.store(global.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        }
+
+        inline void
+        leave() noexcept {
+
+            announced.store(0, std::memory_order_release);
+
+        }
+
+    }; // struct epochs
+
+} // namespace
+
+int
+main() {
+
+    const auto reads = bench::scaled(1 << 24);
+    std::atomic<node *> current{new node{1}};
+
+    hazard::domain<> domain;
+    {
+        auto reader = domain.enroll();
+        bench::report("hazard::domain  protect + clear", bench::measure(reads, [&] {
+            for (std::size_t i = 0; i < reads; ++i) {
+                bench::keep(reader.protect(0, current)->value);
+                reader.clear(0);
+            }
+        }));
+    }
+
+    epochs e;
+    bench::report("epoch           enter + leave", bench::measure(reads, [&] {
+        for (std::size_t i = 0; i < reads; ++i) {
+            e.enter();
+            bench::keep(current.load(std::memory_order_acquire)->value);
+            e.leave();
+        }
+    }));
+
+    std::mutex mutex;
+    bench::report("std::mutex      lock + unlock", bench::measure(reads, [&] {
+        for (std::size_t i = 0; i < reads; ++i) {
+            std::lock_guard<std::mutex> g(mutex);
+            bench::keep(current.load(std::memory_order_relaxed)->value);
+        }
+    }));
+
+    std::shared_mutex shared;
+    bench::report("std::shared_mutex lock_shared", bench::measure(reads, [&] {
+        for (std::size_t i = 0; i < reads; ++i) {
+            std::shared_lock<std::shared_mutex> g(shared);
+            bench::keep(current.load(std::memory_order_relaxed)->value);
+        }
+    }));
+
+    const auto writes = bench::scaled(1 << 20);
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&] {
+            auto reader = domain.enroll();
+            for (std::size_t n = 1; !stop.load(std::memory_order_relaxed); ++n) {
+                bench::keep(reader.protect(0, current)->value);
+                reader.clear(0);
+                if (n % 256 == 0) std::this_thread::yield();
+            }
+        });
+    }
+    {
+        auto writer = domain.enroll();
+        bench::report("hazard::domain  replace + retire", bench::measure(writes, [&] {
+            for (std::size_t i = 0; i < writes; ++i) writer.retire(current.exchange(new node{i}));
+        }));
+        stop = true;
+        for (auto & r : readers) r.join();
+    }
+    delete current.load();
+
+}
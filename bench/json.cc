@@ -0,0 +1,91 @@
+#include <random>
+#include <string>
+#include "bench.hh"
+#include "json.hh"
+
+using namespace dtl;
+
+// Parse throughput in GB/s over two generated documents of about 32 MB each: telemetry records (short keys,
+// numbers, nesting) and log lines (long strings with escapes), then parsing plus a walk that decodes every
+// number. Build with DTL_SIMD_SCALAR to compare stage 1 with the scalar classifier.
+
+namespace {
+
+    std::string
+    telemetry(
+        std::size_t bytes
+        ) {
+
+        std::mt19937_64 rng(1);
+        std::string text = "[";
+        while (text.size() < bytes) {
+            if (text.size() > 1) text += ",";
+            text += "{\"host\":\"h" + std::to_string(rng() % 1000) + "\",\"ts\":" + std::to_string(1700000000000 + rng() % 1000000)
+                    + ",\"cpu\":[" + std::to_string(rng() % 100) + "." + std::to_string(rng() % 100) + ","
+                    + std::to_string(rng() % 100) + ".5],\"mem\":{\"used\":" + std::to_string(rng() % (1ull << 34))
+                    + ",\"free\":" + std::to_string(rng() % (1ull << 34)) + "},\"up\":true,\"tag\":null}";
+        }
+        return text + "]";
+
+    }
+
+    std::string
+    logs(
+        std::size_t bytes
+        ) {
+
+        std::mt19937_64 rng(2);
+        std::string text = "[";
+        while (text.size() < bytes) {
+            if (text.size() > 1) text += ",";
+            text += "{\"level\":\"info\",\"message\":\"request \\\"GET /api/v1/items/" + std::to_string(rng() % 100000)
+                    + "\\\" completed in " + std::to_string(rng() % 1000) + " ms for user agent Mozilla/5.0 (X11; Linux "
+                    "x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\\n\",\"path\":"
+                    "\"C:\\\\logs\\\\app.log\"}";
+        }
+        return text + "]";
+
+    }
+
+    std::uint64_t
+    walk(
+        json::value v
+        ) {
+
+        switch (v.type()) {
+        case json::kind::number: return static_cast<std::uint64_t>(*v.get_double());
+        case json::kind::array: {
+            std::uint64_t sum = 0;
+            v.for_each([&](json::value x) { sum += walk(x); });
+            return sum;
+        }
+        case json::kind::object: {
+            std::uint64_t sum = 0;
+            v.for_each_member([&](std::string_view, json::value x) { sum += walk(x); });
+            return sum;
+        }
+        default: return 1;
+        }
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    const auto bytes = bench::scaled(32 << 20);
+    const auto records = telemetry(bytes), lines = logs(bytes);
+
+    bench::report("document::parse  telemetry", bench::measure(1, [&] {
+        bench::keep(json::document::parse(records).size());
+    }), records.size());
+    bench::report("document::parse  logs", bench::measure(1, [&] {
+        bench::keep(json::document::parse(lines).size());
+    }), lines.size());
+    bench::report("parse + walk     telemetry", bench::measure(1, [&] {
+        auto d = json::document::parse(records);
+        bench::keep(walk(d.root()));
+    }), records.size());
+
+}
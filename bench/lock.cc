@@ -0,0 +1,106 @@
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench.hh"
+#include "lock.hh"
+
+using namespace dtl;
+
+// Cost per acquisition with 1 to 64 threads hammering one lock around a short critical section (a few dependent
+// writes to a shared line): std::mutex against lock::ticket and lock::mcs, then a 95% read mix through
+// std::shared_mutex against lock::rwlock. Threads beyond the core count measure behaviour under preemption, where
+// FIFO handoff to a descheduled waiter is the hazard.
+
+namespace {
+
+    struct alignas(64) shared_state {
+
+        std::uint64_t counter = 0;
+        std::uint64_t check = 0;
+
+    }; // struct shared_state
+
+    // Nanoseconds per acquisition, all threads together, for `total` acquisitions split evenly among `threads`.
+    template<typename Acquire>
+    double
+    contend(
+        unsigned threads,
+        std::size_t total,
+        Acquire && acquire
+        ) {
+
+        return bench::measure(total, [&] {
+            std::atomic<unsigned> ready{0};
+            std::vector<std::thread> running;
+            for (unsigned t = 0; t < threads; ++t) {
+                running.emplace_back([&, t] {
+                    ready.fetch_add(1);
+                    while (ready.load() < threads) std::this_thread::yield();
+                    for (std::size_t i = t; i < total; i += threads) acquire(i);
+                });
+            }
+            for (auto & r : running) r.join();
+        }, 3);
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    const auto total = bench::scaled(1 << 18);
+    shared_state state;
+    auto critical = [&] {
+        state.counter = state.counter + 1;
+        state.check = state.counter * 3;
+    };
+
+    std::mutex mutex;
+    lock::ticket ticket;
+    lock::mcs mcs;
+    std::shared_mutex shared;
+    lock::rwlock rw;
+
+    for (unsigned threads = 1; threads <= 64; threads *= 2) {
+        auto label = [&](const char * name) {
+            return std::string(name) + " " + std::to_string(threads) + " threads";
+        };
+        bench::report(label("std::mutex     ").c_str(), contend(threads, total, [&](std::size_t) {
+            std::lock_guard<std::mutex> g(mutex);
+            critical();
+        }));
+        bench::report(label("lock::ticket   ").c_str(), contend(threads, total, [&](std::size_t) {
+            std::lock_guard<lock::ticket> g(ticket);
+            critical();
+        }));
+        bench::report(label("lock::mcs      ").c_str(), contend(threads, total, [&](std::size_t) {
+            lock::mcs::guard g(mcs);
+            critical();
+        }));
+        bench::report(label("shared_mutex 95% read").c_str(), contend(threads, total, [&](std::size_t i) {
+            if (i % 20 == 0) {
+                std::lock_guard<std::shared_mutex> g(shared);
+                critical();
+            } else {
+                std::shared_lock<std::shared_mutex> g(shared);
+                bench::keep(state.check);
+            }
+        }));
+        bench::report(label("lock::rwlock 95% read").c_str(), contend(threads, total, [&](std::size_t i) {
+            if (i % 20 == 0) {
+                std::lock_guard<lock::rwlock> g(rw);
+                critical();
+            } else {
+                std::shared_lock<lock::rwlock> g(rw);
+                bench::keep(state.check);
+            }
+        }));
+    }
+    bench::keep(state.check);
+
+}
@@ -0,0 +1,97 @@
+#include <cstring>
+#include <vector>
+#include "memory.hh"
+#include "bench.hh"
+
+using namespace dtl;
+
+// memory::copy/equal/zero against libc across packet sizes and alignments, then bulk copies into a mapped region
+// (where memory::stream switches to non-temporal stores).
+
+namespace {
+
+    constexpr std::size_t slots = 1024;
+
+    // Cycles through `slots` buffers so that the working set spans more than L1, as packet buffers do.
+    template<typename Function>
+    double
+    run(
+        std::size_t size,
+        std::size_t alignment,
+        Function && function
+        ) {
+
+        static std::vector<std::uint8_t> source(slots * 2048 + 64), target(slots * 2048 + 64);
+        auto rounds = bench::scaled(200);
+        return bench::measure(rounds * slots, [&] {
+            for (std::size_t r = 0; r < rounds; ++r) {
+                for (std::size_t s = 0; s < slots; ++s) {
+                    function(&target[s * 2048 + alignment], &source[s * 2048 + alignment], size);
+                }
+            }
+        });
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    // Opaque to the optimizer, so that libc calls are not expanded inline for a known size.
+    volatile std::size_t sizes[] = { 64, 128, 256, 512, 1024, 1500 };
+    char name[64];
+
+    for (std::size_t alignment : { 0, 1, 33 }) {
+        for (std::size_t size : sizes) {
+            std::snprintf(name, sizeof(name), "copy     %4zu B +%-2zu  libc", size, alignment);
+            bench::report(name, run(size, alignment, [](void * d, const void * s, std::size_t n) {
+                std::memcpy(d, s, n);
+            }), size);
+            std::snprintf(name, sizeof(name), "copy     %4zu B +%-2zu  dtl", size, alignment);
+            bench::report(name, run(size, alignment, [](void * d, const void * s, std::size_t n) {
+                memory::copy(d, s, n);
+            }), size);
+        }
+    }
+
+    for (std::size_t size : sizes) {
+        std::snprintf(name, sizeof(name), "equal    %4zu B      libc", size);
+        bench::report(name, run(size, 0, [](void * d, const void * s, std::size_t n) {
+            bench::keep(std::memcmp(d, s, n) == 0);
+        }), size);
+        std::snprintf(name, sizeof(name), "equal    %4zu B      dtl", size);
+        bench::report(name, run(size, 0, [](void * d, const void * s, std::size_t n) {
+            bench::keep(memory::equal(d, s, n));
+        }), size);
+        std::snprintf(name, sizeof(name), "zero     %4zu B      libc", size);
+        bench::report(name, run(size, 0, [](void * d, const void *, std::size_t n) {
+            std::memset(d, 0, n);
+        }), size);
+        std::snprintf(name, sizeof(name), "zero     %4zu B      dtl", size);
+        bench::report(name, run(size, 0, [](void * d, const void *, std::size_t n) {
+            memory::zero(d, n);
+        }), size);
+    }
+
+    // Bulk: 64 MiB from a heap buffer into an anonymous mapping, 1 MiB at a time.
+    constexpr std::size_t bulk = 64 << 20, chunk = 1 << 20;
+    std::vector<std::uint8_t> source(bulk, 1);
+    raii::mmap region(bulk);
+    auto * target = static_cast<std::uint8_t *>(region.get());
+    std::memset(target, 0, bulk);
+
+    bench::report("bulk copy 1 MiB         libc", bench::measure(bulk / chunk, [&] {
+        for (std::size_t at = 0; at < bulk; at += chunk) std::memcpy(target + at, &source[at], chunk);
+        bench::keep(target);
+    }), chunk);
+    bench::report("bulk copy 1 MiB         dtl copy", bench::measure(bulk / chunk, [&] {
+        for (std::size_t at = 0; at < bulk; at += chunk) memory::copy(target + at, &source[at], chunk);
+        bench::keep(target);
+    }), chunk);
+    bench::report("bulk copy 1 MiB         dtl stream", bench::measure(bulk / chunk, [&] {
+        for (std::size_t at = 0; at < bulk; at += chunk) memory::stream(region, at, &source[at], chunk);
+        bench::keep(target);
+    }), chunk);
+
+}
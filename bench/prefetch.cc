@@ -0,0 +1,110 @@
+#include <numeric>
+#include <random>
+#include <vector>
+#include "prefetch.hh"
+#include "bench.hh"
+
+using namespace dtl;
+
+// Batched lookups into tables several times larger than the last level cache, with and without the prefetch
+// drivers: a direct-indexed table (one dependent access per key) and chains of four dependent accesses per key.
+
+namespace {
+
+    struct table {
+
+        std::vector<std::uint64_t> slots;
+
+        void prefetch(std::uint64_t key) const { prefetch::read(&slots[key]); }
+        std::uint64_t find(std::uint64_t key) const { return slots[key]; }
+
+    };
+
+} // namespace
+
+int
+main() {
+
+    constexpr std::size_t entries = std::size_t(1) << 26;    // 512 MiB
+    constexpr std::size_t burst = 32, hops = 4;
+
+    std::mt19937_64 rng(1);
+    table t{ std::vector<std::uint64_t>(entries) };
+
+    // A single random cycle through every slot, so that chains never settle into cache.
+    std::vector<std::uint64_t> order(entries);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), rng);
+    for (std::size_t i = 0; i < entries; ++i) t.slots[order[i]] = order[(i + 1) % entries];
+    order = {};
+
+    const auto count = bench::scaled(std::size_t(1) << 22);
+    std::vector<std::uint64_t> keys(count), results(count);
+    for (auto & k : keys) k = rng() % entries;
+
+    bench::report("direct    naive", bench::measure(count, [&] {
+        for (std::size_t i = 0; i < count; ++i) results[i] = t.find(keys[i]);
+        bench::keep(results.data());
+    }));
+    bench::report("direct    lookup<16>", bench::measure(count, [&] {
+        prefetch::lookup<16>(t, keys.data(), count, results.data());
+        bench::keep(results.data());
+    }));
+    bench::report("direct    lookup<32>", bench::measure(count, [&] {
+        prefetch::lookup<32>(t, keys.data(), count, results.data());
+        bench::keep(results.data());
+    }));
+    bench::report("direct    pipeline<8>", bench::measure(count, [&] {
+        prefetch::pipeline<8>(count,
+            [&](std::size_t i) { t.prefetch(keys[i]); },
+            [&](std::size_t i) { results[i] = t.find(keys[i]); });
+        bench::keep(results.data());
+    }));
+
+    bench::report("chain x4  naive", bench::measure(count, [&] {
+        for (std::size_t i = 0; i < count; ++i) {
+            auto at = keys[i];
+            for (std::size_t h = 0; h < hops; ++h) at = t.slots[at];
+            results[i] = at;
+        }
+        bench::keep(results.data());
+    }));
+    bench::report("chain x4  group", bench::measure(count, [&] {
+        std::uint64_t at[burst];
+        for (std::size_t base = 0; base < count; base += burst) {
+            auto n = std::min(burst, count - base);
+            for (std::size_t i = 0; i < n; ++i) {
+                at[i] = keys[base + i];
+                t.prefetch(at[i]);
+            }
+            for (std::size_t h = 0; h < hops; ++h) {
+                for (std::size_t i = 0; i < n; ++i) {
+                    at[i] = t.slots[at[i]];
+                    t.prefetch(at[i]);
+                }
+            }
+            for (std::size_t i = 0; i < n; ++i) results[base + i] = at[i];
+        }
+        bench::keep(results.data());
+    }));
+
+    struct walk { std::size_t key; std::uint64_t at; std::size_t hops; };
+    bench::report("chain x4  amac<16>", bench::measure(count, [&] {
+        prefetch::amac<16, walk>(count,
+            [&](walk & w, std::size_t i) {
+                w = walk{ i, keys[i], 0 };
+                t.prefetch(w.at);
+            },
+            [&](walk & w) {
+                w.at = t.slots[w.at];
+                if (++w.hops == hops) {
+                    results[w.key] = w.at;
+                    return true;
+                }
+                t.prefetch(w.at);
+                return false;
+            });
+        bench::keep(results.data());
+    }));
+
+}
@@ -0,0 +1,103 @@
+#include <random>
+#include <vector>
+#include "bench.hh"
+#include "random.hh"
+
+using namespace dtl;
+
+// Draws/ns from each generator against std::mt19937 and std::mt19937_64, with streams filling a buffer a vector
+// at a time; then samples/ns for 1-in-100 packet sampling over bursts of 32: the usual draw-modulo-compare per
+// packet, bounded() per packet, bernoulli bursts from a scalar generator and from streams, and flows over 13-byte
+// keys. Build with DTL_SIMD_SCALAR to compare streams with scalar lanes.
+
+namespace {
+
+    template<typename Generator>
+    void
+    draws(
+        const char * name,
+        Generator g,
+        std::size_t n
+        ) {
+
+        bench::report(name, bench::measure(n, [&] {
+            std::uint64_t sum = 0;
+            for (std::size_t i = 0; i < n; ++i) sum += g();
+            bench::keep(sum);
+        }), "draws");
+
+    }
+
+    template<typename Sample>
+    void
+    samples(
+        const char * name,
+        std::size_t n,
+        Sample && sample
+        ) {
+
+        bench::report(name, bench::measure(n, [&] {
+            std::uint64_t sampled = 0;
+            for (std::size_t i = 0; i < n; i += 32) sampled += sample(i);
+            bench::keep(sampled);
+        }), "samples");
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    const auto n = bench::scaled(1 << 22) / 1024 * 1024 + 1024;
+
+    draws("std::mt19937", std::mt19937(1), n);
+    draws("std::mt19937_64", std::mt19937_64(1), n);
+    draws("xoshiro256pp", random::xoshiro256pp(1), n);
+    draws("wyrand", random::wyrand(1), n);
+    draws("pcg32", random::pcg32(1), n);
+    std::vector<std::uint64_t> buffer(1024);
+    random::streams<> lanes(1);
+    bench::report("streams::fill", bench::measure(n, [&] {
+        for (std::size_t i = 0; i < n; i += buffer.size()) {
+            lanes.fill(buffer.data(), buffer.size());
+            bench::keep(buffer[0]);
+        }
+    }), "draws");
+
+    // A runtime divisor, as a configured rate would be.
+    volatile std::uint32_t rate = 100;
+    const std::uint32_t every = rate;
+    std::mt19937 mt(1);
+    random::xoshiro256pp x(1);
+    random::wyrand w(1);
+    auto b = random::bernoulli::one_in(every);
+    samples("std::mt19937 % n", n, [&](std::size_t) {
+        std::uint64_t hits = 0;
+        for (int p = 0; p < 32; ++p) hits += mt() % every == 0;
+        return hits;
+    });
+    samples("bounded(xoshiro256pp)", n, [&](std::size_t) {
+        std::uint64_t hits = 0;
+        for (int p = 0; p < 32; ++p) hits += random::bounded(x, every) == 0;
+        return hits;
+    });
+    samples("bernoulli::burst(xoshiro256pp)", n, [&](std::size_t) { return __builtin_popcountll(b.burst(x, 32)); });
+    samples("bernoulli::burst(wyrand)", n, [&](std::size_t) { return __builtin_popcountll(b.burst(w, 32)); });
+    samples("bernoulli::burst(streams)", n, [&](std::size_t) { return __builtin_popcountll(b.burst(lanes, 32)); });
+
+    const auto flows = bench::scaled(1 << 18) / 32 * 32 + 32;
+    std::vector<std::uint8_t> keys(13 * flows);
+    std::vector<const void *> pointers(flows);
+    for (std::size_t i = 0; i < flows; ++i) {
+        keys[13 * i] = static_cast<std::uint8_t>(i);
+        keys[13 * i + 1] = static_cast<std::uint8_t>(i >> 8);
+        keys[13 * i + 2] = static_cast<std::uint8_t>(i >> 16);
+        pointers[i] = &keys[13 * i];
+    }
+    random::flows sampler(1.0 / every, { 1, 2 });
+    samples("flows::burst 13 B", flows, [&](std::size_t i) {
+        return __builtin_popcountll(sampler.burst(&pointers[i], 13, 32));
+    });
+
+}
@@ -0,0 +1,55 @@
+#include <map>
+#include <random>
+#include <vector>
+#include "bench.hh"
+#include "rangemap.hh"
+
+using namespace dtl;
+
+// Lookups of random 32-bit keys (addresses) in a table of disjoint blocks, too large for the L2 cache: the
+// compiled map one key at a time and in bursts, the dynamic map, and std::map keyed on block starts.
+
+int
+main() {
+
+    constexpr std::size_t blocks = 1 << 20;
+
+    std::mt19937_64 rng(1);
+    std::vector<rangemap::range<std::uint32_t, std::uint32_t>> ranges;
+    rangemap::dynamic<std::uint32_t, std::uint32_t> d;
+    std::map<std::uint32_t, std::pair<std::uint32_t, std::uint32_t>> tree;   // low -> (high, value)
+    for (std::uint32_t b = 0; b < blocks; ++b) {
+        std::uint32_t low = b << 12, high = low + static_cast<std::uint32_t>(rng() % 4096);
+        ranges.push_back({ low, high, b });
+        d.assign(low, high, b);
+        tree.emplace(low, std::make_pair(high, b));
+    }
+    const auto m = rangemap::map<std::uint32_t, std::uint32_t>::compile(ranges);
+
+    const auto n = bench::scaled(1 << 22);
+    std::vector<std::uint32_t> keys(n);
+    for (auto & k : keys) k = static_cast<std::uint32_t>(rng());
+    std::vector<const std::uint32_t *> found(n);
+
+    bench::report("std::map upper_bound", bench::measure(n, [&] {
+        for (auto k : keys) {
+            auto at = tree.upper_bound(k);
+            bench::keep(at != tree.begin() && k <= (--at)->second.first ? &at->second.second : nullptr);
+        }
+    }));
+    bench::report("dynamic find", bench::measure(n, [&] {
+        for (auto k : keys) bench::keep(d.find(k));
+    }));
+    bench::report("dynamic find burst", bench::measure(n, [&] {
+        d.find(keys.data(), n, found.data());
+        bench::keep(found[n - 1]);
+    }));
+    bench::report("map find", bench::measure(n, [&] {
+        for (auto k : keys) bench::keep(m.find(k));
+    }));
+    bench::report("map find burst", bench::measure(n, [&] {
+        m.find(keys.data(), n, found.data());
+        bench::keep(found[n - 1]);
+    }));
+
+}
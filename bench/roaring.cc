@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <vector>
+#include "bench.hh"
+#include "roaring.hh"
+
+using namespace dtl;
+
+// Rank, select and set operations over a few million IDs: roaring bitmaps owned and through a serialized view,
+// against sorted std::vector<uint32_t> with binary search and std::set_intersection / std::set_union. The IDs mix
+// dense ranges (bitmap containers), sparse ones (arrays) and long runs.
+
+namespace {
+
+    std::vector<std::uint32_t>
+    ids(
+        std::uint64_t seed
+        ) {
+
+        std::mt19937_64 rng(seed);
+        std::vector<std::uint32_t> out;
+        for (std::uint32_t key = 0; key < 512; ++key) {
+            std::uint32_t base = key << 16;
+            switch (key % 3) {
+            case 0:
+                for (std::uint32_t x = 0; x < 65536; ++x) {
+                    if (rng() % 4 == 0) out.push_back(base | x);
+                }
+                break;
+            case 1:
+                for (int k = 0; k < 1000; ++k) out.push_back(base | static_cast<std::uint32_t>(rng() % 65536));
+                break;
+            default: {
+                auto start = static_cast<std::uint32_t>(rng() % 32768);
+                for (std::uint32_t x = start; x < start + 20000; ++x) out.push_back(base | x);
+            }
+            }
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+        return out;
+
+    }
+
+    roaring::bitmap
+    build(
+        const std::vector<std::uint32_t> & values
+        ) {
+
+        roaring::bitmap b;
+        for (auto x : values) b.add(x);
+        b.optimize();
+        return b;
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    const auto a = ids(1), b = ids(2);
+    const auto ra = build(a), rb = build(b);
+    std::vector<std::uint64_t> stored((ra.serialized_size() + 7) / 8);
+    ra.serialize(stored.data());
+    const roaring::view va(stored.data(), ra.serialized_size());
+
+    const auto queries = bench::scaled(1 << 20);
+    std::vector<std::uint32_t> probes(queries), positions(queries);
+    std::mt19937_64 rng(3);
+    for (std::size_t i = 0; i < queries; ++i) {
+        probes[i] = static_cast<std::uint32_t>(rng() % (std::uint64_t(512) << 16));
+        positions[i] = static_cast<std::uint32_t>(rng() % a.size());
+    }
+
+    bench::report("sorted vector  rank", bench::measure(queries, [&] {
+        for (auto x : probes) bench::keep(std::upper_bound(a.begin(), a.end(), x) - a.begin());
+    }));
+    bench::report("bitmap         rank", bench::measure(queries, [&] {
+        for (auto x : probes) bench::keep(roaring::rank(ra, x));
+    }));
+    bench::report("view           rank", bench::measure(queries, [&] {
+        for (auto x : probes) bench::keep(roaring::rank(va, x));
+    }));
+    bench::report("bitmap         select", bench::measure(queries, [&] {
+        for (auto i : positions) bench::keep(roaring::select(ra, i));
+    }));
+    bench::report("view           select", bench::measure(queries, [&] {
+        for (auto i : positions) bench::keep(roaring::select(va, i));
+    }));
+
+    const auto members = a.size() + b.size();
+    bench::report("sorted vector  intersect", bench::measure(members, [&] {
+        std::vector<std::uint32_t> out;
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+        bench::keep(out.size());
+    }, 3));
+    bench::report("bitmap         intersect", bench::measure(members, [&] {
+        bench::keep(roaring::cardinality(roaring::intersect(ra, rb)));
+    }, 3));
+    bench::report("sorted vector  unite", bench::measure(members, [&] {
+        std::vector<std::uint32_t> out;
+        std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+        bench::keep(out.size());
+    }, 3));
+    bench::report("bitmap         unite", bench::measure(members, [&] {
+        bench::keep(roaring::cardinality(roaring::unite(ra, rb)));
+    }, 3));
+
+}
@@ -0,0 +1,72 @@
+#include <vector>
+#include "soa.hh"
+#include "bench.hh"
+
+using namespace dtl;
+
+// A pass over two of twenty fields of a flow record (bytes of TCP flows), as an array of structs and as a
+// structure of arrays.
+
+namespace {
+
+    struct flow {
+
+        std::uint32_t source, destination;
+        std::uint16_t source_port, destination_port;
+        std::uint8_t protocol, tos, ttl, flags;
+        std::uint64_t packets, bytes;
+        std::uint64_t first, last;
+        std::uint32_t input, output;
+        std::uint32_t next_hop, source_as, destination_as;
+        std::uint16_t vlan, mtu;
+        std::uint32_t application;
+
+    }; // struct flow
+
+    using flows = soa::table<
+        std::uint32_t, std::uint32_t, std::uint16_t, std::uint16_t,
+        std::uint8_t, std::uint8_t, std::uint8_t, std::uint8_t,
+        std::uint64_t, std::uint64_t, std::uint64_t, std::uint64_t,
+        std::uint32_t, std::uint32_t, std::uint32_t, std::uint32_t, std::uint32_t,
+        std::uint16_t, std::uint16_t, std::uint32_t>;
+
+} // namespace
+
+int
+main() {
+
+    const auto count = bench::scaled(std::size_t(1) << 22);
+
+    std::vector<flow> aos(count);
+    flows table;
+    table.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        auto protocol = static_cast<std::uint8_t>((i * 7) % 3 ? 6 : 17);
+        auto bytes = (i * 2654435761u) % 1500;
+        aos[i].protocol = protocol;
+        aos[i].bytes = bytes;
+        table.column<4>()[i] = protocol;
+        table.column<9>()[i] = bytes;
+    }
+
+    bench::report("aos  sum(bytes) where protocol == tcp", bench::measure(count, [&] {
+        std::uint64_t sum = 0;
+        for (auto & f : aos) sum += (f.protocol == 6) ? f.bytes : 0;
+        bench::keep(sum);
+    }));
+
+    bench::report("soa  sum(bytes) where protocol == tcp", bench::measure(count, [&] {
+        std::uint64_t sum = 0;
+        const auto * protocol = table.column<4>();
+        const auto * bytes = table.column<9>();
+        for (std::size_t i = 0; i < count; ++i) sum += (protocol[i] == 6) ? bytes[i] : 0;
+        bench::keep(sum);
+    }));
+
+    bench::report("soa  same, through proxies", bench::measure(count, [&] {
+        std::uint64_t sum = 0;
+        for (auto f : table) sum += (f.get<4>() == 6) ? f.get<9>() : 0;
+        bench::keep(sum);
+    }));
+
+}
@@ -0,0 +1,135 @@
+#include <string>
+#include <vector>
+#include "bench.hh"
+#include "tls.hh"
+
+using namespace dtl;
+
+// ClientHellos per second from the first segment of a thousand different TCP streams, as an L7 load balancer
+// steering by SNI sees them: parse alone, parse plus the JA3 and JA4 strings, and the per-flow assembler path for
+// hellos that arrive split over several records and segments.
+
+namespace {
+
+    using buffer = std::vector<std::uint8_t>;
+
+    void
+    put16(
+        buffer & out,
+        std::size_t v
+        ) {
+
+        out.push_back(static_cast<std::uint8_t>(v >> 8));
+        out.push_back(static_cast<std::uint8_t>(v));
+
+    }
+
+    void
+    put_extension(
+        buffer & out,
+        std::uint16_t type,
+        const buffer & body
+        ) {
+
+        put16(out, type);
+        put16(out, body.size());
+        out.insert(out.end(), body.begin(), body.end());
+
+    }
+
+    // A browser-like hello: 16 ciphers, SNI, ALPN, groups, signature algorithms, versions and padding, in records
+    // of at most `chunk` bytes.
+    buffer
+    stream(
+        const std::string & sni,
+        std::size_t chunk
+        ) {
+
+        buffer body;
+        put16(body, 0x0303);
+        body.insert(body.end(), 32, 7);
+        body.push_back(32);
+        body.insert(body.end(), 32, 9);
+        put16(body, 32);
+        for (std::uint16_t c = 0; c < 16; ++c) put16(body, 0x1301 + c);
+        body.insert(body.end(), { 1, 0 });
+
+        buffer extensions, name;
+        put16(name, sni.size() + 3);
+        name.push_back(0);
+        put16(name, sni.size());
+        name.insert(name.end(), sni.begin(), sni.end());
+        put_extension(extensions, tls::extension::server_name, name);
+        put_extension(extensions, tls::extension::supported_groups, { 0, 8, 0x11, 0xec, 0, 0x1d, 0, 0x17, 0, 0x18 });
+        put_extension(extensions, tls::extension::ec_point_formats, { 1, 0 });
+        put_extension(extensions, tls::extension::signature_algorithms, { 0, 8, 4, 3, 8, 4, 4, 1, 5, 3 });
+        put_extension(extensions, tls::extension::alpn, { 0, 12, 2, 'h', '2', 8, 'h', 't', 't', 'p', '/', '1', '.', '1' });
+        put_extension(extensions, tls::extension::supported_versions, { 4, 0x03, 0x04, 0x03, 0x03 });
+        put_extension(extensions, 51, buffer(1254, 3));        // key_share with a post-quantum share
+        put_extension(extensions, 21, buffer(200, 0));
+        put16(body, extensions.size());
+        body.insert(body.end(), extensions.begin(), extensions.end());
+
+        buffer message = { 1, static_cast<std::uint8_t>(body.size() >> 16), static_cast<std::uint8_t>(body.size() >> 8),
+                           static_cast<std::uint8_t>(body.size()) };
+        message.insert(message.end(), body.begin(), body.end());
+
+        buffer out;
+        for (std::size_t at = 0; at < message.size(); at += chunk) {
+            auto n = std::min(chunk, message.size() - at);
+            out.insert(out.end(), { 22, 3, 1 });
+            put16(out, n);
+            out.insert(out.end(), message.begin() + at, message.begin() + at + n);
+        }
+        return out;
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    std::vector<buffer> whole, split;
+    for (int i = 0; i < 1000; ++i) {
+        auto sni = "host" + std::to_string(i) + ".example.com";
+        whole.push_back(stream(sni, 16384));
+        split.push_back(stream(sni, 700));
+    }
+    const auto rounds = bench::scaled(200);
+    const auto hellos = rounds * whole.size();
+
+    tls::hello h;
+    bench::report("parse                  hello", bench::measure(hellos, [&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            for (auto & s : whole) {
+                tls::parse(s.data(), s.size(), h);
+                bench::keep(h.server_name.size());
+            }
+        }
+    }));
+
+    char out[1024];
+    bench::report("parse + ja3 + ja4      hello", bench::measure(hellos, [&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            for (auto & s : whole) {
+                tls::parse(s.data(), s.size(), h);
+                bench::keep(h.ja3(out, sizeof(out)) + h.ja4(out, sizeof(out)));
+            }
+        }
+    }));
+
+    bench::report("assembler, 1460-byte segments  hello", bench::measure(hellos, [&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            for (auto & s : split) {
+                tls::assembler a;
+                auto result = tls::status::incomplete;
+                for (std::size_t at = 0; at < s.size() && result == tls::status::incomplete; at += 1460) {
+                    result = a.feed(s.data() + at, std::min<std::size_t>(1460, s.size() - at), h);
+                }
+                bench::keep(result);
+            }
+        }
+    }));
+
+}
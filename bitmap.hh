@@ -0,0 +1,502 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+#include "branch.hh"
+#include "branchless.hh"
+
+namespace dtl::bitmap {
+
+    // Hierarchical bitmaps for ID, port and slot allocation. Leaf words hold the bits; every summary level above
+    // them holds one bit per word of the level below, so finding a set or clear bit is one tzcnt per level (four
+    // levels cover 2^24 bits) rather than a linear scan. Storage is rounded up to a power of 2 (at least 64) bits;
+    // the bits past the requested capacity start out set, so they are never found clear or handed out.
+
+    constexpr std::size_t npos = ~std::size_t(0);
+
+    namespace _ {
+
+        constexpr std::size_t max_levels = 8;
+
+        inline static constexpr std::size_t
+        words(
+            std::size_t bits
+            ) noexcept {
+
+            return (bits + 63) >> 6;
+
+        } // _::words()
+
+        inline static constexpr std::size_t
+        capacity(
+            std::size_t bits
+            ) noexcept {
+
+            return branchless::power_of_2::roundup(bits < 64 ? std::size_t(64) : bits);
+
+        } // _::capacity()
+
+        // Bits of leaf word `word` at or past `limit`.
+        inline static constexpr std::uint64_t
+        padding(
+            std::size_t word,
+            std::size_t limit
+            ) noexcept {
+
+            auto first = word << 6;
+            if (first >= limit) return ~std::uint64_t(0);
+            return (limit - first >= 64) ? 0 : ~std::uint64_t(0) << (limit - first);
+
+        } // _::padding()
+
+        // Lowest n clear bits of word (n <= number of clear bits).
+        inline static std::uint64_t
+        lowest_clear(
+            std::uint64_t word,
+            unsigned n
+            ) noexcept {
+
+            auto wanted = (n >= 64) ? ~std::uint64_t(0) : (std::uint64_t(1) << n) - 1;
+#if defined(__BMI2__)
+            return _pdep_u64(wanted, ~word);
+#else
+            std::uint64_t free = ~word, taken = 0;
+            for (; wanted; wanted >>= 1) {
+                taken |= free & -free;
+                free &= free - 1;
+            }
+            return taken;
+#endif
+
+        } // _::lowest_clear()
+
+        // Level geometry shared by both bitmaps: level 0 is the leaves, the last level is a single word.
+        struct layout {
+
+            std::size_t levels = 0;
+            std::size_t offset[max_levels] = {};
+            std::size_t count[max_levels] = {};
+            std::size_t total = 0;
+
+            inline explicit
+            layout(
+                std::size_t bits
+                ) noexcept {
+
+                auto n = words(bits);
+                while (true) {
+                    offset[levels] = total;
+                    count[levels] = n;
+                    total += n;
+                    ++levels;
+                    if (n == 1) break;
+                    n = words(n);
+                }
+
+            } // layout::layout()
+
+        }; // struct dtl::bitmap::_::layout
+
+    } // namespace dtl::bitmap::_
+
+    class hierarchical {
+
+        std::size_t limit;
+        std::size_t bits;
+        _::layout shape;
+        std::vector<std::uint64_t> leaves;
+        std::vector<std::uint64_t> free;    // summaries: child word has a clear bit.
+        std::vector<std::uint64_t> used;    // summaries: child word has a set bit.
+        std::size_t population = 0;
+
+        // Summary word j of level k (k >= 1) lives at offset[k] - count[0] in the summary arrays.
+        inline std::uint64_t &
+        summary(
+            std::vector<std::uint64_t> & s,
+            std::size_t level,
+            std::size_t word
+            ) noexcept {
+
+            return s[shape.offset[level] - shape.count[0] + word];
+
+        } // hierarchical::summary()
+
+        inline std::uint64_t
+        summary(
+            const std::vector<std::uint64_t> & s,
+            std::size_t level,
+            std::size_t word
+            ) const noexcept {
+
+            return s[shape.offset[level] - shape.count[0] + word];
+
+        } // hierarchical::summary() const
+
+        // Sets or clears the summary bit for word `word` of level `level - 1`, propagating emptiness upwards.
+        inline void
+        mark(
+            std::vector<std::uint64_t> & s,
+            std::size_t word,
+            bool value
+            ) noexcept {
+
+            for (std::size_t level = 1; level < shape.levels; ++level) {
+                auto & w = summary(s, level, word >> 6);
+                auto before = w;
+                auto bit = std::uint64_t(1) << (word & 63);
+                w = value ? (w | bit) : (w & ~bit);
+                // Parents only change when this word switches between empty and non-empty.
+                if ((before != 0) == (w != 0)) break;
+                value = (w != 0);
+                word >>= 6;
+            }
+
+        } // hierarchical::mark()
+
+        inline void
+        update(
+            std::size_t word,
+            std::uint64_t before
+            ) noexcept {
+
+            auto after = leaves[word];
+            if ((before != 0) != (after != 0)) mark(used, word, after != 0);
+            if ((before != ~std::uint64_t(0)) != (after != ~std::uint64_t(0))) mark(free, word, after != ~std::uint64_t(0));
+
+        } // hierarchical::update()
+
+        // Next word at `level` at or after `word` whose summary (or, at level 0, whose value under `flip`) is non-zero.
+        inline std::size_t
+        next(
+            const std::vector<std::uint64_t> & s,
+            std::uint64_t flip,
+            std::size_t level,
+            std::size_t position
+            ) const noexcept {
+
+            std::size_t limit = shape.count[level] << 6;
+            while (position < limit) {
+                auto word = position >> 6;
+                auto value = level ? summary(s, level, word) : (leaves[word] ^ flip);
+                value &= ~std::uint64_t(0) << (position & 63);
+                if (value) return (word << 6) | __builtin_ctzll(value);
+                if (level + 1 >= shape.levels) return npos;
+                auto parent = next(s, flip, level + 1, word + 1);
+                if (parent == npos) return npos;
+                position = parent << 6;
+            }
+            return npos;
+
+        } // hierarchical::next()
+
+    public:
+
+        inline explicit
+        hierarchical(
+            std::size_t capacity
+            ) noexcept(false)
+            : limit(capacity), bits(_::capacity(capacity)), shape(bits), leaves(shape.count[0], 0),
+              free(shape.total - shape.count[0], 0), used(shape.total - shape.count[0], 0) {
+
+            for (std::size_t w = 0; w < shape.count[0]; ++w) mark(free, w, true);
+            for (std::size_t w = limit >> 6; w < shape.count[0]; ++w) {
+                auto before = leaves[w];
+                leaves[w] |= _::padding(w, limit);
+                update(w, before);
+            }
+
+        } // hierarchical::hierarchical()
+
+        inline std::size_t capacity() const noexcept { return limit; }
+        inline std::size_t count() const noexcept { return population; }
+        inline bool full() const noexcept { return population == limit; }
+
+        inline bool
+        test(
+            std::size_t i
+            ) const noexcept {
+
+            return (leaves[i >> 6] >> (i & 63)) & 1;
+
+        } // hierarchical::test()
+
+        inline void
+        set(
+            std::size_t i
+            ) noexcept {
+
+            auto & w = leaves[i >> 6];
+            auto before = w;
+            w |= std::uint64_t(1) << (i & 63);
+            population += (w != before);
+            update(i >> 6, before);
+
+        } // hierarchical::set()
+
+        inline void
+        clear(
+            std::size_t i
+            ) noexcept {
+
+            auto & w = leaves[i >> 6];
+            auto before = w;
+            w &= ~(std::uint64_t(1) << (i & 63));
+            population -= (w != before);
+            update(i >> 6, before);
+
+        } // hierarchical::clear()
+
+        // First set / clear bit at or after `from`, or npos.
+        inline std::size_t
+        find_next_set(
+            std::size_t from = 0
+            ) const noexcept {
+
+            // The padding past the capacity is set, so a hit there means there is none below it.
+            auto i = (from < limit) ? next(used, 0, 0, from) : npos;
+            return (i < limit) ? i : npos;
+
+        } // hierarchical::find_next_set()
+
+        inline std::size_t
+        find_next_clear(
+            std::size_t from = 0
+            ) const noexcept {
+
+            return (from < limit) ? next(free, ~std::uint64_t(0), 0, from) : npos;
+
+        } // hierarchical::find_next_clear()
+
+        inline std::size_t find_first_set() const noexcept { return find_next_set(0); }
+        inline std::size_t find_first_clear() const noexcept { return find_next_clear(0); }
+
+        // Sets and returns the lowest clear bit, or npos when full.
+        inline std::size_t
+        allocate() noexcept {
+
+            auto i = find_first_clear();
+            if (likely(i != npos)) set(i);
+            return i;
+
+        } // hierarchical::allocate()
+
+        // Allocates up to n bits, a leaf word at a time, writing their indices to out. Returns how many were taken.
+        inline std::size_t
+        allocate(
+            std::size_t n,
+            std::size_t * out
+            ) noexcept {
+
+            std::size_t taken = 0;
+            while (taken < n) {
+                auto i = find_first_clear();
+                if (unlikely(i == npos)) break;
+                auto word = i >> 6;
+                auto before = leaves[word];
+                auto want = n - taken;
+                auto available = static_cast<std::size_t>(64 - __builtin_popcountll(before));
+                auto mask = _::lowest_clear(before, static_cast<unsigned>(want < available ? want : available));
+                leaves[word] = before | mask;
+                population += __builtin_popcountll(mask);
+                for (; mask; mask &= mask - 1) out[taken++] = (word << 6) | __builtin_ctzll(mask);
+                update(word, before);
+            }
+            return taken;
+
+        } // hierarchical::allocate(std::size_t, std::size_t *)
+
+        inline void
+        release(
+            std::size_t i
+            ) noexcept {
+
+            clear(i);
+
+        } // hierarchical::release()
+
+    }; // class dtl::bitmap::hierarchical
+
+    // Lock-free allocator bitmap. Leaf words are authoritative and updated with CAS; the summaries above them are
+    // hints ("this word may have a clear bit") kept conservative by re-checking a child after clearing its bit, so
+    // a slot freed concurrently is never hidden for good.
+    class atomic {
+
+        std::size_t limit;
+        std::size_t bits;
+        _::layout shape;
+        std::unique_ptr<std::atomic<std::uint64_t>[]> words;
+
+        inline std::atomic<std::uint64_t> &
+        at(
+            std::size_t level,
+            std::size_t word
+            ) const noexcept {
+
+            return words[shape.offset[level] + word];
+
+        } // atomic::at()
+
+        // Whether word `word` of level `level` currently has anything free beneath it.
+        inline bool
+        available(
+            std::size_t level,
+            std::size_t word
+            ) const noexcept {
+
+            auto value = at(level, word).load(std::memory_order_acquire);
+            return level ? (value != 0) : (value != ~std::uint64_t(0));
+
+        } // atomic::available()
+
+        // Sets the hint for word `word` of level `level - 1`, and upwards until a hint was already set.
+        inline void
+        advertise(
+            std::size_t word,
+            std::size_t level = 1
+            ) noexcept {
+
+            for (; level < shape.levels; ++level) {
+                auto bit = std::uint64_t(1) << (word & 63);
+                auto before = at(level, word >> 6).fetch_or(bit, std::memory_order_acq_rel);
+                if (before & bit) break;
+                word >>= 6;
+            }
+
+        } // atomic::advertise()
+
+        inline void
+        retract(
+            std::size_t word
+            ) noexcept {
+
+            for (std::size_t level = 1; level < shape.levels; ++level) {
+                auto bit = std::uint64_t(1) << (word & 63);
+                auto after = at(level, word >> 6).fetch_and(~bit, std::memory_order_acq_rel) & ~bit;
+                // A release may have raced with us; put the hint back if the child is not actually full.
+                if (available(level - 1, word)) {
+                    advertise(word, level);
+                    return;
+                }
+                if (after) return;
+                word >>= 6;
+            }
+
+        } // atomic::retract()
+
+        // Descends the hints to a leaf word that may have a clear bit, or npos.
+        inline std::size_t
+        descend() const noexcept {
+
+            std::size_t word = 0;
+            for (auto level = shape.levels - 1; level > 0; --level) {
+                auto value = at(level, word).load(std::memory_order_acquire);
+                if (!value) return npos;
+                word = (word << 6) | __builtin_ctzll(value);
+            }
+            return word;
+
+        } // atomic::descend()
+
+    public:
+
+        inline explicit
+        atomic(
+            std::size_t capacity
+            ) noexcept(false)
+            : limit(capacity), bits(_::capacity(capacity)), shape(bits),
+              words(new std::atomic<std::uint64_t>[shape.total]) {
+
+            for (std::size_t i = 0; i < shape.total; ++i) words[i].store(0, std::memory_order_relaxed);
+            for (std::size_t w = 0; w < shape.count[0]; ++w) {
+                auto padding = _::padding(w, limit);
+                at(0, w).store(padding, std::memory_order_relaxed);
+                if (padding != ~std::uint64_t(0)) advertise(w);
+            }
+
+        } // atomic::atomic()
+
+        inline std::size_t capacity() const noexcept { return limit; }
+
+        inline bool
+        test(
+            std::size_t i
+            ) const noexcept {
+
+            return (at(0, i >> 6).load(std::memory_order_acquire) >> (i & 63)) & 1;
+
+        } // atomic::test()
+
+        // Claims up to n bits from a single leaf word (n <= 64) with one CAS; returns the claimed mask shifted into
+        // place through `word`, or zero when the bitmap is full.
+        inline std::uint64_t
+        claim(
+            unsigned n,
+            std::size_t & word
+            ) noexcept {
+
+            while (true) {
+                word = descend();
+                if (unlikely(word == npos)) return 0;
+
+                auto & leaf = at(0, word);
+                auto before = leaf.load(std::memory_order_relaxed);
+                while (before != ~std::uint64_t(0)) {
+                    auto available = static_cast<unsigned>(64 - __builtin_popcountll(before));
+                    auto mask = _::lowest_clear(before, n < available ? n : available);
+                    if (leaf.compare_exchange_weak(before, before | mask, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                        if ((before | mask) == ~std::uint64_t(0)) retract(word);
+                        return mask;
+                    }
+                }
+                retract(word);
+            }
+
+        } // atomic::claim()
+
+        inline std::size_t
+        allocate() noexcept {
+
+            std::size_t word;
+            auto mask = claim(1, word);
+            return mask ? (word << 6) | __builtin_ctzll(mask) : npos;
+
+        } // atomic::allocate()
+
+        inline std::size_t
+        allocate(
+            std::size_t n,
+            std::size_t * out
+            ) noexcept {
+
+            std::size_t taken = 0;
+            while (taken < n) {
+                std::size_t word;
+                auto want = n - taken;
+                auto mask = claim(static_cast<unsigned>(want < 64 ? want : 64), word);
+                if (unlikely(!mask)) break;
+                for (; mask; mask &= mask - 1) out[taken++] = (word << 6) | __builtin_ctzll(mask);
+            }
+            return taken;
+
+        } // atomic::allocate(std::size_t, std::size_t *)
+
+        inline void
+        release(
+            std::size_t i
+            ) noexcept {
+
+            auto bit = std::uint64_t(1) << (i & 63);
+            auto before = at(0, i >> 6).fetch_and(~bit, std::memory_order_acq_rel);
+            if (before == ~std::uint64_t(0)) advertise(i >> 6);
+
+        } // atomic::release()
+
+    }; // class dtl::bitmap::atomic
+
+} // namespace dtl::bitmap
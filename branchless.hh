@@ -165,6 +165,7 @@ namespace dtl::branchless {
             value |= value >>  4;
             value |= value >>  8;
             value |= value >> 16;
+            if constexpr (sizeof(T) > 4) value |= value >> 32;
             ++value;
 
             return value;
@@ -195,6 +196,7 @@ namespace dtl::branchless {
             value |= value >>  4;
             value |= value >>  8;
             value |= value >> 16;
+            if constexpr (sizeof(T) > 4) value |= value >> 32;
 
             return value;
 
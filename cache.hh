@@ -0,0 +1,573 @@
+#pragma once
+
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include "branch.hh"
+#include "branchless.hh"
+#include "cacheline.hh"
+#include "hash.hh"
+#include "prefetch.hh"
+
+namespace dtl::cache {
+
+    // Sharded concurrent cache for lookup results (DNS answers, GeoIP records, policy decisions). Keys hash to one
+    // of a power-of-2 number of shards, each a fixed set of entry slots with an open-addressed index:
+    //
+    //   - Lookups take no lock. Entries are written under a per-entry sequence number and readers retry the probe
+    //     when they catch one mid-write, so a hit always returns a value that was stored for that key; a lookup
+    //     racing with an eviction may miss, which a cache is free to do.
+    //   - Eviction is S3-FIFO (Yang et al.): new keys enter a small FIFO and are only promoted to the main FIFO if
+    //     they were hit while there, main entries get one more round per hit (CLOCK-like), and keys evicted from
+    //     the small FIFO are remembered in a ghost table so that a quick return goes straight to main.
+    //   - Admission is TinyLFU: lookups are counted in a 4-row count-min sketch of 4-bit counters, halved
+    //     periodically, and a new key is only let in if it is estimated at least as popular as the entry eviction
+    //     would start from. Only a random sample of lookups is counted, so that the read path does not store to
+    //     four shared counter lines (and bump a shared total) on every hit.
+    //
+    // Inserts and erasures lock only their shard's std::mutex, which sleeps rather than spins when its holder is
+    // preempted; they may therefore throw std::system_error. Keys and values are trivially copyable and keys compare
+    // with ==.
+
+    namespace _ {
+
+        class sketch {
+
+            constexpr static std::uint8_t ceiling = 15;
+            constexpr static std::size_t rows = 4;
+
+        public:
+
+            // One lookup in `sampling` is counted. Popular keys are still sampled in proportion to their hits, so
+            // the sketch ranks them as before; the ageing period is scaled down to match.
+            constexpr static std::uint32_t sampling = 8;
+
+        private:
+
+            std::unique_ptr<std::atomic<std::uint8_t>[]> counters;
+            std::size_t mask = 0;
+            std::size_t period = 0;
+            std::atomic<std::size_t> additions{0};
+
+            inline std::atomic<std::uint8_t> &
+            counter(
+                std::uint64_t h,
+                std::size_t row
+                ) const noexcept {
+
+                // Double hashing across the rows.
+                auto step = (h >> 32) | 1;
+                return counters[row * (mask + 1) + ((h + row * step) & mask)];
+
+            } // sketch::counter()
+
+        public:
+
+            inline void
+            init(
+                std::size_t capacity
+                ) noexcept(false) {
+
+                auto width = branchless::power_of_2::roundup(std::max<std::size_t>(capacity, 64));
+                counters.reset(new std::atomic<std::uint8_t>[rows * width]);
+                for (std::size_t i = 0; i < rows * width; ++i) counters[i].store(0, std::memory_order_relaxed);
+                mask = width - 1;
+                period = std::max<std::size_t>(capacity * 10 / sampling, 1);
+
+            } // sketch::init()
+
+            // Per-thread xorshift draw, so that which lookups are counted does not follow any pattern in the keys.
+            inline static bool
+            sampled() noexcept {
+
+                thread_local std::uint32_t state = 0;
+                if (unlikely(!state)) state = static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(&state) >> 4) | 1;
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                return !(state & (sampling - 1));
+
+            } // sketch::sampled()
+
+            // Counts one lookup in `sampling`. Racy by design: concurrent increments of one counter may be lost,
+            // which only blurs the estimate.
+            inline void
+            increment(
+                std::uint64_t h
+                ) noexcept {
+
+                if (likely(!sampled())) return;
+                for (std::size_t r = 0; r < rows; ++r) {
+                    auto & c = counter(h, r);
+                    auto v = c.load(std::memory_order_relaxed);
+                    if (v < ceiling) c.store(v + 1, std::memory_order_relaxed);
+                }
+                additions.fetch_add(1, std::memory_order_relaxed);
+
+            } // sketch::increment()
+
+            inline std::uint8_t
+            estimate(
+                std::uint64_t h
+                ) const noexcept {
+
+                std::uint8_t v = ceiling;
+                for (std::size_t r = 0; r < rows; ++r) v = std::min(v, counter(h, r).load(std::memory_order_relaxed));
+                return v;
+
+            } // sketch::estimate()
+
+            // Halves every counter once enough accesses were counted, so that the sketch follows a changing
+            // popularity distribution. Called by writers.
+            inline void
+            age() noexcept {
+
+                if (likely(additions.load(std::memory_order_relaxed) < period)) return;
+                additions.store(0, std::memory_order_relaxed);
+                for (std::size_t i = 0; i < rows * (mask + 1); ++i) {
+                    counters[i].store(counters[i].load(std::memory_order_relaxed) >> 1, std::memory_order_relaxed);
+                }
+
+            } // sketch::age()
+
+        }; // class dtl::cache::_::sketch
+
+        // FIFO of entry slots, sized to hold every slot of the shard.
+        class ring {
+
+            std::unique_ptr<std::uint32_t[]> slots;
+            std::uint32_t capacity = 0;
+            std::uint32_t head = 0;
+            std::uint32_t count = 0;
+
+        public:
+
+            inline void
+            init(
+                std::uint32_t size
+                ) noexcept(false) {
+
+                slots.reset(new std::uint32_t[size]);
+                capacity = size;
+
+            } // ring::init()
+
+            inline std::uint32_t size() const noexcept { return count; }
+            inline bool empty() const noexcept { return !count; }
+            inline std::uint32_t front() const noexcept { return slots[head]; }
+
+            inline void
+            push(
+                std::uint32_t slot
+                ) noexcept {
+
+                auto at = head + count++;
+                slots[at >= capacity ? at - capacity : at] = slot;
+
+            } // ring::push()
+
+            inline std::uint32_t
+            pop() noexcept {
+
+                auto slot = slots[head];
+                head = (head + 1 == capacity) ? 0 : head + 1;
+                --count;
+                return slot;
+
+            } // ring::pop()
+
+        }; // class dtl::cache::_::ring
+
+    } // namespace dtl::cache::_
+
+    struct statistics {
+
+        std::uint64_t hits;
+        std::uint64_t misses;
+        std::uint64_t rejected;     // inserts turned away by the admission filter
+
+    }; // struct dtl::cache::statistics
+
+    template<typename Key, typename Value, typename Hash = std::hash<Key>>
+    class sharded {
+
+        static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+                      "entries are read optimistically and copied bytewise");
+
+        struct entry {
+
+            std::atomic<std::uint32_t> sequence{0};     // odd while being written
+            std::atomic<std::uint8_t> frequency{0};     // 0..3, bumped by hits
+            bool live = false;
+            std::uint64_t hash = 0;
+            Key key;
+            Value value;
+
+        }; // struct sharded::entry
+
+        constexpr static std::uint8_t max_frequency = 3;
+
+        struct shard {
+
+            std::mutex lock;
+            std::unique_ptr<entry[]> entries;
+            std::unique_ptr<std::atomic<std::uint32_t>[]> index;   // slot + 1, zero when empty
+            std::uint32_t index_mask = 0;
+            std::uint32_t capacity = 0;
+            std::uint32_t used = 0;
+            std::uint32_t small_target = 0;
+            _::ring small;
+            _::ring main;
+            std::unique_ptr<std::uint64_t[]> ghost;                 // direct-mapped hashes of recent evictions
+            std::uint32_t ghost_mask = 0;
+            _::sketch frequencies;
+
+        }; // struct sharded::shard
+
+        struct counters {
+
+            std::atomic<std::uint64_t> hits{0};
+            std::atomic<std::uint64_t> misses{0};
+            std::atomic<std::uint64_t> rejected{0};
+
+        }; // struct sharded::counters
+
+        std::unique_ptr<cacheline::padded<shard>[]> shards;
+        std::size_t shard_mask;
+        mutable cacheline::per_cpu<counters> stats;
+
+        inline static std::uint64_t
+        hash(
+            const Key & key
+            ) noexcept {
+
+            // Both the shard and the index position are taken from these bits.
+            return hash::mix(static_cast<std::uint64_t>(Hash{}(key)));
+
+        } // sharded::hash()
+
+        inline shard &
+        owner(
+            std::uint64_t h
+            ) const noexcept {
+
+            return shards[(h >> 40) & shard_mask].value;
+
+        } // sharded::owner()
+
+        inline static void
+        bump(
+            std::atomic<std::uint8_t> & frequency
+            ) noexcept {
+
+            // Hot entries stop writing once saturated, so their lines stay shared between readers.
+            auto f = frequency.load(std::memory_order_relaxed);
+            if (f < max_frequency) frequency.store(f + 1, std::memory_order_relaxed);
+
+        } // sharded::bump()
+
+        // Index position holding `slot`, probed under the shard lock.
+        inline static std::uint32_t
+        position(
+            const shard & s,
+            std::uint32_t slot
+            ) noexcept {
+
+            auto i = static_cast<std::uint32_t>(s.entries[slot].hash) & s.index_mask;
+            while (s.index[i].load(std::memory_order_relaxed) != slot + 1) i = (i + 1) & s.index_mask;
+            return i;
+
+        } // sharded::position()
+
+        // Index slot of the live entry for `key`, or -1; under the shard lock.
+        inline static std::int64_t
+        locate(
+            const shard & s,
+            std::uint64_t h,
+            const Key & key
+            ) noexcept {
+
+            for (auto i = static_cast<std::uint32_t>(h) & s.index_mask;; i = (i + 1) & s.index_mask) {
+                auto v = s.index[i].load(std::memory_order_relaxed);
+                if (!v) return -1;
+                auto & e = s.entries[v - 1];
+                if (e.hash == h && e.key == key) return v - 1;
+            }
+
+        } // sharded::locate()
+
+        // Removes a slot from the index with backward-shift deletion, so that probes never need tombstones.
+        inline static void
+        unindex(
+            shard & s,
+            std::uint32_t slot
+            ) noexcept {
+
+            auto hole = position(s, slot);
+            s.index[hole].store(0, std::memory_order_release);
+            for (auto j = (hole + 1) & s.index_mask;; j = (j + 1) & s.index_mask) {
+                auto v = s.index[j].load(std::memory_order_relaxed);
+                if (!v) return;
+                auto home = static_cast<std::uint32_t>(s.entries[v - 1].hash) & s.index_mask;
+                if (((j - home) & s.index_mask) >= ((j - hole) & s.index_mask)) {
+                    s.index[hole].store(v, std::memory_order_release);
+                    s.index[j].store(0, std::memory_order_release);
+                    hole = j;
+                }
+            }
+
+        } // sharded::unindex()
+
+        inline static void
+        index(
+            shard & s,
+            std::uint32_t slot
+            ) noexcept {
+
+            auto i = static_cast<std::uint32_t>(s.entries[slot].hash) & s.index_mask;
+            while (s.index[i].load(std::memory_order_relaxed)) i = (i + 1) & s.index_mask;
+            s.index[i].store(slot + 1, std::memory_order_release);
+
+        } // sharded::index()
+
+        inline static bool
+        ghosted(
+            const shard & s,
+            std::uint64_t h
+            ) noexcept {
+
+            return s.ghost[h & s.ghost_mask] == h;
+
+        } // sharded::ghosted()
+
+        // S3-FIFO eviction; returns the slot freed. Erased entries are reclaimed as they come up.
+        inline static std::uint32_t
+        evict(
+            shard & s
+            ) noexcept {
+
+            for (;;) {
+                if (s.small.size() > s.small_target || s.main.empty()) {
+                    auto slot = s.small.pop();
+                    auto & e = s.entries[slot];
+                    if (!e.live) return slot;
+                    if (e.frequency.load(std::memory_order_relaxed) > 1) {
+                        e.frequency.store(0, std::memory_order_relaxed);
+                        s.main.push(slot);
+                        continue;
+                    }
+                    s.ghost[e.hash & s.ghost_mask] = e.hash;
+                    unindex(s, slot);
+                    return slot;
+                }
+                auto slot = s.main.pop();
+                auto & e = s.entries[slot];
+                if (!e.live) return slot;
+                auto f = e.frequency.load(std::memory_order_relaxed);
+                if (f) {
+                    e.frequency.store(f - 1, std::memory_order_relaxed);
+                    s.main.push(slot);
+                    continue;
+                }
+                unindex(s, slot);
+                return slot;
+            }
+
+        } // sharded::evict()
+
+        inline static void
+        write(
+            entry & e,
+            const Key * key,
+            const Value & value
+            ) noexcept {
+
+            auto sequence = e.sequence.load(std::memory_order_relaxed);
+            e.sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            if (key) std::memcpy(&e.key, key, sizeof(Key));
+            std::memcpy(&e.value, &value, sizeof(Value));
+            e.sequence.store(sequence + 2, std::memory_order_release);
+
+        } // sharded::write()
+
+    public:
+
+        using key_type = Key;
+        using value_type = Value;
+
+        // Capacity is the total number of entries, split evenly; the shard count is rounded up to a power of 2
+        // and defaults to four per CPU.
+        inline explicit
+        sharded(
+            std::size_t capacity,
+            std::size_t count = 4 * static_cast<std::size_t>(::sysconf(_SC_NPROCESSORS_CONF))
+            ) noexcept(false)
+            : shards(), shard_mask(branchless::power_of_2::roundup(std::max<std::size_t>(count, 1)) - 1), stats() {
+
+            shards.reset(new cacheline::padded<shard>[shard_mask + 1]);
+            auto per = static_cast<std::uint32_t>(std::max<std::size_t>((capacity + shard_mask) / (shard_mask + 1), 2));
+
+            for (std::size_t i = 0; i <= shard_mask; ++i) {
+                auto & s = shards[i].value;
+                s.capacity = per;
+                s.small_target = std::max<std::uint32_t>(per / 10, 1);
+                s.entries.reset(new entry[per]);
+                s.index_mask = branchless::power_of_2::roundup(per * 2) - 1;
+                s.index.reset(new std::atomic<std::uint32_t>[s.index_mask + 1]);
+                for (std::uint32_t j = 0; j <= s.index_mask; ++j) s.index[j].store(0, std::memory_order_relaxed);
+                s.small.init(per);
+                s.main.init(per);
+                s.ghost_mask = branchless::power_of_2::roundup(per) - 1;
+                s.ghost.reset(new std::uint64_t[s.ghost_mask + 1]());
+                s.frequencies.init(per);
+            }
+
+        } // sharded::sharded()
+
+        sharded(const sharded &) = delete;
+        sharded & operator=(const sharded &) = delete;
+
+        // Lock-free.
+        inline std::optional<Value>
+        find(
+            const Key & key
+            ) const noexcept {
+
+            auto h = hash(key);
+            auto & s = owner(h);
+            s.frequencies.increment(h);
+
+            for (auto i = static_cast<std::uint32_t>(h) & s.index_mask, probes = 0u; probes <= s.index_mask;
+                 i = (i + 1) & s.index_mask, ++probes) {
+                auto v = s.index[i].load(std::memory_order_acquire);
+                if (!v) break;
+
+                auto & e = s.entries[v - 1];
+                auto sequence = e.sequence.load(std::memory_order_acquire);
+                if (sequence & 1) continue;
+
+                alignas(Key) unsigned char k[sizeof(Key)];
+                alignas(Value) unsigned char value[sizeof(Value)];
+                auto stored = e.hash;
+                std::memcpy(k, &e.key, sizeof(Key));
+                std::memcpy(value, &e.value, sizeof(Value));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (e.sequence.load(std::memory_order_relaxed) != sequence) continue;
+
+                if (stored == h && *std::launder(reinterpret_cast<Key *>(k)) == key) {
+                    bump(const_cast<entry &>(e).frequency);
+                    stats.local().hits.fetch_add(1, std::memory_order_relaxed);
+                    return *std::launder(reinterpret_cast<Value *>(value));
+                }
+            }
+
+            stats.local().misses.fetch_add(1, std::memory_order_relaxed);
+            return std::nullopt;
+
+        } // sharded::find()
+
+        // Touches the key's index position ahead of find(), for prefetch::lookup().
+        inline void
+        prefetch(
+            const Key & key
+            ) const noexcept {
+
+            auto h = hash(key);
+            auto & s = owner(h);
+            prefetch::read(&s.index[static_cast<std::uint32_t>(h) & s.index_mask]);
+
+        } // sharded::prefetch()
+
+        // Stores or updates a value. Returns false when the admission filter turned a new key away.
+        inline bool
+        insert(
+            const Key & key,
+            const Value & value
+            ) noexcept(false) {
+
+            auto h = hash(key);
+            auto & s = owner(h);
+            std::lock_guard<std::mutex> guard(s.lock);
+            s.frequencies.age();
+
+            auto found = locate(s, h, key);
+            if (found >= 0) {
+                write(s.entries[found], nullptr, value);
+                return true;
+            }
+
+            bool returning = ghosted(s, h);
+            std::uint32_t slot;
+            if (s.used < s.capacity) {
+                slot = s.used++;
+            } else {
+                auto & queue = (s.small.size() > s.small_target || s.main.empty()) ? s.small : s.main;
+                auto & victim = s.entries[queue.front()];
+                if (!returning && victim.live && s.frequencies.estimate(h) < s.frequencies.estimate(victim.hash)) {
+                    stats.local().rejected.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                slot = evict(s);
+            }
+
+            auto & e = s.entries[slot];
+            e.hash = h;
+            e.live = true;
+            e.frequency.store(0, std::memory_order_relaxed);
+            write(e, &key, value);
+            index(s, slot);
+            (returning ? s.main : s.small).push(slot);
+            return true;
+
+        } // sharded::insert()
+
+        inline bool
+        erase(
+            const Key & key
+            ) noexcept(false) {
+
+            auto h = hash(key);
+            auto & s = owner(h);
+            std::lock_guard<std::mutex> guard(s.lock);
+
+            auto found = locate(s, h, key);
+            if (found < 0) return false;
+            unindex(s, static_cast<std::uint32_t>(found));
+            s.entries[found].live = false;
+            return true;
+
+        } // sharded::erase()
+
+        inline std::size_t
+        shard_count() const noexcept {
+
+            return shard_mask + 1;
+
+        } // sharded::shard_count()
+
+        inline statistics
+        stats_snapshot() const noexcept {
+
+            statistics total{ 0, 0, 0 };
+            stats.for_each([&](const counters & c) {
+                total.hits += c.hits.load(std::memory_order_relaxed);
+                total.misses += c.misses.load(std::memory_order_relaxed);
+                total.rejected += c.rejected.load(std::memory_order_relaxed);
+            });
+            return total;
+
+        } // sharded::stats_snapshot()
+
+    }; // class dtl::cache::sharded
+
+} // namespace dtl::cache
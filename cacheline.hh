@@ -0,0 +1,310 @@
+#pragma once
+
+#include <sched.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "branch.hh"
+#include "branchless.hh"
+
+namespace dtl::cacheline {
+
+    // Line sizes for layout decisions. GCC's std::hardware_destructive_interference_size is ABI-unstable (and warns
+    // when used in headers), so we fix our own: on x86-64 the adjacent-line prefetcher pulls lines in pairs, which
+    // makes 128 bytes the distance that actually stops two writers from interfering.
+#if defined(__x86_64__) || defined(__aarch64__)
+    constexpr std::size_t destructive = 128;
+#else
+    constexpr std::size_t destructive = 64;
+#endif
+    constexpr std::size_t constructive = 64;
+
+    namespace check {
+
+        // Debug-mode sharing checker, compiled in with DTL_CACHELINE_CHECK. Accesses passed to read() and write()
+        // are sampled into a small table keyed by cache line, keeping the last reader and the last writer of each
+        // line. A sample that finds the line written by another thread within the window (or, for a write, read
+        // by another thread) is reported as true sharing (same address) or false sharing (different addresses).
+        // Reads alone never conflict.
+        //
+        // Only unpadded data can falsely share, so the hooks go on raw addresses: call read()/write() next to the
+        // suspect accesses, or wrap the suspect fields in watched<T>, which keeps their layout.
+
+        enum class kind { true_sharing, false_sharing };
+
+        using handler_type = void (*)(kind, const void * line, const void * mine, const void * theirs);
+
+        constexpr std::uint32_t sample_period = 64;
+        constexpr std::uint64_t window_ns = 1000000;
+
+        inline static void
+        report(
+            kind k,
+            const void * line,
+            const void * mine,
+            const void * theirs
+            ) noexcept {
+
+            std::fprintf(stderr, "dtl::cacheline: %s sharing on line %p (%p vs %p)\n",
+                         k == kind::true_sharing ? "true" : "false", line, mine, theirs);
+
+        } // check::report()
+
+        namespace _ {
+
+            struct access {
+
+                std::atomic<std::uint32_t> thread{0};       // zero when none
+                std::atomic<std::uintptr_t> address{0};
+                std::atomic<std::uint64_t> stamp{0};
+
+            }; // struct dtl::cacheline::check::_::access
+
+            struct entry {
+
+                std::atomic<std::uintptr_t> line{0};
+                access writer;
+                access reader;
+                std::atomic<bool> reported{false};
+
+            }; // struct dtl::cacheline::check::_::entry
+
+            constexpr std::size_t slots = 4096;
+
+            struct state {
+
+                entry table[slots];
+                std::atomic<std::uint32_t> threads{0};
+                std::atomic<handler_type> handler{report};
+
+            }; // struct dtl::cacheline::check::_::state
+
+            // External linkage on purpose: one table per process rather than per translation unit.
+            inline state &
+            global() noexcept {
+
+                static state instance;
+                return instance;
+
+            } // _::global()
+
+            inline std::uint32_t
+            self() noexcept {
+
+                thread_local std::uint32_t id = global().threads.fetch_add(1, std::memory_order_relaxed) + 1;
+                return id;
+
+            } // _::self()
+
+            inline void
+            sample(
+                const void * address,
+                bool write
+                ) noexcept {
+
+                thread_local std::uint32_t countdown = 0;
+                if (likely(countdown--)) return;
+                countdown = sample_period - 1;
+
+                auto now = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count());
+                auto at = reinterpret_cast<std::uintptr_t>(address);
+                auto line = at & ~(std::uintptr_t(destructive) - 1);
+                auto me = self();
+
+                auto & g = global();
+                auto & e = g.table[(line / destructive * 0x9e3779b97f4a7c15ull >> 52) & (slots - 1)];
+
+                auto conflict = [&](const access & other) {
+                    auto thread = other.thread.load(std::memory_order_relaxed);
+                    auto theirs = other.address.load(std::memory_order_relaxed);
+                    if (thread && thread != me && now - other.stamp.load(std::memory_order_relaxed) < window_ns
+                        && !e.reported.exchange(true, std::memory_order_relaxed)) {
+                        g.handler.load(std::memory_order_relaxed)(
+                            theirs == at ? kind::true_sharing : kind::false_sharing,
+                            reinterpret_cast<const void *>(line), address, reinterpret_cast<const void *>(theirs));
+                    }
+                };
+
+                if (e.line.load(std::memory_order_relaxed) == line) {
+                    conflict(e.writer);
+                    if (write) conflict(e.reader);
+                } else {
+                    e.line.store(line, std::memory_order_relaxed);
+                    e.writer.thread.store(0, std::memory_order_relaxed);
+                    e.reader.thread.store(0, std::memory_order_relaxed);
+                    e.reported.store(false, std::memory_order_relaxed);
+                }
+
+                auto & mine = write ? e.writer : e.reader;
+                mine.thread.store(me, std::memory_order_relaxed);
+                mine.address.store(at, std::memory_order_relaxed);
+                mine.stamp.store(now, std::memory_order_relaxed);
+
+            } // _::sample()
+
+        } // namespace dtl::cacheline::check::_
+
+        // Replaces the default handler (a line on stderr, once per cache line).
+        inline void
+        on_sharing(
+            handler_type handler
+            ) noexcept {
+
+            _::global().handler.store(handler, std::memory_order_relaxed);
+
+        } // check::on_sharing()
+
+        inline void
+        read(
+            const void * address
+            ) noexcept {
+
+#if defined(DTL_CACHELINE_CHECK)
+            _::sample(address, false);
+#else
+            (void)address;
+#endif
+
+        } // check::read()
+
+        inline void
+        write(
+            const void * address
+            ) noexcept {
+
+#if defined(DTL_CACHELINE_CHECK)
+            _::sample(address, true);
+#else
+            (void)address;
+#endif
+
+        } // check::write()
+
+        // A value in place (no padding, same layout as T) whose accesses are reported to the checker. Access is
+        // explicit, read() or write(), rather than guessed from constness.
+        template<typename T>
+        struct watched {
+
+            T value;
+
+            template<typename... Args, typename = std::enable_if_t<
+                !(sizeof...(Args) == 1 && (std::is_same<std::decay_t<Args>, watched>::value && ...))>>
+            inline constexpr explicit
+            watched(
+                Args &&... args
+                )
+                : value(std::forward<Args>(args)...) {}
+
+            inline const T &
+            read() const noexcept {
+
+                check::read(&value);
+                return value;
+
+            } // watched::read() const
+
+            inline T &
+            write() noexcept {
+
+                check::write(&value);
+                return value;
+
+            } // watched::write()
+
+        }; // struct dtl::cacheline::check::watched
+
+    } // namespace dtl::cacheline::check
+
+    // A value alone on its own line(s): alignment rounds the size up, so arrays of padded<T> never share either.
+    template<typename T>
+    struct alignas(destructive) padded {
+
+        T value;
+
+        template<typename... Args, typename = std::enable_if_t<
+            !(sizeof...(Args) == 1 && (std::is_same<std::decay_t<Args>, padded>::value && ...))>>
+        inline constexpr explicit
+        padded(
+            Args &&... args
+            )
+            : value(std::forward<Args>(args)...) {}
+
+        inline T & get() noexcept { return value; }
+        inline const T & get() const noexcept { return value; }
+
+        inline T & operator*() noexcept { return value; }
+        inline const T & operator*() const noexcept { return value; }
+        inline T * operator->() noexcept { return &value; }
+        inline const T * operator->() const noexcept { return &value; }
+
+    }; // struct dtl::cacheline::padded
+
+    static_assert(sizeof(padded<char>) == destructive);
+
+    inline static unsigned
+    current_cpu() noexcept {
+
+        auto cpu = ::sched_getcpu();
+        return likely(cpu >= 0) ? static_cast<unsigned>(cpu) : 0;
+
+    } // dtl::cacheline::current_cpu()
+
+    // One padded slot per possible CPU, indexed by the CPU the caller is running on. Threads can migrate between
+    // reading the CPU number and touching the slot, so slots still need atomic (if uncontended) updates.
+    template<typename T>
+    class per_cpu {
+
+        std::unique_ptr<padded<T>[]> slots;
+        unsigned mask;
+
+    public:
+
+        inline explicit
+        per_cpu(
+            unsigned cpus = static_cast<unsigned>(::sysconf(_SC_NPROCESSORS_CONF))
+            ) noexcept(false)
+            : slots(), mask(branchless::power_of_2::roundup(cpus ? cpus : 1u) - 1) {
+
+            slots.reset(new padded<T>[mask + 1]);
+
+        } // per_cpu::per_cpu()
+
+        inline T &
+        local() noexcept {
+
+            return slots[current_cpu() & mask].value;
+
+        } // per_cpu::local()
+
+        inline T & operator[](std::size_t i) noexcept { return slots[i].value; }
+        inline const T & operator[](std::size_t i) const noexcept { return slots[i].value; }
+
+        inline std::size_t
+        size() const noexcept {
+
+            return mask + 1;
+
+        } // per_cpu::size() const
+
+        // Visits every slot, e.g. to sum per-CPU counters.
+        template<typename Visitor>
+        inline void
+        for_each(
+            Visitor && visitor
+            ) const {
+
+            for (std::size_t i = 0; i <= mask; ++i) visitor(static_cast<const T &>(slots[i].value));
+
+        } // per_cpu::for_each() const
+
+    }; // class dtl::cacheline::per_cpu
+
+} // namespace dtl::cacheline
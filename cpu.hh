@@ -0,0 +1,390 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <utility>
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+namespace dtl::cpu {
+
+    enum class feature : std::uint32_t {
+        sse2, sse3, ssse3, sse41, sse42, popcnt, pclmul, aes,
+        avx, avx2, bmi1, bmi2, fma,
+        avx512f, avx512dq, avx512bw, avx512vl, avx512vbmi,
+        erms, fsrm
+    }; // enum class dtl::cpu::feature
+
+    // Dispatch tiers, each a superset of the one below:
+    //   scalar - the x86-64 baseline (SSE2) only.
+    //   sse4   - SSSE3, SSE4.1/4.2, POPCNT, PCLMULQDQ, AES-NI.
+    //   avx2   - AVX, AVX2, BMI1/2 and FMA, with the OS saving YMM state.
+    //   avx512 - AVX-512 F/DQ/BW/VL, with the OS saving opmask and ZMM state.
+    enum class tier : std::uint32_t {
+        scalar, sse4, avx2, avx512
+    }; // enum class dtl::cpu::tier
+
+    class features {
+
+        std::uint64_t bits = 0;
+
+    public:
+
+        constexpr features() noexcept = default;
+
+        inline constexpr explicit
+        features(
+            std::uint64_t bits
+            ) noexcept
+            : bits(bits) {}
+
+        inline constexpr bool
+        has(
+            feature f
+            ) const noexcept {
+
+            return (bits >> static_cast<std::uint32_t>(f)) & 1;
+
+        } // features::has()
+
+        template<typename... Features>
+        inline constexpr bool
+        all(
+            Features... fs
+            ) const noexcept {
+
+            return (has(fs) && ...);
+
+        } // features::all()
+
+        inline constexpr void
+        set(
+            feature f
+            ) noexcept {
+
+            bits |= std::uint64_t(1) << static_cast<std::uint32_t>(f);
+
+        } // features::set()
+
+        inline constexpr features
+        operator&(
+            features other
+            ) const noexcept {
+
+            return features(bits & other.bits);
+
+        } // features::operator&()
+
+        inline constexpr std::uint64_t
+        mask() const noexcept {
+
+            return bits;
+
+        } // features::mask()
+
+        // Highest tier whose requirements are all met.
+        inline constexpr cpu::tier
+        tier() const noexcept {
+
+            if (!all(feature::sse2, feature::sse3, feature::ssse3, feature::sse41, feature::sse42, feature::popcnt)) {
+                return tier::scalar;
+            }
+            if (!all(feature::avx, feature::avx2, feature::bmi1, feature::bmi2, feature::fma)) return tier::sse4;
+            if (!all(feature::avx512f, feature::avx512dq, feature::avx512bw, feature::avx512vl)) return tier::avx2;
+            return tier::avx512;
+
+        } // features::tier()
+
+    }; // class dtl::cpu::features
+
+    namespace _ {
+
+        // Features allowed when capped at a tier. ERMS/FSRM are not vector extensions and survive every cap.
+        inline static constexpr features
+        ceiling(
+            tier t
+            ) noexcept {
+
+            features f;
+            f.set(feature::sse2);
+            f.set(feature::erms);
+            f.set(feature::fsrm);
+            if (t >= tier::sse4) {
+                for (auto g : { feature::sse3, feature::ssse3, feature::sse41, feature::sse42,
+                                feature::popcnt, feature::pclmul, feature::aes }) f.set(g);
+            }
+            if (t >= tier::avx2) {
+                for (auto g : { feature::avx, feature::avx2, feature::bmi1, feature::bmi2, feature::fma }) f.set(g);
+            }
+            if (t >= tier::avx512) {
+                for (auto g : { feature::avx512f, feature::avx512dq, feature::avx512bw,
+                                feature::avx512vl, feature::avx512vbmi }) f.set(g);
+            }
+            return f;
+
+        } // _::ceiling()
+
+#if defined(__x86_64__)
+
+        inline static std::uint64_t
+        xgetbv() noexcept {
+
+            std::uint32_t eax, edx;
+            asm volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+            return (std::uint64_t(edx) << 32) | eax;
+
+        } // _::xgetbv()
+
+        inline static features
+        detect() noexcept {
+
+            features f;
+            unsigned eax, ebx, ecx, edx;
+
+            if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return f;
+            auto bit = [](unsigned reg, unsigned n) { return (reg >> n) & 1; };
+
+            if (bit(edx, 26)) f.set(feature::sse2);
+            if (bit(ecx,  0)) f.set(feature::sse3);
+            if (bit(ecx,  1)) f.set(feature::pclmul);
+            if (bit(ecx,  9)) f.set(feature::ssse3);
+            if (bit(ecx, 19)) f.set(feature::sse41);
+            if (bit(ecx, 20)) f.set(feature::sse42);
+            if (bit(ecx, 23)) f.set(feature::popcnt);
+            if (bit(ecx, 25)) f.set(feature::aes);
+
+            // AVX state must be enabled by the OS in XCR0 (XMM | YMM, plus opmask | ZMM_Hi256 | Hi16_ZMM for AVX-512).
+            bool ymm = false, zmm = false;
+            if (bit(ecx, 27)) {
+                auto xcr0 = xgetbv();
+                ymm = ((xcr0 & 0x06) == 0x06);
+                zmm = ymm && ((xcr0 & 0xe0) == 0xe0);
+            }
+            bool fma = bit(ecx, 12);
+            if (ymm && bit(ecx, 28)) {
+                f.set(feature::avx);
+                if (fma) f.set(feature::fma);
+            }
+
+            if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+                if (bit(ebx,  3)) f.set(feature::bmi1);
+                if (bit(ebx,  8)) f.set(feature::bmi2);
+                if (bit(ebx,  9)) f.set(feature::erms);
+                if (bit(edx,  4)) f.set(feature::fsrm);
+                if (ymm && bit(ebx, 5)) f.set(feature::avx2);
+                if (zmm) {
+                    if (bit(ebx, 16)) f.set(feature::avx512f);
+                    if (bit(ebx, 17)) f.set(feature::avx512dq);
+                    if (bit(ebx, 30)) f.set(feature::avx512bw);
+                    if (bit(ebx, 31)) f.set(feature::avx512vl);
+                    if (bit(ecx,  1)) f.set(feature::avx512vbmi);
+                }
+            }
+
+            return f;
+
+        } // _::detect()
+
+#else
+
+        inline static features
+        detect() noexcept {
+
+            return features();
+
+        } // _::detect()
+
+#endif
+
+        // Setting DTL_CPU_TIER=scalar|sse4|avx2|avx512 in the environment caps the tier for the whole process.
+        inline static features
+        environment(
+            features f
+            ) noexcept {
+
+            auto * value = std::getenv("DTL_CPU_TIER");
+            if (!value) return f;
+
+            constexpr const char * names[] = { "scalar", "sse4", "avx2", "avx512" };
+            for (std::uint32_t t = 0; t < 4; ++t) {
+                if (!std::strcmp(value, names[t])) return f & ceiling(static_cast<tier>(t));
+            }
+            return f;
+
+        } // _::environment()
+
+        class binding {
+
+        public:
+
+            binding * next = nullptr;
+
+            virtual void rebind(const features & f) noexcept = 0;
+
+        protected:
+
+            ~binding() = default;
+
+        }; // class dtl::cpu::_::binding
+
+        struct registry {
+
+            std::mutex lock;
+            binding * head = nullptr;
+            features effective = environment(detect());
+
+        }; // struct dtl::cpu::_::registry
+
+        // External linkage on purpose: one registry per process rather than per translation unit.
+        inline registry &
+        bindings() noexcept {
+
+            static registry instance;
+            return instance;
+
+        } // _::bindings()
+
+    } // namespace dtl::cpu::_
+
+    // Features of the machine we are running on, as reported by CPUID and XCR0.
+    inline features
+    host() noexcept {
+
+        static const features detected = _::detect();
+        return detected;
+
+    } // dtl::cpu::host()
+
+    // Features dispatchers resolve against: the host's, capped by DTL_CPU_TIER or force().
+    inline features
+    current() noexcept {
+
+        auto & r = _::bindings();
+        std::lock_guard<std::mutex> guard(r.lock);
+        return r.effective;
+
+    } // dtl::cpu::current()
+
+    // Caps every dispatcher, present and future, at the given tier (or lifts the cap when given the host's tier).
+    // Meant for tests validating each code path on one machine: it must not race with calls through dispatchers.
+    inline void
+    force(
+        tier t
+        ) noexcept {
+
+        auto & r = _::bindings();
+        std::lock_guard<std::mutex> guard(r.lock);
+        r.effective = host() & _::ceiling(t);
+        for (auto * b = r.head; b; b = b->next) b->rebind(r.effective);
+
+    } // dtl::cpu::force()
+
+    // A value (typically a function pointer, or a struct of them) chosen from the CPU's features by a resolver. It
+    // is resolved once at construction and again only when force() changes the effective features, so calls
+    // through it cost one load and an indirect call, as with an ifunc.
+    template<typename Value>
+    class dispatch final : _::binding {
+
+        using resolver_type = Value (*)(const features &);
+
+        Value value;
+        resolver_type resolver;
+
+        inline void
+        rebind(
+            const features & f
+            ) noexcept override {
+
+            value = resolver(f);
+
+        } // dispatch::rebind()
+
+    public:
+
+        inline explicit
+        dispatch(
+            resolver_type resolver
+            ) noexcept
+            : resolver(resolver) {
+
+            auto & r = _::bindings();
+            std::lock_guard<std::mutex> guard(r.lock);
+            value = resolver(r.effective);
+            next = r.head;
+            r.head = this;
+
+        } // dispatch::dispatch()
+
+        inline
+        ~dispatch() noexcept {
+
+            auto & r = _::bindings();
+            std::lock_guard<std::mutex> guard(r.lock);
+            for (auto ** b = &r.head; *b; b = &(*b)->next) {
+                if (*b == this) {
+                    *b = next;
+                    break;
+                }
+            }
+
+        } // dispatch::~dispatch()
+
+        dispatch(dispatch const & other) = delete;
+        dispatch & operator=(dispatch const & other) = delete;
+
+        inline const Value &
+        get() const noexcept {
+
+            return value;
+
+        } // dispatch::get() const
+
+        inline const Value &
+        operator*() const noexcept {
+
+            return value;
+
+        } // dispatch::operator*() const
+
+        inline const Value *
+        operator->() const noexcept {
+
+            return &value;
+
+        } // dispatch::operator->() const
+
+        template<typename... Args>
+        inline decltype(auto)
+        operator()(
+            Args &&... args
+            ) const {
+
+            return value(std::forward<Args>(args)...);
+
+        } // dispatch::operator()() const
+
+    }; // class dtl::cpu::dispatch
+
+    // Picks the candidate for the highest tier not above the effective one, skipping tiers given as nullptr.
+    template<typename Fn>
+    inline static constexpr Fn *
+    select(
+        const features & f,
+        Fn * scalar,
+        Fn * sse4 = nullptr,
+        Fn * avx2 = nullptr,
+        Fn * avx512 = nullptr
+        ) noexcept {
+
+        Fn * candidates[] = { scalar, sse4, avx2, avx512 };
+        for (auto t = static_cast<int>(f.tier()); t > 0; --t) {
+            if (candidates[t]) return candidates[t];
+        }
+        return scalar;
+
+    } // dtl::cpu::select()
+
+} // namespace dtl::cpu
@@ -0,0 +1,734 @@
+#pragma once
+
+#include <fcntl.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include "branch.hh"
+#include "hash.hh"
+#include "prefetch.hh"
+#include "raii.hh"
+
+namespace dtl::dns {
+
+    // DNS inspection without allocation:
+    //
+    //   message  - validates a wire-format message once (header, every question and resource record, compressed
+    //              names) and then hands out views into the packet: names are walked label by label in place.
+    //   suffixes - domain blocklist compiled into a flat image of hashed suffixes: "example.com" matches itself
+    //              and every name below it. A lookup hashes each suffix of the query right to left, prefetches all
+    //              of their buckets at once, then probes from the most specific suffix and verifies the labels.
+    //
+    // Name comparisons fold ASCII case, as DNS does.
+
+    constexpr static std::size_t max_name = 255;     // wire length, including length octets and the root label
+    constexpr static std::size_t max_labels = 127;
+
+    enum class section {
+
+        question = 0,
+        answer = 1,
+        authority = 2,
+        additional = 3,
+
+    }; // enum class dtl::dns::section
+
+    namespace _ {
+
+        inline static std::uint16_t
+        load16(
+            const std::uint8_t * p
+            ) noexcept {
+
+            return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+
+        } // _::load16()
+
+        inline static std::uint32_t
+        load32(
+            const std::uint8_t * p
+            ) noexcept {
+
+            std::uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return __builtin_bswap32(v);
+
+        } // _::load32()
+
+        inline static std::uint8_t
+        fold(
+            std::uint8_t c
+            ) noexcept {
+
+            return static_cast<std::uint8_t>(c | (std::uint8_t(c - 'A') < 26 ? 0x20 : 0));
+
+        } // _::fold()
+
+        // Walks the name at offset, calling visitor(label, length) for each label. Returns the offset just past the
+        // name where it appears (past its first compression pointer, if any), or 0 if it is malformed. Pointers must
+        // go strictly backward, before every label seen so far, which rules out loops without counting hops.
+        template<typename Visitor>
+        inline static std::size_t
+        walk(
+            const std::uint8_t * data,
+            std::size_t size,
+            std::size_t offset,
+            Visitor && visitor
+            ) noexcept {
+
+            std::size_t end = 0;
+            std::size_t wire = 0;
+            std::size_t limit = offset;
+
+            for (;;) {
+                if (unlikely(offset >= size)) return 0;
+                std::size_t length = data[offset];
+
+                if (length >= 0xc0) {
+                    if (unlikely(offset + 1 >= size)) return 0;
+                    std::size_t target = ((length & 0x3f) << 8) | data[offset + 1];
+                    if (!end) end = offset + 2;
+                    if (unlikely(target >= limit)) return 0;
+                    offset = limit = target;
+                    continue;
+                }
+
+                if (unlikely(length > 63)) return 0;
+                wire += length + 1;
+                if (unlikely(wire > max_name)) return 0;
+                if (!length) return end ? end : offset + 1;
+                if (unlikely(offset + 1 + length > size)) return 0;
+                visitor(data + offset + 1, length);
+                offset += 1 + length;
+            }
+
+        } // _::walk()
+
+    } // namespace dtl::dns::_
+
+    // A name inside a validated message.
+    class name {
+
+        const std::uint8_t * data = nullptr;
+        std::size_t size = 0;
+        std::size_t offset = 0;
+
+    public:
+
+        name() = default;
+
+        inline
+        name(
+            const std::uint8_t * data,
+            std::size_t size,
+            std::size_t offset
+            ) noexcept
+            : data(data), size(size), offset(offset) {}
+
+        // Visits the labels left to right as visitor(const uint8_t * label, size_t length).
+        template<typename Visitor>
+        inline void
+        for_each(
+            Visitor && visitor
+            ) const noexcept {
+
+            _::walk(data, size, offset, visitor);
+
+        } // name::for_each() const
+
+        inline std::size_t
+        labels() const noexcept {
+
+            std::size_t count = 0;
+            for_each([&](const std::uint8_t *, std::size_t) { ++count; });
+            return count;
+
+        } // name::labels() const
+
+        // Length in dotted form without a trailing dot; at most max_name - 2.
+        inline std::size_t
+        length() const noexcept {
+
+            std::size_t total = 0;
+            for_each([&](const std::uint8_t *, std::size_t n) { total += n + 1; });
+            return total ? total - 1 : 0;
+
+        } // name::length() const
+
+        // Writes the dotted form, case preserved, truncated to capacity; returns length().
+        inline std::size_t
+        copy(
+            char * out,
+            std::size_t capacity
+            ) const noexcept {
+
+            std::size_t at = 0;
+            for_each([&](const std::uint8_t * label, std::size_t n) {
+                if (at) {
+                    if (at < capacity) out[at] = '.';
+                    ++at;
+                }
+                if (at < capacity) std::memcpy(out + at, label, std::min(n, capacity - at));
+                at += n;
+            });
+            return at;
+
+        } // name::copy() const
+
+        // Case-insensitive comparison with a dotted name; a single trailing dot is ignored.
+        inline bool
+        equals(
+            std::string_view dotted
+            ) const noexcept {
+
+            if (!dotted.empty() && dotted.back() == '.') dotted.remove_suffix(1);
+            std::size_t at = 0;
+            bool same = true;
+            for_each([&](const std::uint8_t * label, std::size_t n) {
+                if (!same) return;
+                if (at) {
+                    if (at >= dotted.size() || dotted[at] != '.') {
+                        same = false;
+                        return;
+                    }
+                    ++at;
+                }
+                if (at + n > dotted.size()) {
+                    same = false;
+                    return;
+                }
+                for (std::size_t i = 0; i < n; ++i) {
+                    if (_::fold(label[i]) != _::fold(static_cast<std::uint8_t>(dotted[at + i]))) {
+                        same = false;
+                        return;
+                    }
+                }
+                at += n;
+            });
+            return same && at == dotted.size();
+
+        } // name::equals() const
+
+    }; // class dtl::dns::name
+
+    struct question {
+
+        dns::name name;
+        std::uint16_t type;
+        std::uint16_t klass;
+
+    }; // struct dtl::dns::question
+
+    struct record {
+
+        dns::name name;
+        std::uint16_t type;
+        std::uint16_t klass;
+        std::uint32_t ttl;
+        const std::uint8_t * rdata;     // within the message; names inside it may be compressed against the message
+        std::uint16_t rdlength;
+
+    }; // struct dtl::dns::record
+
+    class message {
+
+        const std::uint8_t * data = nullptr;
+        std::size_t size = 0;
+        std::size_t starts[5] = {};     // offset of each section, and the end of the last one
+
+        constexpr static std::size_t header_size = 12;
+
+    public:
+
+        // Validates every section; a message that parses can be walked without further bounds checks failing.
+        // Trailing bytes after the counted records are ignored.
+        inline static std::optional<message>
+        parse(
+            const void * packet,
+            std::size_t length
+            ) noexcept {
+
+            if (unlikely(length < header_size)) return std::nullopt;
+
+            message m;
+            m.data = static_cast<const std::uint8_t *>(packet);
+            m.size = length;
+
+            auto at = header_size;
+            auto ignore = [](const std::uint8_t *, std::size_t) {};
+            for (int s = 0; s < 4; ++s) {
+                m.starts[s] = at;
+                std::size_t count = _::load16(m.data + 4 + 2 * s);
+                for (std::size_t i = 0; i < count; ++i) {
+                    at = _::walk(m.data, length, at, ignore);
+                    if (unlikely(!at)) return std::nullopt;
+                    if (!s) {
+                        at += 4;
+                        if (unlikely(at > length)) return std::nullopt;
+                        continue;
+                    }
+                    if (unlikely(at + 10 > length)) return std::nullopt;
+                    at += 10 + _::load16(m.data + at + 8);
+                    if (unlikely(at > length)) return std::nullopt;
+                }
+            }
+            m.starts[4] = at;
+            return m;
+
+        } // message::parse()
+
+        inline std::uint16_t id() const noexcept { return _::load16(data); }
+        inline std::uint16_t flags() const noexcept { return _::load16(data + 2); }
+        inline bool response() const noexcept { return data[2] & 0x80; }
+        inline std::uint8_t opcode() const noexcept { return (data[2] >> 3) & 0x0f; }
+        inline bool truncated() const noexcept { return data[2] & 0x02; }
+        inline std::uint8_t rcode() const noexcept { return data[3] & 0x0f; }
+
+        inline std::uint16_t
+        count(
+            section s
+            ) const noexcept {
+
+            return _::load16(data + 4 + 2 * static_cast<int>(s));
+
+        } // message::count() const
+
+        // Bytes covered by the header and the counted records.
+        inline std::size_t
+        length() const noexcept {
+
+            return starts[4];
+
+        } // message::length() const
+
+        // Visits the question section as visitor(const question &).
+        template<typename Visitor>
+        inline void
+        questions(
+            Visitor && visitor
+            ) const noexcept(noexcept(visitor(std::declval<const question &>()))) {
+
+            auto at = starts[0];
+            auto ignore = [](const std::uint8_t *, std::size_t) {};
+            for (std::size_t i = 0, n = count(section::question); i < n; ++i) {
+                question q{ name(data, size, at), 0, 0 };
+                at = _::walk(data, size, at, ignore);
+                q.type = _::load16(data + at);
+                q.klass = _::load16(data + at + 2);
+                at += 4;
+                visitor(static_cast<const question &>(q));
+            }
+
+        } // message::questions() const
+
+        // Visits the records of an answer, authority or additional section as visitor(const record &).
+        template<typename Visitor>
+        inline void
+        records(
+            section s,
+            Visitor && visitor
+            ) const noexcept(noexcept(visitor(std::declval<const record &>()))) {
+
+            if (unlikely(s == section::question)) return;
+            auto at = starts[static_cast<int>(s)];
+            auto ignore = [](const std::uint8_t *, std::size_t) {};
+            for (std::size_t i = 0, n = count(s); i < n; ++i) {
+                record r{ name(data, size, at), 0, 0, 0, nullptr, 0 };
+                at = _::walk(data, size, at, ignore);
+                r.type = _::load16(data + at);
+                r.klass = _::load16(data + at + 2);
+                r.ttl = _::load32(data + at + 4);
+                r.rdlength = _::load16(data + at + 8);
+                r.rdata = data + at + 10;
+                at += 10 + r.rdlength;
+                visitor(static_cast<const record &>(r));
+            }
+
+        } // message::records() const
+
+        // A name found in rdata (NS, CNAME, PTR, MX after its preference), resolved against this message.
+        inline std::optional<dns::name>
+        name_at(
+            const std::uint8_t * where
+            ) const noexcept {
+
+            if (unlikely(where < data || where >= data + size)) return std::nullopt;
+            std::size_t offset = static_cast<std::size_t>(where - data);
+            if (unlikely(!_::walk(data, size, offset, [](const std::uint8_t *, std::size_t) {}))) return std::nullopt;
+            return dns::name(data, size, offset);
+
+        } // message::name_at() const
+
+    }; // class dtl::dns::message
+
+    // Compiled suffix sets are a single flat image, host-endian like multimatch databases:
+    //
+    //   header | slots[buckets] | names
+    //
+    // where each slot holds a suffix hash, the offset of the suffix in names and its value, and names holds the
+    // suffixes in wire form with case folded, for verification. Buckets are a power of two, at most half full,
+    // probed linearly; hash 0 marks an empty slot.
+    struct header {
+
+        constexpr static std::uint32_t signature = 0x4e4c5444; // "DTLN"
+        constexpr static std::uint32_t revision = 1;
+
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t entries;
+        std::uint64_t buckets;
+        std::uint64_t names;
+
+    }; // struct dtl::dns::header
+
+    class suffixes {
+
+        struct slot {
+
+            std::uint64_t hash;
+            std::uint32_t offset;
+            std::uint32_t value;
+
+        }; // struct dtl::dns::suffixes::slot
+
+        static_assert(sizeof(header) % alignof(slot) == 0);
+
+        std::vector<std::uint64_t> storage;
+        raii::mmap mapping;
+        const header * image = nullptr;
+
+        inline static std::size_t
+        footprint(
+            std::uint64_t buckets,
+            std::uint64_t names
+            ) noexcept {
+
+            return sizeof(header) + sizeof(slot) * buckets + ((names + 7) & ~std::uint64_t(7));
+
+        } // suffixes::footprint()
+
+        inline const slot *
+        slots() const noexcept {
+
+            return reinterpret_cast<const slot *>(image + 1);
+
+        } // suffixes::slots()
+
+        inline const std::uint8_t *
+        names() const noexcept {
+
+            return reinterpret_cast<const std::uint8_t *>(slots() + image->buckets);
+
+        } // suffixes::names()
+
+        // Chained right to left over the labels, so each suffix's hash extends the next shorter one's.
+        inline static std::uint64_t
+        step(
+            std::uint64_t h,
+            const std::uint8_t * label,
+            std::size_t length
+            ) noexcept {
+
+            h = (h ^ length) * 0x100000001b3ull;
+            for (std::size_t i = 0; i < length; ++i) h = (h ^ _::fold(label[i])) * 0x100000001b3ull;
+            return h;
+
+        } // suffixes::step()
+
+        inline static std::uint64_t
+        finish(
+            std::uint64_t h
+            ) noexcept {
+
+            h = hash::mix(h);
+            return h | (h == 0);
+
+        } // suffixes::finish()
+
+        constexpr static std::uint64_t seed = 0xcbf29ce484222325ull;
+
+        struct labels {
+
+            const std::uint8_t * at[max_labels];
+            std::uint8_t length[max_labels];
+            std::size_t count = 0;
+
+            inline void
+            operator()(
+                const std::uint8_t * label,
+                std::size_t n
+                ) noexcept {
+
+                at[count] = label;
+                length[count] = static_cast<std::uint8_t>(n);
+                ++count;
+
+            } // labels::operator()()
+
+        }; // struct dtl::dns::suffixes::labels
+
+        // Splits a dotted name; false if it is empty or not a valid DNS name. A leading "*." is dropped, as
+        // blocklists use it to mean the same as the bare suffix.
+        inline static bool
+        split(
+            std::string_view dotted,
+            labels & out
+            ) noexcept {
+
+            if (dotted.size() >= 2 && dotted[0] == '*' && dotted[1] == '.') dotted.remove_prefix(2);
+            if (!dotted.empty() && dotted.back() == '.') dotted.remove_suffix(1);
+            if (dotted.empty()) return false;
+
+            std::size_t wire = 1;
+            while (true) {
+                auto dot = dotted.find('.');
+                auto n = std::min(dot, dotted.size());
+                if (!n || n > 63 || out.count == max_labels) return false;
+                wire += n + 1;
+                if (wire > max_name) return false;
+                out(reinterpret_cast<const std::uint8_t *>(dotted.data()), n);
+                if (dot == std::string_view::npos) return true;
+                dotted.remove_prefix(dot + 1);
+            }
+
+        } // suffixes::split()
+
+        // Do labels [first, count) spell the folded wire-form suffix at offset?
+        inline bool
+        verify(
+            const labels & query,
+            std::size_t first,
+            std::uint32_t offset
+            ) const noexcept {
+
+            auto * stored = names() + offset;
+            for (auto i = first; i < query.count; ++i) {
+                auto n = query.length[i];
+                if (*stored++ != n) return false;
+                for (std::size_t j = 0; j < n; ++j) {
+                    if (stored[j] != _::fold(query.at[i][j])) return false;
+                }
+                stored += n;
+            }
+            return *stored == 0;
+
+        } // suffixes::verify()
+
+        inline const std::uint32_t *
+        match(
+            const labels & query
+            ) const noexcept {
+
+            if (unlikely(!image || !query.count)) return nullptr;
+
+            std::uint64_t hashes[max_labels];
+            auto mask = image->buckets - 1;
+            auto h = seed;
+            for (auto i = query.count; i--; ) {
+                h = step(h, query.at[i], query.length[i]);
+                hashes[i] = finish(h);
+                prefetch::read(&slots()[hashes[i] & mask]);
+            }
+
+            for (std::size_t i = 0; i < query.count; ++i) {
+                for (auto b = hashes[i] & mask; ; b = (b + 1) & mask) {
+                    auto & s = slots()[b];
+                    if (!s.hash) break;
+                    if (s.hash == hashes[i] && verify(query, i, s.offset)) return &s.value;
+                }
+            }
+            return nullptr;
+
+        } // suffixes::match()
+
+        inline void
+        validate(
+            std::size_t size
+            ) const noexcept(false) {
+
+            if (unlikely(size < sizeof(header)
+                      || image->magic != header::signature
+                      || image->version != header::revision
+                      || !image->buckets
+                      || (image->buckets & (image->buckets - 1))
+                      || image->buckets > size
+                      || image->names > size
+                      || image->entries >= image->buckets
+                      || footprint(image->buckets, image->names) != size)) {
+                throw std::system_error(std::make_error_code(std::errc::invalid_argument), "dns::suffixes");
+            }
+
+            // Every occupied slot must point at a terminated name inside the names section.
+            auto * s = slots();
+            for (std::uint64_t b = 0; b < image->buckets; ++b) {
+                if (!s[b].hash) continue;
+                std::uint64_t at = s[b].offset;
+                std::size_t wire = 0;
+                while (at < image->names && names()[at] && wire <= max_name) {
+                    wire += names()[at] + 1;
+                    at += names()[at] + 1;
+                }
+                if (unlikely(at >= image->names || wire > max_name)) {
+                    throw std::system_error(std::make_error_code(std::errc::invalid_argument), "dns::suffixes");
+                }
+            }
+
+        } // suffixes::validate()
+
+    public:
+
+        suffixes() = default;
+        suffixes(suffixes &&) = default;
+        suffixes & operator=(suffixes &&) = default;
+
+        // Builds the set from dotted names and their values (e.g. list or category ids). Invalid names are
+        // skipped; for duplicates the entry given last wins.
+        inline static suffixes
+        compile(
+            const std::vector<std::pair<std::string_view, std::uint32_t>> & entries
+            ) noexcept(false) {
+
+            std::vector<std::uint64_t> hashes;
+            std::vector<std::uint32_t> offsets;
+            std::vector<std::uint32_t> values;
+            std::vector<std::size_t> sources;           // index into entries, as invalid names leave gaps
+            std::vector<std::uint8_t> blob;
+
+            for (std::size_t e = 0; e < entries.size(); ++e) {
+                auto & [dotted, value] = entries[e];
+                labels parts;
+                if (!split(dotted, parts)) continue;
+                sources.push_back(e);
+                auto h = seed;
+                for (auto i = parts.count; i--; ) h = step(h, parts.at[i], parts.length[i]);
+                hashes.push_back(finish(h));
+                offsets.push_back(static_cast<std::uint32_t>(blob.size()));
+                values.push_back(value);
+                for (std::size_t i = 0; i < parts.count; ++i) {
+                    blob.push_back(parts.length[i]);
+                    for (std::size_t j = 0; j < parts.length[i]; ++j) blob.push_back(_::fold(parts.at[i][j]));
+                }
+                blob.push_back(0);
+                if (unlikely(blob.size() > UINT32_MAX)) {
+                    throw std::system_error(std::make_error_code(std::errc::value_too_large), "dns::suffixes");
+                }
+            }
+
+            std::uint64_t buckets = 16;
+            while (buckets < 2 * hashes.size()) buckets *= 2;
+
+            header h{ header::signature, header::revision, 0, buckets, blob.size() };
+            suffixes m;
+            m.storage.resize(footprint(h.buckets, h.names) / 8);
+            auto * base = reinterpret_cast<std::uint8_t *>(m.storage.data());
+            auto * table = reinterpret_cast<slot *>(base + sizeof(header));
+            std::memcpy(base, &h, sizeof(h));
+            std::memcpy(table + buckets, blob.data(), blob.size());
+            m.image = reinterpret_cast<const header *>(base);
+
+            for (std::size_t e = 0; e < hashes.size(); ++e) {
+                labels parts;
+                split(entries[sources[e]].first, parts);
+                for (auto b = hashes[e] & (buckets - 1); ; b = (b + 1) & (buckets - 1)) {
+                    if (!table[b].hash) {
+                        table[b] = { hashes[e], offsets[e], values[e] };
+                        ++h.entries;
+                        break;
+                    }
+                    if (table[b].hash == hashes[e] && m.verify(parts, 0, table[b].offset)) {
+                        table[b].value = values[e];
+                        break;
+                    }
+                }
+            }
+            std::memcpy(base, &h, sizeof(h));
+            return m;
+
+        } // suffixes::compile()
+
+        // Maps a set previously written by save(); the image is used in place without deserializing.
+        inline static suffixes
+        load(
+            const char * path
+            ) noexcept(false) {
+
+            int handle = ::open(path, O_RDONLY | O_CLOEXEC);
+            if (unlikely(handle == -1)) throw std::system_error(errno, std::system_category(), "open");
+
+            suffixes m;
+            m.mapping = raii::mmap(raii::fd(handle));
+            m.image = static_cast<const header *>(m.mapping.get());
+            m.validate(m.mapping.size());
+            return m;
+
+        } // suffixes::load()
+
+        inline void
+        save(
+            const char * path
+            ) const noexcept(false) {
+
+            raii::fd handle(::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+            if (unlikely(!handle)) throw std::system_error(errno, std::system_category(), "open");
+
+            auto size = size_bytes();
+            if (unlikely(::ftruncate(handle, size) == -1)) throw std::system_error(errno, std::system_category(), "ftruncate");
+
+            raii::mmap file(std::move(handle), PROT_READ | PROT_WRITE, MAP_SHARED);
+            std::memcpy(file.get(), image, size);
+
+        } // suffixes::save()
+
+        inline std::size_t
+        size_bytes() const noexcept {
+
+            return image ? footprint(image->buckets, image->names) : 0;
+
+        } // suffixes::size_bytes()
+
+        inline std::size_t
+        size() const noexcept {
+
+            return image ? image->entries : 0;
+
+        } // suffixes::size()
+
+        inline
+        operator bool() const noexcept {
+
+            return (image != nullptr);
+
+        } // suffixes::operator bool() const
+
+        // Value of the most specific listed suffix of the name, or nullptr.
+        inline const std::uint32_t *
+        find(
+            const name & query
+            ) const noexcept {
+
+            labels parts;
+            query.for_each(parts);
+            return match(parts);
+
+        } // suffixes::find()
+
+        inline const std::uint32_t *
+        find(
+            std::string_view dotted
+            ) const noexcept {
+
+            labels parts;
+            if (!split(dotted, parts)) return nullptr;
+            return match(parts);
+
+        } // suffixes::find(std::string_view)
+
+    }; // class dtl::dns::suffixes
+
+} // namespace dtl::dns
@@ -0,0 +1,757 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#if defined(__SSSE3__) && !defined(DTL_SIMD_SCALAR)
+#include <immintrin.h>
+#endif
+#include "branch.hh"
+
+namespace dtl::encoding {
+
+    // Base64 (RFC 4648, standard alphabet, padded), hex and UTF-8 validation for record-rate encoding work.
+    //
+    // The vector kernels are the lookup-table formulations of Muła, Lemire and Keiser: base64 and hex translate
+    // characters with pshufb nibble lookups and pack/unpack bits with multiply-add; UTF-8 is validated by looking
+    // up each pair of adjacent bytes in three nibble tables whose AND is non-zero exactly for invalid pairs, with
+    // the 3- and 4-byte sequence lengths checked separately. Each is written once over a small register interface
+    // and instantiated for AVX2 and SSSE3; the AVX2 kernel takes the bulk, SSSE3 what remains of a vector's worth,
+    // and a scalar loop the tail. Without SSSE3 (or with DTL_SIMD_SCALAR) everything runs the scalar loops.
+    //
+    // Decoders stop their vector loop at the first block with an invalid character and let the scalar loop find
+    // and reject it, so the vector paths never have to report where input went wrong.
+
+    namespace _ {
+
+        constexpr static char base64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        constexpr static char hex_lower[] = "0123456789abcdef";
+        constexpr static char hex_upper[] = "0123456789ABCDEF";
+        constexpr static std::uint8_t invalid = 0xff;
+
+        inline static constexpr std::array<std::uint8_t, 256>
+        base64_values() noexcept {
+
+            std::array<std::uint8_t, 256> values{};
+            for (auto & v : values) v = invalid;
+            for (std::size_t i = 0; i < 64; ++i) values[static_cast<std::uint8_t>(base64_alphabet[i])] = i;
+            return values;
+
+        } // _::base64_values()
+
+        inline static constexpr std::array<std::uint8_t, 256>
+        hex_values() noexcept {
+
+            std::array<std::uint8_t, 256> values{};
+            for (auto & v : values) v = invalid;
+            for (std::size_t i = 0; i < 10; ++i) values['0' + i] = i;
+            for (std::size_t i = 0; i < 6; ++i) values['a' + i] = values['A' + i] = 10 + i;
+            return values;
+
+        } // _::hex_values()
+
+        constexpr static auto base64_table = base64_values();
+        constexpr static auto hex_table = hex_values();
+
+#if defined(__SSSE3__) && !defined(DTL_SIMD_SCALAR)
+
+        // The register interface the kernels are written against. Lookups (shuffle) index within 16-byte lanes,
+        // so every table is 16 bytes, repeated across lanes by table().
+        struct ssse3 {
+
+            using reg = __m128i;
+            constexpr static std::size_t size = 16;
+            constexpr static std::size_t reach = 16;    // bytes spread() reads to produce 12 per lane
+            constexpr static std::uint32_t full = 0xffff;
+
+            static reg load(const void * p) noexcept { return _mm_loadu_si128(static_cast<const reg *>(p)); }
+            static void store(void * p, reg v) noexcept { _mm_storeu_si128(static_cast<reg *>(p), v); }
+            static reg table(const std::int8_t * t) noexcept { return load(t); }
+            static reg zero() noexcept { return _mm_setzero_si128(); }
+            static reg splat8(std::int8_t x) noexcept { return _mm_set1_epi8(x); }
+            static reg splat16(std::int16_t x) noexcept { return _mm_set1_epi16(x); }
+            static reg splat32(std::int32_t x) noexcept { return _mm_set1_epi32(x); }
+            static reg and_(reg a, reg b) noexcept { return _mm_and_si128(a, b); }
+            static reg andnot(reg a, reg b) noexcept { return _mm_andnot_si128(a, b); }
+            static reg or_(reg a, reg b) noexcept { return _mm_or_si128(a, b); }
+            static reg xor_(reg a, reg b) noexcept { return _mm_xor_si128(a, b); }
+            static reg add8(reg a, reg b) noexcept { return _mm_add_epi8(a, b); }
+            static reg sub8(reg a, reg b) noexcept { return _mm_sub_epi8(a, b); }
+            static reg subs_u8(reg a, reg b) noexcept { return _mm_subs_epu8(a, b); }
+            static reg min_u8(reg a, reg b) noexcept { return _mm_min_epu8(a, b); }
+            static reg eq8(reg a, reg b) noexcept { return _mm_cmpeq_epi8(a, b); }
+            static reg gt8(reg a, reg b) noexcept { return _mm_cmpgt_epi8(a, b); }
+            static reg shr4(reg a) noexcept { return _mm_srli_epi16(a, 4); }
+            static reg mulhi_u16(reg a, reg b) noexcept { return _mm_mulhi_epu16(a, b); }
+            static reg mullo16(reg a, reg b) noexcept { return _mm_mullo_epi16(a, b); }
+            static reg maddubs(reg a, reg b) noexcept { return _mm_maddubs_epi16(a, b); }
+            static reg madd16(reg a, reg b) noexcept { return _mm_madd_epi16(a, b); }
+            static reg shuffle(reg t, reg i) noexcept { return _mm_shuffle_epi8(t, i); }
+            static std::uint32_t movemask(reg a) noexcept { return static_cast<std::uint32_t>(_mm_movemask_epi8(a)); }
+            static bool nonzero(reg a) noexcept { return movemask(eq8(a, zero())) != full; }
+
+            // The bytes N positions back, continuing from the previous register.
+            template<int N>
+            static reg prev(reg input, reg previous) noexcept { return _mm_alignr_epi8(input, previous, 16 - N); }
+
+            // 12 input bytes at the start of each lane.
+            static reg spread(const std::uint8_t * p) noexcept { return load(p); }
+
+            // The 12 bytes at the start of each lane, moved to the start of the register.
+            static reg compact(reg a) noexcept { return a; }
+
+            // Lanes of a and b alternately, in order: a0 b0 a1 b1 ...
+            static void
+            interleave(reg a, reg b, reg & first, reg & second) noexcept {
+
+                first = _mm_unpacklo_epi8(a, b);
+                second = _mm_unpackhi_epi8(a, b);
+
+            } // ssse3::interleave()
+
+            // 16-bit lanes of a then b, saturated to bytes, in order.
+            static reg pack(reg a, reg b) noexcept { return _mm_packus_epi16(a, b); }
+
+        }; // struct dtl::encoding::_::ssse3
+
+#endif
+#if defined(__AVX2__) && !defined(DTL_SIMD_SCALAR)
+
+        struct avx2 {
+
+            using reg = __m256i;
+            constexpr static std::size_t size = 32;
+            constexpr static std::size_t reach = 28;
+            constexpr static std::uint32_t full = 0xffffffff;
+
+            static reg load(const void * p) noexcept { return _mm256_loadu_si256(static_cast<const reg *>(p)); }
+            static void store(void * p, reg v) noexcept { _mm256_storeu_si256(static_cast<reg *>(p), v); }
+            static reg table(const std::int8_t * t) noexcept {
+                return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(t)));
+            }
+            static reg zero() noexcept { return _mm256_setzero_si256(); }
+            static reg splat8(std::int8_t x) noexcept { return _mm256_set1_epi8(x); }
+            static reg splat16(std::int16_t x) noexcept { return _mm256_set1_epi16(x); }
+            static reg splat32(std::int32_t x) noexcept { return _mm256_set1_epi32(x); }
+            static reg and_(reg a, reg b) noexcept { return _mm256_and_si256(a, b); }
+            static reg andnot(reg a, reg b) noexcept { return _mm256_andnot_si256(a, b); }
+            static reg or_(reg a, reg b) noexcept { return _mm256_or_si256(a, b); }
+            static reg xor_(reg a, reg b) noexcept { return _mm256_xor_si256(a, b); }
+            static reg add8(reg a, reg b) noexcept { return _mm256_add_epi8(a, b); }
+            static reg sub8(reg a, reg b) noexcept { return _mm256_sub_epi8(a, b); }
+            static reg subs_u8(reg a, reg b) noexcept { return _mm256_subs_epu8(a, b); }
+            static reg min_u8(reg a, reg b) noexcept { return _mm256_min_epu8(a, b); }
+            static reg eq8(reg a, reg b) noexcept { return _mm256_cmpeq_epi8(a, b); }
+            static reg gt8(reg a, reg b) noexcept { return _mm256_cmpgt_epi8(a, b); }
+            static reg shr4(reg a) noexcept { return _mm256_srli_epi16(a, 4); }
+            static reg mulhi_u16(reg a, reg b) noexcept { return _mm256_mulhi_epu16(a, b); }
+            static reg mullo16(reg a, reg b) noexcept { return _mm256_mullo_epi16(a, b); }
+            static reg maddubs(reg a, reg b) noexcept { return _mm256_maddubs_epi16(a, b); }
+            static reg madd16(reg a, reg b) noexcept { return _mm256_madd_epi16(a, b); }
+            static reg shuffle(reg t, reg i) noexcept { return _mm256_shuffle_epi8(t, i); }
+            static std::uint32_t movemask(reg a) noexcept { return static_cast<std::uint32_t>(_mm256_movemask_epi8(a)); }
+            static bool nonzero(reg a) noexcept { return !_mm256_testz_si256(a, a); }
+
+            template<int N>
+            static reg prev(reg input, reg previous) noexcept {
+                return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - N);
+            }
+
+            static reg
+            spread(const std::uint8_t * p) noexcept {
+
+                auto lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                auto hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 12));
+                return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+            } // avx2::spread()
+
+            static reg compact(reg a) noexcept { return _mm256_permutevar8x32_epi32(a, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7)); }
+
+            static void
+            interleave(reg a, reg b, reg & first, reg & second) noexcept {
+
+                auto lo = _mm256_unpacklo_epi8(a, b);
+                auto hi = _mm256_unpackhi_epi8(a, b);
+                first = _mm256_permute2x128_si256(lo, hi, 0x20);
+                second = _mm256_permute2x128_si256(lo, hi, 0x31);
+
+            } // avx2::interleave()
+
+            static reg pack(reg a, reg b) noexcept { return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8); }
+
+        }; // struct dtl::encoding::_::avx2
+
+#endif
+#if defined(__SSSE3__) && !defined(DTL_SIMD_SCALAR)
+
+        // Consumes 3/4 of V::size bytes per step while reach bytes remain; returns the number consumed.
+        template<typename V>
+        inline static std::size_t
+        base64_encode(
+            const std::uint8_t * in,
+            std::size_t size,
+            char * out
+            ) noexcept {
+
+            // Each 32-bit lane gets bytes (1, 0, 2, 1) of a triplet, from which two multiplies isolate the four
+            // 6-bit indices into separate bytes; the index range then selects the offset that makes it ASCII.
+            alignas(16) constexpr static std::int8_t triplets[16] = {1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10};
+            alignas(16) constexpr static std::int8_t offsets[16] = {
+                'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+            };
+
+            const auto split = V::table(triplets);
+            const auto shift = V::table(offsets);
+            constexpr std::size_t step = V::size / 4 * 3;
+
+            std::size_t done = 0;
+            for (; size - done >= V::reach; done += step, out += V::size) {
+                auto bytes = V::shuffle(V::spread(in + done), split);
+                auto ac = V::mulhi_u16(V::and_(bytes, V::splat32(0x0fc0fc00)), V::splat32(0x04000040));
+                auto bd = V::mullo16(V::and_(bytes, V::splat32(0x003f03f0)), V::splat32(0x01000010));
+                auto indices = V::or_(ac, bd);
+                auto range = V::subs_u8(indices, V::splat8(51));
+                range = V::or_(range, V::and_(V::gt8(V::splat8(26), indices), V::splat8(13)));
+                V::store(out, V::add8(V::shuffle(shift, range), indices));
+            }
+            return done;
+
+        } // _::base64_encode()
+
+        // Consumes V::size characters per step while the result has room for a whole store and at least one
+        // quartet (the one that may carry padding) is left for the scalar loop; stops early at invalid input.
+        template<typename V>
+        inline static std::size_t
+        base64_decode(
+            const char * in,
+            std::size_t size,
+            std::uint8_t * out
+            ) noexcept {
+
+            // A character is valid when its low-nibble and high-nibble classes share no bit; '/' is told apart
+            // from '+' (same high nibble) by an explicit compare before the high nibble selects the offset.
+            alignas(16) constexpr static std::int8_t low_classes[16] = {
+                0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+            };
+            alignas(16) constexpr static std::int8_t high_classes[16] = {
+                0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+            };
+            alignas(16) constexpr static std::int8_t offsets[16] = {0, 16, 19, 4, -65, -65, -71, -71};
+            alignas(16) constexpr static std::int8_t gather[16] = {2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1};
+
+            const auto low = V::table(low_classes);
+            const auto high = V::table(high_classes);
+            const auto shift = V::table(offsets);
+            const auto order = V::table(gather);
+            const auto nibble = V::splat8(0x2f);
+            constexpr std::size_t step = V::size / 4 * 3;
+
+            std::size_t done = 0;
+            for (; size - done >= V::size / 2 * 3; done += V::size, out += step) {
+                auto text = V::load(in + done);
+                auto hi = V::and_(V::shr4(text), nibble);
+                if (unlikely(V::nonzero(V::and_(V::shuffle(low, V::and_(text, nibble)), V::shuffle(high, hi))))) break;
+                auto values = V::add8(text, V::shuffle(shift, V::add8(V::eq8(text, nibble), hi)));
+                auto pairs = V::maddubs(values, V::splat32(0x01400140));
+                auto triplets = V::madd16(pairs, V::splat32(0x00011000));
+                V::store(out, V::compact(V::shuffle(triplets, order)));
+            }
+            return done;
+
+        } // _::base64_decode()
+
+        template<typename V>
+        inline static std::size_t
+        hex_encode(
+            const std::uint8_t * in,
+            std::size_t size,
+            char * out,
+            const char * digits
+            ) noexcept {
+
+            const auto table = V::table(reinterpret_cast<const std::int8_t *>(digits));
+            const auto low = V::splat8(0x0f);
+
+            std::size_t done = 0;
+            for (; size - done >= V::size; done += V::size, out += 2 * V::size) {
+                auto bytes = V::load(in + done);
+                typename V::reg first, second;
+                V::interleave(V::and_(V::shr4(bytes), low), V::and_(bytes, low), first, second);
+                V::store(out, V::shuffle(table, first));
+                V::store(out + V::size, V::shuffle(table, second));
+            }
+            return done;
+
+        } // _::hex_encode()
+
+        template<typename V>
+        inline static std::size_t
+        hex_decode(
+            const char * in,
+            std::size_t size,
+            std::uint8_t * out
+            ) noexcept {
+
+            const auto zero = V::splat8('0');
+            const auto nine = V::splat8(9);
+            const auto a = V::splat8('a');
+            const auto f = V::splat8(5);
+            const auto ten = V::splat8(10);
+            const auto lower = V::splat8(0x20);
+
+            auto nibbles = [&](typename V::reg text, typename V::reg & valid) {
+                auto digit = V::sub8(text, zero);
+                auto letter = V::sub8(V::or_(text, lower), a);
+                auto is_digit = V::eq8(V::min_u8(digit, nine), digit);
+                auto is_letter = V::eq8(V::min_u8(letter, f), letter);
+                valid = V::and_(valid, V::or_(is_digit, is_letter));
+                return V::or_(V::and_(is_digit, digit), V::andnot(is_digit, V::add8(letter, ten)));
+            };
+
+            std::size_t done = 0;
+            for (; size - done >= 2 * V::size; done += 2 * V::size, out += V::size) {
+                auto valid = V::eq8(zero, zero);
+                auto first = nibbles(V::load(in + done), valid);
+                auto second = nibbles(V::load(in + done + V::size), valid);
+                if (unlikely(V::movemask(valid) != V::full)) break;
+                auto weights = V::splat16(0x0110);
+                V::store(out, V::pack(V::maddubs(first, weights), V::maddubs(second, weights)));
+            }
+            return done;
+
+        } // _::hex_decode()
+
+        // Error bits for a pair of adjacent bytes; a pair is invalid when all three lookups share one.
+        constexpr static std::int8_t too_short = 1 << 0;    // lead then ASCII or lead
+        constexpr static std::int8_t too_long = 1 << 1;     // ASCII then continuation
+        constexpr static std::int8_t overlong_3 = 1 << 2;   // E0 80..9F
+        constexpr static std::int8_t too_large = 1 << 3;    // F4 90..BF, F5..FF
+        constexpr static std::int8_t surrogate = 1 << 4;    // ED A0..BF
+        constexpr static std::int8_t overlong_2 = 1 << 5;   // C0..C1
+        constexpr static std::int8_t too_large_1000 = 1 << 6;
+        constexpr static std::int8_t overlong_4 = 1 << 6;   // F0 80..8F
+        constexpr static std::int8_t two_continuations = -128;
+        constexpr static std::int8_t carry = too_short | too_long | two_continuations;
+
+        // Limits for the last three bytes of a block beyond which a sequence is still open.
+        alignas(32) constexpr static std::uint8_t open_limits[32] = {
+            0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+            0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xf0 - 1, 0xe0 - 1, 0xc0 - 1,
+        };
+
+        template<typename V>
+        class utf8_checker {
+
+            using reg = typename V::reg;
+
+            reg error = V::zero();
+            reg previous = V::zero();
+            reg open = V::zero();
+
+        public:
+
+            inline void
+            feed(
+                reg input
+                ) noexcept {
+
+                if (likely(!V::movemask(input))) {
+                    error = V::or_(error, open);
+                    previous = input;
+                    open = V::zero();
+                    return;
+                }
+
+                alignas(16) constexpr static std::int8_t first_high[16] = {
+                    too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+                    two_continuations, two_continuations, two_continuations, two_continuations,
+                    too_short | overlong_2,
+                    too_short,
+                    too_short | overlong_3 | surrogate,
+                    too_short | too_large | too_large_1000 | overlong_4,
+                };
+                alignas(16) constexpr static std::int8_t first_low[16] = {
+                    carry | overlong_3 | overlong_2 | overlong_4,
+                    carry | overlong_2,
+                    carry,
+                    carry,
+                    carry | too_large,
+                    carry | too_large | too_large_1000,
+                    carry | too_large | too_large_1000,
+                    carry | too_large | too_large_1000,
+                    carry | too_large | too_large_1000,
+                    carry | too_large | too_large_1000,
+                    carry | too_large | too_large_1000,
+                    carry | too_large | too_large_1000,
+                    carry | too_large | too_large_1000,
+                    carry | too_large | too_large_1000 | surrogate,
+                    carry | too_large | too_large_1000,
+                    carry | too_large | too_large_1000,
+                };
+                alignas(16) constexpr static std::int8_t second_high[16] = {
+                    too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+                    too_long | overlong_2 | two_continuations | overlong_3 | too_large_1000 | overlong_4,
+                    too_long | overlong_2 | two_continuations | overlong_3 | too_large,
+                    too_long | overlong_2 | two_continuations | surrogate | too_large,
+                    too_long | overlong_2 | two_continuations | surrogate | too_large,
+                    too_short, too_short, too_short, too_short,
+                };
+
+                const auto nibble = V::splat8(0x0f);
+                auto prev1 = V::template prev<1>(input, previous);
+                auto special = V::and_(
+                    V::and_(V::shuffle(V::table(first_high), V::and_(V::shr4(prev1), nibble)),
+                            V::shuffle(V::table(first_low), V::and_(prev1, nibble))),
+                    V::shuffle(V::table(second_high), V::and_(V::shr4(input), nibble)));
+
+                // Only the third and fourth bytes of a sequence may be continuations without a lead right
+                // before them, and they must be.
+                auto third = V::subs_u8(V::template prev<2>(input, previous), V::splat8(0xe0 - 0x80));
+                auto fourth = V::subs_u8(V::template prev<3>(input, previous), V::splat8(0xf0 - 0x80));
+                auto expected = V::and_(V::or_(third, fourth), V::splat8(-128));
+                error = V::or_(error, V::xor_(expected, special));
+
+                open = V::subs_u8(input, V::load(open_limits + 32 - V::size));
+                previous = input;
+
+            } // utf8_checker::feed()
+
+            inline bool
+            valid() const noexcept {
+
+                return !V::nonzero(error);
+
+            } // utf8_checker::valid() const
+
+        }; // class dtl::encoding::_::utf8_checker
+
+        // The tail is fed zero-padded, which also closes the input: a sequence still open at the end meets an
+        // ASCII zero and fails as too short.
+        template<typename V>
+        inline static bool
+        utf8_valid(
+            const std::uint8_t * text,
+            std::size_t size
+            ) noexcept {
+
+            utf8_checker<V> checker;
+            std::size_t done = 0;
+            for (; size - done >= V::size; done += V::size) checker.feed(V::load(text + done));
+
+            alignas(32) std::uint8_t tail[V::size] = {};
+            if (size - done) std::memcpy(tail, text + done, size - done);
+            checker.feed(V::load(tail));
+            return checker.valid();
+
+        } // _::utf8_valid()
+
+#endif
+
+    } // namespace dtl::encoding::_
+
+    namespace base64 {
+
+        inline static constexpr std::size_t
+        encoded_size(
+            std::size_t size
+            ) noexcept {
+
+            return (size + 2) / 3 * 4;
+
+        } // base64::encoded_size()
+
+        // At least the decoded size of any valid input of this many characters.
+        inline static constexpr std::size_t
+        decoded_size(
+            std::size_t size
+            ) noexcept {
+
+            return size / 4 * 3;
+
+        } // base64::decoded_size()
+
+        // Writes encoded_size(size) characters, padded, and returns that count.
+        inline static std::size_t
+        encode(
+            const void * source,
+            std::size_t size,
+            char * out
+            ) noexcept {
+
+            auto * in = static_cast<const std::uint8_t *>(source);
+            auto * start = out;
+            std::size_t i = 0;
+
+#if defined(__AVX2__) && !defined(DTL_SIMD_SCALAR)
+            i += _::base64_encode<_::avx2>(in + i, size - i, out + i / 3 * 4);
+#endif
+#if defined(__SSSE3__) && !defined(DTL_SIMD_SCALAR)
+            i += _::base64_encode<_::ssse3>(in + i, size - i, out + i / 3 * 4);
+#endif
+            out += i / 3 * 4;
+
+            for (; size - i >= 3; i += 3, out += 4) {
+                std::uint32_t v = std::uint32_t(in[i]) << 16 | std::uint32_t(in[i + 1]) << 8 | in[i + 2];
+                out[0] = _::base64_alphabet[v >> 18];
+                out[1] = _::base64_alphabet[(v >> 12) & 0x3f];
+                out[2] = _::base64_alphabet[(v >> 6) & 0x3f];
+                out[3] = _::base64_alphabet[v & 0x3f];
+            }
+            if (size - i == 1) {
+                out[0] = _::base64_alphabet[in[i] >> 2];
+                out[1] = _::base64_alphabet[(in[i] & 0x03) << 4];
+                out[2] = out[3] = '=';
+                out += 4;
+            } else if (size - i == 2) {
+                out[0] = _::base64_alphabet[in[i] >> 2];
+                out[1] = _::base64_alphabet[(in[i] & 0x03) << 4 | in[i + 1] >> 4];
+                out[2] = _::base64_alphabet[(in[i + 1] & 0x0f) << 2];
+                out[3] = '=';
+                out += 4;
+            }
+            return out - start;
+
+        } // base64::encode()
+
+        // Strict: the length must be a multiple of four, padding may only end the input, and the bits that
+        // padding discards must be zero, so every byte string has exactly one accepted encoding. out needs
+        // decoded_size(size) bytes; returns the number written.
+        inline static std::optional<std::size_t>
+        decode(
+            const char * source,
+            std::size_t size,
+            void * destination
+            ) noexcept {
+
+            if (unlikely(size % 4)) return std::nullopt;
+            if (unlikely(!size)) return 0;
+
+            auto * text = reinterpret_cast<const std::uint8_t *>(source);
+            auto * out = static_cast<std::uint8_t *>(destination);
+            auto * start = out;
+            std::size_t i = 0;
+
+#if defined(__AVX2__) && !defined(DTL_SIMD_SCALAR)
+            i += _::base64_decode<_::avx2>(source + i, size - i, out + i / 4 * 3);
+#endif
+#if defined(__SSSE3__) && !defined(DTL_SIMD_SCALAR)
+            i += _::base64_decode<_::ssse3>(source + i, size - i, out + i / 4 * 3);
+#endif
+            out += i / 4 * 3;
+
+            for (; size - i > 4; i += 4, out += 3) {
+                std::uint32_t a = _::base64_table[text[i]], b = _::base64_table[text[i + 1]];
+                std::uint32_t c = _::base64_table[text[i + 2]], d = _::base64_table[text[i + 3]];
+                if (unlikely((a | b | c | d) & 0x80)) return std::nullopt;
+                std::uint32_t v = a << 18 | b << 12 | c << 6 | d;
+                out[0] = v >> 16;
+                out[1] = v >> 8;
+                out[2] = v;
+            }
+
+            std::uint32_t a = _::base64_table[text[i]], b = _::base64_table[text[i + 1]];
+            std::uint32_t c = _::base64_table[text[i + 2]], d = _::base64_table[text[i + 3]];
+            if (unlikely((a | b) & 0x80)) return std::nullopt;
+            *out++ = a << 2 | b >> 4;
+            if (text[i + 2] == '=') {
+                if (text[i + 3] != '=' || (b & 0x0f)) return std::nullopt;
+            } else if (text[i + 3] == '=') {
+                if ((c & 0x80) || (c & 0x03)) return std::nullopt;
+                *out++ = b << 4 | c >> 2;
+            } else {
+                if ((c | d) & 0x80) return std::nullopt;
+                *out++ = b << 4 | c >> 2;
+                *out++ = c << 6 | d;
+            }
+            return out - start;
+
+        } // base64::decode()
+
+        inline static std::string
+        encode(
+            std::string_view data
+            ) {
+
+            std::string text(encoded_size(data.size()), '\0');
+            encode(data.data(), data.size(), text.data());
+            return text;
+
+        } // base64::encode()
+
+        inline static std::optional<std::string>
+        decode(
+            std::string_view text
+            ) {
+
+            std::string data(decoded_size(text.size()), '\0');
+            auto size = decode(text.data(), text.size(), data.data());
+            if (!size) return std::nullopt;
+            data.resize(*size);
+            return data;
+
+        } // base64::decode()
+
+    } // namespace dtl::encoding::base64
+
+    namespace hex {
+
+        // Writes 2 * size characters.
+        inline static void
+        encode(
+            const void * source,
+            std::size_t size,
+            char * out,
+            bool upper = false
+            ) noexcept {
+
+            auto * in = static_cast<const std::uint8_t *>(source);
+            auto * digits = upper ? _::hex_upper : _::hex_lower;
+            std::size_t i = 0;
+
+#if defined(__AVX2__) && !defined(DTL_SIMD_SCALAR)
+            i += _::hex_encode<_::avx2>(in + i, size - i, out + 2 * i, digits);
+#endif
+#if defined(__SSSE3__) && !defined(DTL_SIMD_SCALAR)
+            i += _::hex_encode<_::ssse3>(in + i, size - i, out + 2 * i, digits);
+#endif
+
+            for (; i < size; ++i) {
+                out[2 * i] = digits[in[i] >> 4];
+                out[2 * i + 1] = digits[in[i] & 0x0f];
+            }
+
+        } // hex::encode()
+
+        // Either case; size must be even. Writes size / 2 bytes.
+        inline static bool
+        decode(
+            const char * source,
+            std::size_t size,
+            void * destination
+            ) noexcept {
+
+            if (unlikely(size % 2)) return false;
+
+            auto * text = reinterpret_cast<const std::uint8_t *>(source);
+            auto * out = static_cast<std::uint8_t *>(destination);
+            std::size_t i = 0;
+
+#if defined(__AVX2__) && !defined(DTL_SIMD_SCALAR)
+            i += _::hex_decode<_::avx2>(source + i, size - i, out + i / 2);
+#endif
+#if defined(__SSSE3__) && !defined(DTL_SIMD_SCALAR)
+            i += _::hex_decode<_::ssse3>(source + i, size - i, out + i / 2);
+#endif
+
+            for (; i < size; i += 2) {
+                auto hi = _::hex_table[text[i]], lo = _::hex_table[text[i + 1]];
+                if (unlikely((hi | lo) & 0x80)) return false;
+                out[i / 2] = hi << 4 | lo;
+            }
+            return true;
+
+        } // hex::decode()
+
+        inline static std::string
+        encode(
+            std::string_view data,
+            bool upper = false
+            ) {
+
+            std::string text(2 * data.size(), '\0');
+            encode(data.data(), data.size(), text.data(), upper);
+            return text;
+
+        } // hex::encode()
+
+        inline static std::optional<std::string>
+        decode(
+            std::string_view text
+            ) {
+
+            std::string data(text.size() / 2, '\0');
+            if (!decode(text.data(), text.size(), data.data())) return std::nullopt;
+            return data;
+
+        } // hex::decode()
+
+    } // namespace dtl::encoding::hex
+
+    namespace utf8 {
+
+        // Well-formed UTF-8 per RFC 3629: no overlong forms, surrogates or code points above U+10FFFF.
+        inline static bool
+        valid(
+            const char * source,
+            std::size_t size
+            ) noexcept {
+
+            auto * text = reinterpret_cast<const std::uint8_t *>(source);
+
+#if defined(__AVX2__) && !defined(DTL_SIMD_SCALAR)
+            return _::utf8_valid<_::avx2>(text, size);
+#elif defined(__SSSE3__) && !defined(DTL_SIMD_SCALAR)
+            return _::utf8_valid<_::ssse3>(text, size);
+#else
+            for (std::size_t i = 0; i < size; ) {
+                if (size - i >= 8) {
+                    std::uint64_t word;
+                    std::memcpy(&word, text + i, 8);
+                    if (!(word & 0x8080808080808080)) {
+                        i += 8;
+                        continue;
+                    }
+                }
+
+                auto lead = text[i];
+                if (lead < 0x80) {
+                    ++i;
+                    continue;
+                }
+
+                std::size_t length;
+                std::uint8_t low = 0x80, high = 0xbf;
+                if (lead >= 0xc2 && lead <= 0xdf) {
+                    length = 2;
+                } else if (lead >= 0xe0 && lead <= 0xef) {
+                    length = 3;
+                    if (lead == 0xe0) low = 0xa0;
+                    else if (lead == 0xed) high = 0x9f;
+                } else if (lead >= 0xf0 && lead <= 0xf4) {
+                    length = 4;
+                    if (lead == 0xf0) low = 0x90;
+                    else if (lead == 0xf4) high = 0x8f;
+                } else {
+                    return false;
+                }
+
+                if (size - i < length) return false;
+                if (text[i + 1] < low || text[i + 1] > high) return false;
+                for (std::size_t k = 2; k < length; ++k) {
+                    if ((text[i + k] & 0xc0) != 0x80) return false;
+                }
+                i += length;
+            }
+            return true;
+#endif
+
+        } // utf8::valid()
+
+        inline static bool
+        valid(
+            std::string_view text
+            ) noexcept {
+
+            return valid(text.data(), text.size());
+
+        } // utf8::valid()
+
+    } // namespace dtl::encoding::utf8
+
+} // namespace dtl::encoding
@@ -0,0 +1,533 @@
+#pragma once
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <system_error>
+#include "branch.hh"
+#include "cacheline.hh"
+#include "lock.hh"
+
+namespace dtl::futex {
+
+    // Thin wrappers over futex(2) on a std::atomic<std::uint32_t>, and two primitives built on them:
+    //
+    //   parking - an address-keyed parking lot: threads sleep keyed by any address, with a validation step under
+    //             the bucket lock so that a wakeup cannot slip in between the check and the sleep.
+    //   event   - an event count that lets lock-free structures sleep without lost wakeups and without a mutex.
+    //
+    // Words in MAP_SHARED memory that are waited on from several processes need shared = true; the default uses
+    // FUTEX_PRIVATE_FLAG, which skips the kernel's page lookup. Every wait may return spuriously, so callers always
+    // recheck their condition.
+
+    using word = std::atomic<std::uint32_t>;
+    using deadline = std::chrono::steady_clock::time_point;
+
+    static_assert(sizeof(word) == sizeof(std::uint32_t) && word::is_always_lock_free);
+
+    namespace _ {
+
+        inline static long
+        call(
+            const word & address,
+            int operation,
+            bool shared,
+            std::uint32_t value,
+            const ::timespec * timeout = nullptr,
+            std::uint32_t mask = 0
+            ) noexcept {
+
+            return ::syscall(SYS_futex, const_cast<word *>(&address), operation | (shared ? 0 : FUTEX_PRIVATE_FLAG),
+                value, timeout, nullptr, mask);
+
+        } // _::call()
+
+        inline static ::timespec
+        relative(
+            std::chrono::nanoseconds timeout
+            ) noexcept {
+
+            if (timeout.count() < 0) timeout = std::chrono::nanoseconds::zero();
+            return {static_cast<std::time_t>(timeout.count() / 1000000000), static_cast<long>(timeout.count() % 1000000000)};
+
+        } // _::relative()
+
+        // steady_clock is CLOCK_MONOTONIC on Linux, the clock FUTEX_WAIT_BITSET and futex_waitv measure against.
+        inline static ::timespec
+        absolute(
+            deadline until
+            ) noexcept {
+
+            return relative(until.time_since_epoch());
+
+        } // _::absolute()
+
+        // EAGAIN (value already changed) and EINTR are ordinary returns; anything else is misuse.
+        inline static bool
+        settle(
+            long result,
+            const char * what
+            ) noexcept(false) {
+
+            if (likely(!result)) return true;
+            switch (errno) {
+            case EAGAIN:
+            case EINTR:
+                return true;
+            case ETIMEDOUT:
+                return false;
+            default:
+                throw std::system_error(errno, std::system_category(), what);
+            }
+
+        } // _::settle()
+
+    } // namespace dtl::futex::_
+
+    // Sleeps while *address == expected. Returns false only on timeout.
+    inline static bool
+    wait(
+        const word & address,
+        std::uint32_t expected,
+        bool shared = false
+        ) noexcept(false) {
+
+        return _::settle(_::call(address, FUTEX_WAIT, shared, expected), "futex::wait");
+
+    } // dtl::futex::wait()
+
+    inline static bool
+    wait(
+        const word & address,
+        std::uint32_t expected,
+        std::chrono::nanoseconds timeout,
+        bool shared = false
+        ) noexcept(false) {
+
+        auto relative = _::relative(timeout);
+        return _::settle(_::call(address, FUTEX_WAIT, shared, expected, &relative), "futex::wait");
+
+    } // dtl::futex::wait()
+
+    // Returns the number of threads woken.
+    inline static int
+    wake(
+        const word & address,
+        int count = INT_MAX,
+        bool shared = false
+        ) noexcept(false) {
+
+        auto result = _::call(address, FUTEX_WAKE, shared, static_cast<std::uint32_t>(count));
+        if (unlikely(result < 0)) throw std::system_error(errno, std::system_category(), "futex::wake");
+        return static_cast<int>(result);
+
+    } // dtl::futex::wake()
+
+    // As wait(), but only wake_bitset() calls whose mask intersects ours wake us, so one word can carry several
+    // wait channels, e.g. one bit per consumer. The deadline is absolute.
+    inline static bool
+    wait_bitset(
+        const word & address,
+        std::uint32_t expected,
+        std::uint32_t mask,
+        bool shared = false
+        ) noexcept(false) {
+
+        return _::settle(_::call(address, FUTEX_WAIT_BITSET, shared, expected, nullptr, mask), "futex::wait_bitset");
+
+    } // dtl::futex::wait_bitset()
+
+    inline static bool
+    wait_bitset(
+        const word & address,
+        std::uint32_t expected,
+        std::uint32_t mask,
+        deadline until,
+        bool shared = false
+        ) noexcept(false) {
+
+        auto absolute = _::absolute(until);
+        return _::settle(_::call(address, FUTEX_WAIT_BITSET, shared, expected, &absolute, mask), "futex::wait_bitset");
+
+    } // dtl::futex::wait_bitset()
+
+    inline static int
+    wake_bitset(
+        const word & address,
+        std::uint32_t mask,
+        int count = INT_MAX,
+        bool shared = false
+        ) noexcept(false) {
+
+        auto result = _::call(address, FUTEX_WAKE_BITSET, shared, static_cast<std::uint32_t>(count), nullptr, mask);
+        if (unlikely(result < 0)) throw std::system_error(errno, std::system_category(), "futex::wake_bitset");
+        return static_cast<int>(result);
+
+    } // dtl::futex::wake_bitset()
+
+#if defined(SYS_futex_waitv) && defined(FUTEX_32)
+
+    constexpr static bool waitv_available = true;
+
+    struct waiter {
+
+        const word * address;
+        std::uint32_t expected;
+        bool shared = false;
+
+    }; // struct dtl::futex::waiter
+
+    // Sleeps until any of the words is woken (Linux 5.16+). Returns the index of the woken word, or -1 if the call
+    // returned without a wakeup: a value already differed, a signal arrived or the deadline passed. Throws ENOSYS
+    // on older kernels.
+    inline static int
+    waitv(
+        const waiter * waiters,
+        std::size_t count,
+        const deadline * until = nullptr
+        ) noexcept(false) {
+
+        if (unlikely(!count || count > FUTEX_WAITV_MAX)) {
+            throw std::system_error(std::make_error_code(std::errc::invalid_argument), "futex::waitv");
+        }
+
+        ::futex_waitv vector[FUTEX_WAITV_MAX];
+        for (std::size_t i = 0; i < count; ++i) {
+            vector[i] = {};
+            vector[i].val = waiters[i].expected;
+            vector[i].uaddr = reinterpret_cast<std::uintptr_t>(waiters[i].address);
+            vector[i].flags = FUTEX_32 | (waiters[i].shared ? 0 : FUTEX_PRIVATE_FLAG);
+        }
+
+        ::timespec absolute;
+        if (until) absolute = _::absolute(*until);
+        auto result = ::syscall(SYS_futex_waitv, vector, static_cast<unsigned>(count), 0u, until ? &absolute : nullptr,
+            CLOCK_MONOTONIC);
+        if (likely(result >= 0)) return static_cast<int>(result);
+        _::settle(result, "futex::waitv");
+        return -1;
+
+    } // dtl::futex::waitv()
+
+#else
+
+    constexpr static bool waitv_available = false;
+
+#endif
+
+    class parking {
+
+        struct node {
+
+            const void * address;
+            node * next;
+            word woken;
+
+        }; // struct dtl::futex::parking::node
+
+        struct bucket {
+
+            lock::ticket guard;
+            node * head = nullptr;
+            node * tail = nullptr;
+
+            // Unlinks node, whose predecessor is previous (nullptr at the head).
+            inline void
+            unlink(
+                node * previous,
+                node * target
+                ) noexcept {
+
+                (previous ? previous->next : head) = target->next;
+                if (tail == target) tail = previous;
+
+            } // bucket::unlink()
+
+        }; // struct dtl::futex::parking::bucket
+
+        constexpr static std::size_t buckets = 256;
+
+        inline static cacheline::padded<bucket> *
+        table() noexcept {
+
+            static cacheline::padded<bucket> table[buckets];
+            return table;
+
+        } // parking::table()
+
+        inline static bucket &
+        locate(
+            const void * address
+            ) noexcept {
+
+            auto h = reinterpret_cast<std::uintptr_t>(address);
+            h = (h ^ (h >> 17)) * 0x9e3779b97f4a7c15ull;
+            return table()[h >> 56].get();
+
+        } // parking::locate()
+
+        // Off the queue first, then release: the waiter's node lives on its stack and may be gone the moment woken
+        // is set, and a wake on a dead address at worst disturbs an unrelated waiter spuriously.
+        inline static void
+        release(
+            node * target
+            ) noexcept {
+
+            target->woken.store(1, std::memory_order_release);
+            _::call(target->woken, FUTEX_WAKE, false, 1);
+
+        } // parking::release()
+
+        template<typename Validate>
+        inline static bool
+        sleep(
+            const void * address,
+            Validate && validate,
+            const deadline * until
+            ) noexcept(false) {
+
+            auto & b = locate(address);
+            node mine{address, nullptr, {0}};
+            {
+                std::lock_guard<lock::ticket> held(b.guard);
+                if (!validate()) return false;
+                (b.tail ? b.tail->next : b.head) = &mine;
+                b.tail = &mine;
+            }
+
+            while (!mine.woken.load(std::memory_order_acquire)) {
+                if (until) {
+                    if (wait_bitset(mine.woken, 0, FUTEX_BITSET_MATCH_ANY, *until)) continue;
+                    std::lock_guard<lock::ticket> held(b.guard);
+                    node * previous = nullptr;
+                    for (auto * n = b.head; n; previous = n, n = n->next) {
+                        if (n != &mine) continue;
+                        b.unlink(previous, n);
+                        return false;
+                    }
+                    // An unparker already dequeued us; its release is imminent.
+                    until = nullptr;
+                } else {
+                    wait(mine.woken, 0);
+                }
+            }
+            return true;
+
+        } // parking::sleep()
+
+    public:
+
+        // Parks the calling thread on address if validate() still holds under the bucket lock. Returns true if
+        // woken by unpark_one()/unpark_all(), false if validation failed or the deadline passed.
+        template<typename Validate>
+        inline static bool
+        park(
+            const void * address,
+            Validate && validate
+            ) noexcept(false) {
+
+            return sleep(address, validate, nullptr);
+
+        } // parking::park()
+
+        template<typename Validate>
+        inline static bool
+        park(
+            const void * address,
+            Validate && validate,
+            deadline until
+            ) noexcept(false) {
+
+            return sleep(address, validate, &until);
+
+        } // parking::park()
+
+        inline static bool
+        unpark_one(
+            const void * address
+            ) noexcept {
+
+            auto & b = locate(address);
+            node * target = nullptr;
+            {
+                std::lock_guard<lock::ticket> held(b.guard);
+                node * previous = nullptr;
+                for (auto * n = b.head; n; previous = n, n = n->next) {
+                    if (n->address != address) continue;
+                    b.unlink(previous, n);
+                    target = n;
+                    break;
+                }
+            }
+            if (!target) return false;
+            release(target);
+            return true;
+
+        } // parking::unpark_one()
+
+        inline static std::size_t
+        unpark_all(
+            const void * address
+            ) noexcept {
+
+            auto & b = locate(address);
+            node * woken = nullptr;
+            {
+                std::lock_guard<lock::ticket> held(b.guard);
+                node * previous = nullptr;
+                for (auto * n = b.head; n; ) {
+                    auto * next = n->next;
+                    if (n->address == address) {
+                        b.unlink(previous, n);
+                        n->next = woken;
+                        woken = n;
+                    } else {
+                        previous = n;
+                    }
+                    n = next;
+                }
+            }
+            std::size_t count = 0;
+            while (woken) {
+                auto * next = woken->next;
+                release(woken);
+                woken = next;
+                ++count;
+            }
+            return count;
+
+        } // parking::unpark_all()
+
+    }; // class dtl::futex::parking
+
+    // Event count: a waiter takes a key, rechecks its condition and sleeps on the key; a notifier that made the
+    // condition true bumps the epoch. The seq_cst pair between prepare() and notify() means that either the
+    // notifier sees the waiter or the waiter's recheck sees the notifier's update, so no wakeup is lost:
+    //
+    //     for (;;) {
+    //         if (queue.try_pop(item)) break;
+    //         auto key = events.prepare();
+    //         if (queue.try_pop(item)) { events.cancel(); break; }
+    //         events.wait(key);
+    //     }
+    //
+    // Notifiers pay one fence and one load when nobody waits.
+    class event {
+
+        word epoch{0};
+        std::atomic<std::uint32_t> waiters{0};
+        bool shared;
+
+        inline void
+        signal(
+            int count
+            ) noexcept {
+
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (likely(!waiters.load(std::memory_order_relaxed))) return;
+            epoch.fetch_add(1, std::memory_order_release);
+            _::call(epoch, FUTEX_WAKE, shared, static_cast<std::uint32_t>(count));
+
+        } // event::signal()
+
+    public:
+
+        using key = std::uint32_t;
+
+        // shared for an event placed in MAP_SHARED memory and waited on across processes.
+        inline explicit
+        event(
+            bool shared = false
+            ) noexcept
+            : shared(shared) {}
+
+        event(const event &) = delete;
+        event & operator=(const event &) = delete;
+
+        inline key
+        prepare() noexcept {
+
+            waiters.fetch_add(1, std::memory_order_seq_cst);
+            return epoch.load(std::memory_order_acquire);
+
+        } // event::prepare()
+
+        inline void
+        cancel() noexcept {
+
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+
+        } // event::cancel()
+
+        inline void
+        wait(
+            key k
+            ) noexcept(false) {
+
+            while (epoch.load(std::memory_order_acquire) == k) futex::wait(epoch, k, shared);
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+
+        } // event::wait()
+
+        // Returns false if the deadline passed without a notification.
+        inline bool
+        wait(
+            key k,
+            deadline until
+            ) noexcept(false) {
+
+            bool notified = true;
+            while (epoch.load(std::memory_order_acquire) == k) {
+                if (!wait_bitset(epoch, k, FUTEX_BITSET_MATCH_ANY, until, shared)) {
+                    notified = epoch.load(std::memory_order_acquire) != k;
+                    break;
+                }
+            }
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+            return notified;
+
+        } // event::wait()
+
+        // Sleeps until condition() holds.
+        template<typename Condition>
+        inline void
+        await(
+            Condition && condition
+            ) noexcept(false) {
+
+            while (!condition()) {
+                auto k = prepare();
+                if (condition()) {
+                    cancel();
+                    return;
+                }
+                wait(k);
+            }
+
+        } // event::await()
+
+        inline void
+        notify_one() noexcept {
+
+            signal(1);
+
+        } // event::notify_one()
+
+        inline void
+        notify_all() noexcept {
+
+            signal(INT_MAX);
+
+        } // event::notify_all()
+
+    }; // class dtl::futex::event
+
+} // namespace dtl::futex
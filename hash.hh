@@ -0,0 +1,484 @@
+#pragma once
+
+#include <sys/random.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#if defined(__AES__)
+#include <immintrin.h>
+#endif
+#include "branch.hh"
+#include "simd.hh"
+
+namespace dtl::hash {
+
+    // Keyed hashes for tables whose keys an attacker chooses (flow keys, names, header values). With a secret key
+    // the attacker cannot compute which inputs collide, so crafted keys spread like random ones; an unkeyed hash
+    // (std::hash, or the MurmurHash3 finalizer the tables apply on top) is invertible and can be driven into a
+    // single bucket.
+    //
+    //   siphash24 - SipHash-2-4: a PRF, the conservative choice.
+    //   siphash13 - SipHash-1-3: fewer rounds, the default of Rust and CPython hash tables.
+    //   aeshash   - AES rounds keyed with the secret (AES-NI), as in Go's runtime map hash: several times faster
+    //               than SipHash on short keys, but with no security analysis beyond AES's round function.
+    //
+    // Each takes an explicit key or uses seed(), drawn once per process from getrandom(2). The batched overloads
+    // hash several messages of one size (fixed-size flow keys in a burst): SipHash over dtl::simd lanes, one
+    // message per 64-bit lane, given at least four lanes (AVX2); AES with the key schedule hoisted and independent
+    // messages back to back. sip<> and aes<> are the seeded hashes as function objects for the tables' Hash
+    // parameter, in increasing order of speed:
+    //
+    //     hashtable::table<flow, state, hash::sip<flow>> flows;
+
+    struct key {
+
+        std::uint64_t k0;
+        std::uint64_t k1;
+
+    }; // struct dtl::hash::key
+
+    // Finalizer of MurmurHash3, shared by the tables that spread std::hash (the identity for integers) over every
+    // bit before taking bucket, shard or index positions from different bits of it. Unkeyed and invertible: it is
+    // no defence against chosen keys, which is what the keyed hashes below are for.
+    inline static constexpr std::uint64_t
+    mix(
+        std::uint64_t h
+        ) noexcept {
+
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+
+    } // dtl::hash::mix()
+
+    namespace _ {
+
+        inline static std::uint64_t
+        load64(
+            const std::uint8_t * p
+            ) noexcept {
+
+            std::uint64_t v;
+            std::memcpy(&v, p, 8);
+            return v;
+
+        } // _::load64()
+
+        // The last size % 8 bytes, little endian, with size in the top byte.
+        inline static std::uint64_t
+        last(
+            const std::uint8_t * p,
+            std::size_t size
+            ) noexcept {
+
+            std::uint64_t b = static_cast<std::uint64_t>(size) << 56;
+            switch (size & 7) {
+                case 7: b |= static_cast<std::uint64_t>(p[6]) << 48; [[fallthrough]];
+                case 6: b |= static_cast<std::uint64_t>(p[5]) << 40; [[fallthrough]];
+                case 5: b |= static_cast<std::uint64_t>(p[4]) << 32; [[fallthrough]];
+                case 4: b |= static_cast<std::uint64_t>(p[3]) << 24; [[fallthrough]];
+                case 3: b |= static_cast<std::uint64_t>(p[2]) << 16; [[fallthrough]];
+                case 2: b |= static_cast<std::uint64_t>(p[1]) << 8; [[fallthrough]];
+                case 1: b |= p[0];
+            }
+            return b;
+
+        } // _::last()
+
+        // Scalars or simd::vec lanes alike.
+        template<int Bits, typename T>
+        inline static T
+        rotl(
+            T x
+            ) noexcept {
+
+            return { (x.v << Bits) | (x.v >> (64 - Bits)) };
+
+        } // _::rotl()
+
+        template<typename T>
+        struct sipstate {
+
+            T v0, v1, v2, v3;
+
+            inline void
+            round() noexcept {
+
+                v0.v += v1.v; v1 = rotl<13>(v1); v1.v ^= v0.v; v0 = rotl<32>(v0);
+                v2.v += v3.v; v3 = rotl<16>(v3); v3.v ^= v2.v;
+                v0.v += v3.v; v3 = rotl<21>(v3); v3.v ^= v0.v;
+                v2.v += v1.v; v1 = rotl<17>(v1); v1.v ^= v2.v; v2 = rotl<32>(v2);
+
+            } // sipstate::round()
+
+            template<int C>
+            inline void
+            absorb(
+                T m
+                ) noexcept {
+
+                v3.v ^= m.v;
+                for (int i = 0; i < C; ++i) round();
+                v0.v ^= m.v;
+
+            } // sipstate::absorb()
+
+            template<int D>
+            inline T
+            finish() noexcept {
+
+                v2.v ^= 0xff;
+                for (int i = 0; i < D; ++i) round();
+                return { v0.v ^ v1.v ^ v2.v ^ v3.v };
+
+            } // sipstate::finish()
+
+        }; // struct dtl::hash::_::sipstate
+
+        template<typename T>
+        inline static sipstate<T>
+        initial(
+            const key & k
+            ) noexcept {
+
+            return {
+                T::broadcast(k.k0 ^ 0x736f6d6570736575ull), T::broadcast(k.k1 ^ 0x646f72616e646f6dull),
+                T::broadcast(k.k0 ^ 0x6c7967656e657261ull), T::broadcast(k.k1 ^ 0x7465646279746573ull),
+            };
+
+        } // _::initial()
+
+        template<int C, int D>
+        inline static std::uint64_t
+        sip(
+            const key & k,
+            const void * data,
+            std::size_t size
+            ) noexcept {
+
+            using word = simd::vec<std::uint64_t, 1>;
+
+            auto * p = static_cast<const std::uint8_t *>(data);
+            auto s = initial<word>(k);
+            auto * end = p + (size & ~std::size_t(7));
+            for (; p != end; p += 8) s.template absorb<C>({ load64(p) });
+            s.template absorb<C>({ last(p, size) });
+            return s.template finish<D>().v;
+
+        } // _::sip()
+
+        // One message per lane, as many lanes as the target's vectors hold (four with AVX2).
+        template<int C, int D>
+        inline static void
+        sip(
+            const key & k,
+            const void * const * data,
+            std::size_t size,
+            std::uint64_t * out,
+            std::size_t count
+            ) noexcept {
+
+            constexpr std::size_t width = simd::native_width<std::uint64_t>;
+            using lanes = simd::vec<std::uint64_t, width>;
+
+            std::size_t i = 0;
+            // Two 64-bit lanes lose to scalar code for want of a vector rotate; batching starts at four.
+            for (auto whole = width >= 4 ? count / width * width : 0; i != whole; i += width) {
+                const std::uint8_t * p[width];
+                for (std::size_t j = 0; j < width; ++j) p[j] = static_cast<const std::uint8_t *>(data[i + j]);
+
+                auto s = initial<lanes>(k);
+                std::uint64_t m[width];
+                std::size_t offset = 0;
+                for (; size - offset >= 8; offset += 8) {
+                    for (std::size_t j = 0; j < width; ++j) m[j] = load64(p[j] + offset);
+                    s.template absorb<C>(lanes::load(m));
+                }
+                for (std::size_t j = 0; j < width; ++j) m[j] = last(p[j] + offset, size);
+                s.template absorb<C>(lanes::load(m));
+                s.template finish<D>().store(out + i);
+            }
+            for (; i < count; ++i) out[i] = sip<C, D>(k, data[i], size);
+
+        } // _::sip()
+
+#if defined(__AES__)
+
+        constexpr static std::uint64_t golden = 0x9e3779b97f4a7c15ull;
+
+        struct schedule {
+
+            __m128i a;
+            __m128i b;
+
+            inline explicit
+            schedule(
+                const key & k
+                ) noexcept
+                : a(_mm_set_epi64x(static_cast<long long>(k.k1), static_cast<long long>(k.k0))),
+                  b(_mm_aesenc_si128(_mm_xor_si128(a, _mm_set1_epi64x(static_cast<long long>(golden))), a)) {}
+
+            // Two rounds per block, so that a difference an attacker puts in one block cannot be cancelled by
+            // the next with better odds than a two-round AES differential.
+            inline __m128i
+            absorb(
+                __m128i state,
+                __m128i block
+                ) const noexcept {
+
+                return _mm_aesenc_si128(_mm_aesenc_si128(_mm_xor_si128(state, block), a), b);
+
+            } // schedule::absorb()
+
+        }; // struct dtl::hash::_::schedule
+
+        inline static __m128i
+        block(
+            const std::uint8_t * p
+            ) noexcept {
+
+            return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+
+        } // _::block()
+
+        // Up to 16 bytes as overlapping loads from both ends, which for a given size cover every byte (the size
+        // itself goes into the state); never reads outside the input.
+        inline static __m128i
+        partial(
+            const std::uint8_t * p,
+            std::size_t size
+            ) noexcept {
+
+            if (size >= 8) {
+                return _mm_set_epi64x(static_cast<long long>(load64(p + size - 8)), static_cast<long long>(load64(p)));
+            }
+            if (size >= 4) {
+                std::uint32_t lo, hi;
+                std::memcpy(&lo, p, 4);
+                std::memcpy(&hi, p + size - 4, 4);
+                return _mm_set_epi64x(hi, lo);
+            }
+            if (size) return _mm_cvtsi32_si128(p[0] | p[size / 2] << 8 | p[size - 1] << 16);
+            return _mm_setzero_si128();
+
+        } // _::partial()
+
+        // Up to 32 bytes take one or two overlapping blocks; longer inputs run four lanes over 64-byte strides
+        // and finish on the last 64 bytes, overlapping the previous stride.
+        inline static std::uint64_t
+        aes(
+            const schedule & keys,
+            const void * data,
+            std::size_t size
+            ) noexcept {
+
+            auto * p = static_cast<const std::uint8_t *>(data);
+            auto seeded = _mm_xor_si128(keys.a, _mm_set_epi64x(0, static_cast<long long>(size)));
+            __m128i s;
+
+            if (likely(size <= 16)) {
+                s = keys.absorb(seeded, partial(p, size));
+            } else if (size <= 32) {
+                s = _mm_xor_si128(keys.absorb(seeded, block(p)),
+                                  keys.absorb(_mm_xor_si128(seeded, keys.b), block(p + size - 16)));
+            } else {
+                __m128i lanes[4];
+                for (int j = 0; j < 4; ++j) {
+                    lanes[j] = _mm_xor_si128(seeded, _mm_set1_epi64x(static_cast<long long>(golden * (j + 1))));
+                }
+                if (size <= 64) {
+                    lanes[0] = keys.absorb(lanes[0], block(p));
+                    lanes[1] = keys.absorb(lanes[1], block(p + 16));
+                } else {
+                    std::size_t offset = 0;
+                    for (; size - offset > 64; offset += 64) {
+                        for (int j = 0; j < 4; ++j) lanes[j] = keys.absorb(lanes[j], block(p + offset + 16 * j));
+                    }
+                    lanes[0] = keys.absorb(lanes[0], block(p + size - 64));
+                    lanes[1] = keys.absorb(lanes[1], block(p + size - 48));
+                }
+                lanes[2] = keys.absorb(lanes[2], block(p + size - 32));
+                lanes[3] = keys.absorb(lanes[3], block(p + size - 16));
+                s = _mm_aesenc_si128(_mm_xor_si128(lanes[0], lanes[1]), keys.a);
+                s = _mm_aesenc_si128(_mm_xor_si128(s, lanes[2]), keys.a);
+                s = _mm_xor_si128(s, lanes[3]);
+            }
+
+            s = _mm_aesenc_si128(s, keys.b);
+            s = _mm_aesenc_si128(s, keys.a);
+            return static_cast<std::uint64_t>(_mm_cvtsi128_si64(s));
+
+        } // _::aes()
+
+#endif
+
+    } // namespace dtl::hash::_
+
+    // Not static: one seed per process, shared by every translation unit, so tables can be handed between them.
+    // Throws if getrandom(2) fails, which from the noexcept function objects below terminates.
+    inline const key &
+    seed() {
+
+        static const key k = [] {
+            key k;
+            auto * p = reinterpret_cast<char *>(&k);
+            for (std::size_t got = 0; got < sizeof k; ) {
+                auto n = ::getrandom(p + got, sizeof k - got, 0);
+                if (unlikely(n < 0)) {
+                    if (errno == EINTR) continue;
+                    throw std::system_error(errno, std::system_category(), "getrandom");
+                }
+                got += static_cast<std::size_t>(n);
+            }
+            return k;
+        }();
+        return k;
+
+    } // dtl::hash::seed()
+
+    inline static std::uint64_t
+    siphash24(
+        const key & k,
+        const void * data,
+        std::size_t size
+        ) noexcept {
+
+        return _::sip<2, 4>(k, data, size);
+
+    } // dtl::hash::siphash24()
+
+    inline static std::uint64_t
+    siphash13(
+        const key & k,
+        const void * data,
+        std::size_t size
+        ) noexcept {
+
+        return _::sip<1, 3>(k, data, size);
+
+    } // dtl::hash::siphash13()
+
+    // out[i] is the hash of the size bytes at data[i].
+    inline static void
+    siphash24(
+        const key & k,
+        const void * const * data,
+        std::size_t size,
+        std::uint64_t * out,
+        std::size_t count
+        ) noexcept {
+
+        _::sip<2, 4>(k, data, size, out, count);
+
+    } // dtl::hash::siphash24()
+
+    inline static void
+    siphash13(
+        const key & k,
+        const void * const * data,
+        std::size_t size,
+        std::uint64_t * out,
+        std::size_t count
+        ) noexcept {
+
+        _::sip<1, 3>(k, data, size, out, count);
+
+    } // dtl::hash::siphash13()
+
+    // Without AES-NI these are SipHash-1-3, so callers need not check the target.
+    inline static std::uint64_t
+    aeshash(
+        const key & k,
+        const void * data,
+        std::size_t size
+        ) noexcept {
+
+#if defined(__AES__)
+        return _::aes(_::schedule(k), data, size);
+#else
+        return siphash13(k, data, size);
+#endif
+
+    } // dtl::hash::aeshash()
+
+    inline static void
+    aeshash(
+        const key & k,
+        const void * const * data,
+        std::size_t size,
+        std::uint64_t * out,
+        std::size_t count
+        ) noexcept {
+
+#if defined(__AES__)
+        _::schedule keys(k);
+        std::size_t i = 0;
+        for (auto whole = count & ~std::size_t(3); i != whole; i += 4) {
+            out[i] = _::aes(keys, data[i], size);
+            out[i + 1] = _::aes(keys, data[i + 1], size);
+            out[i + 2] = _::aes(keys, data[i + 2], size);
+            out[i + 3] = _::aes(keys, data[i + 3], size);
+        }
+        for (; i < count; ++i) out[i] = _::aes(keys, data[i], size);
+#else
+        siphash13(k, data, size, out, count);
+#endif
+
+    } // dtl::hash::aeshash()
+
+    // The bytes a key is hashed as: strings by content, anything else by its object representation, which
+    // therefore must have no padding (equal keys with different padding bytes would hash apart).
+    template<typename Key>
+    inline static std::string_view
+    representation(
+        const Key & value
+        ) noexcept {
+
+        if constexpr (std::is_convertible<const Key &, std::string_view>::value) {
+            return value;
+        } else {
+            static_assert(std::has_unique_object_representations<Key>::value,
+                          "keys are hashed bytewise and must not contain padding");
+            return { reinterpret_cast<const char *>(&value), sizeof(Key) };
+        }
+
+    } // dtl::hash::representation()
+
+    template<typename Key, int C = 1, int D = 3>
+    struct sip {
+
+        inline std::size_t
+        operator()(
+            const Key & value
+            ) const noexcept {
+
+            auto bytes = representation(value);
+            return _::sip<C, D>(seed(), bytes.data(), bytes.size());
+
+        } // sip::operator()() const
+
+    }; // struct dtl::hash::sip
+
+    template<typename Key>
+    struct aes {
+
+        inline std::size_t
+        operator()(
+            const Key & value
+            ) const noexcept {
+
+            auto bytes = representation(value);
+            return aeshash(seed(), bytes.data(), bytes.size());
+
+        } // aes::operator()() const
+
+    }; // struct dtl::hash::aes
+
+} // namespace dtl::hash
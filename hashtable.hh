@@ -0,0 +1,464 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "branch.hh"
+#include "branchless.hh"
+#include "cacheline.hh"
+#include "hash.hh"
+#include "lock.hh"
+#include "prefetch.hh"
+#include "raii.hh"
+
+namespace dtl::hashtable {
+
+    // Concurrent chained hash table that grows without stopping the world. When the load factor is reached a
+    // second bucket array of twice the size is attached to the first, and from then on every write moves its own
+    // bucket plus a few more from the old array to the new one; once all have moved the new array takes over. Each
+    // old bucket splits into exactly two new ones, so a migration step touches one lock.
+    //
+    // Lookups are lock-free throughout: bucket words carry a lock bit (for writers) and a moved bit that sends
+    // readers on to the next array, nodes are immutable once published (updates replace them), and migration
+    // copies nodes rather than relinking them, so a reader already inside an old chain still walks a valid list.
+    // Replaced nodes and arrays are retired rather than freed; collect() frees them once the owner knows no reader
+    // is still inside the table. A moved bucket keeps its chain, so the nodes copied out of an array are freed with
+    // the array. Writers allocate before they lock a bucket, so a failed allocation never leaves one locked or
+    // half-migrated. Bucket arrays are anonymous raii::mmap regions, so even allocating a large new
+    // array costs page faults spread over the migration rather than an up-front clear.
+
+    template<typename Key, typename Value, typename Hash = std::hash<Key>>
+    class table {
+
+        struct node {
+
+            std::atomic<node *> next;
+            std::uint64_t hash;
+            Key key;
+            Value value;
+
+        }; // struct table::node
+
+        constexpr static std::uintptr_t moved = 1;
+        constexpr static std::uintptr_t locked = 2;
+        constexpr static std::uintptr_t flags = moved | locked;
+
+        static_assert(alignof(node) >= 4, "bucket words keep two flags in the low bits of node pointers");
+
+        inline static node *
+        head(
+            std::uintptr_t word
+            ) noexcept {
+
+            return reinterpret_cast<node *>(word & ~flags);
+
+        } // table::head()
+
+        struct generation {
+
+            raii::mmap memory;
+            std::atomic<std::uintptr_t> * buckets;
+            std::size_t mask;
+            std::atomic<generation *> successor{nullptr};
+            std::atomic<std::size_t> cursor{0};         // next bucket to be claimed for migration
+            std::atomic<std::size_t> migrated{0};
+            generation * retired = nullptr;             // next in the retired list, once fully migrated
+
+            inline explicit
+            generation(
+                std::size_t size
+                ) noexcept(false)
+                : memory(size * sizeof(std::atomic<std::uintptr_t>)),
+                  buckets(static_cast<std::atomic<std::uintptr_t> *>(memory.get())),
+                  mask(size - 1) {}
+
+            inline std::atomic<std::uintptr_t> &
+            bucket(
+                std::uint64_t h
+                ) const noexcept {
+
+                return buckets[h & mask];
+
+            } // generation::bucket()
+
+            // Frees every chain, live or moved: nodes copied forward are owned by the array they were copied from.
+            inline void
+            release() noexcept {
+
+                for (std::size_t i = 0; i <= mask; ++i) {
+                    for (auto * n = head(buckets[i].load(std::memory_order_relaxed)); n;) {
+                        auto * next = n->next.load(std::memory_order_relaxed);
+                        delete n;
+                        n = next;
+                    }
+                }
+
+            } // generation::release()
+
+        }; // struct table::generation
+
+        // Buckets moved per write while a migration is under way, on top of the writer's own.
+        constexpr static std::size_t step = 4;
+
+        // Per-CPU size deltas are folded into the shared count in batches.
+        constexpr static std::int64_t batch = 64;
+
+        std::atomic<generation *> current;
+        std::size_t load_factor;
+        std::atomic<std::int64_t> count{0};
+        mutable cacheline::per_cpu<std::atomic<std::int64_t>> pending;
+
+        std::mutex retiring;
+        std::vector<node *> retired_nodes;
+        generation * retired_generations = nullptr;
+
+        inline static std::uint64_t
+        hash(
+            const Key & key
+            ) noexcept {
+
+            // So that identity hashes (std::hash of integers) still spread over the buckets.
+            return hash::mix(static_cast<std::uint64_t>(Hash{}(key)));
+
+        } // table::hash()
+
+        // Locks a bucket; returns false without locking if it has moved.
+        inline static bool
+        lock(
+            std::atomic<std::uintptr_t> & bucket,
+            std::uintptr_t & word
+            ) noexcept {
+
+            for (;;) {
+                word = bucket.load(std::memory_order_relaxed);
+                if (word & moved) return false;
+                if (!(word & locked)
+                    && bucket.compare_exchange_weak(word, word | locked, std::memory_order_acquire,
+                                                    std::memory_order_relaxed)) {
+                    return true;
+                }
+                lock::relax();
+            }
+
+        } // table::lock()
+
+        inline void
+        retire(
+            node * n
+            ) noexcept(false) {
+
+            std::lock_guard<std::mutex> guard(retiring);
+            retired_nodes.push_back(n);
+
+        } // table::retire()
+
+        // Copies a locked old bucket into its two successors and marks it moved (which also unlocks it). The copies
+        // are all made before any is published: if one cannot be, the bucket is unlocked untouched and the
+        // exception propagates. The old chain stays on the moved bucket, to be freed with its array.
+        inline void
+        migrate_locked(
+            generation * g,
+            std::atomic<std::uintptr_t> & bucket,
+            std::uintptr_t word
+            ) noexcept(false) {
+
+            node * copies = nullptr;
+            try {
+                for (auto * n = head(word); n; n = n->next.load(std::memory_order_relaxed)) {
+                    copies = new node{ {copies}, n->hash, n->key, n->value };
+                }
+            } catch (...) {
+                while (copies) {
+                    auto * next = copies->next.load(std::memory_order_relaxed);
+                    delete copies;
+                    copies = next;
+                }
+                bucket.store(word, std::memory_order_release);
+                throw;
+            }
+
+            auto * successor = g->successor.load(std::memory_order_acquire);
+            while (copies) {
+                auto * copy = copies;
+                copies = copy->next.load(std::memory_order_relaxed);
+                auto & target = successor->bucket(copy->hash);
+                copy->next.store(head(target.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+                target.store(reinterpret_cast<std::uintptr_t>(copy), std::memory_order_release);
+            }
+            bucket.store(word | moved, std::memory_order_release);
+
+            if (g->migrated.fetch_add(1, std::memory_order_acq_rel) == g->mask) {
+                current.store(successor, std::memory_order_release);
+                std::lock_guard<std::mutex> guard(retiring);
+                g->retired = retired_generations;
+                retired_generations = g;
+            }
+
+        } // table::migrate_locked()
+
+        inline void
+        migrate(
+            generation * g,
+            std::size_t i
+            ) noexcept(false) {
+
+            std::uintptr_t word;
+            if (lock(g->buckets[i], word)) migrate_locked(g, g->buckets[i], word);
+
+        } // table::migrate()
+
+        // Moves a few buckets of the current migration, if any.
+        inline void
+        help() noexcept(false) {
+
+            auto * g = current.load(std::memory_order_acquire);
+            if (likely(!g->successor.load(std::memory_order_acquire))) return;
+            for (std::size_t k = 0; k < step; ++k) {
+                auto i = g->cursor.fetch_add(1, std::memory_order_relaxed);
+                if (i > g->mask) return;
+                migrate(g, i);
+            }
+
+        } // table::help()
+
+        inline void
+        account(
+            std::int64_t delta
+            ) noexcept(false) {
+
+            auto & local = pending.local();
+            auto v = local.fetch_add(delta, std::memory_order_relaxed) + delta;
+            if (likely(v < batch && v > -batch)) return;
+            local.fetch_sub(v, std::memory_order_relaxed);
+            auto total = count.fetch_add(v, std::memory_order_relaxed) + v;
+
+            auto * g = current.load(std::memory_order_acquire);
+            if (total > static_cast<std::int64_t>((g->mask + 1) * load_factor)
+                && !g->successor.load(std::memory_order_relaxed)) {
+                auto * next = new generation((g->mask + 1) * 2);
+                generation * expected = nullptr;
+                if (!g->successor.compare_exchange_strong(expected, next, std::memory_order_acq_rel)) delete next;
+            }
+
+        } // table::account()
+
+        // Locks the bucket for h in the newest array that holds it, moving it forward first if a migration is
+        // pending for it. Returns the generation and bucket, locked.
+        inline std::atomic<std::uintptr_t> &
+        acquire(
+            std::uint64_t h,
+            std::uintptr_t & word
+            ) noexcept(false) {
+
+            auto * g = current.load(std::memory_order_acquire);
+            for (;;) {
+                auto & bucket = g->bucket(h);
+                if (!lock(bucket, word)) {
+                    g = g->successor.load(std::memory_order_acquire);
+                    continue;
+                }
+                if (g->successor.load(std::memory_order_acquire)) {
+                    migrate_locked(g, bucket, word);
+                    g = g->successor.load(std::memory_order_acquire);
+                    continue;
+                }
+                return bucket;
+            }
+
+        } // table::acquire()
+
+    public:
+
+        using key_type = Key;
+        using value_type = Value;
+
+        // Starts with capacity / load_factor buckets (rounded up to a power of 2) and grows past an average of
+        // load_factor entries per bucket.
+        inline explicit
+        table(
+            std::size_t capacity = 1024,
+            std::size_t load_factor = 2
+            ) noexcept(false)
+            : current(nullptr), load_factor(load_factor ? load_factor : 1), pending() {
+
+            auto buckets = branchless::power_of_2::roundup(std::max<std::size_t>(capacity / this->load_factor, 16));
+            current.store(new generation(buckets), std::memory_order_release);
+
+        } // table::table()
+
+        table(const table &) = delete;
+        table & operator=(const table &) = delete;
+
+        inline
+        ~table() noexcept {
+
+            auto * g = current.load(std::memory_order_relaxed);
+            while (g) {
+                g->release();
+                auto * next = g->successor.load(std::memory_order_relaxed);
+                delete g;
+                g = next;
+            }
+            collect();
+
+        } // table::~table()
+
+        // Lock-free, including while a migration is under way.
+        inline std::optional<Value>
+        find(
+            const Key & key
+            ) const noexcept(std::is_nothrow_copy_constructible<Value>::value) {
+
+            auto h = hash(key);
+            auto * g = current.load(std::memory_order_acquire);
+            for (;;) {
+                auto & bucket = g->bucket(h);
+                auto word = bucket.load(std::memory_order_acquire);
+                if (!(word & moved)) {
+                    for (auto * n = head(word); n; n = n->next.load(std::memory_order_acquire)) {
+                        if (n->hash == h && n->key == key) return n->value;
+                    }
+                    // A miss only counts if the bucket did not move while it was being walked.
+                    if (!(bucket.load(std::memory_order_acquire) & moved)) return std::nullopt;
+                }
+                g = g->successor.load(std::memory_order_acquire);
+            }
+
+        } // table::find()
+
+        // Touches the key's bucket ahead of find(), for prefetch::lookup().
+        inline void
+        prefetch(
+            const Key & key
+            ) const noexcept {
+
+            prefetch::read(&current.load(std::memory_order_acquire)->bucket(hash(key)));
+
+        } // table::prefetch()
+
+        // Inserts or replaces; true when the key was not present before.
+        inline bool
+        insert(
+            const Key & key,
+            const Value & value
+            ) noexcept(false) {
+
+            auto h = hash(key);
+            // Made before the bucket is locked, so that a throwing allocation or copy cannot leave it locked.
+            std::unique_ptr<node> made(new node{ {nullptr}, h, key, value });
+            std::uintptr_t word;
+            auto & bucket = acquire(h, word);
+
+            std::atomic<node *> * link = nullptr;
+            node * n = head(word);
+            for (; n && !(n->hash == h && n->key == key); n = n->next.load(std::memory_order_relaxed)) link = &n->next;
+
+            if (n) {
+                auto * replacement = made.release();
+                replacement->next.store(n->next.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                if (link) {
+                    link->store(replacement, std::memory_order_release);
+                    bucket.store(word, std::memory_order_release);
+                } else {
+                    bucket.store(reinterpret_cast<std::uintptr_t>(replacement), std::memory_order_release);
+                }
+                retire(n);
+                help();
+                return false;
+            }
+
+            auto * fresh = made.release();
+            fresh->next.store(head(word), std::memory_order_relaxed);
+            bucket.store(reinterpret_cast<std::uintptr_t>(fresh), std::memory_order_release);
+            account(1);
+            help();
+            return true;
+
+        } // table::insert()
+
+        inline bool
+        erase(
+            const Key & key
+            ) noexcept(false) {
+
+            auto h = hash(key);
+            std::uintptr_t word;
+            auto & bucket = acquire(h, word);
+
+            std::atomic<node *> * link = nullptr;
+            node * n = head(word);
+            for (; n && !(n->hash == h && n->key == key); n = n->next.load(std::memory_order_relaxed)) link = &n->next;
+
+            if (!n) {
+                bucket.store(word, std::memory_order_release);
+                help();
+                return false;
+            }
+            auto * after = n->next.load(std::memory_order_relaxed);
+            if (link) {
+                link->store(after, std::memory_order_release);
+                bucket.store(word, std::memory_order_release);
+            } else {
+                bucket.store(reinterpret_cast<std::uintptr_t>(after), std::memory_order_release);
+            }
+            retire(n);
+            account(-1);
+            help();
+            return true;
+
+        } // table::erase()
+
+        // Approximate while writers are active: per-CPU deltas are folded in batches.
+        inline std::size_t
+        size() const noexcept {
+
+            auto total = count.load(std::memory_order_relaxed);
+            pending.for_each([&](const std::atomic<std::int64_t> & v) { total += v.load(std::memory_order_relaxed); });
+            return total > 0 ? static_cast<std::size_t>(total) : 0;
+
+        } // table::size()
+
+        inline std::size_t
+        buckets() const noexcept {
+
+            return current.load(std::memory_order_acquire)->mask + 1;
+
+        } // table::buckets()
+
+        inline bool
+        resizing() const noexcept {
+
+            return current.load(std::memory_order_acquire)->successor.load(std::memory_order_acquire) != nullptr;
+
+        } // table::resizing()
+
+        // Frees nodes and bucket arrays replaced so far. Only safe while no reader or writer is inside the table.
+        inline void
+        collect() noexcept {
+
+            std::vector<node *> nodes;
+            generation * generations;
+            {
+                std::lock_guard<std::mutex> guard(retiring);
+                nodes.swap(retired_nodes);
+                generations = std::exchange(retired_generations, nullptr);
+            }
+            for (auto * n : nodes) delete n;
+            while (generations) {
+                generations->release();
+                delete std::exchange(generations, generations->retired);
+            }
+
+        } // table::collect()
+
+    }; // class dtl::hashtable::table
+
+} // namespace dtl::hashtable
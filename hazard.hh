@@ -0,0 +1,301 @@
+#pragma once
+
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "branch.hh"
+#include "cacheline.hh"
+
+namespace dtl::hazard {
+
+    // Hazard-pointer reclamation for readers without quiescent points: a reader publishes each pointer it is about
+    // to dereference in one of its slots, and retired memory is freed only once no slot holds it. A stalled reader
+    // pins only what it protects, not everything retired since it started as with epochs or with reclamation at
+    // quiescence (art::tree::collect(), which a single long reader holds back indefinitely).
+    //
+    // Readers pay a plain store plus a reload of the source: the store-load ordering that hazard pointers need is
+    // provided asymmetrically by membarrier(2), issued once per batched scan on the reclaiming side. Where the
+    // kernel lacks MEMBARRIER_CMD_PRIVATE_EXPEDITED, readers fall back to a seq_cst fence.
+    //
+    //     hazard::domain<> domain;
+    //     auto reader = domain.enroll();             // one per thread, reusable
+    //     auto * n = reader.protect(0, head);        // safe to dereference until cleared or overwritten
+    //     ...
+    //     reader.clear(0);
+    //     reader.retire(old);                        // after unlinking old from every shared location
+
+    namespace _ {
+
+        class barrier {
+
+            bool asymmetric;
+
+            barrier() noexcept
+                : asymmetric(!::syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0)) {}
+
+        public:
+
+            inline static const barrier &
+            instance() noexcept {
+
+                static const barrier instance;
+                return instance;
+
+            } // barrier::instance()
+
+            // Reader side: between publishing a hazard and revalidating the source.
+            inline void
+            light() const noexcept {
+
+                if (likely(asymmetric)) std::atomic_signal_fence(std::memory_order_seq_cst);
+                else std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            } // barrier::light()
+
+            // Reclaimer side: before reading hazards, acts as a full fence on every running thread of the process.
+            inline void
+            heavy() const noexcept {
+
+                if (likely(asymmetric) && !::syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0)) return;
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            } // barrier::heavy()
+
+        }; // class dtl::hazard::_::barrier
+
+        struct retired {
+
+            void * pointer;
+            void (*deleter)(void *);
+
+        }; // struct dtl::hazard::_::retired
+
+    } // namespace dtl::hazard::_
+
+    template<std::size_t Slots = 2>
+    class domain {
+
+        static_assert(Slots > 0);
+
+        // One per enrolled thread, never freed before the domain; the retired list travels with the record, so a
+        // thread that leaves hands its backlog to the next one to enroll.
+        struct alignas(cacheline::destructive) record {
+
+            std::atomic<const void *> hazards[Slots] = {};
+            std::atomic<bool> active{false};
+            record * next = nullptr;
+            std::vector<_::retired> retired;
+
+        }; // struct dtl::hazard::domain::record
+
+        std::atomic<record *> records{nullptr};
+        std::atomic<std::size_t> enrolled{0};
+        const _::barrier & fences = _::barrier::instance();
+
+        // Frees whatever in list no hazard protects.
+        inline void
+        scan(
+            std::vector<_::retired> & list
+            ) {
+
+            fences.heavy();
+
+            std::vector<const void *> protect;
+            protect.reserve(enrolled.load(std::memory_order_relaxed) * Slots);
+            for (auto * r = records.load(std::memory_order_acquire); r; r = r->next) {
+                for (auto & h : r->hazards) {
+                    auto * p = h.load(std::memory_order_acquire);
+                    if (p) protect.push_back(p);
+                }
+            }
+            std::sort(protect.begin(), protect.end());
+
+            auto keep = list.begin();
+            for (auto & r : list) {
+                if (std::binary_search(protect.begin(), protect.end(), static_cast<const void *>(r.pointer))) {
+                    *keep++ = r;
+                } else {
+                    r.deleter(r.pointer);
+                }
+            }
+            list.erase(keep, list.end());
+
+        } // domain::scan()
+
+    public:
+
+        // A scan runs once a thread has retired this many times the number of hazards in the domain, so each scan
+        // frees at least the excess and its cost is amortized to O(1) per retire.
+        constexpr static std::size_t batch = 2;
+        constexpr static std::size_t minimum = 64;
+
+        class reader {
+
+            friend class domain;
+
+            domain * owner;
+            record * mine;
+
+            inline
+            reader(
+                domain * owner,
+                record * mine
+                ) noexcept
+                : owner(owner), mine(mine) {}
+
+        public:
+
+            inline
+            reader(
+                reader && other
+                ) noexcept
+                : owner(other.owner), mine(std::exchange(other.mine, nullptr)) {}
+
+            reader(const reader &) = delete;
+            reader & operator=(const reader &) = delete;
+            reader & operator=(reader &&) = delete;
+
+            inline
+            ~reader() noexcept {
+
+                if (!mine) return;
+                clear();
+                mine->active.store(false, std::memory_order_release);
+
+            } // reader::~reader()
+
+            // Loads source and publishes it in slot until the published value is confirmed still current.
+            template<typename T>
+            inline T *
+            protect(
+                std::size_t slot,
+                const std::atomic<T *> & source
+                ) noexcept {
+
+                auto * p = source.load(std::memory_order_relaxed);
+                for (;;) {
+                    mine->hazards[slot].store(p, std::memory_order_relaxed);
+                    owner->fences.light();
+                    auto * again = source.load(std::memory_order_acquire);
+                    if (likely(again == p)) return p;
+                    p = again;
+                }
+
+            } // reader::protect()
+
+            // Publishes p, which the caller must revalidate against its source before dereferencing.
+            template<typename T>
+            inline void
+            set(
+                std::size_t slot,
+                T * p
+                ) noexcept {
+
+                mine->hazards[slot].store(p, std::memory_order_relaxed);
+                owner->fences.light();
+
+            } // reader::set()
+
+            inline void
+            clear(
+                std::size_t slot
+                ) noexcept {
+
+                mine->hazards[slot].store(nullptr, std::memory_order_release);
+
+            } // reader::clear()
+
+            inline void
+            clear() noexcept {
+
+                for (auto & h : mine->hazards) h.store(nullptr, std::memory_order_release);
+
+            } // reader::clear()
+
+            // Hands p, already unreachable from shared state, to the domain; deleter(p) runs once no hazard holds it.
+            inline void
+            retire(
+                void * p,
+                void (*deleter)(void *)
+                ) {
+
+                mine->retired.push_back({p, deleter});
+                auto threshold = std::max(minimum, batch * Slots * owner->enrolled.load(std::memory_order_relaxed));
+                if (unlikely(mine->retired.size() >= threshold)) owner->scan(mine->retired);
+
+            } // reader::retire()
+
+            template<typename T>
+            inline void
+            retire(
+                T * p
+                ) {
+
+                retire(const_cast<void *>(static_cast<const void *>(p)), [](void * v) { delete static_cast<T *>(v); });
+
+            } // reader::retire()
+
+            // Scans now, e.g. before a thread goes idle with a backlog.
+            inline void
+            flush() {
+
+                owner->scan(mine->retired);
+
+            } // reader::flush()
+
+            inline std::size_t
+            pending() const noexcept {
+
+                return mine->retired.size();
+
+            } // reader::pending() const
+
+        }; // class dtl::hazard::domain::reader
+
+        domain() = default;
+        domain(const domain &) = delete;
+        domain & operator=(const domain &) = delete;
+
+        // No reader may be alive: everything still retired is freed unconditionally.
+        inline
+        ~domain() noexcept {
+
+            for (auto * r = records.load(std::memory_order_relaxed); r; ) {
+                auto * next = r->next;
+                for (auto & item : r->retired) item.deleter(item.pointer);
+                delete r;
+                r = next;
+            }
+
+        } // domain::~domain()
+
+        // Claims a free record or adds one; the list only grows, so scans never race with removal.
+        inline reader
+        enroll() {
+
+            for (auto * r = records.load(std::memory_order_acquire); r; r = r->next) {
+                bool expected = false;
+                if (!r->active.load(std::memory_order_relaxed) &&
+                    r->active.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                    return reader(this, r);
+                }
+            }
+
+            auto * r = new record;
+            r->active.store(true, std::memory_order_relaxed);
+            r->next = records.load(std::memory_order_relaxed);
+            while (!records.compare_exchange_weak(r->next, r, std::memory_order_release, std::memory_order_relaxed));
+            enrolled.fetch_add(1, std::memory_order_relaxed);
+            return reader(this, r);
+
+        } // domain::enroll()
+
+    }; // class dtl::hazard::domain
+
+} // namespace dtl::hazard
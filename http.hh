@@ -0,0 +1,424 @@
+#pragma once
+
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include "branch.hh"
+#include "raii.hh"
+#include "simd.hh"
+
+namespace dtl::http {
+
+    // HTTP/1.x request and response heads, parsed in place: every field is a string_view into the caller's buffer.
+    // Targets and header values, the long fields, are scanned a vector at a time for their terminating control
+    // byte with range comparisons (SSE2/AVX2 through dtl::simd); methods and header names are short tokens and are
+    // checked against a table. Bare LF line endings are accepted; obsolete line folding is rejected.
+    //
+    //   parse_request() / parse_response() - one head that must be entirely in the buffer.
+    //   reader                             - incremental parsing over a socket: reads into a growing buffer,
+    //                                        rescans only new bytes for the end of the head, and keeps pipelined
+    //                                        bytes for the next request.
+
+    enum class status {
+
+        complete,
+        incomplete,
+        invalid,
+        closed,         // reader only: the peer closed before a complete head
+
+    }; // enum class dtl::http::status
+
+    struct header {
+
+        std::string_view name;
+        std::string_view value;     // without surrounding whitespace
+
+    }; // struct dtl::http::header
+
+    struct request {
+
+        std::string_view method;
+        std::string_view target;
+        int minor_version;
+        std::size_t headers;        // number of headers filled in
+        std::size_t length;         // bytes of the head, up to and including the blank line
+
+    }; // struct dtl::http::request
+
+    struct response {
+
+        int minor_version;
+        int code;
+        std::string_view reason;
+        std::size_t headers;
+        std::size_t length;
+
+    }; // struct dtl::http::response
+
+    namespace _ {
+
+        // 128 bits of tchar (RFC 9110): ALPHA / DIGIT / "!#$%&'*+-.^_`|~".
+        constexpr static std::uint64_t token[2] = { 0x03ff6cfa00000000ull, 0x57ffffffc7fffffeull };
+
+        inline static bool
+        is_token(
+            char c
+            ) noexcept {
+
+            auto u = static_cast<unsigned char>(c);
+            return u < 128 && ((token[u >> 6] >> (u & 63)) & 1);
+
+        } // _::is_token()
+
+        // Lower case for A-Z only: setting bit 5 of any byte would also fold '^' into '~' and '@' into '`'.
+        inline static char
+        fold(
+            char c
+            ) noexcept {
+
+            return static_cast<char>(c | (static_cast<unsigned char>(c - 'A') < 26 ? 0x20 : 0));
+
+        } // _::fold()
+
+        constexpr static std::size_t width = simd::native_width<std::uint8_t>;
+        using bytes = simd::vec<std::uint8_t, width>;
+
+        // First byte at or after p that ends a request target: a control byte, SP or DEL. Returns end if none.
+        inline static const char *
+        target_end(
+            const char * p,
+            const char * end
+            ) noexcept {
+
+            if constexpr (width > 1) {
+                auto space = bytes::broadcast(0x21);
+                auto del = bytes::broadcast(0x7f);
+                for (; end - p >= static_cast<std::ptrdiff_t>(width); p += width) {
+                    auto v = bytes::load(reinterpret_cast<const std::uint8_t *>(p));
+                    auto stop = simd::movemask(simd::lt(v, space)) | simd::movemask(simd::eq(v, del));
+                    if (stop) return p + __builtin_ctzll(stop);
+                }
+            }
+            for (; p < end; ++p) {
+                auto u = static_cast<unsigned char>(*p);
+                if (u <= 0x20 || u == 0x7f) return p;
+            }
+            return end;
+
+        } // _::target_end()
+
+        // First byte at or after p that ends a field value: a control byte other than HTAB, or DEL.
+        inline static const char *
+        value_end(
+            const char * p,
+            const char * end
+            ) noexcept {
+
+            if constexpr (width > 1) {
+                auto control = bytes::broadcast(0x20);
+                auto tab = bytes::broadcast('\t');
+                auto del = bytes::broadcast(0x7f);
+                for (; end - p >= static_cast<std::ptrdiff_t>(width); p += width) {
+                    auto v = bytes::load(reinterpret_cast<const std::uint8_t *>(p));
+                    auto stop = (simd::movemask(simd::lt(v, control)) & ~simd::movemask(simd::eq(v, tab)))
+                              | simd::movemask(simd::eq(v, del));
+                    if (stop) return p + __builtin_ctzll(stop);
+                }
+            }
+            for (; p < end; ++p) {
+                auto u = static_cast<unsigned char>(*p);
+                if ((u < 0x20 && u != '\t') || u == 0x7f) return p;
+            }
+            return end;
+
+        } // _::value_end()
+
+        // Cursor over the head; every step reports incomplete when it runs off the end of the buffer.
+        class cursor {
+
+        public:
+
+            const char * begin;
+            const char * p;
+            const char * end;
+
+            // Consumes CRLF or LF.
+            inline status
+            newline() noexcept {
+
+                if (p == end) return status::incomplete;
+                if (*p == '\r') {
+                    if (++p == end) return status::incomplete;
+                }
+                if (*p != '\n') return status::invalid;
+                ++p;
+                return status::complete;
+
+            } // cursor::newline()
+
+            inline status
+            token(
+                std::string_view & out,
+                char terminator
+                ) noexcept {
+
+                auto * start = p;
+                while (p < end && is_token(*p)) ++p;
+                if (p == end) return status::incomplete;
+                if (p == start || *p != terminator) return status::invalid;
+                out = { start, static_cast<std::size_t>(p - start) };
+                ++p;
+                return status::complete;
+
+            } // cursor::token()
+
+            // "HTTP/1.x"
+            inline status
+            version(
+                int & minor
+                ) noexcept {
+
+                constexpr static char prefix[] = "HTTP/1.";
+                for (std::size_t i = 0; i < sizeof(prefix) - 1; ++i, ++p) {
+                    if (p == end) return status::incomplete;
+                    if (*p != prefix[i]) return status::invalid;
+                }
+                if (p == end) return status::incomplete;
+                if (*p < '0' || *p > '9') return status::invalid;
+                minor = *p++ - '0';
+                return status::complete;
+
+            } // cursor::version()
+
+            // Header lines up to and including the blank line.
+            inline status
+            headers(
+                header * out,
+                std::size_t capacity,
+                std::size_t & count
+                ) noexcept {
+
+                count = 0;
+                for (;;) {
+                    if (p == end) return status::incomplete;
+                    if (*p == '\r' || *p == '\n') return newline();
+                    if (unlikely(count == capacity)) return status::invalid;
+
+                    auto & h = out[count];
+                    if (auto s = token(h.name, ':'); s != status::complete) return s;
+                    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+                    auto * start = p;
+                    p = value_end(p, end);
+                    if (p == end) return status::incomplete;
+                    auto * stop = p;
+                    while (stop > start && (stop[-1] == ' ' || stop[-1] == '\t')) --stop;
+                    h.value = { start, static_cast<std::size_t>(stop - start) };
+                    if (auto s = newline(); s != status::complete) return s;
+                    ++count;
+                }
+
+            } // cursor::headers()
+
+        }; // class dtl::http::_::cursor
+
+    } // namespace dtl::http::_
+
+    inline static status
+    parse_request(
+        const char * data,
+        std::size_t length,
+        request & out,
+        header * headers,
+        std::size_t capacity
+        ) noexcept {
+
+        _::cursor c{ data, data, data + length };
+
+        // Tolerate empty lines before the request line (RFC 9112 section 2.2).
+        while (c.p < c.end && (*c.p == '\r' || *c.p == '\n')) ++c.p;
+
+        if (auto s = c.token(out.method, ' '); s != status::complete) return s;
+        auto * start = c.p;
+        c.p = _::target_end(c.p, c.end);
+        if (c.p == c.end) return status::incomplete;
+        if (c.p == start || *c.p != ' ') return status::invalid;
+        out.target = { start, static_cast<std::size_t>(c.p - start) };
+        ++c.p;
+        if (auto s = c.version(out.minor_version); s != status::complete) return s;
+        if (auto s = c.newline(); s != status::complete) return s;
+        if (auto s = c.headers(headers, capacity, out.headers); s != status::complete) return s;
+        out.length = static_cast<std::size_t>(c.p - c.begin);
+        return status::complete;
+
+    } // dtl::http::parse_request()
+
+    inline static status
+    parse_response(
+        const char * data,
+        std::size_t length,
+        response & out,
+        header * headers,
+        std::size_t capacity
+        ) noexcept {
+
+        _::cursor c{ data, data, data + length };
+
+        if (auto s = c.version(out.minor_version); s != status::complete) return s;
+        if (c.end - c.p < 5) return status::incomplete;
+        if (c.p[0] != ' ' || c.p[4] != ' ') return status::invalid;
+        out.code = 0;
+        for (int i = 1; i <= 3; ++i) {
+            if (c.p[i] < '0' || c.p[i] > '9') return status::invalid;
+            out.code = out.code * 10 + (c.p[i] - '0');
+        }
+        c.p += 5;
+        auto * start = c.p;
+        c.p = _::value_end(c.p, c.end);
+        if (c.p == c.end) return status::incomplete;
+        out.reason = { start, static_cast<std::size_t>(c.p - start) };
+        if (auto s = c.newline(); s != status::complete) return s;
+        if (auto s = c.headers(headers, capacity, out.headers); s != status::complete) return s;
+        out.length = static_cast<std::size_t>(c.p - c.begin);
+        return status::complete;
+
+    } // dtl::http::parse_response()
+
+    // Reads requests off a socket or pipe. Parsing runs only once the blank line ending the head has arrived, so
+    // a head split over many reads is scanned about once. Views stay valid until the next read() or consume().
+    template<std::size_t Headers = 64>
+    class reader {
+
+        std::vector<char> buffer;
+        std::size_t used = 0;
+        std::size_t scanned = 0;        // bytes already searched for the end of the head
+        std::size_t limit;
+        bool parsed = false;
+
+        http::request head{};
+        http::header fields[Headers];
+
+        // Looks for the blank line in the bytes not searched yet.
+        inline bool
+        terminated() noexcept {
+
+            auto * data = buffer.data();
+            auto from = scanned >= 2 ? scanned - 2 : 0;
+            while (from < used) {
+                auto * nl = static_cast<const char *>(std::memchr(data + from, '\n', used - from));
+                if (!nl) break;
+                auto at = static_cast<std::size_t>(nl - data);
+                // A blank line is "\n\n" or "\n\r\n"; leading blank lines before the request line do not count.
+                bool blank = (at >= 1 && data[at - 1] == '\n') || (at >= 2 && data[at - 1] == '\r' && data[at - 2] == '\n');
+                if (blank) {
+                    std::size_t lead = 0;
+                    while (lead < at && (data[lead] == '\r' || data[lead] == '\n')) ++lead;
+                    if (lead < at - 1) {
+                        scanned = used;
+                        return true;
+                    }
+                }
+                from = at + 1;
+            }
+            scanned = used;
+            return false;
+
+        } // reader::terminated()
+
+        inline status
+        parse() noexcept {
+
+            if (parsed) return status::complete;
+            if (!terminated()) return used >= limit ? status::invalid : status::incomplete;
+            auto s = parse_request(buffer.data(), used, head, fields, Headers);
+            // With the blank line present, running out of bytes means the head was malformed.
+            if (s == status::incomplete) s = status::invalid;
+            parsed = s == status::complete;
+            return s;
+
+        } // reader::parse()
+
+    public:
+
+        // limit bounds the head; longer heads are rejected as invalid.
+        inline explicit
+        reader(
+            std::size_t limit = 64 * 1024
+            ) noexcept(false)
+            : buffer(std::min<std::size_t>(limit, 4096)), limit(limit) {}
+
+        // Returns complete once a head is available, from bytes already buffered if possible, otherwise after one
+        // read(2). incomplete means the read would block or the head is still partial.
+        inline status
+        read(
+            const raii::fd & handle
+            ) noexcept(false) {
+
+            if (auto s = parse(); s != status::incomplete) return s;
+
+            if (used == buffer.size()) buffer.resize(std::min(buffer.size() * 2, limit));
+            ssize_t n;
+            do {
+                n = ::read(handle, buffer.data() + used, buffer.size() - used);
+            } while (n == -1 && errno == EINTR);
+            if (n == -1) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return status::incomplete;
+                throw std::system_error(errno, std::system_category(), "read");
+            }
+            if (!n) return status::closed;
+            used += static_cast<std::size_t>(n);
+            return parse();
+
+        } // reader::read()
+
+        inline const http::request & request() const noexcept { return head; }
+        inline const http::header * headers() const noexcept { return fields; }
+
+        // Case-insensitive lookup of the first header with this name.
+        inline const http::header *
+        find(
+            std::string_view name
+            ) const noexcept {
+
+            for (std::size_t i = 0; i < head.headers; ++i) {
+                auto & h = fields[i];
+                if (h.name.size() != name.size()) continue;
+                bool same = true;
+                for (std::size_t j = 0; j < name.size() && same; ++j) same = _::fold(h.name[j]) == _::fold(name[j]);
+                if (same) return &h;
+            }
+            return nullptr;
+
+        } // reader::find() const
+
+        // Bytes received after the head: the start of a body or pipelined requests.
+        inline std::string_view
+        rest() const noexcept {
+
+            auto from = parsed ? head.length : used;
+            return { buffer.data() + from, used - from };
+
+        } // reader::rest() const
+
+        // Drops the current head and the first body bytes of rest(); later bytes are kept for the next request.
+        inline void
+        consume(
+            std::size_t body = 0
+            ) noexcept {
+
+            auto drop = std::min(used, (parsed ? head.length : 0) + body);
+            std::memmove(buffer.data(), buffer.data() + drop, used - drop);
+            used -= drop;
+            scanned = 0;
+            parsed = false;
+
+        } // reader::consume()
+
+    }; // class dtl::http::reader
+
+} // namespace dtl::http
@@ -0,0 +1,867 @@
+#pragma once
+
+#include <fcntl.h>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include "branch.hh"
+#include "raii.hh"
+#include "simd.hh"
+
+namespace dtl::json {
+
+    // Two-stage JSON parsing in the manner of simdjson, for large configuration and telemetry documents:
+    //
+    //   stage 1 - classifies 64 bytes at a time into bitmasks (structural characters, whitespace, quotes,
+    //             backslashes) with SIMD compares; escaped quotes are removed with carry arithmetic and the
+    //             inside-string mask is the prefix XOR of the quotes, one carry-less multiply (PCLMUL) per block.
+    //             The result is the positions of structural characters and of the first byte of every scalar.
+    //   stage 2 - a state machine over those positions validates the structure and writes a tape: one 64-bit
+    //             word per value, containers linked to their ends so that skipping a subtree is O(1).
+    //
+    // The stages run chunk by chunk, so besides the input only the tape is held in memory. Scalars are decoded on
+    // demand: the tape stores where each string, number and literal starts in the text, and value's accessors
+    // parse it (and reject it if malformed) when asked. Strings are not checked for valid UTF-8.
+    //
+    // document::load() parses a file in place through raii::mmap; values point into the document, which must
+    // outlive them and not be moved while they are in use.
+
+    enum class kind : std::uint8_t {
+
+        null,
+        boolean,
+        number,
+        string,
+        array,
+        object,
+
+    }; // enum class dtl::json::kind
+
+    namespace _ {
+
+        // Tape words: the kind in the top byte; for arrays and objects the tape index of their end word, for the
+        // end words the text offset of the closing character, and for scalars the text offset of their first byte.
+        constexpr static std::uint8_t end_array = 6;
+        constexpr static std::uint8_t end_object = 7;
+        constexpr static std::uint64_t payload = (std::uint64_t(1) << 56) - 1;
+
+        inline static constexpr std::uint64_t
+        word(
+            std::uint8_t type,
+            std::uint64_t value
+            ) noexcept {
+
+            return (std::uint64_t(type) << 56) | value;
+
+        } // _::word()
+
+        inline static std::uint64_t
+        prefix_xor(
+            std::uint64_t bits
+            ) noexcept {
+
+#if defined(__PCLMUL__)
+            auto product = _mm_clmulepi64_si128(_mm_set_epi64x(0, static_cast<long long>(bits)), _mm_set1_epi8(-1), 0);
+            return static_cast<std::uint64_t>(_mm_cvtsi128_si64(product));
+#else
+            bits ^= bits << 1;
+            bits ^= bits << 2;
+            bits ^= bits << 4;
+            bits ^= bits << 8;
+            bits ^= bits << 16;
+            bits ^= bits << 32;
+            return bits;
+#endif
+
+        } // _::prefix_xor()
+
+        constexpr static std::size_t width = simd::native_width<std::uint8_t>;
+        using bytes = simd::vec<std::uint8_t, width>;
+
+        struct masks {
+
+            std::uint64_t op;           // { } [ ] : ,
+            std::uint64_t space;        // SP HT LF CR
+            std::uint64_t quote;
+            std::uint64_t backslash;
+
+        }; // struct dtl::json::_::masks
+
+        inline static masks
+        classify(
+            const std::uint8_t * block
+            ) noexcept {
+
+            masks m{};
+            for (std::size_t i = 0; i < 64; i += width) {
+                auto v = bytes::load(block + i);
+                auto folded = v | bytes::broadcast(0x20);   // '[' ']' fold onto '{' '}'
+                auto op = simd::movemask(simd::eq(folded, bytes::broadcast('{')))
+                        | simd::movemask(simd::eq(folded, bytes::broadcast('}')))
+                        | simd::movemask(simd::eq(v, bytes::broadcast(':')))
+                        | simd::movemask(simd::eq(v, bytes::broadcast(',')));
+                auto space = simd::movemask(simd::eq(v, bytes::broadcast(' ')))
+                           | simd::movemask(simd::eq(v, bytes::broadcast('\t')))
+                           | simd::movemask(simd::eq(v, bytes::broadcast('\n')))
+                           | simd::movemask(simd::eq(v, bytes::broadcast('\r')));
+                m.op |= op << i;
+                m.space |= space << i;
+                m.quote |= simd::movemask(simd::eq(v, bytes::broadcast('"'))) << i;
+                m.backslash |= simd::movemask(simd::eq(v, bytes::broadcast('\\'))) << i;
+            }
+            return m;
+
+        } // _::classify()
+
+        // Stage 1 state carried between blocks.
+        class scanner {
+
+            std::uint64_t escaped_carry = 0;    // the next block's first byte is escaped
+            std::uint64_t string_carry = 0;     // all ones while inside a string
+            std::uint64_t scalar_carry = 0;     // the previous block ended inside a scalar
+
+            // Bytes escaped by a backslash, from runs of backslashes of odd length.
+            inline std::uint64_t
+            escaped(
+                std::uint64_t backslash
+                ) noexcept {
+
+                constexpr std::uint64_t even = 0x5555555555555555ull;
+
+                backslash &= ~escaped_carry;
+                auto follows = (backslash << 1) | escaped_carry;
+                auto odd_starts = backslash & ~even & ~follows;
+                std::uint64_t even_starts;
+                escaped_carry = __builtin_add_overflow(odd_starts, backslash, &even_starts);
+                return (even ^ (even_starts << 1)) & follows;
+
+            } // scanner::escaped()
+
+        public:
+
+            // Bit i set: byte i of the block starts a token stage 2 must see.
+            inline std::uint64_t
+            structurals(
+                const std::uint8_t * block
+                ) noexcept {
+
+                auto m = classify(block);
+                auto quote = m.quote & ~escaped(m.backslash);
+                auto inside = prefix_xor(quote) ^ string_carry;
+                string_carry = static_cast<std::uint64_t>(static_cast<std::int64_t>(inside) >> 63);
+
+                // A scalar starts after an operator or whitespace; an opening quote always starts one, even right
+                // after another scalar's last byte, so that stage 2 sees both and rejects [1"a"].
+                auto scalar = ~(m.op | m.space);
+                auto plain = scalar & ~quote;
+                auto follows = (plain << 1) | scalar_carry;
+                scalar_carry = plain >> 63;
+                auto starts = (scalar & ~follows) | (quote & inside);
+
+                // Inside strings, and closing quotes, are not structural; opening quotes are.
+                return (m.op | starts) & ~(inside ^ quote);
+
+            } // scanner::structurals()
+
+            inline bool
+            in_string() const noexcept {
+
+                return string_carry != 0;
+
+            } // scanner::in_string()
+
+        }; // class dtl::json::_::scanner
+
+        // Appends base + the index of every set bit to out and returns how many. Positions are written eight at a
+        // time past the count, which out has room for, so that only blocks denser than that take a branch.
+        inline static std::size_t
+        flatten(
+            std::uint64_t bits,
+            std::uint64_t base,
+            std::uint64_t * out
+            ) noexcept {
+
+            auto count = static_cast<std::size_t>(__builtin_popcountll(bits));
+            auto next = [&]() {
+                // The top bit keeps the count defined once bits runs out; those slots are overwritten or unused.
+                auto at = base + static_cast<std::uint64_t>(__builtin_ctzll(bits | (std::uint64_t(1) << 63)));
+                bits &= bits - 1;
+                return at;
+            };
+            for (std::size_t i = 0; i < 8; ++i) out[i] = next();
+            if (unlikely(count > 8)) {
+                for (std::size_t i = 8; i < 16; ++i) out[i] = next();
+                for (std::size_t i = 16; i < count; ++i) out[i] = next();
+            }
+            return count;
+
+        } // _::flatten()
+
+        inline static bool
+        delimiter(
+            char c
+            ) noexcept {
+
+            switch (c) {
+            case ' ': case '\t': case '\n': case '\r': case ',': case ':': case ']': case '}': case '[': case '{':
+                return true;
+            default:
+                return false;
+            }
+
+        } // _::delimiter()
+
+        // End of the number starting at p per the JSON grammar, or nullptr.
+        inline static const char *
+        number(
+            const char * p,
+            const char * end
+            ) noexcept {
+
+            auto digits = [&]() {
+                auto * start = p;
+                while (p < end && *p >= '0' && *p <= '9') ++p;
+                return p != start;
+            };
+
+            if (p < end && *p == '-') ++p;
+            if (p < end && *p == '0') ++p;
+            else if (!digits()) return nullptr;
+            if (p < end && *p == '.') {
+                ++p;
+                if (!digits()) return nullptr;
+            }
+            if (p < end && (*p == 'e' || *p == 'E')) {
+                ++p;
+                if (p < end && (*p == '+' || *p == '-')) ++p;
+                if (!digits()) return nullptr;
+            }
+            if (p < end && !delimiter(*p)) return nullptr;
+            return p;
+
+        } // _::number()
+
+        // Closing quote of the string whose opening quote is at p; stage 1 guaranteed there is one.
+        inline static const char *
+        closing(
+            const char * p,
+            const char * end
+            ) noexcept {
+
+            auto * start = ++p;
+            for (;;) {
+                p = static_cast<const char *>(std::memchr(p, '"', static_cast<std::size_t>(end - p)));
+                if (unlikely(!p)) return end;
+                auto * q = p;
+                while (q > start && q[-1] == '\\') --q;
+                if (!((p - q) & 1)) return p;
+                ++p;
+            }
+
+        } // _::closing()
+
+        inline static int
+        hex(
+            char c
+            ) noexcept {
+
+            if (c >= '0' && c <= '9') return c - '0';
+            c = static_cast<char>(c | 0x20);
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            return -1;
+
+        } // _::hex()
+
+        // Decodes the escapes of a raw string into out; false on a malformed escape or unpaired surrogate.
+        inline static bool
+        unescape(
+            std::string_view raw,
+            std::string & out
+            ) {
+
+            out.clear();
+            out.reserve(raw.size());
+            auto u16 = [&](std::size_t at, std::uint32_t & v) {
+                if (at + 4 > raw.size()) return false;
+                v = 0;
+                for (std::size_t i = 0; i < 4; ++i) {
+                    auto d = hex(raw[at + i]);
+                    if (d < 0) return false;
+                    v = (v << 4) | static_cast<std::uint32_t>(d);
+                }
+                return true;
+            };
+
+            for (std::size_t i = 0; i < raw.size(); ++i) {
+                char c = raw[i];
+                if (static_cast<unsigned char>(c) < 0x20) return false;
+                if (c != '\\') {
+                    out.push_back(c);
+                    continue;
+                }
+                if (++i == raw.size()) return false;
+                switch (raw[i]) {
+                case '"': out.push_back('"'); break;
+                case '\\': out.push_back('\\'); break;
+                case '/': out.push_back('/'); break;
+                case 'b': out.push_back('\b'); break;
+                case 'f': out.push_back('\f'); break;
+                case 'n': out.push_back('\n'); break;
+                case 'r': out.push_back('\r'); break;
+                case 't': out.push_back('\t'); break;
+                case 'u': {
+                    std::uint32_t cp;
+                    if (!u16(i + 1, cp)) return false;
+                    i += 4;
+                    if (cp >= 0xdc00 && cp <= 0xdfff) return false;
+                    if (cp >= 0xd800 && cp <= 0xdbff) {
+                        std::uint32_t low;
+                        if (i + 2 >= raw.size() || raw[i + 1] != '\\' || raw[i + 2] != 'u' || !u16(i + 3, low)) return false;
+                        if (low < 0xdc00 || low > 0xdfff) return false;
+                        i += 6;
+                        cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                    }
+                    if (cp < 0x80) {
+                        out.push_back(static_cast<char>(cp));
+                    } else if (cp < 0x800) {
+                        out.push_back(static_cast<char>(0xc0 | (cp >> 6)));
+                        out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+                    } else if (cp < 0x10000) {
+                        out.push_back(static_cast<char>(0xe0 | (cp >> 12)));
+                        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+                        out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+                    } else {
+                        out.push_back(static_cast<char>(0xf0 | (cp >> 18)));
+                        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3f)));
+                        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+                        out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+                    }
+                    break;
+                }
+                default:
+                    return false;
+                }
+            }
+            return true;
+
+        } // _::unescape()
+
+        // Stage 2: validates the token sequence and writes the tape. Direct-threaded like simdjson's: each state
+        // jumps straight to its successor, so the only data-dependent branches are on the token itself. The state
+        // is saved when a chunk of positions runs out and resumed by the next feed().
+        class builder {
+
+            enum class state : std::uint8_t {
+
+                value,
+                array_first,    // after '[': a value or ']'
+                array_next,     // after an element: ',' or ']'
+                object_first,   // after '{': a key or '}'
+                object_key,     // after ',' in an object
+                colon,
+                object_next,    // after a member: ',' or '}'
+                done,
+
+            }; // enum class dtl::json::_::builder::state
+
+            const char * text;
+            std::size_t length;
+            std::vector<std::uint64_t> & tape;
+            std::vector<std::uint64_t> open;    // tape indices of the open containers
+            state at = state::value;
+
+            [[noreturn]] inline static void
+            fail() noexcept(false) {
+
+                throw std::system_error(std::make_error_code(std::errc::invalid_argument), "json::document");
+
+            } // builder::fail()
+
+            template<std::size_t Size>
+            inline bool
+            literal(
+                std::uint64_t offset,
+                const char (&expected)[Size]
+                ) const noexcept {
+
+                constexpr auto size = Size - 1;
+                if (length - offset < size || std::memcmp(text + offset, expected, size)) return false;
+                return offset + size == length || delimiter(text[offset + size]);
+
+            } // builder::literal()
+
+        public:
+
+            inline
+            builder(
+                const char * text,
+                std::size_t length,
+                std::vector<std::uint64_t> & tape
+                ) noexcept
+                : text(text), length(length), tape(tape) {}
+
+            inline void
+            feed(
+                const std::uint64_t * offsets,
+                std::size_t count
+                ) noexcept(false) {
+
+                // At most one tape word per position; the slack is trimmed on the way out.
+                auto used = tape.size();
+                tape.resize(used + count);
+                auto * words = tape.data();
+                std::size_t i = 0;
+                std::uint64_t offset = 0;
+                char c = 0;
+
+#define DTL_JSON_NEXT(resume)                                       \
+                if (unlikely(i == count)) {                         \
+                    at = state::resume;                             \
+                    goto out;                                       \
+                }                                                   \
+                offset = offsets[i++];                              \
+                c = text[offset]
+
+                switch (at) {
+                case state::value: goto value;
+                case state::array_first: goto array_first;
+                case state::array_next: goto array_next;
+                case state::object_first: goto object_first;
+                case state::object_key: goto object_key;
+                case state::colon: goto colon;
+                case state::object_next: goto object_next;
+                case state::done: goto done;
+                }
+
+            value:
+                DTL_JSON_NEXT(value);
+            parse_value:
+                switch (c) {
+                case '{':
+                    open.push_back(used);
+                    words[used++] = word(static_cast<std::uint8_t>(kind::object), 0);
+                    goto object_first;
+                case '[':
+                    open.push_back(used);
+                    words[used++] = word(static_cast<std::uint8_t>(kind::array), 0);
+                    goto array_first;
+                case '"':
+                    words[used++] = word(static_cast<std::uint8_t>(kind::string), offset);
+                    goto scalar;
+                case 't':
+                    if (!literal(offset, "true")) fail();
+                    words[used++] = word(static_cast<std::uint8_t>(kind::boolean), offset);
+                    goto scalar;
+                case 'f':
+                    if (!literal(offset, "false")) fail();
+                    words[used++] = word(static_cast<std::uint8_t>(kind::boolean), offset);
+                    goto scalar;
+                case 'n':
+                    if (!literal(offset, "null")) fail();
+                    words[used++] = word(static_cast<std::uint8_t>(kind::null), offset);
+                    goto scalar;
+                case '-': case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
+                    words[used++] = word(static_cast<std::uint8_t>(kind::number), offset);
+                    goto scalar;
+                default:
+                    fail();
+                }
+
+            scalar:
+                if (unlikely(open.empty())) goto done;
+                if ((words[open.back()] >> 56) == static_cast<std::uint8_t>(kind::object)) goto object_next;
+                goto array_next;
+
+            close:
+                // The closing character must match the innermost container.
+                {
+                    auto begin = open.back();
+                    bool object = (words[begin] >> 56) == static_cast<std::uint8_t>(kind::object);
+                    if (unlikely(object != (c == '}'))) fail();
+                    open.pop_back();
+                    words[begin] |= used;
+                    words[used++] = word(object ? end_object : end_array, offset);
+                }
+                goto scalar;
+
+            array_first:
+                DTL_JSON_NEXT(array_first);
+                if (c == ']') goto close;
+                goto parse_value;
+
+            array_next:
+                DTL_JSON_NEXT(array_next);
+                if (likely(c == ',')) goto value;
+                if (c == ']') goto close;
+                fail();
+
+            object_first:
+                DTL_JSON_NEXT(object_first);
+                if (c == '}') goto close;
+                if (unlikely(c != '"')) fail();
+                words[used++] = word(static_cast<std::uint8_t>(kind::string), offset);
+                goto colon;
+
+            object_key:
+                DTL_JSON_NEXT(object_key);
+                if (unlikely(c != '"')) fail();
+                words[used++] = word(static_cast<std::uint8_t>(kind::string), offset);
+                goto colon;
+
+            colon:
+                DTL_JSON_NEXT(colon);
+                if (unlikely(c != ':')) fail();
+                goto value;
+
+            object_next:
+                DTL_JSON_NEXT(object_next);
+                if (likely(c == ',')) goto object_key;
+                if (c == '}') goto close;
+                fail();
+
+            done:
+                DTL_JSON_NEXT(done);
+                fail();
+
+            out:
+#undef DTL_JSON_NEXT
+                tape.resize(used);
+
+            } // builder::feed()
+
+            inline void
+            finish() noexcept(false) {
+
+                if (at != state::done) fail();
+
+            } // builder::finish()
+
+        }; // class dtl::json::_::builder
+
+    } // namespace dtl::json::_
+
+    class document;
+
+    class value {
+
+        const document * owner = nullptr;
+        std::size_t at = 0;
+
+        inline std::uint64_t entry() const noexcept;
+        inline std::uint64_t entry(std::size_t i) const noexcept;
+        inline std::string_view text() const noexcept;
+
+        // Tape index just past this value.
+        inline std::size_t
+        next(
+            std::size_t i
+            ) const noexcept {
+
+            auto e = entry(i);
+            auto type = static_cast<kind>(e >> 56);
+            return (type == kind::array || type == kind::object) ? (e & _::payload) + 1 : i + 1;
+
+        } // value::next()
+
+        // The scalar's characters; for strings, between the quotes with escapes intact.
+        inline std::string_view
+        token() const noexcept {
+
+            auto t = text();
+            auto * begin = t.data() + (entry() & _::payload);
+            auto * end = t.data() + t.size();
+            switch (type()) {
+            case kind::string: {
+                auto * close = _::closing(begin, end);
+                return { begin + 1, static_cast<std::size_t>(close - begin - 1) };
+            }
+            case kind::number: {
+                auto * stop = _::number(begin, end);
+                return stop ? std::string_view(begin, static_cast<std::size_t>(stop - begin)) : std::string_view();
+            }
+            case kind::boolean:
+                return { begin, *begin == 't' ? 4u : 5u };
+            case kind::null:
+                return { begin, 4 };
+            default:
+                return {};
+            }
+
+        } // value::token()
+
+        inline static bool
+        same(
+            std::string_view raw,
+            std::string_view key
+            ) {
+
+            if (raw.find('\\') == std::string_view::npos) return raw == key;
+            std::string decoded;
+            return _::unescape(raw, decoded) && decoded == key;
+
+        } // value::same()
+
+    public:
+
+        value() = default;
+
+        inline
+        value(
+            const document * owner,
+            std::size_t at
+            ) noexcept
+            : owner(owner), at(at) {}
+
+        // False for the result of a failed lookup.
+        inline explicit
+        operator bool() const noexcept {
+
+            return owner != nullptr;
+
+        } // value::operator bool() const
+
+        inline kind
+        type() const noexcept {
+
+            return owner ? static_cast<kind>(entry() >> 56) : kind::null;
+
+        } // value::type() const
+
+        inline bool is_null() const noexcept { return owner && type() == kind::null; }
+
+        inline std::optional<bool>
+        get_bool() const noexcept {
+
+            if (!owner || type() != kind::boolean) return std::nullopt;
+            return text()[entry() & _::payload] == 't';
+
+        } // value::get_bool() const
+
+        template<typename T>
+        inline std::optional<T>
+        get_number() const noexcept {
+
+            if (!owner || type() != kind::number) return std::nullopt;
+            auto t = token();
+            if (t.empty()) return std::nullopt;
+            T v;
+            auto [end, error] = std::from_chars(t.data(), t.data() + t.size(), v);
+            if (error != std::errc() || end != t.data() + t.size()) return std::nullopt;
+            return v;
+
+        } // value::get_number() const
+
+        inline std::optional<std::int64_t> get_int64() const noexcept { return get_number<std::int64_t>(); }
+        inline std::optional<std::uint64_t> get_uint64() const noexcept { return get_number<std::uint64_t>(); }
+        inline std::optional<double> get_double() const noexcept { return get_number<double>(); }
+
+        // The string between its quotes, escapes intact: no copy.
+        inline std::optional<std::string_view>
+        get_raw_string() const noexcept {
+
+            if (!owner || type() != kind::string) return std::nullopt;
+            return token();
+
+        } // value::get_raw_string() const
+
+        inline std::optional<std::string>
+        get_string() const {
+
+            auto raw = get_raw_string();
+            if (!raw) return std::nullopt;
+            std::string out;
+            if (!_::unescape(*raw, out)) return std::nullopt;
+            return out;
+
+        } // value::get_string() const
+
+        // Source text of a scalar, e.g. a number to be parsed some other way.
+        inline std::string_view
+        raw() const noexcept {
+
+            return owner ? token() : std::string_view();
+
+        } // value::raw() const
+
+        // Elements of an array or members of an object.
+        inline std::size_t
+        size() const noexcept {
+
+            if (!owner) return 0;
+            auto type = this->type();
+            if (type != kind::array && type != kind::object) return 0;
+            std::size_t count = 0;
+            for (auto i = at + 1, end = entry() & _::payload; i < end; i = next(type == kind::object ? i + 1 : i)) ++count;
+            return count;
+
+        } // value::size() const
+
+        // Visits array elements as visitor(value).
+        template<typename Visitor>
+        inline void
+        for_each(
+            Visitor && visitor
+            ) const {
+
+            if (!owner || type() != kind::array) return;
+            for (auto i = at + 1, end = entry() & _::payload; i < end; i = next(i)) visitor(value(owner, i));
+
+        } // value::for_each() const
+
+        // Visits object members in order as visitor(std::string_view raw_key, value).
+        template<typename Visitor>
+        inline void
+        for_each_member(
+            Visitor && visitor
+            ) const {
+
+            if (!owner || type() != kind::object) return;
+            for (auto i = at + 1, end = entry() & _::payload; i < end; i = next(i + 1)) {
+                visitor(*value(owner, i).get_raw_string(), value(owner, i + 1));
+            }
+
+        } // value::for_each_member() const
+
+        // First member with this (unescaped) key, or an invalid value.
+        inline value
+        operator[](
+            std::string_view key
+            ) const {
+
+            if (!owner || type() != kind::object) return {};
+            for (auto i = at + 1, end = entry() & _::payload; i < end; i = next(i + 1)) {
+                if (same(*value(owner, i).get_raw_string(), key)) return value(owner, i + 1);
+            }
+            return {};
+
+        } // value::operator[]() const
+
+        inline value
+        operator[](
+            std::size_t index
+            ) const noexcept {
+
+            if (!owner || type() != kind::array) return {};
+            for (auto i = at + 1, end = entry() & _::payload; i < end; i = next(i)) {
+                if (!index--) return value(owner, i);
+            }
+            return {};
+
+        } // value::operator[](std::size_t) const
+
+    }; // class dtl::json::value
+
+    class document {
+
+        friend class value;
+
+        raii::mmap mapping;
+        const char * text = nullptr;
+        std::size_t length = 0;
+        std::vector<std::uint64_t> tape;
+
+        inline void
+        build() noexcept(false) {
+
+            if (unlikely(length > _::payload)) {
+                throw std::system_error(std::make_error_code(std::errc::file_too_large), "json::document");
+            }
+
+            // Chunks of stage 1 output feed stage 2 as they fill, so the positions never exist all at once.
+            constexpr std::size_t chunk = 1 << 14;
+            std::vector<std::uint64_t> positions(chunk + 64);
+            std::size_t pending = 0;
+
+            tape.clear();
+            tape.reserve(length / 16);
+            _::scanner scanner;
+            _::builder builder(text, length, tape);
+
+            auto * data = reinterpret_cast<const std::uint8_t *>(text);
+            alignas(64) std::uint8_t tail[64];
+            for (std::size_t base = 0; base < length; base += 64) {
+                const std::uint8_t * block = data + base;
+                if (length - base < 64) {
+                    std::memset(tail, ' ', sizeof(tail));
+                    std::memcpy(tail, block, length - base);
+                    block = tail;
+                }
+                pending += _::flatten(scanner.structurals(block), base, positions.data() + pending);
+                if (pending >= chunk) {
+                    builder.feed(positions.data(), pending);
+                    pending = 0;
+                }
+            }
+            if (scanner.in_string()) {
+                throw std::system_error(std::make_error_code(std::errc::invalid_argument), "json::document");
+            }
+            builder.feed(positions.data(), pending);
+            builder.finish();
+
+        } // document::build()
+
+    public:
+
+        document() = default;
+        document(document &&) = default;
+        document & operator=(document &&) = default;
+
+        // Parses text in place; it must outlive the document. Throws std::system_error on malformed input.
+        inline static document
+        parse(
+            std::string_view text
+            ) noexcept(false) {
+
+            document d;
+            d.text = text.data();
+            d.length = text.size();
+            d.build();
+            return d;
+
+        } // document::parse()
+
+        inline static document
+        load(
+            const char * path
+            ) noexcept(false) {
+
+            int handle = ::open(path, O_RDONLY | O_CLOEXEC);
+            if (unlikely(handle == -1)) throw std::system_error(errno, std::system_category(), "open");
+
+            document d;
+            d.mapping = raii::mmap(raii::fd(handle));
+            d.text = static_cast<const char *>(d.mapping.get());
+            d.length = d.mapping.size();
+            d.build();
+            return d;
+
+        } // document::load()
+
+        inline value
+        root() const noexcept {
+
+            return tape.empty() ? value() : value(this, 0);
+
+        } // document::root() const
+
+        // Tape words, one per value plus one per container end.
+        inline std::size_t
+        size() const noexcept {
+
+            return tape.size();
+
+        } // document::size() const
+
+    }; // class dtl::json::document
+
+    inline std::uint64_t value::entry() const noexcept { return owner->tape[at]; }
+    inline std::uint64_t value::entry(std::size_t i) const noexcept { return owner->tape[i]; }
+    inline std::string_view value::text() const noexcept { return { owner->text, owner->length }; }
+
+} // namespace dtl::json
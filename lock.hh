@@ -0,0 +1,347 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <thread>
+#include "branch.hh"
+#include "cacheline.hh"
+
+namespace dtl::lock {
+
+    // Locks for slow paths that std::mutex and std::shared_mutex serve poorly under contention:
+    //
+    //   ticket - FIFO spinlock; waiters back off in proportion to their distance from the head of the queue.
+    //   mcs    - queue lock where each waiter spins on its own node, so a release touches one waiter's line.
+    //   rwlock - BRAVO reader bias over std::shared_mutex: readers announce themselves in indicator slots instead
+    //            of writing the shared lock word; a writer revokes the bias and waits for those slots to drain, and
+    //            bias stays off for a while after a costly revocation. There are as many slots as CPUs (rounded up
+    //            to a power of two), but a thread's slot comes from its thread number masked by the slot count, not
+    //            from the CPU it runs on: readers only share a line once more threads have read than there are CPUs.
+    //
+    // ticket and rwlock meet the standard Lockable/SharedLockable requirements; mcs needs a queue node per
+    // acquisition and is used through mcs::guard.
+
+    // Spin-wait hint, shared by every spinning loop in the library (ring claims, hash table bucket locks).
+    inline static void
+    relax() noexcept {
+
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield" ::: "memory");
+#endif
+
+    } // dtl::lock::relax()
+
+    namespace _ {
+
+        // Spins with pause for a while, then yields on every call so that a preempted holder or predecessor gets
+        // the CPU back when threads outnumber cores.
+        class waiter {
+
+            std::uint32_t spins = 0;
+
+        public:
+
+            constexpr static std::uint32_t limit = 1024;
+
+            inline void
+            operator()(
+                std::uint32_t pauses = 1
+                ) noexcept {
+
+                if (likely(spins < limit)) {
+                    spins += pauses;
+                    while (pauses--) relax();
+                    return;
+                }
+                std::this_thread::yield();
+
+            } // waiter::operator()()
+
+        }; // class dtl::lock::_::waiter
+
+    } // namespace dtl::lock::_
+
+    class ticket {
+
+        std::atomic<std::uint32_t> next{0};
+        std::atomic<std::uint32_t> serving{0};
+
+    public:
+
+        // Pause iterations per waiter ahead of us: roughly one short critical section.
+        constexpr static std::uint32_t backoff = 64;
+
+        ticket() = default;
+        ticket(const ticket &) = delete;
+        ticket & operator=(const ticket &) = delete;
+
+        inline void
+        lock() noexcept {
+
+            auto mine = next.fetch_add(1, std::memory_order_relaxed);
+            _::waiter wait;
+            for (;;) {
+                auto now = serving.load(std::memory_order_acquire);
+                if (now == mine) return;
+                wait((mine - now) * backoff);
+            }
+
+        } // ticket::lock()
+
+        inline bool
+        try_lock() noexcept {
+
+            auto now = serving.load(std::memory_order_relaxed);
+            auto expected = now;
+            return next.compare_exchange_strong(expected, now + 1, std::memory_order_acquire, std::memory_order_relaxed);
+
+        } // ticket::try_lock()
+
+        inline void
+        unlock() noexcept {
+
+            serving.store(serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+        } // ticket::unlock()
+
+    }; // class dtl::lock::ticket
+
+    class mcs {
+
+    public:
+
+        // One per acquisition, alive until the matching unlock(); its own line so that waiters never share.
+        struct alignas(cacheline::destructive) node {
+
+            std::atomic<node *> next{nullptr};
+            std::atomic<bool> waiting{false};
+
+        }; // struct dtl::lock::mcs::node
+
+    private:
+
+        std::atomic<node *> tail{nullptr};
+
+    public:
+
+        mcs() = default;
+        mcs(const mcs &) = delete;
+        mcs & operator=(const mcs &) = delete;
+
+        inline void
+        lock(
+            node & mine
+            ) noexcept {
+
+            mine.next.store(nullptr, std::memory_order_relaxed);
+            mine.waiting.store(true, std::memory_order_relaxed);
+            auto * previous = tail.exchange(&mine, std::memory_order_acq_rel);
+            if (likely(!previous)) return;
+            previous->next.store(&mine, std::memory_order_release);
+            _::waiter wait;
+            while (mine.waiting.load(std::memory_order_acquire)) wait();
+
+        } // mcs::lock()
+
+        inline bool
+        try_lock(
+            node & mine
+            ) noexcept {
+
+            mine.next.store(nullptr, std::memory_order_relaxed);
+            node * expected = nullptr;
+            return tail.compare_exchange_strong(expected, &mine, std::memory_order_acquire, std::memory_order_relaxed);
+
+        } // mcs::try_lock()
+
+        inline void
+        unlock(
+            node & mine
+            ) noexcept {
+
+            auto * successor = mine.next.load(std::memory_order_acquire);
+            if (!successor) {
+                auto * expected = &mine;
+                if (tail.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed)) {
+                    return;
+                }
+                // A waiter swapped itself in but has not linked yet.
+                _::waiter wait;
+                while (!(successor = mine.next.load(std::memory_order_acquire))) wait();
+            }
+            successor->waiting.store(false, std::memory_order_release);
+
+        } // mcs::unlock()
+
+        class guard {
+
+            mcs & owner;
+            node mine;
+
+        public:
+
+            inline explicit
+            guard(
+                mcs & owner
+                ) noexcept
+                : owner(owner) {
+
+                owner.lock(mine);
+
+            } // guard::guard()
+
+            inline
+            ~guard() noexcept {
+
+                owner.unlock(mine);
+
+            } // guard::~guard()
+
+            guard(const guard &) = delete;
+            guard & operator=(const guard &) = delete;
+
+        }; // class dtl::lock::mcs::guard
+
+    }; // class dtl::lock::mcs
+
+    class rwlock {
+
+        std::shared_mutex underlying;
+        std::atomic<bool> bias{true};
+        std::atomic<std::int64_t> inhibit_until{0};
+        cacheline::per_cpu<std::atomic<std::uint32_t>> readers;
+
+        // Bias stays off for this many times as long as the last revocation took.
+        constexpr static std::int64_t penalty = 9;
+
+        inline static std::int64_t
+        now() noexcept {
+
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+
+        } // rwlock::now()
+
+        // Each thread keeps one indicator slot for its lifetime: its thread number masked by the slot count, rather
+        // than sched_getcpu(), so that a shared hold is released from the slot it was taken in without carrying a
+        // token across a migration. Until more threads have read than there are CPUs, no two readers share a line.
+        inline std::atomic<std::uint32_t> &
+        indicator() noexcept {
+
+            static std::atomic<std::size_t> threads{0};
+            thread_local std::size_t self = threads.fetch_add(1, std::memory_order_relaxed);
+            return readers[self & (readers.size() - 1)];
+
+        } // rwlock::indicator()
+
+        inline bool
+        drained() const noexcept {
+
+            for (std::size_t i = 0; i < readers.size(); ++i) {
+                if (readers[i].load(std::memory_order_seq_cst)) return false;
+            }
+            return true;
+
+        } // rwlock::drained()
+
+        // Biased fast path: announce, then confirm no writer revoked in between. The seq_cst pair with lock()
+        // guarantees that either the writer sees our indicator or we see the bias gone.
+        inline bool
+        enter(
+            std::atomic<std::uint32_t> & mine
+            ) noexcept {
+
+            if (unlikely(!bias.load(std::memory_order_relaxed))) return false;
+            mine.fetch_add(1, std::memory_order_seq_cst);
+            if (likely(bias.load(std::memory_order_seq_cst))) return true;
+            mine.fetch_sub(1, std::memory_order_release);
+            return false;
+
+        } // rwlock::enter()
+
+    public:
+
+        rwlock() = default;
+        rwlock(const rwlock &) = delete;
+        rwlock & operator=(const rwlock &) = delete;
+
+        // Every shared hold is counted in the indicators; the underlying lock only keeps unbiased readers out while
+        // a writer is inside, so the writer always waits for the indicators to drain and pays the scan.
+        inline void
+        lock() {
+
+            underlying.lock();
+            if (bias.load(std::memory_order_relaxed)) {
+                bias.store(false, std::memory_order_seq_cst);
+                auto start = now();
+                _::waiter wait;
+                while (!drained()) wait();
+                auto end = now();
+                inhibit_until.store(end + (end - start) * penalty, std::memory_order_relaxed);
+                return;
+            }
+            _::waiter wait;
+            while (!drained()) wait();
+
+        } // rwlock::lock()
+
+        inline bool
+        try_lock() {
+
+            if (!underlying.try_lock()) return false;
+            bias.store(false, std::memory_order_seq_cst);
+            if (likely(drained())) return true;
+            underlying.unlock();
+            return false;
+
+        } // rwlock::try_lock()
+
+        inline void
+        unlock() {
+
+            underlying.unlock();
+
+        } // rwlock::unlock()
+
+        inline void
+        lock_shared() {
+
+            auto & mine = indicator();
+            if (likely(enter(mine))) return;
+
+            underlying.lock_shared();
+            mine.fetch_add(1, std::memory_order_relaxed);
+            if (!bias.load(std::memory_order_relaxed) && now() >= inhibit_until.load(std::memory_order_relaxed)) {
+                bias.store(true, std::memory_order_relaxed);
+            }
+            underlying.unlock_shared();
+
+        } // rwlock::lock_shared()
+
+        inline bool
+        try_lock_shared() {
+
+            auto & mine = indicator();
+            if (likely(enter(mine))) return true;
+            if (!underlying.try_lock_shared()) return false;
+            mine.fetch_add(1, std::memory_order_relaxed);
+            underlying.unlock_shared();
+            return true;
+
+        } // rwlock::try_lock_shared()
+
+        inline void
+        unlock_shared() noexcept {
+
+            indicator().fetch_sub(1, std::memory_order_release);
+
+        } // rwlock::unlock_shared()
+
+    }; // class dtl::lock::rwlock
+
+} // namespace dtl::lock
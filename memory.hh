@@ -0,0 +1,624 @@
+#pragma once
+
+#include <unistd.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#include "branch.hh"
+#include "cpu.hh"
+#include "raii.hh"
+
+namespace dtl::memory {
+
+    // Copies, compares and clears tuned for packet-sized buffers. Sizes up to a few cache lines are handled inline
+    // with overlapping fixed-size moves; larger sizes go through a cpu::dispatch picked from the CPU's features
+    // (SSE2, AVX2 or AVX-512 vectors, ERMS `rep movsb`/`rep stosb` for bulk work).
+    // Buffers must not overlap.
+
+    namespace _ {
+
+        template<typename T>
+        inline static T
+        load(
+            const void * address
+            ) noexcept {
+
+            T value;
+            __builtin_memcpy(&value, address, sizeof(T));
+            return value;
+
+        } // _::load()
+
+        template<std::size_t N>
+        inline static void
+        move(
+            std::uint8_t * dst,
+            const std::uint8_t * src
+            ) noexcept {
+
+            __builtin_memcpy(dst, src, N);
+
+        } // _::move()
+
+        template<std::size_t N>
+        inline static void
+        clear(
+            std::uint8_t * dst
+            ) noexcept {
+
+            __builtin_memset(dst, 0, N);
+
+        } // _::clear()
+
+        using copy_fn = void (*)(void *, const void *, std::size_t);
+        using zero_fn = void (*)(void *, std::size_t);
+        using equal_fn = bool (*)(const void *, const void *, std::size_t);
+
+        struct routines {
+
+            copy_fn copy;
+            copy_fn stream;
+            zero_fn zero;
+            equal_fn equal;
+            std::size_t nontemporal_threshold;
+
+        }; // struct dtl::memory::_::routines
+
+        // ERMS `rep movsb`/`rep stosb` only beat vector loops once the startup cost is amortized.
+        constexpr std::size_t erms_threshold = 2048;
+
+#if defined(__x86_64__)
+
+        inline static void
+        movsb(
+            void * dst,
+            const void * src,
+            std::size_t length
+            ) noexcept {
+
+            asm volatile("rep movsb" : "+D"(dst), "+S"(src), "+c"(length) : : "memory");
+
+        } // _::movsb()
+
+        inline static void
+        stosb(
+            void * dst,
+            std::size_t length
+            ) noexcept {
+
+            asm volatile("rep stosb" : "+D"(dst), "+c"(length) : "a"(0) : "memory");
+
+        } // _::stosb()
+
+        // All medium-size routines below require length > 64 and process 64-byte blocks, finishing with one
+        // (overlapping) block aligned to the end of the buffer.
+
+        template<bool erms>
+        inline static void
+        copy_sse2(
+            void * dst,
+            const void * src,
+            std::size_t length
+            ) noexcept {
+
+            if (erms && length >= erms_threshold) return movsb(dst, src, length);
+
+            auto * d = static_cast<__m128i *>(dst);
+            auto * s = static_cast<const __m128i *>(src);
+            auto * dend = reinterpret_cast<__m128i *>(static_cast<std::uint8_t *>(dst) + length) - 4;
+            auto * send = reinterpret_cast<const __m128i *>(static_cast<const std::uint8_t *>(src) + length) - 4;
+
+            for (; d < dend; d += 4, s += 4) {
+                auto a = _mm_loadu_si128(s + 0), b = _mm_loadu_si128(s + 1);
+                auto c = _mm_loadu_si128(s + 2), e = _mm_loadu_si128(s + 3);
+                _mm_storeu_si128(d + 0, a); _mm_storeu_si128(d + 1, b);
+                _mm_storeu_si128(d + 2, c); _mm_storeu_si128(d + 3, e);
+            }
+            auto a = _mm_loadu_si128(send + 0), b = _mm_loadu_si128(send + 1);
+            auto c = _mm_loadu_si128(send + 2), e = _mm_loadu_si128(send + 3);
+            _mm_storeu_si128(dend + 0, a); _mm_storeu_si128(dend + 1, b);
+            _mm_storeu_si128(dend + 2, c); _mm_storeu_si128(dend + 3, e);
+
+        } // _::copy_sse2()
+
+        template<bool erms>
+        __attribute__((target("avx2"))) inline static void
+        copy_avx2(
+            void * dst,
+            const void * src,
+            std::size_t length
+            ) noexcept {
+
+            if (erms && length >= erms_threshold) return movsb(dst, src, length);
+
+            auto * d = static_cast<__m256i *>(dst);
+            auto * s = static_cast<const __m256i *>(src);
+            auto * dend = reinterpret_cast<__m256i *>(static_cast<std::uint8_t *>(dst) + length) - 2;
+            auto * send = reinterpret_cast<const __m256i *>(static_cast<const std::uint8_t *>(src) + length) - 2;
+
+            for (; d < dend; d += 2, s += 2) {
+                auto a = _mm256_loadu_si256(s + 0), b = _mm256_loadu_si256(s + 1);
+                _mm256_storeu_si256(d + 0, a); _mm256_storeu_si256(d + 1, b);
+            }
+            auto a = _mm256_loadu_si256(send + 0), b = _mm256_loadu_si256(send + 1);
+            _mm256_storeu_si256(dend + 0, a); _mm256_storeu_si256(dend + 1, b);
+
+        } // _::copy_avx2()
+
+        template<bool erms>
+        __attribute__((target("avx512f"))) inline static void
+        copy_avx512(
+            void * dst,
+            const void * src,
+            std::size_t length
+            ) noexcept {
+
+            if (erms && length >= erms_threshold) return movsb(dst, src, length);
+
+            auto * d = static_cast<std::uint8_t *>(dst);
+            auto * s = static_cast<const std::uint8_t *>(src);
+            auto * dend = d + length - 64;
+            auto * send = s + length - 64;
+
+            for (; d < dend; d += 64, s += 64) _mm512_storeu_si512(d, _mm512_loadu_si512(s));
+            _mm512_storeu_si512(dend, _mm512_loadu_si512(send));
+
+        } // _::copy_avx512()
+
+        // Non-temporal copies: align the destination to a cache line with one ordinary (unaligned) block, stream
+        // whole lines, then finish with an ordinary block aligned to the end. Requires length > 64.
+
+        inline static void
+        stream_sse2(
+            void * dst,
+            const void * src,
+            std::size_t length
+            ) noexcept {
+
+            auto * d = static_cast<std::uint8_t *>(dst);
+            auto * s = static_cast<const std::uint8_t *>(src);
+            auto * end = d + length;
+
+            move<64>(d, s);
+            auto skew = 64 - (reinterpret_cast<std::uintptr_t>(d) & 63);
+            d += skew; s += skew;
+            for (; d + 64 <= end; d += 64, s += 64) {
+                auto * v = reinterpret_cast<__m128i *>(d);
+                auto * u = reinterpret_cast<const __m128i *>(s);
+                _mm_stream_si128(v + 0, _mm_loadu_si128(u + 0));
+                _mm_stream_si128(v + 1, _mm_loadu_si128(u + 1));
+                _mm_stream_si128(v + 2, _mm_loadu_si128(u + 2));
+                _mm_stream_si128(v + 3, _mm_loadu_si128(u + 3));
+            }
+            _mm_sfence();
+            move<64>(end - 64, static_cast<const std::uint8_t *>(src) + length - 64);
+
+        } // _::stream_sse2()
+
+        __attribute__((target("avx2"))) inline static void
+        stream_avx2(
+            void * dst,
+            const void * src,
+            std::size_t length
+            ) noexcept {
+
+            auto * d = static_cast<std::uint8_t *>(dst);
+            auto * s = static_cast<const std::uint8_t *>(src);
+            auto * end = d + length;
+
+            move<64>(d, s);
+            auto skew = 64 - (reinterpret_cast<std::uintptr_t>(d) & 63);
+            d += skew; s += skew;
+            for (; d + 64 <= end; d += 64, s += 64) {
+                auto * v = reinterpret_cast<__m256i *>(d);
+                auto * u = reinterpret_cast<const __m256i *>(s);
+                _mm256_stream_si256(v + 0, _mm256_loadu_si256(u + 0));
+                _mm256_stream_si256(v + 1, _mm256_loadu_si256(u + 1));
+            }
+            _mm_sfence();
+            move<64>(end - 64, static_cast<const std::uint8_t *>(src) + length - 64);
+
+        } // _::stream_avx2()
+
+        __attribute__((target("avx512f"))) inline static void
+        stream_avx512(
+            void * dst,
+            const void * src,
+            std::size_t length
+            ) noexcept {
+
+            auto * d = static_cast<std::uint8_t *>(dst);
+            auto * s = static_cast<const std::uint8_t *>(src);
+            auto * end = d + length;
+
+            move<64>(d, s);
+            auto skew = 64 - (reinterpret_cast<std::uintptr_t>(d) & 63);
+            d += skew; s += skew;
+            for (; d + 64 <= end; d += 64, s += 64) _mm512_stream_si512(reinterpret_cast<__m512i *>(d), _mm512_loadu_si512(s));
+            _mm_sfence();
+            move<64>(end - 64, static_cast<const std::uint8_t *>(src) + length - 64);
+
+        } // _::stream_avx512()
+
+        template<bool erms>
+        inline static void
+        zero_sse2(
+            void * dst,
+            std::size_t length
+            ) noexcept {
+
+            if (erms && length >= erms_threshold) return stosb(dst, length);
+
+            auto * d = static_cast<__m128i *>(dst);
+            auto * dend = reinterpret_cast<__m128i *>(static_cast<std::uint8_t *>(dst) + length) - 4;
+            auto z = _mm_setzero_si128();
+
+            for (; d < dend; d += 4) {
+                _mm_storeu_si128(d + 0, z); _mm_storeu_si128(d + 1, z);
+                _mm_storeu_si128(d + 2, z); _mm_storeu_si128(d + 3, z);
+            }
+            _mm_storeu_si128(dend + 0, z); _mm_storeu_si128(dend + 1, z);
+            _mm_storeu_si128(dend + 2, z); _mm_storeu_si128(dend + 3, z);
+
+        } // _::zero_sse2()
+
+        template<bool erms>
+        __attribute__((target("avx2"))) inline static void
+        zero_avx2(
+            void * dst,
+            std::size_t length
+            ) noexcept {
+
+            if (erms && length >= erms_threshold) return stosb(dst, length);
+
+            auto * d = static_cast<__m256i *>(dst);
+            auto * dend = reinterpret_cast<__m256i *>(static_cast<std::uint8_t *>(dst) + length) - 2;
+            auto z = _mm256_setzero_si256();
+
+            for (; d < dend; d += 2) { _mm256_storeu_si256(d + 0, z); _mm256_storeu_si256(d + 1, z); }
+            _mm256_storeu_si256(dend + 0, z); _mm256_storeu_si256(dend + 1, z);
+
+        } // _::zero_avx2()
+
+        template<bool erms>
+        __attribute__((target("avx512f"))) inline static void
+        zero_avx512(
+            void * dst,
+            std::size_t length
+            ) noexcept {
+
+            if (erms && length >= erms_threshold) return stosb(dst, length);
+
+            auto * d = static_cast<std::uint8_t *>(dst);
+            auto * dend = d + length - 64;
+            auto z = _mm512_setzero_si512();
+
+            for (; d < dend; d += 64) _mm512_storeu_si512(d, z);
+            _mm512_storeu_si512(dend, z);
+
+        } // _::zero_avx512()
+
+        inline static bool
+        equal_sse2(
+            const void * lhs,
+            const void * rhs,
+            std::size_t length
+            ) noexcept {
+
+            auto * a = static_cast<const std::uint8_t *>(lhs);
+            auto * b = static_cast<const std::uint8_t *>(rhs);
+            auto * aend = a + length - 64;
+            auto * bend = b + length - 64;
+
+            auto block = [](const std::uint8_t * x, const std::uint8_t * y) {
+                auto * u = reinterpret_cast<const __m128i *>(x);
+                auto * v = reinterpret_cast<const __m128i *>(y);
+                auto diff = _mm_or_si128(
+                    _mm_or_si128(_mm_xor_si128(_mm_loadu_si128(u + 0), _mm_loadu_si128(v + 0)),
+                                 _mm_xor_si128(_mm_loadu_si128(u + 1), _mm_loadu_si128(v + 1))),
+                    _mm_or_si128(_mm_xor_si128(_mm_loadu_si128(u + 2), _mm_loadu_si128(v + 2)),
+                                 _mm_xor_si128(_mm_loadu_si128(u + 3), _mm_loadu_si128(v + 3))));
+                return (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) == 0xffff);
+            };
+
+            for (; a < aend; a += 64, b += 64) if (!block(a, b)) return false;
+            return block(aend, bend);
+
+        } // _::equal_sse2()
+
+        __attribute__((target("avx2"))) inline static bool
+        equal_avx2(
+            const void * lhs,
+            const void * rhs,
+            std::size_t length
+            ) noexcept {
+
+            auto * a = static_cast<const std::uint8_t *>(lhs);
+            auto * b = static_cast<const std::uint8_t *>(rhs);
+            auto * aend = a + length - 64;
+            auto * bend = b + length - 64;
+
+            for (; a < aend; a += 64, b += 64) {
+                auto * u = reinterpret_cast<const __m256i *>(a);
+                auto * v = reinterpret_cast<const __m256i *>(b);
+                auto diff = _mm256_or_si256(_mm256_xor_si256(_mm256_loadu_si256(u + 0), _mm256_loadu_si256(v + 0)),
+                                            _mm256_xor_si256(_mm256_loadu_si256(u + 1), _mm256_loadu_si256(v + 1)));
+                if (!_mm256_testz_si256(diff, diff)) return false;
+            }
+            auto * u = reinterpret_cast<const __m256i *>(aend);
+            auto * v = reinterpret_cast<const __m256i *>(bend);
+            auto diff = _mm256_or_si256(_mm256_xor_si256(_mm256_loadu_si256(u + 0), _mm256_loadu_si256(v + 0)),
+                                        _mm256_xor_si256(_mm256_loadu_si256(u + 1), _mm256_loadu_si256(v + 1)));
+            return _mm256_testz_si256(diff, diff);
+
+        } // _::equal_avx2()
+
+        __attribute__((target("avx512f"))) inline static bool
+        equal_avx512(
+            const void * lhs,
+            const void * rhs,
+            std::size_t length
+            ) noexcept {
+
+            auto * a = static_cast<const std::uint8_t *>(lhs);
+            auto * b = static_cast<const std::uint8_t *>(rhs);
+            auto * aend = a + length - 64;
+            auto * bend = b + length - 64;
+
+            for (; a < aend; a += 64, b += 64) {
+                if (_mm512_cmpneq_epi64_mask(_mm512_loadu_si512(a), _mm512_loadu_si512(b))) return false;
+            }
+            return !_mm512_cmpneq_epi64_mask(_mm512_loadu_si512(aend), _mm512_loadu_si512(bend));
+
+        } // _::equal_avx512()
+
+        inline static routines
+        resolve(
+            const cpu::features & f
+            ) noexcept {
+
+            // Past roughly the per-core share of the last level cache, ordinary stores just evict useful lines.
+            std::size_t threshold = std::size_t(4) << 20;
+#if defined(_SC_LEVEL3_CACHE_SIZE)
+            auto llc = ::sysconf(_SC_LEVEL3_CACHE_SIZE);
+            if (llc > 0) threshold = static_cast<std::size_t>(llc) / 4 * 3;
+#endif
+
+            bool erms = f.has(cpu::feature::erms);
+
+            if (f.has(cpu::feature::avx512f)) {
+                return {
+                    erms ? copy_avx512<true> : copy_avx512<false>,
+                    stream_avx512,
+                    erms ? zero_avx512<true> : zero_avx512<false>,
+                    equal_avx512,
+                    threshold
+                };
+            }
+            if (f.has(cpu::feature::avx2)) {
+                return {
+                    erms ? copy_avx2<true> : copy_avx2<false>,
+                    stream_avx2,
+                    erms ? zero_avx2<true> : zero_avx2<false>,
+                    equal_avx2,
+                    threshold
+                };
+            }
+            return {
+                erms ? copy_sse2<true> : copy_sse2<false>,
+                stream_sse2,
+                erms ? zero_sse2<true> : zero_sse2<false>,
+                equal_sse2,
+                threshold
+            };
+
+        } // _::resolve()
+
+#else
+
+        inline static routines
+        resolve(
+            const cpu::features &
+            ) noexcept {
+
+            return {
+                [](void * dst, const void * src, std::size_t length) { std::memcpy(dst, src, length); },
+                [](void * dst, const void * src, std::size_t length) { std::memcpy(dst, src, length); },
+                [](void * dst, std::size_t length) { std::memset(dst, 0, length); },
+                [](const void * lhs, const void * rhs, std::size_t length) { return !std::memcmp(lhs, rhs, length); },
+                ~std::size_t(0)
+            };
+
+        } // _::resolve()
+
+#endif
+
+        // Resolved on first use; function-local so that copies made from other static initializers are safe.
+        inline static const routines &
+        table() noexcept {
+
+            static const cpu::dispatch<routines> resolved(resolve);
+            return *resolved;
+
+        } // _::table()
+
+    } // namespace dtl::memory::_
+
+    inline static void
+    copy(
+        void * dst,
+        const void * src,
+        std::size_t length
+        ) noexcept {
+
+        auto * d = static_cast<std::uint8_t *>(dst);
+        auto * s = static_cast<const std::uint8_t *>(src);
+
+        if (length <= 16) {
+            if (length >= 8) {
+                auto head = _::load<std::uint64_t>(s), tail = _::load<std::uint64_t>(s + length - 8);
+                __builtin_memcpy(d, &head, 8);
+                __builtin_memcpy(d + length - 8, &tail, 8);
+            } else if (length >= 4) {
+                auto head = _::load<std::uint32_t>(s), tail = _::load<std::uint32_t>(s + length - 4);
+                __builtin_memcpy(d, &head, 4);
+                __builtin_memcpy(d + length - 4, &tail, 4);
+            } else if (length) {
+                d[0] = s[0];
+                d[length >> 1] = s[length >> 1];
+                d[length - 1] = s[length - 1];
+            }
+            return;
+        }
+        if (length <= 32) {
+            _::move<16>(d, s);
+            _::move<16>(d + length - 16, s + length - 16);
+            return;
+        }
+        if (length <= 64) {
+            _::move<32>(d, s);
+            _::move<32>(d + length - 32, s + length - 32);
+            return;
+        }
+
+        auto & table = _::table();
+        if (unlikely(length >= table.nontemporal_threshold)) return table.stream(dst, src, length);
+        table.copy(dst, src, length);
+
+    } // dtl::memory::copy()
+
+    // Copies with non-temporal stores regardless of size, for bulk data that will not be read back soon (e.g. when
+    // filling a capture or export region).
+    inline static void
+    stream(
+        void * dst,
+        const void * src,
+        std::size_t length
+        ) noexcept {
+
+        if (length <= 64) return copy(dst, src, length);
+        _::table().stream(dst, src, length);
+
+    } // dtl::memory::stream()
+
+    inline static void
+    stream(
+        raii::mmap & region,
+        std::size_t offset,
+        const void * src,
+        std::size_t length
+        ) noexcept(false) {
+
+        if (unlikely(offset > region.size() || length > region.size() - offset)) {
+            throw std::system_error(std::make_error_code(std::errc::result_out_of_range), "memory::stream");
+        }
+        stream(static_cast<std::uint8_t *>(region.get()) + offset, src, length);
+
+    } // dtl::memory::stream(raii::mmap &, ...)
+
+    inline static void
+    zero(
+        void * dst,
+        std::size_t length
+        ) noexcept {
+
+        auto * d = static_cast<std::uint8_t *>(dst);
+
+        if (length <= 16) {
+            if (length >= 8) {
+                _::clear<8>(d);
+                _::clear<8>(d + length - 8);
+            } else if (length >= 4) {
+                _::clear<4>(d);
+                _::clear<4>(d + length - 4);
+            } else if (length) {
+                d[0] = 0;
+                d[length >> 1] = 0;
+                d[length - 1] = 0;
+            }
+            return;
+        }
+        if (length <= 32) {
+            _::clear<16>(d);
+            _::clear<16>(d + length - 16);
+            return;
+        }
+        if (length <= 64) {
+            _::clear<32>(d);
+            _::clear<32>(d + length - 32);
+            return;
+        }
+
+        _::table().zero(dst, length);
+
+    } // dtl::memory::zero()
+
+    inline static bool
+    equal(
+        const void * lhs,
+        const void * rhs,
+        std::size_t length
+        ) noexcept {
+
+        auto * a = static_cast<const std::uint8_t *>(lhs);
+        auto * b = static_cast<const std::uint8_t *>(rhs);
+
+        if (length <= 16) {
+            if (length >= 8) {
+                return !((_::load<std::uint64_t>(a) ^ _::load<std::uint64_t>(b))
+                       | (_::load<std::uint64_t>(a + length - 8) ^ _::load<std::uint64_t>(b + length - 8)));
+            }
+            if (length >= 4) {
+                return !((_::load<std::uint32_t>(a) ^ _::load<std::uint32_t>(b))
+                       | (_::load<std::uint32_t>(a + length - 4) ^ _::load<std::uint32_t>(b + length - 4)));
+            }
+            if (length) {
+                return !((a[0] ^ b[0]) | (a[length >> 1] ^ b[length >> 1]) | (a[length - 1] ^ b[length - 1]));
+            }
+            return true;
+        }
+        if (length <= 64) {
+            // Four overlapping 16-byte probes, evenly spaced so that no gap between them exceeds 16 bytes.
+            auto probe = [&](std::size_t at) {
+                return (_::load<std::uint64_t>(a + at) ^ _::load<std::uint64_t>(b + at))
+                     | (_::load<std::uint64_t>(a + at + 8) ^ _::load<std::uint64_t>(b + at + 8));
+            };
+            auto last = length - 16, step = (last + 2) / 3;
+            return !(probe(0) | probe(step) | probe(last - step) | probe(last));
+        }
+
+        return _::table().equal(lhs, rhs, length);
+
+    } // dtl::memory::equal()
+
+    // Three-way comparison with memcmp() semantics (sign of the result orders the buffers as unsigned bytes).
+    inline static int
+    compare(
+        const void * lhs,
+        const void * rhs,
+        std::size_t length
+        ) noexcept {
+
+        auto * a = static_cast<const std::uint8_t *>(lhs);
+        auto * b = static_cast<const std::uint8_t *>(rhs);
+
+        for (; length >= 8; a += 8, b += 8, length -= 8) {
+            auto x = _::load<std::uint64_t>(a), y = _::load<std::uint64_t>(b);
+            if (x != y) {
+                x = __builtin_bswap64(x);
+                y = __builtin_bswap64(y);
+                return (x > y) - (x < y);
+            }
+        }
+        for (; length; ++a, ++b, --length) {
+            if (*a != *b) return int(*a) - int(*b);
+        }
+        return 0;
+
+    } // dtl::memory::compare()
+
+} // namespace dtl::memory
@@ -0,0 +1,464 @@
+#pragma once
+
+#include <fcntl.h>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+#if defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+#include "branch.hh"
+#include "raii.hh"
+
+namespace dtl::multimatch {
+
+    // Compiled databases are a single flat image so that they can be written to disk and mapped back in place:
+    //
+    //   header | transitions[states * classes] | accept[states + 1] | outputs[...] | lengths[patterns]
+    //
+    // Transition entries hold the target state premultiplied by the number of byte classes, with the top bit set
+    // when the target state reports matches. The image is host-endian; it is not meant to be shipped across
+    // architectures.
+
+    struct header {
+
+        constexpr static std::uint32_t signature = 0x4d4c5444; // "DTLM"
+        constexpr static std::uint32_t revision = 1;
+
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint32_t states;
+        std::uint32_t classes;
+        std::uint32_t patterns;
+        std::uint32_t outputs;
+        std::uint32_t teddy;        // prefilter width in bytes (1..3), zero when disabled.
+        std::uint32_t reserved;
+        std::uint8_t classmap[256];
+        std::uint8_t teddy_lo[3][16];
+        std::uint8_t teddy_hi[3][16];
+
+    }; // struct dtl::multimatch::header
+
+    static_assert(sizeof(header) % 4 == 0);
+
+    // Scanning state carried across segments of the same stream.
+    struct stream {
+
+        std::uint32_t state = 0;
+        std::uint64_t offset = 0;
+
+    }; // struct dtl::multimatch::stream
+
+    namespace _ {
+
+        constexpr std::uint32_t match = 0x80000000u;
+
+        // Teddy is only worth running while the pattern set is small enough for the buckets to stay selective.
+        constexpr std::size_t teddy_max_patterns = 128;
+
+        inline static bool
+        teddy_hit(
+            const header & db,
+            const std::uint8_t * bytes
+            ) noexcept {
+
+            std::uint8_t mask = 0xff;
+            for (std::uint32_t k = 0; k < db.teddy; ++k) {
+                mask &= db.teddy_lo[k][bytes[k] & 0x0f] & db.teddy_hi[k][bytes[k] >> 4];
+            }
+            return (mask != 0);
+
+        } // _::teddy_hit()
+
+        // Returns the first position in [from, length - width] at which some pattern may start, or the start of the
+        // unfiltered tail (the last width - 1 bytes, which the DFA must see regardless) if there is none.
+        inline static std::size_t
+        teddy_find(
+            const header & db,
+            const std::uint8_t * bytes,
+            std::size_t from,
+            std::size_t length
+            ) noexcept {
+
+            std::size_t limit = (length >= db.teddy) ? length - db.teddy + 1 : 0;
+            std::size_t i = from;
+
+#if defined(__SSSE3__)
+            const __m128i nibble = _mm_set1_epi8(0x0f);
+            const __m128i zero = _mm_setzero_si128();
+            while (i + 16 <= limit) {
+                __m128i acc = _mm_set1_epi8(-1);
+                for (std::uint32_t k = 0; k < db.teddy; ++k) {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + i + k));
+                    __m128i lo = _mm_and_si128(v, nibble);
+                    __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+                    __m128i tlo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(db.teddy_lo[k]));
+                    __m128i thi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(db.teddy_hi[k]));
+                    acc = _mm_and_si128(acc, _mm_and_si128(_mm_shuffle_epi8(tlo, lo), _mm_shuffle_epi8(thi, hi)));
+                }
+                auto candidates = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(acc, zero))) ^ 0xffffu;
+                if (candidates) return i + __builtin_ctz(candidates);
+                i += 16;
+            }
+#endif
+
+            for (; i < limit; ++i) {
+                if (teddy_hit(db, bytes + i)) return i;
+            }
+            return (from > limit) ? from : limit;
+
+        } // _::teddy_find()
+
+    } // namespace dtl::multimatch::_
+
+    class database {
+
+        std::vector<std::uint8_t> storage;
+        raii::mmap mapping;
+        const header * image = nullptr;
+
+        inline const std::uint32_t *
+        transitions() const noexcept {
+
+            return reinterpret_cast<const std::uint32_t *>(image + 1);
+
+        } // database::transitions()
+
+        inline const std::uint32_t *
+        accept() const noexcept {
+
+            return transitions() + std::size_t(image->states) * image->classes;
+
+        } // database::accept()
+
+        inline const std::uint32_t *
+        outputs() const noexcept {
+
+            return accept() + image->states + 1;
+
+        } // database::outputs()
+
+        inline const std::uint32_t *
+        lengths() const noexcept {
+
+            return outputs() + image->outputs;
+
+        } // database::lengths()
+
+        inline static std::size_t
+        footprint(
+            const header & h
+            ) noexcept {
+
+            return sizeof(header)
+                + sizeof(std::uint32_t) * (std::size_t(h.states) * h.classes + h.states + 1 + h.outputs + h.patterns);
+
+        } // database::footprint()
+
+        inline void
+        validate(
+            std::size_t size
+            ) const noexcept(false) {
+
+            if (unlikely(size < sizeof(header)
+                      || image->magic != header::signature
+                      || image->version != header::revision
+                      || image->teddy > 3
+                      || !image->states
+                      || !image->classes
+                      || image->classes > 256
+                      || std::size_t(image->states) * image->classes >= _::match
+                      || footprint(*image) != size)) {
+                throw std::system_error(std::make_error_code(std::errc::invalid_argument), "multimatch::database");
+            }
+
+            // scan() indexes the tables without bounds checks, so every byte class, transition target, accept
+            // range and pattern identifier must stay inside the image.
+            bool valid = true;
+            for (std::size_t c = 0; c < 256; ++c) valid &= (image->classmap[c] < image->classes);
+
+            const auto * table = transitions();
+            const auto cells = std::size_t(image->states) * image->classes;
+            for (std::size_t i = 0; i < cells; ++i) {
+                auto target = table[i] & ~_::match;
+                valid &= (target < cells) & (target % image->classes == 0);
+            }
+
+            const auto * acc = accept();
+            valid &= (acc[0] == 0) & (acc[image->states] == image->outputs);
+            for (std::uint32_t s = 0; s < image->states; ++s) valid &= (acc[s] <= acc[s + 1]);
+
+            const auto * ids = outputs();
+            for (std::uint32_t k = 0; k < image->outputs; ++k) valid &= (ids[k] < image->patterns);
+
+            if (unlikely(!valid)) {
+                throw std::system_error(std::make_error_code(std::errc::invalid_argument), "multimatch::database");
+            }
+
+        } // database::validate()
+
+    public:
+
+        database() = default;
+        database(database &&) = default;
+        database & operator=(database &&) = default;
+
+        database(database const & other) = delete;
+        database & operator=(database const & other) = delete;
+
+        // Compiles a set of literal patterns; pattern identifiers are their indices in the input.
+        inline static database
+        compile(
+            const std::vector<std::string_view> & patterns
+            ) noexcept(false) {
+
+            constexpr std::uint32_t none = ~std::uint32_t(0);
+
+            header h{};
+            h.magic = header::signature;
+            h.version = header::revision;
+            h.patterns = static_cast<std::uint32_t>(patterns.size());
+
+            // Bytes that occur in no pattern all share class 0, every other byte gets a class of its own. When all
+            // 256 byte values occur the catch-all class would be unused, so the last one folds into it.
+            std::uint32_t classes = 1;
+            std::uint32_t assigned[256] = {};
+            for (auto pattern : patterns) {
+                if (unlikely(pattern.empty())) {
+                    throw std::system_error(std::make_error_code(std::errc::invalid_argument), "multimatch::compile");
+                }
+                for (auto c : pattern) {
+                    auto & slot = assigned[static_cast<std::uint8_t>(c)];
+                    if (!slot) slot = classes++;
+                }
+            }
+            if (unlikely(classes > 256)) classes = 256;
+            for (std::size_t c = 0; c < 256; ++c) h.classmap[c] = static_cast<std::uint8_t>(assigned[c] & 0xff);
+            h.classes = classes;
+
+            // Trie.
+            std::vector<std::uint32_t> delta(classes, none);
+            std::vector<std::vector<std::uint32_t>> out(1);
+            std::uint32_t states = 1;
+            for (std::uint32_t id = 0; id < patterns.size(); ++id) {
+                std::uint32_t s = 0;
+                for (auto c : patterns[id]) {
+                    auto & next = delta[std::size_t(s) * classes + h.classmap[static_cast<std::uint8_t>(c)]];
+                    if (next == none) {
+                        next = states++;
+                        delta.resize(std::size_t(states) * classes, none);
+                        out.emplace_back();
+                    }
+                    s = delta[std::size_t(s) * classes + h.classmap[static_cast<std::uint8_t>(c)]];
+                }
+                out[s].push_back(id);
+            }
+            if (unlikely(std::size_t(states) * classes >= _::match)) {
+                throw std::system_error(std::make_error_code(std::errc::value_too_large), "multimatch::compile");
+            }
+            h.states = states;
+
+            // Failure links folded into a full DFA, breadth first so every failure target is complete before use.
+            std::vector<std::uint32_t> fail(states, 0);
+            std::deque<std::uint32_t> queue;
+            for (std::uint32_t c = 0; c < classes; ++c) {
+                auto & next = delta[c];
+                if (next == none) {
+                    next = 0;
+                } else {
+                    queue.push_back(next);
+                }
+            }
+            while (!queue.empty()) {
+                auto u = queue.front();
+                queue.pop_front();
+                for (std::uint32_t c = 0; c < classes; ++c) {
+                    auto & next = delta[std::size_t(u) * classes + c];
+                    auto fallback = delta[std::size_t(fail[u]) * classes + c];
+                    if (next == none) {
+                        next = fallback;
+                    } else {
+                        fail[next] = fallback;
+                        out[next].insert(out[next].end(), out[fallback].begin(), out[fallback].end());
+                        queue.push_back(next);
+                    }
+                }
+            }
+
+            std::size_t outputs = 0;
+            for (auto & o : out) outputs += o.size();
+            h.outputs = static_cast<std::uint32_t>(outputs);
+
+            // Teddy masks over the first (up to) three bytes of each pattern.
+            std::size_t shortest = ~std::size_t(0);
+            for (auto pattern : patterns) shortest = (pattern.size() < shortest) ? pattern.size() : shortest;
+            if (!patterns.empty() && patterns.size() <= _::teddy_max_patterns) {
+                h.teddy = static_cast<std::uint32_t>((shortest < 3) ? shortest : 3);
+                for (auto pattern : patterns) {
+                    auto first = static_cast<std::uint8_t>(pattern[0]);
+                    std::uint8_t bucket = std::uint8_t(1) << ((first ^ (first >> 3)) & 7);
+                    for (std::uint32_t k = 0; k < h.teddy; ++k) {
+                        auto c = static_cast<std::uint8_t>(pattern[k]);
+                        h.teddy_lo[k][c & 0x0f] |= bucket;
+                        h.teddy_hi[k][c >> 4] |= bucket;
+                    }
+                }
+            }
+
+            database db;
+            db.storage.resize(footprint(h));
+            std::memcpy(db.storage.data(), &h, sizeof(h));
+            db.image = reinterpret_cast<const header *>(db.storage.data());
+
+            auto * table = const_cast<std::uint32_t *>(db.transitions());
+            for (std::size_t i = 0; i < delta.size(); ++i) {
+                auto target = delta[i];
+                table[i] = (target * classes) | (out[target].empty() ? 0 : _::match);
+            }
+
+            auto * acc = const_cast<std::uint32_t *>(db.accept());
+            auto * ids = const_cast<std::uint32_t *>(db.outputs());
+            std::uint32_t at = 0;
+            for (std::uint32_t s = 0; s < states; ++s) {
+                acc[s] = at;
+                for (auto id : out[s]) ids[at++] = id;
+            }
+            acc[states] = at;
+
+            auto * len = const_cast<std::uint32_t *>(db.lengths());
+            for (std::uint32_t id = 0; id < patterns.size(); ++id) len[id] = static_cast<std::uint32_t>(patterns[id].size());
+
+            return db;
+
+        } // database::compile()
+
+        // Maps a database previously written by save(); the image is used in place without deserializing.
+        inline static database
+        load(
+            const char * path
+            ) noexcept(false) {
+
+            int handle = ::open(path, O_RDONLY | O_CLOEXEC);
+            if (unlikely(handle == -1)) throw std::system_error(errno, std::system_category(), "open");
+
+            database db;
+            db.mapping = raii::mmap(raii::fd(handle));
+            db.image = static_cast<const header *>(db.mapping.get());
+            db.validate(db.mapping.size());
+            return db;
+
+        } // database::load()
+
+        inline void
+        save(
+            const char * path
+            ) const noexcept(false) {
+
+            raii::fd handle(::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+            if (unlikely(!handle)) throw std::system_error(errno, std::system_category(), "open");
+
+            auto size = size_bytes();
+            if (unlikely(::ftruncate(handle, size) == -1)) throw std::system_error(errno, std::system_category(), "ftruncate");
+
+            raii::mmap file(std::move(handle), PROT_READ | PROT_WRITE, MAP_SHARED);
+            std::memcpy(file.get(), image, size);
+
+        } // database::save()
+
+        inline std::size_t
+        size_bytes() const noexcept {
+
+            return image ? footprint(*image) : 0;
+
+        } // database::size_bytes()
+
+        inline std::uint32_t
+        patterns() const noexcept {
+
+            return image ? image->patterns : 0;
+
+        } // database::patterns()
+
+        inline std::uint32_t
+        length(
+            std::uint32_t pattern
+            ) const noexcept {
+
+            return lengths()[pattern];
+
+        } // database::length()
+
+        inline
+        operator bool() const noexcept {
+
+            return (image != nullptr);
+
+        } // database::operator bool() const
+
+        // Scans the next segment of a stream. The callback is invoked as callback(pattern, end) with the stream
+        // offset one past the last byte of the match, and returns false to stop scanning. Returns false if stopped.
+        template<typename Callback>
+        inline bool
+        scan(
+            stream & s,
+            const void * data,
+            std::size_t length,
+            Callback && callback
+            ) const {
+
+            auto * bytes = static_cast<const std::uint8_t *>(data);
+            const auto * table = transitions();
+            const auto * map = image->classmap;
+            auto state = s.state;
+            auto base = s.offset;
+
+            for (std::size_t i = 0; i < length; ) {
+
+                if (image->teddy && !state) {
+                    i = _::teddy_find(*image, bytes, i, length);
+                    if (unlikely(i >= length)) break;
+                }
+
+                state = table[(state & ~_::match) + map[bytes[i++]]];
+
+                if (unlikely(state & _::match)) {
+                    auto n = (state & ~_::match) / image->classes;
+                    const auto * ids = outputs();
+                    for (auto k = accept()[n], end = accept()[n + 1]; k < end; ++k) {
+                        if (!callback(ids[k], base + i)) {
+                            s.state = state;
+                            s.offset = base + i;
+                            return false;
+                        }
+                    }
+                }
+
+            }
+
+            s.state = state;
+            s.offset = base + length;
+            return true;
+
+        } // database::scan(stream &, ...)
+
+        // Block mode: scans a self-contained buffer with offsets relative to its start.
+        template<typename Callback>
+        inline bool
+        scan(
+            const void * data,
+            std::size_t length,
+            Callback && callback
+            ) const {
+
+            stream s;
+            return scan(s, data, length, std::forward<Callback>(callback));
+
+        } // database::scan()
+
+    }; // class dtl::multimatch::database
+
+} // namespace dtl::multimatch
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+namespace dtl::prefetch {
+
+    // Helpers for hiding memory latency across a burst of independent lookups. Each lookup is split into stages,
+    // every stage but the last ending with a prefetch of whatever the following stage will touch; the drivers below
+    // then interleave the stages of different keys so that the prefetches have time to land:
+    //
+    //   group()    - runs stage 0 over the whole burst, then stage 1, and so on (group prefetching).
+    //   pipeline() - runs stage k of key i alongside stage k + 1 of key i - distance (software pipelining).
+    //   amac()     - keeps a fixed number of lookups in flight as resumable state machines, for lookups whose
+    //                number of dependent accesses varies per key (chains, tree descents).
+
+    template<typename T>
+    inline static void
+    read(
+        const T * address
+        ) noexcept {
+
+        __builtin_prefetch(address, 0, 3);
+
+    } // dtl::prefetch::read()
+
+    template<typename T>
+    inline static void
+    write(
+        const T * address
+        ) noexcept {
+
+        __builtin_prefetch(address, 1, 3);
+
+    } // dtl::prefetch::write()
+
+    // Prefetches for data read once and not reused (streams past the caches where the hardware supports it).
+    template<typename T>
+    inline static void
+    once(
+        const T * address
+        ) noexcept {
+
+        __builtin_prefetch(address, 0, 0);
+
+    } // dtl::prefetch::once()
+
+    namespace _ {
+
+        template<std::size_t Distance, typename Stages, std::size_t... I>
+        inline static void
+        step(
+            std::size_t t,
+            std::size_t count,
+            Stages & stages,
+            std::index_sequence<I...>
+            ) {
+
+            // Later stages first, so that each consumes its prefetch before the earlier stages issue new ones.
+            constexpr std::size_t last = sizeof...(I) - 1;
+            ((t >= (last - I) * Distance && t - (last - I) * Distance < count
+                ? std::get<last - I>(stages)(t - (last - I) * Distance)
+                : void()), ...);
+
+        } // _::step()
+
+    } // namespace dtl::prefetch::_
+
+    // Invokes every stage over [0, count) in turn: stage(i) for all i, then the next stage.
+    template<typename... Stages>
+    inline static void
+    group(
+        std::size_t count,
+        Stages &&... stages
+        ) {
+
+        ([&](auto & stage) {
+            for (std::size_t i = 0; i < count; ++i) stage(i);
+        }(stages), ...);
+
+    } // dtl::prefetch::group()
+
+    // Invokes stage k for key t - k * Distance at step t, so consecutive stages of one key are Distance steps apart.
+    template<std::size_t Distance, typename... Stages>
+    inline static void
+    pipeline(
+        std::size_t count,
+        Stages &&... stages
+        ) {
+
+        static_assert(Distance > 0 && sizeof...(Stages) > 0);
+
+        auto tuple = std::forward_as_tuple(stages...);
+        auto steps = count + (sizeof...(Stages) - 1) * Distance;
+        for (std::size_t t = 0; t < steps; ++t) {
+            _::step<Distance>(t, count, tuple, std::index_sequence_for<Stages...>{});
+        }
+
+    } // dtl::prefetch::pipeline()
+
+    // Asynchronous memory access chaining: Width lookups are kept in flight in a ring of State slots.
+    // start(state, i) initializes a slot for key i and prefetches its first access; advance(state) performs the
+    // access prefetched last time and either returns true (done) or prefetches the next one and returns false.
+    template<std::size_t Width, typename State, typename Start, typename Advance>
+    inline static void
+    amac(
+        std::size_t count,
+        Start && start,
+        Advance && advance
+        ) {
+
+        static_assert(Width > 0);
+
+        State slots[Width];
+        bool live[Width] = {};
+        std::size_t next = 0, active = 0;
+
+        for (; active < Width && next < count; ++active) {
+            start(slots[active], next++);
+            live[active] = true;
+        }
+
+        while (active) {
+            for (std::size_t w = 0; w < Width; ++w) {
+                if (!live[w] || !advance(slots[w])) continue;
+                if (next < count) {
+                    start(slots[w], next++);
+                } else {
+                    live[w] = false;
+                    --active;
+                }
+            }
+        }
+
+    } // dtl::prefetch::amac()
+
+    // Batched lookups over any table exposing `prefetch(key)` (touching the key's home location without using
+    // it) and `find(key)`: keys are processed in bursts of Burst, all prefetched before any is looked up.
+    template<std::size_t Burst = 16, typename Table, typename Key, typename Result>
+    inline static void
+    lookup(
+        Table & table,
+        const Key * keys,
+        std::size_t count,
+        Result * results
+        ) {
+
+        for (std::size_t base = 0; base < count; base += Burst) {
+            std::size_t n = (count - base < Burst) ? count - base : Burst;
+            group(n,
+                [&](std::size_t i) { table.prefetch(keys[base + i]); },
+                [&](std::size_t i) { results[base + i] = table.find(keys[base + i]); }
+                );
+        }
+
+    } // dtl::prefetch::lookup()
+
+} // namespace dtl::prefetch
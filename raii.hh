@@ -150,6 +150,10 @@ namespace dtl::raii {
 
     public:
 
+        inline
+        mmap() noexcept
+            : address(MAP_FAILED), length(0) {}
+
         inline explicit
         mmap(
             raii::fd && fd,
@@ -0,0 +1,468 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include "branch.hh"
+#include "hash.hh"
+#include "simd.hh"
+
+namespace dtl::random {
+
+    // Small, fast generators for sampling and load spreading; none is suitable where an attacker must not predict
+    // the output (use getrandom(2) or hash::seed() for keys). All satisfy UniformRandomBitGenerator, so they also
+    // work with <random> distributions.
+    //
+    //   xoshiro256pp - xoshiro256++ (Blackman, Vigna): 256 bits of state, jump() for 2^128 disjoint streams.
+    //   wyrand       - one 64-bit add and a 64x64->128 multiply per draw, as Go's runtime uses.
+    //   pcg32        - PCG-XSH-RR 64/32 (O'Neill): 32-bit output, selectable stream.
+    //   streams      - xoshiro256++ in every 64-bit lane of a dtl::simd vector, lanes a jump apart.
+    //
+    // bounded() draws uniformly from [0, range) with Lemire's multiply-shift, which needs a division only on the
+    // rare draws that fall in the biased zone. bernoulli samples packets with probability p (or 1 in n) as one
+    // compare against a 64-bit threshold, and a burst at once as a bitmask, without a branch per packet. flows
+    // samples by flow key instead: a keyed hash against the same threshold, so a flow is always or never sampled
+    // on every host that shares the key, and a flow sampled at rate p is also sampled at every rate above p.
+
+    namespace _ {
+
+        inline static constexpr std::uint64_t
+        rotl(
+            std::uint64_t x,
+            int bits
+            ) noexcept {
+
+            return (x << bits) | (x >> (64 - bits));
+
+        } // _::rotl()
+
+        inline static constexpr std::uint64_t
+        splitmix64(
+            std::uint64_t & state
+            ) noexcept {
+
+            auto z = (state += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            return z ^ (z >> 31);
+
+        } // _::splitmix64()
+
+        template<typename Generator>
+        inline static std::uint64_t
+        draw64(
+            Generator & g
+            ) noexcept {
+
+            static_assert(Generator::min() == 0 && (Generator::max() == 0xffffffffffffffffull || Generator::max() == 0xffffffffu),
+                          "generators must produce full 32- or 64-bit words");
+
+            if constexpr (Generator::max() == 0xffffffffu) {
+                std::uint64_t hi = g();
+                return hi << 32 | g();
+            } else {
+                return g();
+            }
+
+        } // _::draw64()
+
+        template<typename Generator>
+        inline static std::uint32_t
+        draw32(
+            Generator & g
+            ) noexcept {
+
+            if constexpr (Generator::max() == 0xffffffffu) return g();
+            else return static_cast<std::uint32_t>(draw64(g) >> 32);
+
+        } // _::draw32()
+
+        // floor(p * 2^64), saturating at both ends.
+        inline static constexpr std::uint64_t
+        threshold(
+            double p
+            ) noexcept {
+
+            if (!(p > 0)) return 0;
+            auto scaled = p * 0x1p64;
+            return scaled >= 0x1p64 ? std::numeric_limits<std::uint64_t>::max() : static_cast<std::uint64_t>(scaled);
+
+        } // _::threshold()
+
+        // floor(2^64 / n): one draw in n falls below it, to within 2^-64.
+        inline static constexpr std::uint64_t
+        one_in(
+            std::uint64_t n
+            ) noexcept {
+
+            if (n <= 1) return std::numeric_limits<std::uint64_t>::max();
+            auto max = std::numeric_limits<std::uint64_t>::max();
+            return max / n + (max % n + 1 == n);
+
+        } // _::one_in()
+
+    } // namespace dtl::random::_
+
+    class xoshiro256pp {
+
+        std::uint64_t s[4];
+
+    public:
+
+        using result_type = std::uint64_t;
+
+        static constexpr result_type min() noexcept { return 0; }
+        static constexpr result_type max() noexcept { return std::numeric_limits<result_type>::max(); }
+
+        // The state is expanded from seed with splitmix64, so any seed (zero included) is fine.
+        inline explicit constexpr
+        xoshiro256pp(
+            std::uint64_t seed
+            ) noexcept
+            : s{} {
+
+            for (auto & word : s) word = _::splitmix64(seed);
+
+        } // xoshiro256pp::xoshiro256pp()
+
+        inline constexpr result_type
+        operator()() noexcept {
+
+            auto result = _::rotl(s[0] + s[3], 23) + s[0];
+            auto t = s[1] << 17;
+            s[2] ^= s[0];
+            s[3] ^= s[1];
+            s[1] ^= s[2];
+            s[0] ^= s[3];
+            s[2] ^= t;
+            s[3] = _::rotl(s[3], 45);
+            return result;
+
+        } // xoshiro256pp::operator()()
+
+        // Advances by 2^128 draws: successive jumps from one seed give streams that cannot overlap.
+        inline constexpr void
+        jump() noexcept {
+
+            constexpr std::uint64_t polynomial[4] = {
+                0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c,
+            };
+
+            std::uint64_t t[4] = {};
+            for (auto word : polynomial) {
+                for (int bit = 0; bit < 64; ++bit) {
+                    if (word & (std::uint64_t(1) << bit)) {
+                        for (int i = 0; i < 4; ++i) t[i] ^= s[i];
+                    }
+                    (*this)();
+                }
+            }
+            for (int i = 0; i < 4; ++i) s[i] = t[i];
+
+        } // xoshiro256pp::jump()
+
+        inline constexpr const std::uint64_t *
+        state() const noexcept {
+
+            return s;
+
+        } // xoshiro256pp::state() const
+
+    }; // class dtl::random::xoshiro256pp
+
+    class wyrand {
+
+        std::uint64_t s;
+
+    public:
+
+        using result_type = std::uint64_t;
+
+        static constexpr result_type min() noexcept { return 0; }
+        static constexpr result_type max() noexcept { return std::numeric_limits<result_type>::max(); }
+
+        inline explicit constexpr
+        wyrand(
+            std::uint64_t seed
+            ) noexcept
+            : s(seed) {}
+
+        inline constexpr result_type
+        operator()() noexcept {
+
+            s += 0xa0761d6478bd642full;
+            auto m = static_cast<unsigned __int128>(s) * (s ^ 0xe7037ed1a0b428dbull);
+            return static_cast<std::uint64_t>(m) ^ static_cast<std::uint64_t>(m >> 64);
+
+        } // wyrand::operator()()
+
+    }; // class dtl::random::wyrand
+
+    class pcg32 {
+
+        std::uint64_t s;
+        std::uint64_t increment;
+
+        inline constexpr void
+        step() noexcept {
+
+            s = s * 6364136223846793005ull + increment;
+
+        } // pcg32::step()
+
+    public:
+
+        using result_type = std::uint32_t;
+
+        static constexpr result_type min() noexcept { return 0; }
+        static constexpr result_type max() noexcept { return std::numeric_limits<result_type>::max(); }
+
+        // Generators with different streams produce unrelated sequences from the same seed.
+        inline explicit constexpr
+        pcg32(
+            std::uint64_t seed,
+            std::uint64_t stream = 0
+            ) noexcept
+            : s(0), increment(stream << 1 | 1) {
+
+            step();
+            s += seed;
+            step();
+
+        } // pcg32::pcg32()
+
+        inline constexpr result_type
+        operator()() noexcept {
+
+            auto old = s;
+            step();
+            auto shifted = static_cast<std::uint32_t>(((old >> 18) ^ old) >> 27);
+            auto rotation = static_cast<std::uint32_t>(old >> 59);
+            return (shifted >> rotation) | (shifted << ((32 - rotation) & 31));
+
+        } // pcg32::operator()()
+
+    }; // class dtl::random::pcg32
+
+    // W xoshiro256++ generators stepped together, lane i seeded i jumps after lane 0.
+    template<std::size_t W = simd::native_width<std::uint64_t>>
+    class streams {
+
+    public:
+
+        using lanes = simd::vec<std::uint64_t, W>;
+
+    private:
+
+        lanes s0, s1, s2, s3;
+
+        inline static lanes
+        rotl(
+            lanes x,
+            int bits
+            ) noexcept {
+
+            return { (x.v << bits) | (x.v >> (64 - bits)) };
+
+        } // streams::rotl()
+
+    public:
+
+        static constexpr std::size_t width = W;
+
+        inline explicit
+        streams(
+            std::uint64_t seed
+            ) noexcept {
+
+            xoshiro256pp g(seed);
+            std::uint64_t words[4][W];
+            for (std::size_t i = 0; i < W; ++i, g.jump()) {
+                for (std::size_t j = 0; j < 4; ++j) words[j][i] = g.state()[j];
+            }
+            s0 = lanes::load(words[0]);
+            s1 = lanes::load(words[1]);
+            s2 = lanes::load(words[2]);
+            s3 = lanes::load(words[3]);
+
+        } // streams::streams()
+
+        // One draw from every lane.
+        inline lanes
+        next() noexcept {
+
+            lanes result = { rotl({ s0.v + s3.v }, 23).v + s0.v };
+            lanes t = { s1.v << 17 };
+            s2.v ^= s0.v;
+            s3.v ^= s1.v;
+            s1.v ^= s2.v;
+            s0.v ^= s3.v;
+            s2.v ^= t.v;
+            s3 = rotl(s3, 45);
+            return result;
+
+        } // streams::next()
+
+        inline void
+        fill(
+            std::uint64_t * out,
+            std::size_t count
+            ) noexcept {
+
+            auto whole = count / W * W;
+            for (std::size_t i = 0; i != whole; i += W) next().store(out + i);
+            if (whole != count) {
+                std::uint64_t rest[W];
+                next().store(rest);
+                std::memcpy(out + whole, rest, (count - whole) * sizeof(std::uint64_t));
+            }
+
+        } // streams::fill()
+
+    }; // class dtl::random::streams
+
+    // Uniform in [0, range), range > 0, without modulo bias: 32-bit ranges take 32 bits of a draw, wider ones 64.
+    template<typename Generator, typename T>
+    inline static T
+    bounded(
+        Generator & g,
+        T range
+        ) noexcept {
+
+        static_assert(std::is_integral<T>::value);
+
+        if constexpr (sizeof(T) <= 4) {
+            auto r = static_cast<std::uint32_t>(range);
+            auto m = std::uint64_t(_::draw32(g)) * r;
+            if (unlikely(static_cast<std::uint32_t>(m) < r)) {
+                auto floor = static_cast<std::uint32_t>(-r) % r;
+                while (static_cast<std::uint32_t>(m) < floor) m = std::uint64_t(_::draw32(g)) * r;
+            }
+            return static_cast<T>(m >> 32);
+        } else {
+            auto r = static_cast<std::uint64_t>(range);
+            auto m = static_cast<unsigned __int128>(_::draw64(g)) * r;
+            if (unlikely(static_cast<std::uint64_t>(m) < r)) {
+                auto floor = -r % r;
+                while (static_cast<std::uint64_t>(m) < floor) m = static_cast<unsigned __int128>(_::draw64(g)) * r;
+            }
+            return static_cast<T>(m >> 64);
+        }
+
+    } // dtl::random::bounded()
+
+    class bernoulli {
+
+        std::uint64_t threshold;
+
+    public:
+
+        // p is clamped to [0, 1]; p = 1 misses once in 2^64.
+        inline explicit constexpr
+        bernoulli(
+            double p
+            ) noexcept
+            : threshold(_::threshold(p)) {}
+
+        inline static constexpr bernoulli
+        one_in(
+            std::uint64_t n
+            ) noexcept {
+
+            bernoulli b(0.0);
+            b.threshold = _::one_in(n);
+            return b;
+
+        } // bernoulli::one_in()
+
+        template<typename Generator>
+        inline bool
+        operator()(
+            Generator & g
+            ) const noexcept {
+
+            return _::draw64(g) < threshold;
+
+        } // bernoulli::operator()() const
+
+        // Bit i set if packet i of a burst of count <= 64 is sampled.
+        template<typename Generator>
+        inline std::uint64_t
+        burst(
+            Generator & g,
+            std::size_t count
+            ) const noexcept {
+
+            std::uint64_t sampled = 0;
+            for (std::size_t i = 0; i < count; ++i) sampled |= std::uint64_t(_::draw64(g) < threshold) << i;
+            return sampled;
+
+        } // bernoulli::burst() const
+
+        // A lane per packet: one vector compare and movemask per streams::width packets.
+        template<std::size_t W>
+        inline std::uint64_t
+        burst(
+            streams<W> & g,
+            std::size_t count
+            ) const noexcept {
+
+            using lanes = typename streams<W>::lanes;
+
+            auto limit = lanes::broadcast(threshold);
+            std::uint64_t sampled = 0;
+            for (std::size_t i = 0; i < count; i += W) sampled |= simd::movemask(simd::lt(g.next(), limit)) << i;
+            return count == 64 ? sampled : sampled & ((std::uint64_t(1) << count) - 1);
+
+        } // bernoulli::burst() const
+
+    }; // class dtl::random::bernoulli
+
+    // Deterministic sampling by flow key with SipHash-1-3, which unlike hash::aeshash gives the same answer on
+    // every target. Keys are hashed as hash::representation() has them.
+    class flows {
+
+        hash::key secret;
+        std::uint64_t threshold;
+
+    public:
+
+        inline
+        flows(
+            double p,
+            const hash::key & secret
+            ) noexcept
+            : secret(secret), threshold(_::threshold(p)) {}
+
+        template<typename Key>
+        inline bool
+        operator()(
+            const Key & flow
+            ) const noexcept {
+
+            auto bytes = hash::representation(flow);
+            return hash::siphash13(secret, bytes.data(), bytes.size()) < threshold;
+
+        } // flows::operator()() const
+
+        // Bit i set if keys[i], each size bytes, is sampled; count <= 64.
+        inline std::uint64_t
+        burst(
+            const void * const * keys,
+            std::size_t size,
+            std::size_t count
+            ) const noexcept {
+
+            std::uint64_t hashes[64];
+            hash::siphash13(secret, keys, size, hashes, count);
+            std::uint64_t sampled = 0;
+            for (std::size_t i = 0; i < count; ++i) sampled |= std::uint64_t(hashes[i] < threshold) << i;
+            return sampled;
+
+        } // flows::burst() const
+
+    }; // class dtl::random::flows
+
+} // namespace dtl::random
@@ -0,0 +1,533 @@
+#pragma once
+
+#include <fcntl.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <queue>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+#include "branch.hh"
+#include "prefetch.hh"
+#include "raii.hh"
+
+namespace dtl::rangemap {
+
+    // Maps from key ranges (port ranges, address blocks) to values. Ranges are kept as disjoint segments: a sorted
+    // array of segment starts, the first always 0, with one value and a presence flag per segment, so a lookup is a
+    // single branchless search for the last start <= key. Overlapping inputs resolve to the range given last.
+    //
+    //   map     - compiled once from a list of ranges into a flat image that save() writes and load() maps back.
+    //   dynamic - the same segments in vectors, updated range by range with assign() and erase().
+    //
+    // Both also answer bursts of keys at once, advancing all of the searches together so that their cache misses
+    // overlap instead of being taken one after the other.
+
+    template<typename Key, typename Value>
+    struct range {
+
+        Key low;
+        Key high;       // inclusive
+        Value value;
+
+    }; // struct dtl::rangemap::range
+
+    namespace _ {
+
+        template<typename Key>
+        constexpr bool is_key = std::is_unsigned<Key>::value
+#if defined(__SIZEOF_INT128__)
+            || std::is_same<Key, unsigned __int128>::value
+#endif
+            ;
+
+        // Index of the last start <= key; starts[0] must be 0 and count at least 1.
+        template<typename Key>
+        inline static std::size_t
+        locate(
+            const Key * starts,
+            std::size_t count,
+            Key key
+            ) noexcept {
+
+            const Key * base = starts;
+            while (count > 1) {
+                auto half = count / 2;
+                base = (base[half] <= key) ? base + half : base;
+                count -= half;
+            }
+            return static_cast<std::size_t>(base - starts);
+
+        } // _::locate()
+
+        // locate() over a burst of keys in lockstep: every search takes the same number of steps, so each step
+        // issues one independent load per key and prefetches both lines the next step may probe.
+        template<std::size_t Burst = 16, typename Key>
+        inline static void
+        locate(
+            const Key * starts,
+            std::size_t count,
+            const Key * keys,
+            std::size_t n,
+            std::size_t * out
+            ) noexcept {
+
+            for (std::size_t first = 0; first < n; first += Burst) {
+                std::size_t width = (n - first < Burst) ? n - first : Burst;
+                const Key * base[Burst];
+                for (std::size_t b = 0; b < width; ++b) base[b] = starts;
+
+                for (auto left = count; left > 1;) {
+                    auto half = left / 2;
+                    auto next = left - half;
+                    if (next > 1) {
+                        for (std::size_t b = 0; b < width; ++b) {
+                            prefetch::read(base[b] + next / 2);
+                            prefetch::read(base[b] + half + next / 2);
+                        }
+                    }
+                    for (std::size_t b = 0; b < width; ++b) {
+                        base[b] = (base[b][half] <= keys[first + b]) ? base[b] + half : base[b];
+                    }
+                    left = next;
+                }
+
+                for (std::size_t b = 0; b < width; ++b) out[first + b] = static_cast<std::size_t>(base[b] - starts);
+            }
+
+        } // _::locate(const Key *, ...)
+
+        template<typename Value>
+        inline static bool
+        same(
+            bool a_present,
+            const Value & a,
+            bool b_present,
+            const Value & b
+            ) noexcept {
+
+            // Bytewise: a miss only leaves two equal segments unmerged.
+            return a_present == b_present && (!a_present || !std::memcmp(&a, &b, sizeof(Value)));
+
+        } // _::same()
+
+    } // namespace dtl::rangemap::_
+
+    template<typename Key, typename Value>
+    class dynamic {
+
+        static_assert(_::is_key<Key>, "keys are unsigned integers");
+        static_assert(std::is_trivially_copyable<Value>::value);
+
+        std::vector<Key> starts{ Key(0) };
+        std::vector<Value> values{ Value() };
+        std::vector<std::uint8_t> present{ 0 };
+
+        // Makes `at` the start of a segment (splitting the one containing it) and returns that segment's index.
+        inline std::size_t
+        split(
+            Key at
+            ) noexcept(false) {
+
+            auto i = _::locate(starts.data(), starts.size(), at);
+            if (starts[i] == at) return i;
+            starts.insert(starts.begin() + i + 1, at);
+            values.insert(values.begin() + i + 1, values[i]);
+            present.insert(present.begin() + i + 1, present[i]);
+            return i + 1;
+
+        } // dynamic::split()
+
+        inline void
+        merge(
+            std::size_t i
+            ) noexcept {
+
+            if (_::same<Value>(present[i - 1], values[i - 1], present[i], values[i])) {
+                starts.erase(starts.begin() + i);
+                values.erase(values.begin() + i);
+                present.erase(present.begin() + i);
+            }
+
+        } // dynamic::merge()
+
+        inline void
+        paint(
+            Key low,
+            Key high,
+            const Value * value
+            ) noexcept(false) {
+
+            if (unlikely(high < low)) return;
+
+            auto i = split(low);
+            auto end = (high == Key(~Key(0))) ? starts.size() : split(Key(high + 1));
+
+            starts.erase(starts.begin() + i + 1, starts.begin() + end);
+            values.erase(values.begin() + i + 1, values.begin() + end);
+            present.erase(present.begin() + i + 1, present.begin() + end);
+
+            values[i] = value ? *value : Value();
+            present[i] = (value != nullptr);
+
+            if (i + 1 < starts.size()) merge(i + 1);
+            if (i > 0) merge(i);
+
+        } // dynamic::paint()
+
+    public:
+
+        using key_type = Key;
+        using value_type = Value;
+
+        // Maps [low, high] to value, replacing whatever those keys mapped to before.
+        inline void
+        assign(
+            Key low,
+            Key high,
+            const Value & value
+            ) noexcept(false) {
+
+            paint(low, high, &value);
+
+        } // dynamic::assign()
+
+        inline void
+        erase(
+            Key low,
+            Key high
+            ) noexcept(false) {
+
+            paint(low, high, nullptr);
+
+        } // dynamic::erase()
+
+        inline void
+        clear() noexcept {
+
+            starts.assign(1, Key(0));
+            values.assign(1, Value());
+            present.assign(1, 0);
+
+        } // dynamic::clear()
+
+        inline const Value *
+        find(
+            Key key
+            ) const noexcept {
+
+            auto i = _::locate(starts.data(), starts.size(), key);
+            return present[i] ? &values[i] : nullptr;
+
+        } // dynamic::find()
+
+        // Batched find(): results[i] is the value for keys[i], or nullptr.
+        inline void
+        find(
+            const Key * keys,
+            std::size_t count,
+            const Value ** results
+            ) const noexcept {
+
+            constexpr std::size_t burst = 16;
+            std::size_t at[burst];
+            for (std::size_t first = 0; first < count; first += burst) {
+                std::size_t n = (count - first < burst) ? count - first : burst;
+                _::locate<burst>(starts.data(), starts.size(), keys + first, n, at);
+                for (std::size_t b = 0; b < n; ++b) results[first + b] = present[at[b]] ? &values[at[b]] : nullptr;
+            }
+
+        } // dynamic::find(const Key *, ...)
+
+        inline std::size_t
+        segments() const noexcept {
+
+            return starts.size();
+
+        } // dynamic::segments()
+
+        // Visits the mapped ranges in order as visitor(low, high, value).
+        template<typename Visitor>
+        inline void
+        for_each(
+            Visitor && visitor
+            ) const {
+
+            for (std::size_t i = 0; i < starts.size(); ++i) {
+                if (!present[i]) continue;
+                auto high = (i + 1 < starts.size()) ? Key(starts[i + 1] - 1) : Key(~Key(0));
+                visitor(starts[i], high, values[i]);
+            }
+
+        } // dynamic::for_each()
+
+    }; // class dtl::rangemap::dynamic
+
+    // Compiled maps are a single flat image, host-endian like multimatch databases:
+    //
+    //   header | starts[segments] | values[segments] | present[segments]
+    //
+    // with each array starting on a 16-byte boundary, enough for 128-bit (IPv6) keys.
+
+    struct header {
+
+        constexpr static std::uint32_t signature = 0x494c5444; // "DTLI"
+        constexpr static std::uint32_t revision = 1;
+
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint32_t key_size;
+        std::uint32_t value_size;
+        std::uint64_t segments;
+        std::uint64_t reserved;
+
+    }; // struct dtl::rangemap::header
+
+    static_assert(sizeof(header) % 16 == 0);
+
+    template<typename Key, typename Value>
+    class map {
+
+        static_assert(_::is_key<Key>, "keys are unsigned integers");
+        static_assert(std::is_trivially_copyable<Value>::value);
+        static_assert(alignof(Key) <= 16 && alignof(Value) <= 16, "image sections are 16-byte aligned");
+
+        std::vector<std::uint64_t> storage;   // operator new alignment is at least 16 on the targets we build for
+        raii::mmap mapping;
+        const header * image = nullptr;
+
+        inline static constexpr std::size_t
+        align(
+            std::size_t bytes
+            ) noexcept {
+
+            return (bytes + 15) & ~std::size_t(15);
+
+        } // map::align()
+
+        inline static std::size_t
+        footprint(
+            std::uint64_t segments
+            ) noexcept {
+
+            return sizeof(header) + align(sizeof(Key) * segments) + align(sizeof(Value) * segments) + align(segments);
+
+        } // map::footprint()
+
+        inline const Key *
+        starts() const noexcept {
+
+            return reinterpret_cast<const Key *>(image + 1);
+
+        } // map::starts()
+
+        inline const Value *
+        values() const noexcept {
+
+            return reinterpret_cast<const Value *>(
+                reinterpret_cast<const std::uint8_t *>(starts()) + align(sizeof(Key) * image->segments));
+
+        } // map::values()
+
+        inline const std::uint8_t *
+        present() const noexcept {
+
+            return reinterpret_cast<const std::uint8_t *>(values()) + align(sizeof(Value) * image->segments);
+
+        } // map::present()
+
+        inline void
+        validate(
+            std::size_t size
+            ) const noexcept(false) {
+
+            if (unlikely(size < sizeof(header)
+                      || image->magic != header::signature
+                      || image->version != header::revision
+                      || image->key_size != sizeof(Key)
+                      || image->value_size != sizeof(Value)
+                      || !image->segments
+                      || image->segments > size
+                      || footprint(image->segments) != size
+                      || starts()[0] != Key(0))) {
+                throw std::system_error(std::make_error_code(std::errc::invalid_argument), "rangemap::map");
+            }
+
+        } // map::validate()
+
+        // Builds the image from disjoint segments given as parallel arrays.
+        inline static map
+        build(
+            const std::vector<Key> & starts,
+            const std::vector<Value> & values,
+            const std::vector<std::uint8_t> & present
+            ) noexcept(false) {
+
+            header h{ header::signature, header::revision, sizeof(Key), sizeof(Value), starts.size(), 0 };
+
+            map m;
+            m.storage.resize(footprint(h.segments) / 8);
+            std::memcpy(m.storage.data(), &h, sizeof(h));
+            m.image = reinterpret_cast<const header *>(m.storage.data());
+
+            std::memcpy(const_cast<Key *>(m.starts()), starts.data(), sizeof(Key) * starts.size());
+            std::memcpy(const_cast<Value *>(m.values()), values.data(), sizeof(Value) * values.size());
+            std::memcpy(const_cast<std::uint8_t *>(m.present()), present.data(), present.size());
+            return m;
+
+        } // map::build()
+
+    public:
+
+        using key_type = Key;
+        using value_type = Value;
+
+        map() = default;
+        map(map &&) = default;
+        map & operator=(map &&) = default;
+
+        // Resolves overlaps by a sweep over the range boundaries, keeping at each point the range given last
+        // among those covering it: O(n log n) in the number of ranges.
+        inline static map
+        compile(
+            const std::vector<range<Key, Value>> & ranges
+            ) noexcept(false) {
+
+            constexpr Key last = Key(~Key(0));
+
+            std::vector<std::size_t> order;
+            std::vector<Key> bounds{ Key(0) };
+            for (std::size_t i = 0; i < ranges.size(); ++i) {
+                auto & r = ranges[i];
+                if (unlikely(r.high < r.low)) continue;
+                order.push_back(i);
+                bounds.push_back(r.low);
+                if (r.high != last) bounds.push_back(Key(r.high + 1));
+            }
+            std::sort(bounds.begin(), bounds.end());
+            bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+            std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+                return ranges[a].low < ranges[b].low;
+            });
+
+            std::vector<Key> starts;
+            std::vector<Value> values;
+            std::vector<std::uint8_t> present;
+            std::priority_queue<std::size_t> active;
+            std::size_t next = 0;
+
+            for (auto at : bounds) {
+                for (; next < order.size() && ranges[order[next]].low <= at; ++next) active.push(order[next]);
+                while (!active.empty() && ranges[active.top()].high < at) active.pop();
+
+                bool hit = !active.empty();
+                auto value = hit ? ranges[active.top()].value : Value();
+                if (!starts.empty() && _::same<Value>(present.back(), values.back(), hit, value)) continue;
+                starts.push_back(at);
+                values.push_back(value);
+                present.push_back(hit);
+            }
+
+            return build(starts, values, present);
+
+        } // map::compile()
+
+        // Freezes a dynamic map into a compiled one.
+        inline static map
+        compile(
+            const dynamic<Key, Value> & source
+            ) noexcept(false) {
+
+            std::vector<range<Key, Value>> ranges;
+            source.for_each([&](Key low, Key high, const Value & value) { ranges.push_back({ low, high, value }); });
+            return compile(ranges);
+
+        } // map::compile(const dynamic &)
+
+        // Maps an index previously written by save(); the image is used in place without deserializing.
+        inline static map
+        load(
+            const char * path
+            ) noexcept(false) {
+
+            int handle = ::open(path, O_RDONLY | O_CLOEXEC);
+            if (unlikely(handle == -1)) throw std::system_error(errno, std::system_category(), "open");
+
+            map m;
+            m.mapping = raii::mmap(raii::fd(handle));
+            m.image = static_cast<const header *>(m.mapping.get());
+            m.validate(m.mapping.size());
+            return m;
+
+        } // map::load()
+
+        inline void
+        save(
+            const char * path
+            ) const noexcept(false) {
+
+            raii::fd handle(::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+            if (unlikely(!handle)) throw std::system_error(errno, std::system_category(), "open");
+
+            auto size = size_bytes();
+            if (unlikely(::ftruncate(handle, size) == -1)) throw std::system_error(errno, std::system_category(), "ftruncate");
+
+            raii::mmap file(std::move(handle), PROT_READ | PROT_WRITE, MAP_SHARED);
+            std::memcpy(file.get(), image, size);
+
+        } // map::save()
+
+        inline std::size_t
+        size_bytes() const noexcept {
+
+            return image ? footprint(image->segments) : 0;
+
+        } // map::size_bytes()
+
+        inline std::size_t
+        segments() const noexcept {
+
+            return image ? image->segments : 0;
+
+        } // map::segments()
+
+        inline
+        operator bool() const noexcept {
+
+            return (image != nullptr);
+
+        } // map::operator bool() const
+
+        inline const Value *
+        find(
+            Key key
+            ) const noexcept {
+
+            auto i = _::locate(starts(), image->segments, key);
+            return present()[i] ? &values()[i] : nullptr;
+
+        } // map::find()
+
+        // Batched find(): results[i] is the value for keys[i], or nullptr.
+        inline void
+        find(
+            const Key * keys,
+            std::size_t count,
+            const Value ** results
+            ) const noexcept {
+
+            constexpr std::size_t burst = 16;
+            std::size_t at[burst];
+            for (std::size_t first = 0; first < count; first += burst) {
+                std::size_t n = (count - first < burst) ? count - first : burst;
+                _::locate<burst>(starts(), image->segments, keys + first, n, at);
+                for (std::size_t b = 0; b < n; ++b) results[first + b] = present()[at[b]] ? &values()[at[b]] : nullptr;
+            }
+
+        } // map::find(const Key *, ...)
+
+    }; // class dtl::rangemap::map
+
+} // namespace dtl::rangemap
@@ -0,0 +1,585 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+#include <type_traits>
+#include "branch.hh"
+#include "branchless.hh"
+#include "cacheline.hh"
+#include "lock.hh"
+#include "raii.hh"
+
+namespace dtl::ring {
+
+    namespace _ {
+
+        inline static constexpr std::size_t
+        align(
+            std::size_t bytes
+            ) noexcept {
+
+            return (bytes + cacheline::destructive - 1) & ~(cacheline::destructive - 1);
+
+        } // _::align()
+
+        inline static raii::mmap
+        create(
+            const char * path,
+            std::size_t size
+            ) noexcept(false) {
+
+            raii::fd handle(::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600));
+            if (unlikely(!handle)) throw std::system_error(errno, std::system_category(), "open");
+            if (unlikely(::ftruncate(handle, size) == -1)) throw std::system_error(errno, std::system_category(), "ftruncate");
+            return raii::mmap(std::move(handle), PROT_READ | PROT_WRITE, MAP_SHARED);
+
+        } // _::create()
+
+        inline static raii::mmap
+        attach(
+            const char * path
+            ) noexcept(false) {
+
+            int handle = ::open(path, O_RDWR | O_CLOEXEC);
+            if (unlikely(handle == -1)) throw std::system_error(errno, std::system_category(), "open");
+            return raii::mmap(raii::fd(handle), PROT_READ | PROT_WRITE, MAP_SHARED);
+
+        } // _::attach()
+
+    } // namespace dtl::ring::_
+
+    // Single-producer, multi-consumer sequenced ring in the style of the LMAX Disruptor: every consumer sees every
+    // entry, in place, and keeps its own cursor; the producer may only reuse a slot once the slowest consumer has
+    // moved past it. Entries are claimed and published in batches, so the shared cursor is written once per batch.
+    //
+    // The whole ring lives in one raii::mmap region laid out as
+    //
+    //   header | published cursor | consumer cursors[consumers] | slots[capacity]
+    //
+    // with every cursor on its own line. Anonymous rings can be shared with forked children (shared = true);
+    // file-backed rings (create()/attach(), e.g. under /dev/shm) are shared by path between processes. Sequences
+    // are 64-bit and never wrap in practice. Waiting is left to the caller: try_claim() and poll() never block.
+    template<typename T>
+    class multicast {
+
+        static_assert(std::is_trivially_copyable<T>::value, "slots are shared memory");
+
+        struct header {
+
+            constexpr static std::uint32_t signature = 0x51435444; // "DTCQ"
+            constexpr static std::uint32_t revision = 1;
+
+            std::uint32_t magic;
+            std::uint32_t version;
+            std::uint32_t slot_size;
+            std::uint32_t consumers;
+            std::uint64_t capacity;
+
+        }; // struct multicast::header
+
+        struct cursor {
+
+            std::atomic<std::uint64_t> next;        // next sequence this consumer will read
+            std::atomic<std::uint32_t> state;       // vacant, joining or active
+
+        }; // struct multicast::cursor
+
+        enum : std::uint32_t { vacant = 0, joining = 1, active = 2 };
+
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "cursors are shared between processes");
+
+        raii::mmap region;
+        header * head = nullptr;
+        std::atomic<std::uint64_t> * published = nullptr;
+        std::uint8_t * cursors = nullptr;
+        T * slots = nullptr;
+        std::uint64_t mask = 0;
+
+        // Producer state, private to the producing process.
+        std::uint64_t next = 0;
+        std::uint64_t gate = 0;
+
+        inline static std::size_t
+        footprint(
+            std::size_t capacity,
+            std::size_t consumers
+            ) noexcept {
+
+            return _::align(sizeof(header)) + cacheline::destructive + consumers * cacheline::destructive
+                + capacity * sizeof(T);
+
+        } // multicast::footprint()
+
+        inline cursor &
+        consumer_cursor(
+            std::size_t i
+            ) const noexcept {
+
+            return *reinterpret_cast<cursor *>(cursors + i * cacheline::destructive);
+
+        } // multicast::consumer_cursor()
+
+        inline void
+        bind() noexcept {
+
+            auto * base = static_cast<std::uint8_t *>(region.get());
+            head = reinterpret_cast<header *>(base);
+            published = reinterpret_cast<std::atomic<std::uint64_t> *>(base + _::align(sizeof(header)));
+            cursors = base + _::align(sizeof(header)) + cacheline::destructive;
+            slots = reinterpret_cast<T *>(cursors + head->consumers * cacheline::destructive);
+            mask = head->capacity - 1;
+            next = published->load(std::memory_order_acquire);
+            gate = next;
+
+        } // multicast::bind()
+
+        inline void
+        format(
+            std::size_t capacity,
+            std::size_t consumers
+            ) noexcept {
+
+            auto * h = static_cast<header *>(region.get());
+            *h = { header::signature, header::revision, sizeof(T), static_cast<std::uint32_t>(consumers), capacity };
+            bind();
+            published->store(0, std::memory_order_relaxed);
+            for (std::size_t i = 0; i < consumers; ++i) {
+                consumer_cursor(i).next.store(0, std::memory_order_relaxed);
+                consumer_cursor(i).state.store(vacant, std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_release);
+
+        } // multicast::format()
+
+        // Lowest cursor among active consumers, and never above the published cursor: a consumer joining now
+        // starts no earlier than that, and claimed but unpublished slots are not free. The fence orders this
+        // producer's earlier publish() stores before the state loads, pairing with the seq_cst store and load in
+        // subscribe(): either the joining consumer is seen here, or it starts at or past the published cursor.
+        inline std::uint64_t
+        slowest() const noexcept {
+
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto lowest = published->load(std::memory_order_relaxed);
+            for (std::size_t i = 0; i < head->consumers; ++i) {
+                auto & c = consumer_cursor(i);
+                if (c.state.load(std::memory_order_acquire) != active) continue;
+                auto at = c.next.load(std::memory_order_acquire);
+                lowest = (at < lowest) ? at : lowest;
+            }
+            return lowest;
+
+        } // multicast::slowest()
+
+        multicast() = default;
+
+    public:
+
+        using value_type = T;
+
+        // A consumer's handle: reads entries in place between its cursor and the published cursor. Releasing the
+        // handle (destruction) stops it from gating the producer.
+        class consumer {
+
+            const std::atomic<std::uint64_t> * published = nullptr;
+            const T * slots = nullptr;
+            std::uint64_t mask = 0;
+            cursor * position = nullptr;
+            std::uint64_t at = 0;
+
+            friend class multicast;
+
+        public:
+
+            consumer() = default;
+
+            inline
+            consumer(
+                consumer && other
+                ) noexcept
+                : published(other.published), slots(other.slots), mask(other.mask), position(other.position),
+                  at(other.at) {
+
+                other.position = nullptr;
+
+            } // consumer::consumer(consumer &&)
+
+            inline consumer &
+            operator=(
+                consumer && other
+                ) noexcept {
+
+                if (this != &other) {
+                    leave();
+                    published = other.published;
+                    slots = other.slots;
+                    mask = other.mask;
+                    position = other.position;
+                    at = other.at;
+                    other.position = nullptr;
+                }
+                return *this;
+
+            } // consumer::operator=(consumer &&)
+
+            inline
+            ~consumer() noexcept {
+
+                leave();
+
+            } // consumer::~consumer()
+
+            inline void
+            leave() noexcept {
+
+                if (position) position->state.store(vacant, std::memory_order_release);
+                position = nullptr;
+
+            } // consumer::leave()
+
+            inline explicit operator bool() const noexcept { return position != nullptr; }
+
+            // Number of entries published and not yet released by this consumer.
+            inline std::uint64_t
+            available() const noexcept {
+
+                return published->load(std::memory_order_acquire) - at;
+
+            } // consumer::available()
+
+            inline std::uint64_t sequence() const noexcept { return at; }
+
+            // The i-th available entry, valid until release().
+            inline const T &
+            operator[](
+                std::uint64_t i
+                ) const noexcept {
+
+                return slots[(at + i) & mask];
+
+            } // consumer::operator[]()
+
+            // Hands the first n available entries back to the producer.
+            inline void
+            release(
+                std::uint64_t n
+                ) noexcept {
+
+                at += n;
+                position->next.store(at, std::memory_order_release);
+
+            } // consumer::release()
+
+            // Visits up to `limit` available entries as visitor(entry, sequence), then releases them in one store.
+            template<typename Visitor>
+            inline std::uint64_t
+            poll(
+                Visitor && visitor,
+                std::uint64_t limit = ~std::uint64_t(0)
+                ) {
+
+                auto n = available();
+                n = (n < limit) ? n : limit;
+                for (std::uint64_t i = 0; i < n; ++i) visitor((*this)[i], at + i);
+                if (n) release(n);
+                return n;
+
+            } // consumer::poll()
+
+        }; // class dtl::ring::multicast::consumer
+
+        // Anonymous ring; capacity is rounded up to a power of 2. With shared set the mapping survives fork() as
+        // shared memory, so producer and consumers may be separate processes.
+        inline
+        multicast(
+            std::size_t capacity,
+            std::size_t consumers,
+            bool shared = false
+            ) noexcept(false) {
+
+            capacity = branchless::power_of_2::roundup(capacity ? capacity : 1);
+            region = raii::mmap(footprint(capacity, consumers), PROT_READ | PROT_WRITE, shared ? MAP_SHARED : MAP_PRIVATE);
+            format(capacity, consumers);
+
+        } // multicast::multicast()
+
+        multicast(multicast &&) = default;
+        multicast & operator=(multicast &&) = default;
+
+        // File-backed ring, for processes that find each other by path.
+        inline static multicast
+        create(
+            const char * path,
+            std::size_t capacity,
+            std::size_t consumers
+            ) noexcept(false) {
+
+            if (unlikely(!capacity)) throw std::system_error(std::make_error_code(std::errc::invalid_argument), "ring::multicast");
+            capacity = branchless::power_of_2::roundup(capacity);
+            multicast ring;
+            ring.region = _::create(path, footprint(capacity, consumers));
+            ring.format(capacity, consumers);
+            return ring;
+
+        } // multicast::create()
+
+        inline static multicast
+        attach(
+            const char * path
+            ) noexcept(false) {
+
+            multicast ring;
+            ring.region = _::attach(path);
+            auto * h = static_cast<const header *>(ring.region.get());
+            if (unlikely(ring.region.size() < sizeof(header)
+                      || h->magic != header::signature
+                      || h->version != header::revision
+                      || h->slot_size != sizeof(T)
+                      || !h->capacity
+                      || !branchless::power_of_2::isa(h->capacity)
+                      || ring.region.size() != footprint(h->capacity, h->consumers))) {
+                throw std::system_error(std::make_error_code(std::errc::invalid_argument), "ring::multicast");
+            }
+            ring.bind();
+            return ring;
+
+        } // multicast::attach()
+
+        inline std::uint64_t capacity() const noexcept { return mask + 1; }
+
+        // Joins at the current published position; the handle is empty when every consumer slot is taken.
+        inline consumer
+        subscribe() const noexcept {
+
+            consumer c;
+            for (std::size_t i = 0; i < head->consumers; ++i) {
+                auto & slot = consumer_cursor(i);
+                std::uint32_t expected = vacant;
+                if (!slot.state.compare_exchange_strong(expected, joining, std::memory_order_acq_rel)) continue;
+                // Announce a provisional cursor before anything is read, then start from the published cursor as
+                // seen after the announcement. A producer computing its gate either sees this consumer active
+                // (and at most the provisional cursor) or published no further than where it starts.
+                auto provisional = published->load(std::memory_order_seq_cst);
+                slot.next.store(provisional, std::memory_order_seq_cst);
+                slot.state.store(active, std::memory_order_seq_cst);
+                c.at = published->load(std::memory_order_seq_cst);
+                slot.next.store(c.at, std::memory_order_release);
+                c.published = published;
+                c.slots = slots;
+                c.mask = mask;
+                c.position = &slot;
+                break;
+            }
+            return c;
+
+        } // multicast::subscribe()
+
+        // Reserves n consecutive slots, starting at `first`, without waiting. n must not exceed the capacity.
+        inline bool
+        try_claim(
+            std::uint64_t n,
+            std::uint64_t & first
+            ) noexcept {
+
+            if (next + n > gate + capacity()) {
+                gate = slowest();
+                if (next + n > gate + capacity()) return false;
+            }
+            first = next;
+            next += n;
+            return true;
+
+        } // multicast::try_claim()
+
+        // Spins until n slots are free.
+        inline std::uint64_t
+        claim(
+            std::uint64_t n = 1
+            ) noexcept {
+
+            std::uint64_t first;
+            while (!try_claim(n, first)) lock::relax();
+            return first;
+
+        } // multicast::claim()
+
+        inline T &
+        operator[](
+            std::uint64_t sequence
+            ) noexcept {
+
+            return slots[sequence & mask];
+
+        } // multicast::operator[]()
+
+        // Makes every claimed sequence up to (excluding) `end` visible to consumers.
+        inline void
+        publish(
+            std::uint64_t end
+            ) noexcept {
+
+            published->store(end, std::memory_order_release);
+
+        } // multicast::publish()
+
+    }; // class dtl::ring::multicast
+
+    // Single-producer, single-consumer queue of variable-length records (16 B log lines to 4 KB telemetry blobs)
+    // packed back to back. The buffer is a memfd mapped twice in a row, so a record that runs past the end of the
+    // buffer continues, in virtual memory, into the second mapping of its start: every reservation is one
+    // contiguous span and nothing is ever split or skipped. Records are an 8-byte length header followed by the
+    // payload, padded to 8 bytes.
+    //
+    // The producer reserve()s the largest size it may need, writes in place and then commit()s the actual length
+    // or abort()s; the consumer reads published records in batches and releases them with a single store. Apart
+    // from setting up the mappings, neither side makes a syscall or allocates.
+    class records {
+
+        constexpr static std::size_t header = 8;
+
+        raii::mmap region;                          // both views, one range
+        std::uint8_t * base = nullptr;
+        std::size_t mask = 0;
+
+        cacheline::padded<std::atomic<std::uint64_t>> head{0};     // consumer position, in bytes
+        cacheline::padded<std::atomic<std::uint64_t>> tail{0};     // producer position, in bytes
+
+        // Private to the producer.
+        std::uint64_t producer_head = 0;
+
+        // Private to the consumer.
+        std::uint64_t consumer_tail = 0;
+
+        inline static constexpr std::size_t
+        padded_size(
+            std::size_t length
+            ) noexcept {
+
+            return header + ((length + 7) & ~std::size_t(7));
+
+        } // records::padded_size()
+
+    public:
+
+        // Capacity is rounded up to a power-of-2 number of pages.
+        inline explicit
+        records(
+            std::size_t capacity
+            ) noexcept(false) {
+
+            auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            auto size = branchless::power_of_2::roundup(capacity < page ? page : capacity);
+
+            raii::fd memory(::memfd_create("dtl::ring::records", MFD_CLOEXEC));
+            if (unlikely(!memory)) throw std::system_error(errno, std::system_category(), "memfd_create");
+            if (unlikely(::ftruncate(memory, size) == -1)) throw std::system_error(errno, std::system_category(), "ftruncate");
+
+            // Reserve the whole range first, then place both views over it.
+            region = raii::mmap(size * 2, PROT_NONE, MAP_PRIVATE | MAP_NORESERVE);
+            base = static_cast<std::uint8_t *>(region.get());
+            for (std::size_t view = 0; view < 2; ++view) {
+                auto * at = ::mmap(base + view * size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, memory, 0);
+                if (unlikely(at == MAP_FAILED)) throw std::system_error(errno, std::system_category(), "mmap");
+            }
+            mask = size - 1;
+
+        } // records::records()
+
+        records(const records &) = delete;
+        records & operator=(const records &) = delete;
+
+        inline std::size_t capacity() const noexcept { return mask + 1; }
+
+        // Largest payload a single record can carry.
+        inline std::size_t max_record() const noexcept { return capacity() - header; }
+
+        // Producer: room for a record of up to `length` bytes, or nullptr while the queue is too full. The span
+        // is contiguous and stays reserved until commit() or abort().
+        inline void *
+        reserve(
+            std::size_t length
+            ) noexcept {
+
+            auto size = padded_size(length);
+            auto at = tail->load(std::memory_order_relaxed);
+            if (unlikely(at + size - producer_head > capacity())) {
+                producer_head = head->load(std::memory_order_acquire);
+                if (at + size - producer_head > capacity()) return nullptr;
+            }
+            return base + (at & mask) + header;
+
+        } // records::reserve()
+
+        // Producer: publishes the reserved record with its final length (at most what was reserved).
+        inline void
+        commit(
+            std::size_t length
+            ) noexcept {
+
+            auto at = tail->load(std::memory_order_relaxed);
+            std::uint64_t word = length;
+            std::memcpy(base + (at & mask), &word, sizeof(word));
+            tail->store(at + padded_size(length), std::memory_order_release);
+
+        } // records::commit()
+
+        // Producer: drops the reservation. Nothing becomes visible, and the next reserve() starts at the same place.
+        inline void abort() noexcept {}
+
+        // Producer: reserve(), copy and commit() in one step; false when full.
+        inline bool
+        push(
+            const void * data,
+            std::size_t length
+            ) noexcept {
+
+            auto * at = reserve(length);
+            if (unlikely(!at)) return false;
+            std::memcpy(at, data, length);
+            commit(length);
+            return true;
+
+        } // records::push()
+
+        // Consumer: visits up to `limit` published records as visitor(data, length), each contiguous in place,
+        // then releases them all with one store. Returns the number visited.
+        template<typename Visitor>
+        inline std::size_t
+        read(
+            Visitor && visitor,
+            std::size_t limit = ~std::size_t(0)
+            ) {
+
+            auto at = head->load(std::memory_order_relaxed);
+            if (at == consumer_tail) {
+                consumer_tail = tail->load(std::memory_order_acquire);
+                if (at == consumer_tail) return 0;
+            }
+
+            std::size_t n = 0;
+            for (; n < limit && at != consumer_tail; ++n) {
+                std::uint64_t length;
+                std::memcpy(&length, base + (at & mask), sizeof(length));
+                visitor(static_cast<const void *>(base + (at & mask) + header), static_cast<std::size_t>(length));
+                at += padded_size(length);
+            }
+            head->store(at, std::memory_order_release);
+            return n;
+
+        } // records::read()
+
+        inline bool
+        empty() const noexcept {
+
+            return head->load(std::memory_order_acquire) == tail->load(std::memory_order_acquire);
+
+        } // records::empty()
+
+    }; // class dtl::ring::records
+
+} // namespace dtl::ring
@@ -0,0 +1,1036 @@
+#pragma once
+
+#include <fcntl.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+#include <vector>
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+#include "branch.hh"
+#include "raii.hh"
+#include "simd.hh"
+
+namespace dtl::roaring {
+
+    // Compressed bitmaps over 32-bit IDs, after Roaring: IDs are split on their high 16 bits into containers, each
+    // holding the low 16 bits as whichever is smallest of a sorted array (up to 4096 values), a 65536-bit bitmap or
+    // a list of runs. Query code works on container views, so the same code serves owned bitmaps and serialized
+    // images mapped straight from disk (roaring::view). Rank and select are logarithmic: containers carry the number
+    // of members before each 512-bit block (bitmaps) or each run, and sets keep the number of members before each
+    // container (a Fenwick tree in bitmap, a field of every descriptor in a serialized image).
+
+    enum class kind : std::uint8_t {
+        array = 1, bitmap = 2, run = 3
+    }; // enum class dtl::roaring::kind
+
+    namespace _ {
+
+        constexpr std::uint32_t array_limit = 4096;
+        constexpr std::size_t words = 1024;
+        constexpr std::size_t block_words = 8;
+        constexpr std::size_t blocks = words / block_words;
+
+        // Position of the i-th (from 0) set bit of a word holding more than i.
+        inline static unsigned
+        select_bit(
+            std::uint64_t word,
+            unsigned i
+            ) noexcept {
+
+#if defined(__BMI2__)
+            return static_cast<unsigned>(__builtin_ctzll(_pdep_u64(std::uint64_t(1) << i, word)));
+#else
+            for (; i; --i) word &= word - 1;
+            return static_cast<unsigned>(__builtin_ctzll(word));
+#endif
+
+        } // _::select_bit()
+
+        // A read-only container: array and run payloads are uint16 (runs as start, length - 1 pairs), bitmaps
+        // are 1024 uint64 words. Bitmaps and runs come with a rank index: the members before each block of
+        // block_words words, or before each run. Neither ever exceeds 65535, so it fits the same uint16 payload.
+        struct cview {
+
+            roaring::kind kind;
+            std::uint32_t cardinality;
+            std::uint32_t size;             // array values, or run pairs * 2; unused for bitmaps.
+            const std::uint16_t * values;
+            const std::uint64_t * bits;
+            const std::uint16_t * ranks;    // blocks entries for bitmaps, size / 2 for runs; unused for arrays.
+
+            // Last run starting at or before x, plus one (0 when there is none).
+            inline std::uint32_t
+            runs_through(
+                std::uint16_t x
+                ) const noexcept {
+
+                std::uint32_t lo = 0, hi = size / 2;
+                while (lo < hi) {
+                    auto mid = (lo + hi) / 2;
+                    if (values[2 * mid] <= x) lo = mid + 1; else hi = mid;
+                }
+                return lo;
+
+            } // cview::runs_through()
+
+            inline bool
+            contains(
+                std::uint16_t x
+                ) const noexcept {
+
+                switch (kind) {
+                case kind::array:
+                    return std::binary_search(values, values + size, x);
+                case kind::bitmap:
+                    return (bits[x >> 6] >> (x & 63)) & 1;
+                default: {
+                    auto r = runs_through(x);
+                    return r && x - values[2 * (r - 1)] <= values[2 * (r - 1) + 1];
+                }
+                }
+
+            } // cview::contains()
+
+            // Number of values <= x.
+            inline std::uint32_t
+            rank(
+                std::uint16_t x
+                ) const noexcept {
+
+                switch (kind) {
+                case kind::array:
+                    return static_cast<std::uint32_t>(std::upper_bound(values, values + size, x) - values);
+                case kind::bitmap: {
+                    std::size_t w = x >> 6;
+                    std::uint32_t n = ranks[w / block_words];
+                    for (auto b = w & ~(block_words - 1); b < w; ++b) n += __builtin_popcountll(bits[b]);
+                    auto tail = bits[w] & (~std::uint64_t(0) >> (63 - (x & 63)));
+                    return n + __builtin_popcountll(tail);
+                }
+                default: {
+                    auto r = runs_through(x);
+                    if (!r) return 0;
+                    std::uint32_t start = values[2 * (r - 1)], length = values[2 * (r - 1) + 1] + 1u;
+                    return ranks[r - 1] + std::min(x - start + 1, length);
+                }
+                }
+
+            } // cview::rank()
+
+            // The i-th smallest value (i < cardinality).
+            inline std::uint16_t
+            select(
+                std::uint32_t i
+                ) const noexcept {
+
+                switch (kind) {
+                case kind::array:
+                    return values[i];
+                case kind::bitmap: {
+                    // Last block with at most i members before it, then at most block_words popcounts.
+                    std::size_t lo = 1, hi = blocks;
+                    while (lo < hi) {
+                        auto mid = (lo + hi) / 2;
+                        if (ranks[mid] <= i) lo = mid + 1; else hi = mid;
+                    }
+                    i -= ranks[lo - 1];
+                    auto w = (lo - 1) * block_words;
+                    for (;; ++w) {
+                        auto n = static_cast<std::uint32_t>(__builtin_popcountll(bits[w]));
+                        if (i < n) break;
+                        i -= n;
+                    }
+                    return static_cast<std::uint16_t>((w << 6) | select_bit(bits[w], i));
+                }
+                default: {
+                    std::uint32_t lo = 1, hi = size / 2;
+                    while (lo < hi) {
+                        auto mid = (lo + hi) / 2;
+                        if (ranks[mid] <= i) lo = mid + 1; else hi = mid;
+                    }
+                    return static_cast<std::uint16_t>(values[2 * (lo - 1)] + (i - ranks[lo - 1]));
+                }
+                }
+
+            } // cview::select()
+
+            template<typename Visitor>
+            inline void
+            for_each(
+                Visitor && visitor
+                ) const {
+
+                switch (kind) {
+                case kind::array:
+                    for (std::uint32_t i = 0; i < size; ++i) visitor(values[i]);
+                    break;
+                case kind::bitmap:
+                    for (std::size_t w = 0; w < words; ++w) {
+                        for (auto word = bits[w]; word; word &= word - 1) {
+                            visitor(static_cast<std::uint16_t>((w << 6) | __builtin_ctzll(word)));
+                        }
+                    }
+                    break;
+                default:
+                    for (std::uint32_t r = 0; r < size; r += 2) {
+                        for (std::uint32_t v = values[r], end = v + values[r + 1]; v <= end; ++v) {
+                            visitor(static_cast<std::uint16_t>(v));
+                        }
+                    }
+                    break;
+                }
+
+            } // cview::for_each()
+
+            // Sets this container's values in a 1024-word bitmap.
+            inline void
+            expand(
+                std::uint64_t * out
+                ) const noexcept {
+
+                switch (kind) {
+                case kind::array:
+                    for (std::uint32_t i = 0; i < size; ++i) out[values[i] >> 6] |= std::uint64_t(1) << (values[i] & 63);
+                    break;
+                case kind::bitmap:
+                    for (std::size_t w = 0; w < words; ++w) out[w] |= bits[w];
+                    break;
+                default:
+                    for (std::uint32_t r = 0; r < size; r += 2) {
+                        std::uint32_t start = values[r], end = start + values[r + 1];
+                        for (auto w = start >> 6; w <= (end >> 6); ++w) {
+                            auto lo = (w == (start >> 6)) ? (start & 63) : 0;
+                            auto hi = (w == (end >> 6)) ? (end & 63) : 63;
+                            out[w] |= (~std::uint64_t(0) >> (63 - hi + lo)) << lo;
+                        }
+                    }
+                    break;
+                }
+
+            } // cview::expand()
+
+            // Whether the payload agrees with the cardinality and the rank index: arrays strictly increasing,
+            // runs ordered and disjoint, and every count matching what it summarizes. Serialized images are
+            // checked with this before any query trusts them.
+            inline bool
+            consistent() const noexcept {
+
+                if (!cardinality || cardinality > words * 64) return false;
+                std::uint32_t n = 0;
+                switch (kind) {
+                case kind::array:
+                    if (size != cardinality) return false;
+                    for (std::uint32_t i = 1; i < size; ++i) {
+                        if (values[i - 1] >= values[i]) return false;
+                    }
+                    return true;
+                case kind::bitmap:
+                    for (std::size_t b = 0; b < blocks; ++b) {
+                        if (ranks[b] != n) return false;
+                        for (std::size_t w = b * block_words; w < (b + 1) * block_words; ++w) {
+                            n += __builtin_popcountll(bits[w]);
+                        }
+                    }
+                    return n == cardinality;
+                default: {
+                    if (!size || size & 1) return false;
+                    std::uint32_t next = 0;
+                    for (std::uint32_t r = 0; r < size; r += 2) {
+                        std::uint32_t start = values[r], length = values[r + 1] + 1u;
+                        if (start < next || start + length > words * 64 || ranks[r / 2] != n) return false;
+                        next = start + length;
+                        n += length;
+                    }
+                    return n == cardinality;
+                }
+                }
+
+            } // cview::consistent()
+
+        }; // struct dtl::roaring::_::cview
+
+        // Payload bytes of a container: values or words, then the rank index.
+        inline static std::size_t
+        payload(
+            roaring::kind kind,
+            std::size_t size
+            ) noexcept {
+
+            switch (kind) {
+            case kind::array:
+                return size * 2;
+            case kind::bitmap:
+                return words * 8 + blocks * 2;
+            default:
+                return size * 2 + (size / 2) * 2;
+            }
+
+        } // _::payload()
+
+        struct container {
+
+            roaring::kind kind = kind::array;
+            std::uint32_t cardinality = 0;
+            std::vector<std::uint16_t> values;
+            std::vector<std::uint64_t> bits;
+            std::vector<std::uint16_t> ranks;
+
+            inline cview
+            view() const noexcept {
+
+                return { kind, cardinality, static_cast<std::uint32_t>(values.size()), values.data(), bits.data(),
+                         ranks.data() };
+
+            } // container::view()
+
+            // Rebuilds the rank index after the encoding changed.
+            inline void
+            reindex() noexcept(false) {
+
+                ranks.clear();
+                std::uint32_t n = 0;
+                if (kind == kind::bitmap) {
+                    ranks.resize(blocks);
+                    for (std::size_t b = 0; b < blocks; ++b) {
+                        ranks[b] = static_cast<std::uint16_t>(n);
+                        for (std::size_t w = b * block_words; w < (b + 1) * block_words; ++w) {
+                            n += __builtin_popcountll(bits[w]);
+                        }
+                    }
+                } else if (kind == kind::run) {
+                    ranks.reserve(values.size() / 2);
+                    for (std::size_t r = 0; r < values.size(); r += 2) {
+                        ranks.push_back(static_cast<std::uint16_t>(n));
+                        n += values[r + 1] + 1u;
+                    }
+                }
+                ranks.shrink_to_fit();
+
+            } // container::reindex()
+
+            // Array when small enough, bitmap otherwise.
+            inline static container
+            from_bits(
+                std::vector<std::uint64_t> && bits
+                ) noexcept(false) {
+
+                container c;
+                for (auto w : bits) c.cardinality += __builtin_popcountll(w);
+                if (c.cardinality > array_limit) {
+                    c.kind = kind::bitmap;
+                    c.bits = std::move(bits);
+                    c.reindex();
+                } else {
+                    c.values.reserve(c.cardinality);
+                    for (std::size_t w = 0; w < words; ++w) {
+                        for (auto word = bits[w]; word; word &= word - 1) {
+                            c.values.push_back(static_cast<std::uint16_t>((w << 6) | __builtin_ctzll(word)));
+                        }
+                    }
+                }
+                return c;
+
+            } // container::from_bits()
+
+            inline static container
+            from_array(
+                std::vector<std::uint16_t> && values
+                ) noexcept(false) {
+
+                if (values.size() > array_limit) {
+                    std::vector<std::uint64_t> bits(words, 0);
+                    for (auto v : values) bits[v >> 6] |= std::uint64_t(1) << (v & 63);
+                    return from_bits(std::move(bits));
+                }
+                container c;
+                c.cardinality = static_cast<std::uint32_t>(values.size());
+                c.values = std::move(values);
+                return c;
+
+            } // container::from_array()
+
+            // Re-encodes into the array or bitmap form so that it can be edited in place.
+            inline void
+            normalize() noexcept(false) {
+
+                if (kind != kind::run) return;
+                std::vector<std::uint64_t> expanded(words, 0);
+                view().expand(expanded.data());
+                *this = from_bits(std::move(expanded));
+
+            } // container::normalize()
+
+            inline bool
+            add(
+                std::uint16_t x
+                ) noexcept(false) {
+
+                normalize();
+                if (kind == kind::bitmap) {
+                    auto & w = bits[x >> 6];
+                    auto bit = std::uint64_t(1) << (x & 63);
+                    if (w & bit) return false;
+                    w |= bit;
+                    ++cardinality;
+                    for (auto b = (x >> 6) / block_words + 1; b < blocks; ++b) ++ranks[b];
+                    return true;
+                }
+                auto at = std::lower_bound(values.begin(), values.end(), x);
+                if (at != values.end() && *at == x) return false;
+                values.insert(at, x);
+                ++cardinality;
+                if (cardinality > array_limit) *this = from_array(std::move(values));
+                return true;
+
+            } // container::add()
+
+            inline bool
+            remove(
+                std::uint16_t x
+                ) noexcept(false) {
+
+                normalize();
+                if (kind == kind::bitmap) {
+                    auto & w = bits[x >> 6];
+                    auto bit = std::uint64_t(1) << (x & 63);
+                    if (!(w & bit)) return false;
+                    w &= ~bit;
+                    if (--cardinality <= array_limit) {
+                        *this = from_bits(std::move(bits));
+                    } else {
+                        for (auto b = (x >> 6) / block_words + 1; b < blocks; ++b) --ranks[b];
+                    }
+                    return true;
+                }
+                auto at = std::lower_bound(values.begin(), values.end(), x);
+                if (at == values.end() || *at != x) return false;
+                values.erase(at);
+                --cardinality;
+                return true;
+
+            } // container::remove()
+
+            // Switches to runs where they are smaller than the current encoding.
+            inline void
+            optimize() noexcept(false) {
+
+                normalize();
+                std::vector<std::uint16_t> runs;
+                view().for_each([&](std::uint16_t v) {
+                    if (!runs.empty() && runs[runs.size() - 2] + runs.back() + 1u == v) {
+                        ++runs.back();
+                    } else {
+                        runs.push_back(v);
+                        runs.push_back(0);
+                    }
+                });
+                if (payload(kind::run, runs.size()) < payload(kind, values.size())) {
+                    kind = kind::run;
+                    values = std::move(runs);
+                    bits.clear();
+                    bits.shrink_to_fit();
+                    reindex();
+                }
+
+            } // container::optimize()
+
+        }; // struct dtl::roaring::_::container
+
+        // Sorted array intersection, a vector at a time: each block of `a` is compared with every rotation of the
+        // current block of `b`. Matches found for a block of `a` are held until that block is retired, and since
+        // every value occurs once per side they can only be matched against one block of `b`.
+        inline static void
+        intersect_arrays(
+            const std::uint16_t * a,
+            std::size_t na,
+            const std::uint16_t * b,
+            std::size_t nb,
+            std::vector<std::uint16_t> & out
+            ) noexcept(false) {
+
+            constexpr std::size_t W = simd::native_width<std::uint16_t>;
+            using block = simd::vec<std::uint16_t, W>;
+
+            std::size_t i = 0, j = 0;
+
+            if constexpr (W > 1) {
+                block rotations[W];
+                for (std::size_t r = 0; r < W; ++r) {
+                    std::uint16_t lanes[W];
+                    for (std::size_t k = 0; k < W; ++k) lanes[k] = static_cast<std::uint16_t>((k + r) & (W - 1));
+                    rotations[r] = block::load(lanes);
+                }
+
+                std::uint64_t pending = 0;
+                auto retire = [&]() {
+                    for (; pending; pending &= pending - 1) out.push_back(a[i + __builtin_ctzll(pending)]);
+                };
+
+                while (i + W <= na && j + W <= nb) {
+                    auto x = block::load(a + i);
+                    auto y = block::load(b + j);
+                    auto hit = simd::eq(x, y);
+                    for (std::size_t r = 1; r < W; ++r) hit.v |= simd::eq(x, simd::shuffle(y, rotations[r])).v;
+                    pending |= simd::movemask(hit);
+
+                    auto amax = a[i + W - 1], bmax = b[j + W - 1];
+                    if (amax <= bmax) {
+                        retire();
+                        i += W;
+                    }
+                    if (bmax <= amax) j += W;
+                }
+                retire();
+            }
+
+            while (i < na && j < nb) {
+                if (a[i] < b[j]) {
+                    ++i;
+                } else if (b[j] < a[i]) {
+                    ++j;
+                } else {
+                    out.push_back(a[i]);
+                    ++i;
+                    ++j;
+                }
+            }
+
+        } // _::intersect_arrays()
+
+        inline static container
+        intersect(
+            const cview & a,
+            const cview & b
+            ) noexcept(false) {
+
+            if (a.kind == kind::array && b.kind == kind::array) {
+                std::vector<std::uint16_t> out;
+                out.reserve(std::min(a.size, b.size));
+                intersect_arrays(a.values, a.size, b.values, b.size, out);
+                return container::from_array(std::move(out));
+            }
+            if (a.kind == kind::array || b.kind == kind::array) {
+                auto & small = (a.kind == kind::array) ? a : b;
+                auto & other = (a.kind == kind::array) ? b : a;
+                std::vector<std::uint16_t> out;
+                for (std::uint32_t i = 0; i < small.size; ++i) {
+                    if (other.contains(small.values[i])) out.push_back(small.values[i]);
+                }
+                return container::from_array(std::move(out));
+            }
+
+            std::vector<std::uint64_t> x(words, 0), y(words, 0);
+            a.expand(x.data());
+            b.expand(y.data());
+            using vw = simd::vec<std::uint64_t>;
+            for (std::size_t w = 0; w < words; w += vw::width) (vw::load(&x[w]) & vw::load(&y[w])).store(&x[w]);
+            return container::from_bits(std::move(x));
+
+        } // _::intersect()
+
+        inline static container
+        unite(
+            const cview & a,
+            const cview & b
+            ) noexcept(false) {
+
+            if (a.kind == kind::array && b.kind == kind::array && a.size + b.size <= array_limit) {
+                std::vector<std::uint16_t> out(a.size + b.size);
+                auto end = std::set_union(a.values, a.values + a.size, b.values, b.values + b.size, out.begin());
+                out.erase(end, out.end());
+                return container::from_array(std::move(out));
+            }
+
+            std::vector<std::uint64_t> x(words, 0), y(words, 0);
+            a.expand(x.data());
+            b.expand(y.data());
+            using vw = simd::vec<std::uint64_t>;
+            for (std::size_t w = 0; w < words; w += vw::width) (vw::load(&x[w]) | vw::load(&y[w])).store(&x[w]);
+            return container::from_bits(std::move(x));
+
+        } // _::unite()
+
+        // Serialized image: header, one descriptor per container, then payloads at 8-byte aligned offsets.
+
+        struct header {
+
+            constexpr static std::uint32_t signature = 0x524c5444; // "DTLR"
+            constexpr static std::uint32_t revision = 2;
+
+            std::uint32_t magic;
+            std::uint32_t version;
+            std::uint32_t containers;
+            std::uint32_t reserved;
+
+        }; // struct dtl::roaring::_::header
+
+        struct descriptor {
+
+            std::uint16_t key;
+            std::uint8_t kind;
+            std::uint8_t reserved;
+            std::uint32_t cardinality;
+            std::uint32_t size;
+            std::uint32_t offset;
+            std::uint64_t before;           // members in the containers before this one.
+
+        }; // struct dtl::roaring::_::descriptor
+
+    } // namespace dtl::roaring::_
+
+    class bitmap {
+
+        std::vector<std::uint16_t> keys;
+        std::vector<_::container> containers;
+        std::vector<std::uint64_t> counts;      // Fenwick tree over container cardinalities.
+
+        inline std::size_t
+        locate(
+            std::uint16_t key
+            ) const noexcept {
+
+            return static_cast<std::size_t>(std::lower_bound(keys.begin(), keys.end(), key) - keys.begin());
+
+        } // bitmap::locate()
+
+        // Rebuilds the Fenwick tree after containers were inserted or erased.
+        inline void
+        recount() noexcept(false) {
+
+            counts.resize(containers.size());
+            for (std::size_t i = 0; i < containers.size(); ++i) counts[i] = containers[i].cardinality;
+            for (std::size_t k = 1; k <= counts.size(); ++k) {
+                auto parent = k + (k & -k);
+                if (parent <= counts.size()) counts[parent - 1] += counts[k - 1];
+            }
+
+        } // bitmap::recount()
+
+        inline void
+        adjust(
+            std::size_t i,
+            std::int64_t delta
+            ) noexcept {
+
+            for (auto k = i + 1; k <= counts.size(); k += k & -k) counts[k - 1] += delta;
+
+        } // bitmap::adjust()
+
+    public:
+
+        bitmap() = default;
+
+        // Container access shared with roaring::view, for the set operations below.
+        inline std::size_t containers_size() const noexcept { return keys.size(); }
+        inline std::uint16_t key(std::size_t i) const noexcept { return keys[i]; }
+        inline _::cview container(std::size_t i) const noexcept { return containers[i].view(); }
+
+        // Members in the containers before container i (i <= containers_size()).
+        inline std::uint64_t
+        preceding(
+            std::size_t i
+            ) const noexcept {
+
+            std::uint64_t n = 0;
+            for (auto k = i; k; k &= k - 1) n += counts[k - 1];
+            return n;
+
+        } // bitmap::preceding()
+
+        // The container holding the i-th smallest member (i below the cardinality).
+        inline std::size_t
+        holding(
+            std::uint64_t i
+            ) const noexcept {
+
+            std::size_t at = 0;
+            auto top = counts.empty() ? 0 : std::size_t(1) << (63 - __builtin_clzll(counts.size()));
+            for (auto step = top; step; step >>= 1) {
+                if (at + step <= counts.size() && counts[at + step - 1] <= i) {
+                    at += step;
+                    i -= counts[at - 1];
+                }
+            }
+            return at;
+
+        } // bitmap::holding()
+
+        inline void
+        add(
+            std::uint32_t x
+            ) noexcept(false) {
+
+            auto key = static_cast<std::uint16_t>(x >> 16);
+            auto i = locate(key);
+            if (i == keys.size() || keys[i] != key) {
+                keys.insert(keys.begin() + i, key);
+                containers.insert(containers.begin() + i, _::container());
+                containers[i].add(static_cast<std::uint16_t>(x));
+                recount();
+            } else if (containers[i].add(static_cast<std::uint16_t>(x))) {
+                adjust(i, 1);
+            }
+
+        } // bitmap::add()
+
+        inline void
+        remove(
+            std::uint32_t x
+            ) noexcept(false) {
+
+            auto key = static_cast<std::uint16_t>(x >> 16);
+            auto i = locate(key);
+            if (i == keys.size() || keys[i] != key || !containers[i].remove(static_cast<std::uint16_t>(x))) return;
+            if (!containers[i].cardinality) {
+                keys.erase(keys.begin() + i);
+                containers.erase(containers.begin() + i);
+                recount();
+            } else {
+                adjust(i, -1);
+            }
+
+        } // bitmap::remove()
+
+        // Appends a container built elsewhere; keys must be added in increasing order.
+        inline void
+        append(
+            std::uint16_t key,
+            _::container && c
+            ) noexcept(false) {
+
+            if (!c.cardinality) return;
+            // The new node covers the containers after k - lowbit(k), up to and including itself.
+            auto k = counts.size() + 1;
+            counts.push_back(c.cardinality + preceding(k - 1) - preceding(k - (k & -k)));
+            keys.push_back(key);
+            containers.push_back(std::move(c));
+
+        } // bitmap::append()
+
+        inline void
+        optimize() noexcept(false) {
+
+            for (auto & c : containers) c.optimize();
+
+        } // bitmap::optimize()
+
+        inline std::size_t
+        serialized_size() const noexcept {
+
+            auto size = sizeof(_::header) + sizeof(_::descriptor) * keys.size();
+            for (auto & c : containers) {
+                size = (size + 7) & ~std::size_t(7);
+                size += _::payload(c.kind, c.values.size());
+            }
+            return size;
+
+        } // bitmap::serialized_size()
+
+        // Writes the image that roaring::view reads in place; `out` must hold serialized_size() bytes and be
+        // 8-byte aligned.
+        inline void
+        serialize(
+            void * out
+            ) const noexcept {
+
+            auto * base = static_cast<std::uint8_t *>(out);
+            _::header h{ _::header::signature, _::header::revision, static_cast<std::uint32_t>(keys.size()), 0 };
+            std::memcpy(base, &h, sizeof(h));
+
+            auto offset = sizeof(_::header) + sizeof(_::descriptor) * keys.size();
+            std::uint64_t before = 0;
+            for (std::size_t i = 0; i < keys.size(); ++i) {
+                auto & c = containers[i];
+                offset = (offset + 7) & ~std::size_t(7);
+                _::descriptor d{ keys[i], static_cast<std::uint8_t>(c.kind), 0, c.cardinality,
+                                 static_cast<std::uint32_t>(c.values.size()), static_cast<std::uint32_t>(offset), before };
+                std::memcpy(base + sizeof(_::header) + sizeof(_::descriptor) * i, &d, sizeof(d));
+                before += c.cardinality;
+                if (c.kind == kind::bitmap) {
+                    std::memcpy(base + offset, c.bits.data(), _::words * 8);
+                    offset += _::words * 8;
+                } else {
+                    std::memcpy(base + offset, c.values.data(), c.values.size() * 2);
+                    offset += c.values.size() * 2;
+                }
+                std::memcpy(base + offset, c.ranks.data(), c.ranks.size() * 2);
+                offset += c.ranks.size() * 2;
+            }
+
+        } // bitmap::serialize()
+
+        inline void
+        save(
+            const char * path
+            ) const noexcept(false) {
+
+            raii::fd handle(::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+            if (unlikely(!handle)) throw std::system_error(errno, std::system_category(), "open");
+
+            auto size = serialized_size();
+            if (unlikely(::ftruncate(handle, size) == -1)) throw std::system_error(errno, std::system_category(), "ftruncate");
+
+            raii::mmap file(std::move(handle), PROT_READ | PROT_WRITE, MAP_SHARED);
+            serialize(file.get());
+
+        } // bitmap::save()
+
+    }; // class dtl::roaring::bitmap
+
+    // A serialized bitmap queried in place, from memory the caller owns or from a file mapped by load().
+    class view {
+
+        raii::mmap mapping;
+        const std::uint8_t * base = nullptr;
+        const _::header * head = nullptr;
+
+        inline const _::descriptor &
+        descriptor(
+            std::size_t i
+            ) const noexcept {
+
+            return reinterpret_cast<const _::descriptor *>(head + 1)[i];
+
+        } // view::descriptor()
+
+        inline void
+        attach(
+            const void * data,
+            std::size_t size
+            ) noexcept(false) {
+
+            auto invalid = [] {
+                return std::system_error(std::make_error_code(std::errc::invalid_argument), "roaring::view");
+            };
+
+            base = static_cast<const std::uint8_t *>(data);
+            head = reinterpret_cast<const _::header *>(base);
+            if (unlikely(size < sizeof(_::header) || reinterpret_cast<std::uintptr_t>(data) & 7
+                      || head->magic != _::header::signature || head->version != _::header::revision
+                      || size < sizeof(_::header) + sizeof(_::descriptor) * std::size_t(head->containers))) {
+                throw invalid();
+            }
+            std::uint64_t before = 0;
+            for (std::size_t i = 0; i < head->containers; ++i) {
+                auto & d = descriptor(i);
+                if (unlikely(d.kind < 1 || d.kind > 3 || d.offset & 7 || d.before != before
+                          || std::size_t(d.offset) + _::payload(static_cast<kind>(d.kind), d.size) > size
+                          || (i && d.key <= descriptor(i - 1).key) || !container(i).consistent())) {
+                    throw invalid();
+                }
+                before += d.cardinality;
+            }
+
+        } // view::attach()
+
+    public:
+
+        view() = default;
+        view(view &&) = default;
+        view & operator=(view &&) = default;
+
+        inline
+        view(
+            const void * data,
+            std::size_t size
+            ) noexcept(false) {
+
+            attach(data, size);
+
+        } // view::view(const void *, std::size_t)
+
+        inline static view
+        load(
+            const char * path
+            ) noexcept(false) {
+
+            int handle = ::open(path, O_RDONLY | O_CLOEXEC);
+            if (unlikely(handle == -1)) throw std::system_error(errno, std::system_category(), "open");
+
+            view v;
+            v.mapping = raii::mmap(raii::fd(handle));
+            v.attach(v.mapping.get(), v.mapping.size());
+            return v;
+
+        } // view::load()
+
+        inline std::size_t containers_size() const noexcept { return head ? head->containers : 0; }
+        inline std::uint16_t key(std::size_t i) const noexcept { return descriptor(i).key; }
+
+        inline _::cview
+        container(
+            std::size_t i
+            ) const noexcept {
+
+            auto & d = descriptor(i);
+            auto index = (d.kind == std::uint8_t(kind::bitmap)) ? _::words * 8 : std::size_t(d.size) * 2;
+            return { static_cast<kind>(d.kind), d.cardinality, d.size,
+                     reinterpret_cast<const std::uint16_t *>(base + d.offset),
+                     reinterpret_cast<const std::uint64_t *>(base + d.offset),
+                     reinterpret_cast<const std::uint16_t *>(base + d.offset + index) };
+
+        } // view::container()
+
+        inline std::uint64_t
+        preceding(
+            std::size_t i
+            ) const noexcept {
+
+            if (i < containers_size()) return descriptor(i).before;
+            return i ? descriptor(i - 1).before + descriptor(i - 1).cardinality : 0;
+
+        } // view::preceding()
+
+        inline std::size_t
+        holding(
+            std::uint64_t i
+            ) const noexcept {
+
+            std::size_t lo = 1, hi = containers_size();
+            while (lo < hi) {
+                auto mid = (lo + hi) / 2;
+                if (descriptor(mid).before <= i) lo = mid + 1; else hi = mid;
+            }
+            return lo - 1;
+
+        } // view::holding()
+
+    }; // class dtl::roaring::view
+
+    // Queries over anything exposing containers_size(), key(i), container(i), preceding(i) and holding(i): bitmap
+    // and view alike.
+
+    template<typename Set>
+    inline static std::size_t
+    locate(
+        const Set & s,
+        std::uint16_t key
+        ) noexcept {
+
+        std::size_t lo = 0, hi = s.containers_size();
+        while (lo < hi) {
+            auto mid = (lo + hi) / 2;
+            if (s.key(mid) < key) lo = mid + 1; else hi = mid;
+        }
+        return lo;
+
+    } // dtl::roaring::locate()
+
+    template<typename Set>
+    inline static bool
+    contains(
+        const Set & s,
+        std::uint32_t x
+        ) noexcept {
+
+        auto key = static_cast<std::uint16_t>(x >> 16);
+        auto i = locate(s, key);
+        return i < s.containers_size() && s.key(i) == key && s.container(i).contains(static_cast<std::uint16_t>(x));
+
+    } // dtl::roaring::contains()
+
+    template<typename Set>
+    inline static std::uint64_t
+    cardinality(
+        const Set & s
+        ) noexcept {
+
+        return s.preceding(s.containers_size());
+
+    } // dtl::roaring::cardinality()
+
+    // Number of members <= x.
+    template<typename Set>
+    inline static std::uint64_t
+    rank(
+        const Set & s,
+        std::uint32_t x
+        ) noexcept {
+
+        auto key = static_cast<std::uint16_t>(x >> 16);
+        auto i = locate(s, key);
+        auto n = s.preceding(i);
+        if (i < s.containers_size() && s.key(i) == key) n += s.container(i).rank(static_cast<std::uint16_t>(x));
+        return n;
+
+    } // dtl::roaring::rank()
+
+    // The i-th smallest member; i must be below the cardinality.
+    template<typename Set>
+    inline static std::uint32_t
+    select(
+        const Set & s,
+        std::uint64_t i
+        ) noexcept {
+
+        auto c = s.holding(i);
+        return (std::uint32_t(s.key(c)) << 16) | s.container(c).select(static_cast<std::uint32_t>(i - s.preceding(c)));
+
+    } // dtl::roaring::select()
+
+    template<typename Set, typename Visitor>
+    inline static void
+    for_each(
+        const Set & s,
+        Visitor && visitor
+        ) {
+
+        for (std::size_t c = 0; c < s.containers_size(); ++c) {
+            std::uint32_t high = std::uint32_t(s.key(c)) << 16;
+            s.container(c).for_each([&](std::uint16_t low) { visitor(high | low); });
+        }
+
+    } // dtl::roaring::for_each()
+
+    template<typename A, typename B>
+    inline static bitmap
+    intersect(
+        const A & a,
+        const B & b
+        ) noexcept(false) {
+
+        bitmap out;
+        std::size_t i = 0, j = 0;
+        while (i < a.containers_size() && j < b.containers_size()) {
+            if (a.key(i) < b.key(j)) {
+                ++i;
+            } else if (b.key(j) < a.key(i)) {
+                ++j;
+            } else {
+                out.append(a.key(i), _::intersect(a.container(i), b.container(j)));
+                ++i;
+                ++j;
+            }
+        }
+        return out;
+
+    } // dtl::roaring::intersect()
+
+    template<typename A, typename B>
+    inline static bitmap
+    unite(
+        const A & a,
+        const B & b
+        ) noexcept(false) {
+
+        constexpr _::cview empty{ kind::array, 0, 0, nullptr, nullptr, nullptr };
+
+        bitmap out;
+        std::size_t i = 0, j = 0;
+        while (i < a.containers_size() || j < b.containers_size()) {
+            bool left = j == b.containers_size() || (i < a.containers_size() && a.key(i) <= b.key(j));
+            bool right = i == a.containers_size() || (j < b.containers_size() && b.key(j) <= a.key(i));
+            auto key = left ? a.key(i) : b.key(j);
+            out.append(key, _::unite(left ? a.container(i) : empty, right ? b.container(j) : empty));
+            i += left;
+            j += right;
+        }
+        return out;
+
+    } // dtl::roaring::unite()
+
+} // namespace dtl::roaring
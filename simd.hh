@@ -0,0 +1,502 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "branchless.hh"
+
+namespace dtl::simd {
+
+    // Width-agnostic vectors over the compiler's generic vector extensions, so one kernel compiles to SSE, AVX2,
+    // AVX-512 or NEON depending on the target flags. The width defaults to the widest the target supports; defining
+    // DTL_SIMD_SCALAR (or building for a target without vectors) selects the scalar backend, in which everything
+    // reduces to plain constexpr arithmetic on one lane.
+    //
+    // Masks hold all-ones or all-zero lanes, which lets the integral operations below use the same xor/and
+    // formulations as dtl::branchless.
+
+    namespace _ {
+
+        template<std::size_t Size> struct lane;
+        template<> struct lane<1> { using type = std::int8_t; };
+        template<> struct lane<2> { using type = std::int16_t; };
+        template<> struct lane<4> { using type = std::int32_t; };
+        template<> struct lane<8> { using type = std::int64_t; };
+
+        template<typename T>
+        using lane_t = typename lane<sizeof(T)>::type;
+
+        constexpr std::size_t native_bytes =
+#if defined(DTL_SIMD_SCALAR)
+            0;
+#elif defined(__AVX512BW__)
+            64;
+#elif defined(__AVX2__)
+            32;
+#elif defined(__SSE2__) || defined(__ARM_NEON)
+            16;
+#else
+            0;
+#endif
+
+    } // namespace dtl::simd::_
+
+    template<typename T>
+    constexpr std::size_t native_width = _::native_bytes ? _::native_bytes / sizeof(T) : 1;
+
+    template<typename T, std::size_t W = native_width<T>>
+    struct mask {
+
+        static_assert(branchless::power_of_2::isa(W), "vector width must be a power of 2");
+
+        typedef _::lane_t<T> native_type __attribute__((vector_size(sizeof(T) * W)));
+
+        native_type v;
+
+    }; // struct dtl::simd::mask
+
+    template<typename T>
+    struct mask<T, 1> {
+
+        using native_type = _::lane_t<T>;
+
+        native_type v;
+
+    }; // struct dtl::simd::mask<T, 1>
+
+    template<typename T, std::size_t W = native_width<T>>
+    struct vec {
+
+        static_assert(std::is_arithmetic<T>::value, "vectors hold arithmetic lanes");
+        static_assert(branchless::power_of_2::isa(W), "vector width must be a power of 2");
+
+        using value_type = T;
+        static constexpr std::size_t width = W;
+
+        typedef T native_type __attribute__((vector_size(sizeof(T) * W)));
+
+        native_type v;
+
+        inline static vec
+        load(
+            const T * address
+            ) noexcept {
+
+            vec r;
+            std::memcpy(&r.v, address, sizeof(r.v));
+            return r;
+
+        } // vec::load()
+
+        inline static vec
+        broadcast(
+            T value
+            ) noexcept {
+
+            return { native_type{} + value };
+
+        } // vec::broadcast()
+
+        inline void
+        store(
+            T * address
+            ) const noexcept {
+
+            std::memcpy(address, &v, sizeof(v));
+
+        } // vec::store()
+
+        inline T
+        operator[](
+            std::size_t i
+            ) const noexcept {
+
+            return v[i];
+
+        } // vec::operator[]()
+
+    }; // struct dtl::simd::vec
+
+    template<typename T>
+    struct vec<T, 1> {
+
+        using value_type = T;
+        static constexpr std::size_t width = 1;
+
+        using native_type = T;
+
+        native_type v;
+
+        inline static constexpr vec
+        load(
+            const T * address
+            ) noexcept {
+
+            return { *address };
+
+        } // vec::load()
+
+        inline static constexpr vec
+        broadcast(
+            T value
+            ) noexcept {
+
+            return { value };
+
+        } // vec::broadcast()
+
+        inline constexpr void
+        store(
+            T * address
+            ) const noexcept {
+
+            *address = v;
+
+        } // vec::store()
+
+        inline constexpr T
+        operator[](
+            std::size_t
+            ) const noexcept {
+
+            return v;
+
+        } // vec::operator[]()
+
+    }; // struct dtl::simd::vec<T, 1>
+
+    // The casts matter to the scalar backend only, where lanes narrower than int are promoted by the arithmetic.
+
+    template<typename T, std::size_t W>
+    inline static constexpr vec<T, W>
+    operator+(
+        const vec<T, W> & a,
+        const vec<T, W> & b
+        ) noexcept {
+
+        return { static_cast<typename vec<T, W>::native_type>(a.v + b.v) };
+
+    } // dtl::simd::operator+()
+
+    template<typename T, std::size_t W>
+    inline static constexpr vec<T, W>
+    operator-(
+        const vec<T, W> & a,
+        const vec<T, W> & b
+        ) noexcept {
+
+        return { static_cast<typename vec<T, W>::native_type>(a.v - b.v) };
+
+    } // dtl::simd::operator-()
+
+    template<typename T, std::size_t W>
+    inline static constexpr vec<T, W>
+    operator&(
+        const vec<T, W> & a,
+        const vec<T, W> & b
+        ) noexcept {
+
+        return { static_cast<typename vec<T, W>::native_type>(a.v & b.v) };
+
+    } // dtl::simd::operator&()
+
+    template<typename T, std::size_t W>
+    inline static constexpr vec<T, W>
+    operator|(
+        const vec<T, W> & a,
+        const vec<T, W> & b
+        ) noexcept {
+
+        return { static_cast<typename vec<T, W>::native_type>(a.v | b.v) };
+
+    } // dtl::simd::operator|()
+
+    template<typename T, std::size_t W>
+    inline static constexpr vec<T, W>
+    operator^(
+        const vec<T, W> & a,
+        const vec<T, W> & b
+        ) noexcept {
+
+        return { static_cast<typename vec<T, W>::native_type>(a.v ^ b.v) };
+
+    } // dtl::simd::operator^()
+
+    template<typename T, std::size_t W>
+    inline static constexpr mask<T, W>
+    eq(
+        const vec<T, W> & a,
+        const vec<T, W> & b
+        ) noexcept {
+
+        if constexpr (W == 1) return { static_cast<_::lane_t<T>>(-(a.v == b.v)) };
+        else return { a.v == b.v };
+
+    } // dtl::simd::eq()
+
+    template<typename T, std::size_t W>
+    inline static constexpr mask<T, W>
+    lt(
+        const vec<T, W> & a,
+        const vec<T, W> & b
+        ) noexcept {
+
+        if constexpr (W == 1) return { static_cast<_::lane_t<T>>(-(a.v < b.v)) };
+        else return { a.v < b.v };
+
+    } // dtl::simd::lt()
+
+    template<typename T, std::size_t W>
+    inline static constexpr mask<T, W>
+    gt(
+        const vec<T, W> & a,
+        const vec<T, W> & b
+        ) noexcept {
+
+        return lt(b, a);
+
+    } // dtl::simd::gt()
+
+    // One bit per lane, lane 0 in bit 0.
+    template<typename T, std::size_t W>
+    inline static constexpr std::uint64_t
+    movemask(
+        const mask<T, W> & m
+        ) noexcept {
+
+        static_assert(W <= 64);
+
+        if constexpr (W == 1) {
+            return m.v & 1;
+        }
+#if defined(__SSE2__)
+        else if constexpr (sizeof(m.v) == 16) {
+            __m128i x;
+            std::memcpy(&x, &m.v, 16);
+            if constexpr (sizeof(T) == 1) {
+                return static_cast<std::uint32_t>(_mm_movemask_epi8(x));
+            } else if constexpr (sizeof(T) == 2) {
+                // Lanes are all-ones or zero, so saturating them to bytes keeps them intact.
+                return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(x, _mm_setzero_si128())));
+            } else if constexpr (sizeof(T) == 4) {
+                return static_cast<std::uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(x)));
+            } else {
+                return static_cast<std::uint32_t>(_mm_movemask_pd(_mm_castsi128_pd(x)));
+            }
+        }
+#endif
+#if defined(__AVX2__)
+        else if constexpr (sizeof(m.v) == 32) {
+            __m256i x;
+            std::memcpy(&x, &m.v, 32);
+            if constexpr (sizeof(T) == 1) {
+                return static_cast<std::uint32_t>(_mm256_movemask_epi8(x));
+            } else if constexpr (sizeof(T) == 2) {
+                // 256-bit packs interleave the halves, so pack the two 128-bit halves instead.
+                auto bytes = _mm_packs_epi16(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+                return static_cast<std::uint32_t>(_mm_movemask_epi8(bytes));
+            } else if constexpr (sizeof(T) == 4) {
+                return static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(x)));
+            } else {
+                return static_cast<std::uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(x)));
+            }
+        }
+#endif
+#if defined(__AVX512BW__)
+        else if constexpr (sizeof(m.v) == 64) {
+            __m512i x;
+            std::memcpy(&x, &m.v, 64);
+            if constexpr (sizeof(T) == 1) {
+                return _mm512_movepi8_mask(x);
+            } else if constexpr (sizeof(T) == 2) {
+                return _mm512_movepi16_mask(x);
+            }
+#if defined(__AVX512DQ__)
+            else if constexpr (sizeof(T) == 4) {
+                return _mm512_movepi32_mask(x);
+            } else {
+                return _mm512_movepi64_mask(x);
+            }
+#else
+            else if constexpr (sizeof(T) == 4) {
+                return _mm512_cmplt_epi32_mask(x, _mm512_setzero_si512());
+            } else {
+                return _mm512_cmplt_epi64_mask(x, _mm512_setzero_si512());
+            }
+#endif
+        }
+#endif
+        else {
+            std::uint64_t bits = 0;
+            for (std::size_t i = 0; i < W; ++i) bits |= std::uint64_t(m.v[i] & 1) << i;
+            return bits;
+        }
+
+    } // dtl::simd::movemask()
+
+    template<typename T, std::size_t W>
+    inline static constexpr bool
+    any(
+        const mask<T, W> & m
+        ) noexcept {
+
+        return (movemask(m) != 0);
+
+    } // dtl::simd::any()
+
+    // Lanes of `a` where the mask is set, of `b` elsewhere.
+    template<typename T, std::size_t W>
+    inline static constexpr vec<T, W>
+    blend(
+        const mask<T, W> & m,
+        const vec<T, W> & a,
+        const vec<T, W> & b
+        ) noexcept {
+
+        using native_type = typename vec<T, W>::native_type;
+
+        if constexpr (std::is_integral<T>::value) {
+            return { static_cast<native_type>(b.v ^ ((a.v ^ b.v) & (native_type)m.v)) };
+        } else {
+            return { m.v ? a.v : b.v };
+        }
+
+    } // dtl::simd::blend()
+
+    // Lane i of the result is lane (indices[i] mod W) of `a`.
+    template<typename T, std::size_t W>
+    inline static vec<T, W>
+    shuffle(
+        const vec<T, W> & a,
+        const vec<std::make_unsigned_t<_::lane_t<T>>, W> & indices
+        ) noexcept {
+
+        if constexpr (W == 1) {
+            return a;
+        } else {
+#if defined(__GNUC__) && !defined(__clang__)
+            return { __builtin_shuffle(a.v, indices.v) };
+#else
+            vec<T, W> r;
+            for (std::size_t i = 0; i < W; ++i) r.v[i] = a.v[indices.v[i] & (W - 1)];
+            return r;
+#endif
+        }
+
+    } // dtl::simd::shuffle()
+
+    // Lane i of the result is base[indices[i]].
+    template<typename T, typename I, std::size_t W>
+    inline static vec<T, W>
+    gather(
+        const T * base,
+        const vec<I, W> & indices
+        ) noexcept {
+
+        static_assert(std::is_integral<I>::value);
+
+        if constexpr (W == 1) {
+            return { base[indices.v] };
+        }
+#if defined(__AVX2__)
+        else if constexpr (W == 8 && sizeof(T) == 4 && sizeof(I) == 4 && std::is_integral<T>::value) {
+            __m256i idx;
+            std::memcpy(&idx, &indices.v, 32);
+            auto x = _mm256_i32gather_epi32(reinterpret_cast<const int *>(base), idx, 4);
+            vec<T, W> r;
+            std::memcpy(&r.v, &x, 32);
+            return r;
+        }
+#endif
+        else {
+            vec<T, W> r;
+            for (std::size_t i = 0; i < W; ++i) r.v[i] = base[indices.v[i]];
+            return r;
+        }
+
+    } // dtl::simd::gather()
+
+    template<typename T, std::size_t W>
+    inline static constexpr std::enable_if_t<std::is_integral<T>::value, vec<T, W>>
+    min(
+        const vec<T, W> & x,
+        const vec<T, W> & y
+        ) noexcept {
+
+        return blend(lt(x, y), x, y);
+
+    } // dtl::simd::min()
+
+    template<typename T, std::size_t W>
+    inline static constexpr std::enable_if_t<std::is_integral<T>::value, vec<T, W>>
+    max(
+        const vec<T, W> & x,
+        const vec<T, W> & y
+        ) noexcept {
+
+        return blend(lt(x, y), y, x);
+
+    } // dtl::simd::max()
+
+    template<typename T, std::size_t W>
+    inline static constexpr std::enable_if_t<std::is_integral<T>::value && std::is_signed<T>::value, vec<T, W>>
+    abs(
+        const vec<T, W> & value
+        ) noexcept {
+
+        auto sign = value.v >> (sizeof(T) * 8 - 1);
+        return { static_cast<typename vec<T, W>::native_type>((value.v ^ sign) - sign) };
+
+    } // dtl::simd::abs()
+
+    // Array kernels: element-wise over [0, count), full vectors first and the tail through dtl::branchless.
+
+    template<typename T, std::size_t W = native_width<T>>
+    inline static std::enable_if_t<std::is_integral<T>::value, void>
+    min(
+        const T * x,
+        const T * y,
+        T * out,
+        std::size_t count
+        ) noexcept {
+
+        std::size_t i = 0;
+        for (; i + W <= count; i += W) min(vec<T, W>::load(x + i), vec<T, W>::load(y + i)).store(out + i);
+        for (; i < count; ++i) out[i] = branchless::min(x[i], y[i]);
+
+    } // dtl::simd::min(const T *, ...)
+
+    template<typename T, std::size_t W = native_width<T>>
+    inline static std::enable_if_t<std::is_integral<T>::value, void>
+    max(
+        const T * x,
+        const T * y,
+        T * out,
+        std::size_t count
+        ) noexcept {
+
+        std::size_t i = 0;
+        for (; i + W <= count; i += W) max(vec<T, W>::load(x + i), vec<T, W>::load(y + i)).store(out + i);
+        for (; i < count; ++i) out[i] = branchless::max(x[i], y[i]);
+
+    } // dtl::simd::max(const T *, ...)
+
+    template<typename T, std::size_t W = native_width<T>>
+    inline static std::enable_if_t<std::is_integral<T>::value && std::is_signed<T>::value, void>
+    abs(
+        const T * in,
+        T * out,
+        std::size_t count
+        ) noexcept {
+
+        std::size_t i = 0;
+        for (; i + W <= count; i += W) abs(vec<T, W>::load(in + i)).store(out + i);
+        for (; i < count; ++i) out[i] = branchless::abs(in[i]);
+
+    } // dtl::simd::abs(const T *, ...)
+
+} // namespace dtl::simd
@@ -0,0 +1,356 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "branch.hh"
+#include "branchless.hh"
+#include "raii.hh"
+
+namespace dtl::soa {
+
+    // Structure-of-arrays storage for records of trivially copyable fields: table<A, B, C> keeps one column per
+    // field, each starting on its own cache line inside a single anonymous raii::mmap. Passes that touch a few
+    // fields scan only those columns (column<I>() returns an aligned pointer that loops vectorize over), while
+    // operator[] and the iterators still present whole records through proxy references.
+
+    constexpr std::size_t alignment = 64;
+
+    template<typename... Fields>
+    class table;
+
+    // Reference to one record of a table: get<I>() yields the field in its column, conversion yields a copy of
+    // the whole record and assignment scatters a tuple across the columns.
+    template<bool Const, typename... Fields>
+    class proxy {
+
+        using owner_type = std::conditional_t<Const, const table<Fields...>, table<Fields...>>;
+        using value_type = std::tuple<Fields...>;
+
+        owner_type * owner;
+        std::size_t index;
+
+        friend class table<Fields...>;
+
+        inline
+        proxy(
+            owner_type * owner,
+            std::size_t index
+            ) noexcept
+            : owner(owner), index(index) {}
+
+    public:
+
+        template<std::size_t I>
+        inline auto &
+        get() const noexcept {
+
+            return owner->template column<I>()[index];
+
+        } // proxy::get()
+
+        inline
+        operator value_type() const noexcept {
+
+            return owner->fetch(index, std::index_sequence_for<Fields...>{});
+
+        } // proxy::operator value_type()
+
+        template<bool C = Const, typename = std::enable_if_t<!C>>
+        inline const proxy &
+        operator=(
+            const value_type & values
+            ) const noexcept {
+
+            owner->assign(index, values, std::index_sequence_for<Fields...>{});
+            return *this;
+
+        } // proxy::operator=()
+
+    }; // class dtl::soa::proxy
+
+    template<typename... Fields>
+    class table {
+
+        static_assert(sizeof...(Fields) > 0);
+        static_assert((std::is_trivially_copyable<Fields>::value && ...), "columns are moved with memcpy");
+        static_assert(((alignof(Fields) <= alignment) && ...));
+
+        template<std::size_t I>
+        using field_t = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+        raii::mmap storage;
+        std::size_t count = 0;
+        std::size_t limit = 0;
+        std::tuple<Fields *...> columns;
+
+        inline static constexpr std::size_t
+        stride(
+            std::size_t bytes
+            ) noexcept {
+
+            return (bytes + alignment - 1) & ~(alignment - 1);
+
+        } // table::stride()
+
+        inline static constexpr std::size_t
+        footprint(
+            std::size_t capacity
+            ) noexcept {
+
+            return (stride(sizeof(Fields) * capacity) + ...);
+
+        } // table::footprint()
+
+        template<std::size_t... I>
+        inline void
+        relocate(
+            std::size_t capacity,
+            std::index_sequence<I...>
+            ) noexcept(false) {
+
+            raii::mmap next(footprint(capacity));
+            auto * base = static_cast<std::uint8_t *>(next.get());
+
+            std::tuple<Fields *...> placed;
+            std::size_t offset = 0;
+            ((std::get<I>(placed) = reinterpret_cast<field_t<I> *>(base + offset),
+              offset += stride(sizeof(field_t<I>) * capacity)), ...);
+
+            if (count) (std::memcpy(std::get<I>(placed), std::get<I>(columns), sizeof(field_t<I>) * count), ...);
+
+            storage = std::move(next);
+            columns = placed;
+            limit = capacity;
+
+        } // table::relocate()
+
+        template<typename Tuple, std::size_t... I>
+        inline void
+        assign(
+            std::size_t index,
+            Tuple && values,
+            std::index_sequence<I...>
+            ) noexcept {
+
+            ((std::get<I>(columns)[index] = std::get<I>(std::forward<Tuple>(values))), ...);
+
+        } // table::assign()
+
+        template<std::size_t... I>
+        inline std::tuple<Fields...>
+        fetch(
+            std::size_t index,
+            std::index_sequence<I...>
+            ) const noexcept {
+
+            return std::tuple<Fields...>(std::get<I>(columns)[index]...);
+
+        } // table::fetch()
+
+        template<bool, typename...> friend class proxy;
+
+    public:
+
+        using value_type = std::tuple<Fields...>;
+        using size_type = std::size_t;
+
+        using reference = proxy<false, Fields...>;
+        using const_reference = proxy<true, Fields...>;
+
+        template<bool Const>
+        class basic_iterator {
+
+            using owner_type = std::conditional_t<Const, const table, table>;
+
+            owner_type * owner = nullptr;
+            std::ptrdiff_t index = 0;
+
+        public:
+
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = table::value_type;
+            using difference_type = std::ptrdiff_t;
+            using reference = proxy<Const, Fields...>;
+            using pointer = void;
+
+            basic_iterator() = default;
+
+            inline
+            basic_iterator(
+                owner_type * owner,
+                std::ptrdiff_t index
+                ) noexcept
+                : owner(owner), index(index) {}
+
+            inline reference operator*() const noexcept { return (*owner)[index]; }
+            inline reference operator[](difference_type n) const noexcept { return (*owner)[index + n]; }
+
+            inline basic_iterator & operator++() noexcept { ++index; return *this; }
+            inline basic_iterator & operator--() noexcept { --index; return *this; }
+            inline basic_iterator operator++(int) noexcept { auto tmp = *this; ++index; return tmp; }
+            inline basic_iterator operator--(int) noexcept { auto tmp = *this; --index; return tmp; }
+            inline basic_iterator & operator+=(difference_type n) noexcept { index += n; return *this; }
+            inline basic_iterator & operator-=(difference_type n) noexcept { index -= n; return *this; }
+            inline basic_iterator operator+(difference_type n) const noexcept { return { owner, index + n }; }
+            inline basic_iterator operator-(difference_type n) const noexcept { return { owner, index - n }; }
+            inline difference_type operator-(const basic_iterator & other) const noexcept { return index - other.index; }
+
+            inline bool operator==(const basic_iterator & other) const noexcept { return index == other.index; }
+            inline bool operator!=(const basic_iterator & other) const noexcept { return index != other.index; }
+            inline bool operator<(const basic_iterator & other) const noexcept { return index < other.index; }
+            inline bool operator>(const basic_iterator & other) const noexcept { return index > other.index; }
+            inline bool operator<=(const basic_iterator & other) const noexcept { return index <= other.index; }
+            inline bool operator>=(const basic_iterator & other) const noexcept { return index >= other.index; }
+
+        }; // class dtl::soa::table::basic_iterator
+
+        using iterator = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+
+        inline explicit
+        table(
+            std::size_t capacity = 0
+            ) noexcept(false) {
+
+            if (capacity) reserve(capacity);
+
+        } // table::table()
+
+        inline
+        table(
+            table && other
+            ) noexcept
+            : storage(std::move(other.storage)), count(other.count), limit(other.limit), columns(other.columns) {
+
+            other.count = 0;
+            other.limit = 0;
+            other.columns = {};
+
+        } // table::table(table &&)
+
+        inline table &
+        operator=(
+            table && other
+            ) noexcept(false) {
+
+            storage = std::move(other.storage);
+            count = other.count;
+            other.count = 0;
+            limit = other.limit;
+            other.limit = 0;
+            columns = other.columns;
+            other.columns = {};
+
+            return *this;
+
+        } // table::operator=(table &&)
+
+        table(table const & other) = delete;
+        table & operator=(table const & other) = delete;
+
+        // Start of column I, aligned to a cache line.
+        template<std::size_t I>
+        inline field_t<I> *
+        column() noexcept {
+
+            return static_cast<field_t<I> *>(__builtin_assume_aligned(std::get<I>(columns), alignment));
+
+        } // table::column()
+
+        template<std::size_t I>
+        inline const field_t<I> *
+        column() const noexcept {
+
+            return static_cast<const field_t<I> *>(__builtin_assume_aligned(std::get<I>(columns), alignment));
+
+        } // table::column() const
+
+        inline reference operator[](std::size_t i) noexcept { return { this, i }; }
+        inline const_reference operator[](std::size_t i) const noexcept { return { this, i }; }
+
+        inline iterator begin() noexcept { return { this, 0 }; }
+        inline iterator end() noexcept { return { this, static_cast<std::ptrdiff_t>(count) }; }
+        inline const_iterator begin() const noexcept { return { this, 0 }; }
+        inline const_iterator end() const noexcept { return { this, static_cast<std::ptrdiff_t>(count) }; }
+
+        inline std::size_t size() const noexcept { return count; }
+        inline std::size_t capacity() const noexcept { return limit; }
+        inline bool empty() const noexcept { return !count; }
+
+        inline void
+        reserve(
+            std::size_t capacity
+            ) noexcept(false) {
+
+            if (capacity <= limit) return;
+            relocate(branchless::power_of_2::roundup(capacity), std::index_sequence_for<Fields...>{});
+
+        } // table::reserve()
+
+        // New records are zero-filled.
+        inline void
+        resize(
+            std::size_t size
+            ) noexcept(false) {
+
+            reserve(size);
+            if (size > count) {
+                std::apply([&](auto *... column) {
+                    (std::memset(column + count, 0, sizeof(*column) * (size - count)), ...);
+                }, columns);
+            }
+            count = size;
+
+        } // table::resize()
+
+        inline void
+        push_back(
+            const Fields &... values
+            ) noexcept(false) {
+
+            if (unlikely(count == limit)) {
+                // The values may live in this table (copying a row), and growing unmaps the old columns.
+                std::tuple<Fields...> row(values...);
+                reserve(limit ? limit * 2 : alignment);
+                assign(count++, row, std::index_sequence_for<Fields...>{});
+                return;
+            }
+            assign(count++, std::forward_as_tuple(values...), std::index_sequence_for<Fields...>{});
+
+        } // table::push_back()
+
+        inline void
+        pop_back() noexcept {
+
+            --count;
+
+        } // table::pop_back()
+
+        inline void
+        clear() noexcept {
+
+            count = 0;
+
+        } // table::clear()
+
+    }; // class dtl::soa::table
+
+} // namespace dtl::soa
+
+// Structured bindings over proxy references bind directly to the column elements.
+
+template<bool Const, typename... Fields>
+struct std::tuple_size<dtl::soa::proxy<Const, Fields...>>
+    : std::integral_constant<std::size_t, sizeof...(Fields)> {};
+
+template<std::size_t I, bool Const, typename... Fields>
+struct std::tuple_element<I, dtl::soa::proxy<Const, Fields...>> {
+    using type = std::conditional_t<Const,
+        const std::tuple_element_t<I, std::tuple<Fields...>>,
+        std::tuple_element_t<I, std::tuple<Fields...>>>;
+};
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+#include "art.hh"
+#include "check.hh"
+
+using namespace dtl;
+
+namespace {
+
+    using key = std::array<std::uint8_t, 8>;
+    using tree = art::tree<8, std::uint64_t>;
+
+    // Big-endian, so that byte order is numeric order.
+    key
+    encode(
+        std::uint64_t x
+        ) {
+
+        key k;
+        for (int i = 0; i < 8; ++i) k[i] = static_cast<std::uint8_t>(x >> (56 - 8 * i));
+        return k;
+
+    }
+
+    std::uint64_t
+    decode(
+        const key & k
+        ) {
+
+        std::uint64_t x = 0;
+        for (auto byte : k) x = (x << 8) | byte;
+        return x;
+
+    }
+
+    // Random inserts and erases against std::map, with keys sharing long prefixes (small values shifted into
+    // place) so that every node size and prefix compression are exercised, then point, range and prefix scans.
+    void
+    check_sequential() {
+
+        std::mt19937_64 rng(3);
+        tree t;
+        std::map<std::uint64_t, std::uint64_t> m;
+        for (std::uint64_t i = 0; i < 100000; ++i) {
+            auto x = (i % 3 == 0) ? rng() : (rng() % 5000) << (8 * (rng() % 7));
+            if (rng() % 4) {
+                DTL_CHECK(t.insert(encode(x), i) == m.insert_or_assign(x, i).second);
+            } else {
+                DTL_CHECK(t.erase(encode(x)) == (m.erase(x) == 1));
+            }
+        }
+        DTL_CHECK(t.size() == m.size());
+        for (auto & [k, v] : m) {
+            auto found = t.find(encode(k));
+            DTL_CHECK(found && *found == v);
+        }
+        for (int i = 0; i < 1000; ++i) {
+            auto x = (rng() % 5000) << (8 * (rng() % 7));
+            DTL_CHECK(t.find(encode(x)).has_value() == (m.count(x) == 1));
+        }
+
+        for (int i = 0; i < 1000; ++i) {
+            std::uint64_t low = rng(), high = rng();
+            if (i % 2) {
+                low = rng() % 100000;
+                high = low + rng() % (std::uint64_t(1) << 40);
+            }
+            if (low > high) std::swap(low, high);
+            std::vector<std::uint64_t> got, expected;
+            t.scan(encode(low), encode(high), [&](const key & k, const std::uint64_t &) {
+                got.push_back(decode(k));
+                return true;
+            });
+            for (auto at = m.lower_bound(low); at != m.end() && at->first <= high; ++at) expected.push_back(at->first);
+            DTL_CHECK(got == expected);
+        }
+
+        // A visitor returning false stops the scan.
+        std::size_t visited = 0;
+        t.scan(encode(0), encode(~std::uint64_t(0)), [&](const key &, const std::uint64_t &) { return ++visited < 10; });
+        DTL_CHECK(visited == std::min<std::size_t>(10, m.size()));
+
+        const std::uint8_t prefix[2] = { 0, 0 };
+        std::size_t matched = 0, expected = 0;
+        t.scan_prefix(prefix, 2, [&](const key & k, const std::uint64_t &) {
+            DTL_CHECK(k[0] == 0 && k[1] == 0);
+            ++matched;
+            return true;
+        });
+        for (auto & entry : m) expected += (entry.first >> 48) == 0;
+        DTL_CHECK(matched == expected);
+
+        for (auto & entry : m) DTL_CHECK(t.erase(encode(entry.first)));
+        DTL_CHECK(t.size() == 0);
+        DTL_CHECK(!t.find(encode(m.begin()->first)));
+        t.collect();
+
+    }
+
+    // Writers churn odd keys while readers look up and scan the even keys, which never change: every lookup must
+    // find its key, and every scan must see all of its even keys in increasing order. Retired memory is collected
+    // once all threads have left, as the tree requires.
+    void
+    check_concurrent() {
+
+        tree t;
+        for (std::uint64_t i = 0; i < 10000; ++i) t.insert(encode(i * 2), i * 2);
+
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> writers, readers;
+        for (int w = 0; w < 2; ++w) {
+            writers.emplace_back([&, w] {
+                std::mt19937_64 rng(w);
+                for (int i = 0; i < 100000; ++i) {
+                    auto x = (rng() % 20000) * 2 + 1;
+                    if (rng() % 2) t.insert(encode(x), x); else t.erase(encode(x));
+                }
+            });
+        }
+        for (int r = 0; r < 3; ++r) {
+            readers.emplace_back([&, r] {
+                std::mt19937_64 rng(9 + r);
+                while (!stop.load(std::memory_order_relaxed)) {
+                    auto x = (rng() % 10000) * 2;
+                    auto found = t.find(encode(x));
+                    DTL_CHECK(found && *found == x);
+
+                    std::uint64_t previous = 0, evens = 0;
+                    bool first = true;
+                    t.scan(encode(x), encode(x + 2000), [&](const key & k, const std::uint64_t & v) {
+                        auto d = decode(k);
+                        DTL_CHECK(v == d && (first || d > previous));
+                        first = false;
+                        previous = d;
+                        evens += d % 2 == 0;
+                        return true;
+                    });
+                    DTL_CHECK(evens == 1001 || x + 2000 >= 20000);
+                    std::this_thread::yield();
+                }
+            });
+        }
+        for (auto & w : writers) w.join();
+        stop = true;
+        for (auto & r : readers) r.join();
+        t.collect();
+
+        for (std::uint64_t i = 0; i < 10000; ++i) DTL_CHECK(*t.find(encode(i * 2)) == i * 2);
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    check_sequential();
+    check_concurrent();
+
+}
@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+#include "bitmap.hh"
+#include "check.hh"
+
+using namespace dtl;
+
+namespace {
+
+    std::size_t
+    reference_next(
+        const std::vector<bool> & bits,
+        std::size_t from,
+        bool value
+        ) {
+
+        for (auto i = from; i < bits.size(); ++i) {
+            if (bits[i] == value) return i;
+        }
+        return bitmap::npos;
+
+    }
+
+    // Random operations against std::vector<bool>, at capacities below, at and above a leaf word and across
+    // several summary levels, none of them powers of 2 except 64 and 4096.
+    void
+    check_hierarchical() {
+
+        std::mt19937_64 rng(5);
+        for (std::size_t capacity : { 1, 64, 100, 4096, 4097, 300000 }) {
+            bitmap::hierarchical h(capacity);
+            DTL_CHECK(h.capacity() == capacity);
+            std::vector<bool> reference(capacity);
+            std::size_t population = 0;
+            auto mark = [&](std::size_t i, bool value) {
+                population += value - reference[i];
+                reference[i] = value;
+            };
+
+            for (int round = 0; round < 40000; ++round) {
+                auto i = rng() % capacity;
+                switch (rng() % 6) {
+                case 0:
+                    h.set(i);
+                    mark(i, true);
+                    break;
+                case 1:
+                    h.clear(i);
+                    mark(i, false);
+                    break;
+                case 2:
+                    DTL_CHECK(h.find_next_set(i) == reference_next(reference, i, true));
+                    DTL_CHECK(h.find_next_clear(i) == reference_next(reference, i, false));
+                    break;
+                case 3: {
+                    auto id = h.allocate();
+                    DTL_CHECK(id == reference_next(reference, 0, false));
+                    if (id != bitmap::npos) mark(id, true);
+                    break;
+                }
+                case 4: {
+                    std::size_t out[100];
+                    auto n = rng() % 100;
+                    auto taken = h.allocate(n, out);
+                    DTL_CHECK(taken == std::min(n, capacity - population));
+                    for (std::size_t k = 0; k < taken; ++k) {
+                        DTL_CHECK(out[k] < capacity && !reference[out[k]]);
+                        mark(out[k], true);
+                    }
+                    break;
+                }
+                default:
+                    DTL_CHECK(h.count() == population);
+                    DTL_CHECK(h.full() == (population == capacity));
+                }
+            }
+        }
+
+        // IDs stay inside the requested capacity: a 100-entry allocator hands out exactly 0..99.
+        bitmap::hierarchical ids(100);
+        std::set<std::size_t> seen;
+        for (std::size_t id; (id = ids.allocate()) != bitmap::npos; ) seen.insert(id);
+        DTL_CHECK(seen.size() == 100 && *seen.rbegin() == 99 && ids.full());
+        DTL_CHECK(ids.find_next_set(99) == 99 && ids.find_next_clear() == bitmap::npos);
+        ids.release(42);
+        DTL_CHECK(!ids.full() && ids.allocate() == 42);
+
+    }
+
+    void
+    check_atomic() {
+
+        bitmap::atomic small(100);
+        DTL_CHECK(small.capacity() == 100);
+        std::size_t out[128];
+        DTL_CHECK(small.allocate(128, out) == 100);
+        DTL_CHECK(*std::max_element(out, out + 100) == 99);
+        DTL_CHECK(small.allocate() == bitmap::npos);
+        small.release(7);
+        DTL_CHECK(small.allocate() == 7);
+
+        // Threads allocating and releasing concurrently never hold the same ID.
+        constexpr std::size_t capacity = (1 << 20) - 3;
+        bitmap::atomic a(capacity);
+        std::vector<std::vector<std::size_t>> owned(8);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; ++t) {
+            threads.emplace_back([&, t] {
+                std::mt19937 rng(t);
+                auto & mine = owned[t];
+                for (int i = 0; i < 100000; ++i) {
+                    if (mine.size() < 20000 && rng() % 3) {
+                        if (rng() % 2) {
+                            auto id = a.allocate();
+                            if (id != bitmap::npos) mine.push_back(id);
+                        } else {
+                            std::size_t burst[37];
+                            auto taken = a.allocate(37, burst);
+                            mine.insert(mine.end(), burst, burst + taken);
+                        }
+                    } else if (!mine.empty()) {
+                        a.release(mine.back());
+                        mine.pop_back();
+                    }
+                }
+            });
+        }
+        for (auto & t : threads) t.join();
+
+        std::set<std::size_t> held;
+        std::size_t total = 0;
+        for (auto & mine : owned) {
+            total += mine.size();
+            held.insert(mine.begin(), mine.end());
+        }
+        DTL_CHECK(held.size() == total);
+        for (auto id : held) DTL_CHECK(a.test(id));
+
+        std::size_t filled = 0;
+        for (std::size_t id; (id = a.allocate()) != bitmap::npos; ++filled) DTL_CHECK(id < capacity);
+        DTL_CHECK(filled + total == capacity);
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    check_hierarchical();
+    check_atomic();
+
+}
@@ -0,0 +1,28 @@
+#include <cstdint>
+#include "branchless.hh"
+#include "check.hh"
+
+using namespace dtl;
+
+int
+main() {
+
+    using branchless::power_of_2::roundup;
+    using branchless::power_of_2::roundup_minus_1;
+
+    static_assert(roundup(1u) == 1 && roundup(3u) == 4 && roundup(64u) == 64 && roundup(65u) == 128);
+    static_assert(roundup(std::uint32_t(1) << 31) == std::uint32_t(1) << 31);
+    static_assert(roundup_minus_1(100u) == 127);
+
+    // Beyond 32 bits, every bit below the leading one must be filled in.
+    for (unsigned shift = 0; shift < 63; ++shift) {
+        auto p = std::uint64_t(1) << shift;
+        DTL_CHECK(roundup(p) == p);
+        DTL_CHECK(roundup(p + 1) == (p << 1) || p == 1);
+        DTL_CHECK(roundup_minus_1(p + 1) == (p << 1) - 1 || p == 1);
+    }
+    DTL_CHECK(roundup((std::uint64_t(1) << 32) + 1) == std::uint64_t(1) << 33);
+    DTL_CHECK(roundup(std::uint64_t(0x123456789)) == std::uint64_t(1) << 33);
+    DTL_CHECK(roundup(std::size_t(5000000000)) == std::size_t(1) << 33);
+
+}
@@ -0,0 +1,100 @@
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+#include "cache.hh"
+#include "check.hh"
+
+using namespace dtl;
+
+namespace {
+
+    using cache_type = cache::sharded<std::uint64_t, std::uint64_t>;
+
+    // A hit only ever returns the value stored for that key; updates replace it, erasures remove it.
+    void
+    check_sequential() {
+
+        cache_type c(1000, 4);
+        DTL_CHECK(c.shard_count() == 4);
+
+        std::mt19937_64 rng(1);
+        std::size_t finds = 0;
+        for (int i = 0; i < 200000; ++i) {
+            auto k = rng() % 5000;
+            auto v = c.find(k);
+            ++finds;
+            if (v) DTL_CHECK(*v == k * 7); else c.insert(k, k * 7);
+            if (i % 97 == 0) c.erase(rng() % 5000);
+        }
+        auto stats = c.stats_snapshot();
+        DTL_CHECK(stats.hits + stats.misses == finds);
+        DTL_CHECK(stats.hits > 0 && stats.misses > 0);
+
+        for (std::uint64_t k = 0; k < 5000; ++k) {
+            c.erase(k);
+            DTL_CHECK(!c.find(k));
+        }
+        DTL_CHECK(!c.erase(0));
+
+        // Into an emptied cache nothing is turned away, and a second insert updates in place.
+        for (std::uint64_t k = 0; k < 100; ++k) {
+            DTL_CHECK(c.insert(k, 1));
+            DTL_CHECK(c.insert(k, 2));
+            auto v = c.find(k);
+            DTL_CHECK(v && *v == 2);
+        }
+
+    }
+
+    // Keys looked up often survive a one-off scan of many more new keys than the cache holds: the scan's keys
+    // enter the small FIFO and leave from there, and the admission filter favours the established keys.
+    void
+    check_scan_resistance() {
+
+        cache_type c(1000, 1);
+        for (int round = 0; round < 50; ++round) {
+            for (std::uint64_t k = 0; k < 500; ++k) {
+                if (!c.find(k)) c.insert(k, k);
+            }
+        }
+        for (std::uint64_t k = 1000000; k < 1100000; ++k) {
+            if (!c.find(k)) c.insert(k, k);
+        }
+        std::size_t kept = 0;
+        for (std::uint64_t k = 0; k < 500; ++k) kept += c.find(k).has_value();
+        DTL_CHECK(kept >= 450);
+
+    }
+
+    // Threads mixing lookups, inserts and erasures never see a torn or foreign value.
+    void
+    check_concurrent() {
+
+        cache_type c(4096, 8);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 6; ++t) {
+            threads.emplace_back([&, t] {
+                std::mt19937_64 rng(t);
+                for (int i = 0; i < 100000; ++i) {
+                    auto k = rng() % 20000;
+                    auto v = c.find(k);
+                    if (v) DTL_CHECK(*v == k * 3 + 1); else c.insert(k, k * 3 + 1);
+                    if (i % 50 == 0) c.erase(rng() % 20000);
+                }
+            });
+        }
+        for (auto & t : threads) t.join();
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    check_sequential();
+    check_scan_resistance();
+    check_concurrent();
+
+}
@@ -0,0 +1,121 @@
+#define DTL_CACHELINE_CHECK
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "cacheline.hh"
+#include "check.hh"
+
+using namespace dtl;
+
+namespace {
+
+    std::atomic<int> true_reports{0}, false_reports{0};
+
+    void
+    count(
+        cacheline::check::kind k,
+        const void *,
+        const void *,
+        const void *
+        ) noexcept {
+
+        (k == cacheline::check::kind::true_sharing ? true_reports : false_reports).fetch_add(1);
+
+    }
+
+    struct alignas(cacheline::destructive) pair {
+
+        cacheline::check::watched<long> first{0};
+        cacheline::check::watched<long> second{0};
+
+    };
+
+    // Runs two threads that alternate often, so that each sees the other's recent accesses even on one CPU.
+    template<typename First, typename Second>
+    void
+    race(
+        First && first,
+        Second && second
+        ) {
+
+        auto loop = [](auto & body) {
+            for (int i = 0; i < 20000; ++i) {
+                body();
+                if (i % 16 == 0) std::this_thread::yield();
+            }
+        };
+        std::thread a([&] { loop(first); }), b([&] { loop(second); });
+        a.join();
+        b.join();
+
+    }
+
+    void
+    reset() {
+
+        true_reports = 0;
+        false_reports = 0;
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    cacheline::check::on_sharing(count);
+
+    static_assert(sizeof(cacheline::check::watched<long>) == sizeof(long));
+    static_assert(sizeof(cacheline::padded<char>) == cacheline::destructive);
+    static_assert(alignof(cacheline::padded<char>) == cacheline::destructive);
+
+    // Two writers on neighbouring fields.
+    pair writers;
+    race([&] { ++writers.first.write(); }, [&] { ++writers.second.write(); });
+    DTL_CHECK(false_reports > 0 && true_reports == 0);
+    reset();
+
+    // A writer and a reader of a neighbouring field.
+    pair mixed;
+    long sink = 0;
+    race([&] { ++mixed.first.write(); }, [&] { sink += mixed.second.read(); });
+    DTL_CHECK(false_reports > 0 && true_reports == 0);
+    reset();
+
+    // Two writers of the same address.
+    pair same;
+    race([&] { ++same.first.write(); }, [&] { ++same.first.write(); });
+    DTL_CHECK(true_reports > 0 && false_reports == 0);
+    reset();
+
+    // Readers only: nothing to report.
+    pair readers;
+    race([&] { sink += readers.first.read(); }, [&] { sink += readers.second.read(); });
+    DTL_CHECK(true_reports == 0 && false_reports == 0);
+
+    // Raw hooks on an unpadded array.
+    reset();
+    long raw[2] = {};
+    race([&] { cacheline::check::write(&raw[0]); ++raw[0]; }, [&] { cacheline::check::write(&raw[1]); ++raw[1]; });
+    DTL_CHECK(false_reports > 0);
+    (void)sink;
+
+    // per_cpu: slots on separate lines, const access through const references.
+    cacheline::per_cpu<std::atomic<long>> counters(3);
+    DTL_CHECK(counters.size() == 4);
+    DTL_CHECK(reinterpret_cast<std::uintptr_t>(&counters[1]) - reinterpret_cast<std::uintptr_t>(&counters[0])
+              == cacheline::destructive);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 1000; ++i) counters.local().fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+    for (auto & t : threads) t.join();
+    long total = 0;
+    const auto & view = counters;
+    view.for_each([&](const std::atomic<long> & c) { total += c.load(); });
+    DTL_CHECK(total == 4000);
+    static_assert(std::is_same<decltype(view[0]), const std::atomic<long> &>::value);
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include "branch.hh"
+
+// Minimal checks for the tests: each test is a plain executable that aborts on the first failure, reporting the
+// failed expression and its location.
+
+#define DTL_CHECK(condition)                                                                                \
+    do {                                                                                                    \
+        if (unlikely(!(condition))) {                                                                       \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);             \
+            std::abort();                                                                                   \
+        }                                                                                                   \
+    } while (0)
+
+#define DTL_CHECK_THROWS(expression)                                                                        \
+    do {                                                                                                    \
+        bool thrown = false;                                                                                \
+        try {                                                                                               \
+            (void)(expression);                                                                             \
+        } catch (...) {                                                                                     \
+            thrown = true;                                                                                  \
+        }                                                                                                   \
+        if (unlikely(!thrown)) {                                                                            \
+            std::fprintf(stderr, "%s:%d: did not throw: %s\n", __FILE__, __LINE__, #expression);           \
+            std::abort();                                                                                   \
+        }                                                                                                   \
+    } while (0)
@@ -0,0 +1,69 @@
+#include <cstdlib>
+#include <cstring>
+#include "cpu.hh"
+#include "check.hh"
+
+using namespace dtl;
+
+namespace {
+
+    int base(int x) { return x; }
+    int plus2(int x) { return x + 2; }
+    int plus5(int x) { return x + 5; }
+
+    // No SSE4 candidate: the SSE4 tier falls back to scalar.
+    cpu::dispatch<int (*)(int)> function([](const cpu::features & f) {
+        return cpu::select<int(int)>(f, base, nullptr, plus2, plus5);
+    });
+
+} // namespace
+
+int
+main() {
+
+    // DTL_CPU_TIER (set by the cpu.environment run) caps the effective features from the start.
+    auto host = cpu::host();
+    if (auto * value = std::getenv("DTL_CPU_TIER"); value && !std::strcmp(value, "scalar")) {
+        DTL_CHECK(cpu::current().tier() == cpu::tier::scalar);
+    } else {
+        DTL_CHECK(cpu::current().mask() == host.mask());
+    }
+
+    // Detection agrees with the compiler's runtime checks.
+    __builtin_cpu_init();
+    DTL_CHECK(host.has(cpu::feature::sse2));
+    DTL_CHECK(host.has(cpu::feature::ssse3) == !!__builtin_cpu_supports("ssse3"));
+    DTL_CHECK(host.has(cpu::feature::sse42) == !!__builtin_cpu_supports("sse4.2"));
+    DTL_CHECK(host.has(cpu::feature::popcnt) == !!__builtin_cpu_supports("popcnt"));
+    DTL_CHECK(host.has(cpu::feature::avx2) == !!__builtin_cpu_supports("avx2"));
+    DTL_CHECK(host.has(cpu::feature::bmi2) == !!__builtin_cpu_supports("bmi2"));
+    DTL_CHECK(host.has(cpu::feature::avx512bw) == !!__builtin_cpu_supports("avx512bw"));
+
+    // Tiers from feature sets.
+    cpu::features f;
+    DTL_CHECK(f.tier() == cpu::tier::scalar);
+    for (auto g : { cpu::feature::sse2, cpu::feature::sse3, cpu::feature::ssse3, cpu::feature::sse41,
+                    cpu::feature::sse42, cpu::feature::popcnt }) f.set(g);
+    DTL_CHECK(f.tier() == cpu::tier::sse4);
+    for (auto g : { cpu::feature::avx, cpu::feature::avx2, cpu::feature::bmi1, cpu::feature::bmi2 }) f.set(g);
+    DTL_CHECK(f.tier() == cpu::tier::sse4);
+    f.set(cpu::feature::fma);
+    DTL_CHECK(f.tier() == cpu::tier::avx2);
+    DTL_CHECK(cpu::select<int(int)>(f, base, nullptr, plus2, plus5) == plus2);
+
+    // force() caps and rebinds every dispatcher, and lifts the cap again at the host's tier.
+    int expected[] = { 10, 10, 12, 15 };
+    for (int t = 0; t <= static_cast<int>(host.tier()); ++t) {
+        cpu::force(static_cast<cpu::tier>(t));
+        DTL_CHECK(cpu::current().tier() == static_cast<cpu::tier>(t));
+        DTL_CHECK(function(10) == expected[t]);
+        cpu::dispatch<int (*)(int)> late([](const cpu::features & f) {
+            return cpu::select<int(int)>(f, base, nullptr, plus2, plus5);
+        });
+        DTL_CHECK(late(10) == expected[t]);
+    }
+    cpu::force(host.tier());
+    DTL_CHECK(cpu::current().mask() == host.mask());
+    DTL_CHECK(cpu::current().has(cpu::feature::erms) == host.has(cpu::feature::erms));
+
+}
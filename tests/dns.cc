@@ -0,0 +1,179 @@
+#include <unistd.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "check.hh"
+#include "dns.hh"
+
+using namespace dtl;
+
+namespace {
+
+    // Appends a dotted name in uncompressed wire form.
+    void
+    put_name(
+        std::vector<std::uint8_t> & out,
+        const std::string & dotted
+        ) {
+
+        for (std::size_t at = 0; at < dotted.size();) {
+            auto dot = std::min(dotted.find('.', at), dotted.size());
+            out.push_back(static_cast<std::uint8_t>(dot - at));
+            out.insert(out.end(), dotted.begin() + at, dotted.begin() + dot);
+            at = dot + 1;
+        }
+        out.push_back(0);
+
+    }
+
+    // A response to "www.Example.COM A": a CNAME whose owner is a pointer to the question and whose target is
+    // "cdn" plus a pointer to "example.com", then an A record owned by a pointer to that target.
+    std::vector<std::uint8_t>
+    response() {
+
+        std::vector<std::uint8_t> m = { 0x12, 0x34, 0x81, 0x80, 0, 1, 0, 2, 0, 0, 0, 0 };
+        put_name(m, "www.Example.COM");
+        m.insert(m.end(), { 0, 1, 0, 1 });
+        m.insert(m.end(), { 0xc0, 12, 0, 5, 0, 1, 0, 0, 0x0e, 0x10, 0, 6, 3, 'c', 'd', 'n', 0xc0, 16 });
+        m.insert(m.end(), { 0xc0, 0x2d, 0, 1, 0, 1, 0, 0, 0, 60, 0, 4, 1, 2, 3, 4 });
+        return m;
+
+    }
+
+    void
+    check_message() {
+
+        auto m = response();
+        auto msg = dns::message::parse(m.data(), m.size());
+        DTL_CHECK(msg);
+        DTL_CHECK(msg->id() == 0x1234 && msg->response() && msg->rcode() == 0);
+        DTL_CHECK(msg->count(dns::section::answer) == 2 && msg->length() == m.size());
+
+        std::size_t questions = 0;
+        msg->questions([&](const dns::question & q) {
+            char dotted[64];
+            DTL_CHECK(q.name.copy(dotted, sizeof(dotted)) == 15 && std::string(dotted, 15) == "www.Example.COM");
+            DTL_CHECK(q.name.equals("www.example.com.") && !q.name.equals("www.example.co"));
+            DTL_CHECK(q.name.labels() == 3 && q.name.length() == 15 && q.type == 1);
+            ++questions;
+        });
+        DTL_CHECK(questions == 1);
+
+        std::size_t records = 0;
+        msg->records(dns::section::answer, [&](const dns::record & r) {
+            if (r.type == 5) {
+                auto target = msg->name_at(r.rdata);
+                DTL_CHECK(target && target->equals("cdn.example.com") && r.ttl == 3600);
+            } else {
+                DTL_CHECK(r.name.equals("cdn.example.com") && r.rdlength == 4 && r.rdata[3] == 4);
+            }
+            ++records;
+        });
+        DTL_CHECK(records == 2);
+
+    }
+
+    // Pointer loops, forward pointers and every truncation are rejected; random corruption never reads out of
+    // bounds (run under a sanitizer to make that a hard check).
+    void
+    check_malformed() {
+
+        const auto m = response();
+        auto looped = m;
+        looped[12] = 0xc0;
+        looped[13] = 12;
+        DTL_CHECK(!dns::message::parse(looped.data(), looped.size()));
+        auto forward = m;
+        forward[12] = 0xc0;
+        forward[13] = 40;
+        DTL_CHECK(!dns::message::parse(forward.data(), forward.size()));
+        for (std::size_t n = 0; n < m.size(); ++n) DTL_CHECK(!dns::message::parse(m.data(), n));
+
+        std::mt19937_64 rng(1);
+        for (int i = 0; i < 50000; ++i) {
+            auto b = m;
+            for (int k = 0; k < 3; ++k) b[rng() % b.size()] = static_cast<std::uint8_t>(rng());
+            auto parsed = dns::message::parse(b.data(), b.size());
+            if (!parsed) continue;
+            char scratch[300];
+            parsed->questions([&](const dns::question & q) { DTL_CHECK(q.name.copy(scratch, sizeof(scratch)) <= 253); });
+            for (int s = 1; s < 4; ++s) {
+                parsed->records(dns::section(s), [&](const dns::record & r) {
+                    DTL_CHECK(r.name.length() <= 253);
+                    parsed->name_at(r.rdata);
+                });
+            }
+        }
+
+    }
+
+    void
+    check_suffixes() {
+
+        std::mt19937_64 rng(2);
+        std::vector<std::string> domains;
+        for (int i = 0; i < 100000; ++i) {
+            domains.push_back("d" + std::to_string(rng() % 100000000) + (i % 3 ? ".com" : ".ads.example.net"));
+        }
+        std::vector<std::pair<std::string_view, std::uint32_t>> entries;
+        for (std::size_t i = 0; i < domains.size(); ++i) entries.push_back({ domains[i], std::uint32_t(i) });
+        entries.push_back({ "*.Tracker.ORG.", 7 });
+        entries.push_back({ "bad..name", 1 });
+        entries.push_back({ "", 1 });
+        auto s = dns::suffixes::compile(entries);
+
+        auto tracker = s.find("x.y.tracker.org");
+        DTL_CHECK(tracker && *tracker == 7 && s.find("TRACKER.org"));
+        DTL_CHECK(!s.find("racker.org") && !s.find("org") && !s.find(""));
+        for (int i = 0; i < 1000; ++i) {
+            auto & d = domains[rng() % domains.size()];
+            auto hit = s.find("www." + d);
+            DTL_CHECK(hit && domains[*hit] == d);       // a duplicate domain keeps its last index
+            DTL_CHECK(!s.find("zz" + d));
+        }
+
+        auto m = response();
+        auto msg = dns::message::parse(m.data(), m.size());
+        auto blocked = dns::suffixes::compile({ { "example.com", 3 } });
+        msg->questions([&](const dns::question & q) { DTL_CHECK(blocked.find(q.name) && *blocked.find(q.name) == 3); });
+
+        // Saved and mapped back, the image answers the same; a damaged image is refused.
+        auto path = "/tmp/dtl-dns-test-" + std::to_string(::getpid());
+        s.save(path.c_str());
+        auto loaded = dns::suffixes::load(path.c_str());
+        DTL_CHECK(loaded.size() == s.size() && loaded.size_bytes() == s.size_bytes());
+        for (int i = 0; i < 1000; ++i) {
+            auto & d = domains[rng() % domains.size()];
+            DTL_CHECK(*loaded.find("a.b." + d) == *s.find("a.b." + d));
+        }
+        DTL_CHECK(*loaded.find("tracker.org") == 7);
+        DTL_CHECK(::truncate(path.c_str(), static_cast<off_t>(s.size_bytes() - 8)) == 0);
+        DTL_CHECK_THROWS(dns::suffixes::load(path.c_str()));
+        ::unlink(path.c_str());
+
+    }
+
+    // Duplicates separated by an invalid name: the last valid entry wins, and the set holds one entry.
+    void
+    check_duplicates() {
+
+        auto s = dns::suffixes::compile({ { "x.com", 1 }, { "bad..name", 9 }, { "x.com", 2 } });
+        DTL_CHECK(s.size() == 1);
+        DTL_CHECK(s.find("x.com") && *s.find("x.com") == 2);
+
+        auto t = dns::suffixes::compile({ { "", 5 }, { "A.example", 1 }, { "-", 6 }, { "a.EXAMPLE.", 4 } });
+        DTL_CHECK(t.size() == 2 && *t.find("a.example") == 4 && *t.find("-") == 6);
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    check_message();
+    check_malformed();
+    check_suffixes();
+    check_duplicates();
+
+}
@@ -0,0 +1,218 @@
+#include <cstdio>
+#include <random>
+#include <string>
+#include "check.hh"
+#include "encoding.hh"
+
+using namespace dtl;
+
+namespace {
+
+    const std::string alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    std::string
+    reference_base64(
+        const std::string & s
+        ) {
+
+        std::string out;
+        std::size_t i = 0;
+        for (; i + 3 <= s.size(); i += 3) {
+            unsigned v = std::uint8_t(s[i]) << 16 | std::uint8_t(s[i + 1]) << 8 | std::uint8_t(s[i + 2]);
+            for (int shift = 18; shift >= 0; shift -= 6) out += alphabet[(v >> shift) & 63];
+        }
+        if (s.size() - i == 1) {
+            unsigned v = std::uint8_t(s[i]) << 16;
+            out += { alphabet[v >> 18], alphabet[(v >> 12) & 63], '=', '=' };
+        } else if (s.size() - i == 2) {
+            unsigned v = std::uint8_t(s[i]) << 16 | std::uint8_t(s[i + 1]) << 8;
+            out += { alphabet[v >> 18], alphabet[(v >> 12) & 63], alphabet[(v >> 6) & 63], '=' };
+        }
+        return out;
+
+    }
+
+    // Canonical base64 only: decodes bit by bit and accepts text only if encoding the result gives it back, which
+    // rejects bad lengths, misplaced padding and non-zero trailing bits.
+    bool
+    reference_canonical(
+        const std::string & text
+        ) {
+
+        std::size_t pad = 0;
+        while (pad < 2 && pad < text.size() && text[text.size() - 1 - pad] == '=') ++pad;
+        unsigned bits = 0, have = 0;
+        std::string out;
+        for (std::size_t k = 0; k < text.size() - pad; ++k) {
+            auto at = alphabet.find(text[k]);
+            if (at == std::string::npos || !text[k]) return false;
+            bits = (bits << 6) | static_cast<unsigned>(at);
+            have += 6;
+            if (have >= 8) {
+                have -= 8;
+                out += static_cast<char>(bits >> have);
+                bits &= (1u << have) - 1;
+            }
+        }
+        return reference_base64(out) == text;
+
+    }
+
+    bool
+    reference_utf8(
+        const std::string & s
+        ) {
+
+        for (std::size_t i = 0; i < s.size();) {
+            unsigned c = std::uint8_t(s[i]), cp;
+            std::size_t n;
+            if (c < 0x80) {
+                ++i;
+                continue;
+            } else if ((c & 0xe0) == 0xc0) {
+                n = 2;
+                cp = c & 0x1f;
+            } else if ((c & 0xf0) == 0xe0) {
+                n = 3;
+                cp = c & 0x0f;
+            } else if ((c & 0xf8) == 0xf0) {
+                n = 4;
+                cp = c & 0x07;
+            } else {
+                return false;
+            }
+            if (i + n > s.size()) return false;
+            for (std::size_t k = 1; k < n; ++k) {
+                if ((std::uint8_t(s[i + k]) & 0xc0) != 0x80) return false;
+                cp = cp << 6 | (std::uint8_t(s[i + k]) & 0x3f);
+            }
+            if ((n == 2 && cp < 0x80) || (n == 3 && cp < 0x800) || (n == 4 && cp < 0x10000)) return false;
+            if (cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff)) return false;
+            i += n;
+        }
+        return true;
+
+    }
+
+    // Round trips at every length through the vector, the half-vector and the scalar paths, against the reference
+    // encoders; then every single-character corruption of a few encodings.
+    void
+    check_round_trips() {
+
+        std::mt19937_64 rng(42);
+        for (std::size_t n = 0; n < 300; ++n) {
+            for (int round = 0; round < 4; ++round) {
+                std::string s(n, 0);
+                for (auto & c : s) c = static_cast<char>(rng());
+
+                auto text = encoding::base64::encode(s);
+                DTL_CHECK(text == reference_base64(s) && text.size() == encoding::base64::encoded_size(n));
+                auto back = encoding::base64::decode(text);
+                DTL_CHECK(back && *back == s);
+
+                std::string expected;
+                for (auto c : s) {
+                    char pair[3];
+                    std::snprintf(pair, sizeof(pair), "%02x", std::uint8_t(c));
+                    expected += pair;
+                }
+                auto lower = encoding::hex::encode(s), upper = encoding::hex::encode(s, true);
+                DTL_CHECK(lower == expected);
+                auto from_lower = encoding::hex::decode(lower), from_upper = encoding::hex::decode(upper);
+                DTL_CHECK(from_lower && *from_lower == s && from_upper && *from_upper == s);
+
+                if (round || (n > 16 && n % 41)) continue;      // every tail, and a few lengths spanning vectors
+                for (std::size_t p = 0; p < text.size(); ++p) {
+                    for (int v = 0; v < 256; ++v) {
+                        auto bad = text;
+                        bad[p] = static_cast<char>(v);
+                        DTL_CHECK(encoding::base64::decode(bad).has_value() == reference_canonical(bad));
+                    }
+                }
+                for (std::size_t p = 0; p < lower.size(); ++p) {
+                    for (int v = 0; v < 256; ++v) {
+                        auto bad = lower;
+                        bad[p] = static_cast<char>(v);
+                        bool digit = (v >= '0' && v <= '9') || (v >= 'a' && v <= 'f') || (v >= 'A' && v <= 'F');
+                        DTL_CHECK(encoding::hex::decode(bad).has_value() == digit);
+                    }
+                }
+            }
+        }
+
+        DTL_CHECK(!encoding::base64::decode("abc") && !encoding::base64::decode("a===") && !encoding::base64::decode("ab=c"));
+        DTL_CHECK(!encoding::base64::decode("ab==ab==") && !encoding::base64::decode("Zh=="));
+        DTL_CHECK(encoding::base64::decode("")->empty() && *encoding::base64::decode("Zm9vYmFy") == "foobar");
+        DTL_CHECK(*encoding::base64::decode("Zm9vYg==") == "foob");
+        DTL_CHECK(!encoding::hex::decode("abc"));
+
+    }
+
+    // Random code point sequences, mutated with bytes at the edges of every range, truncated and shifted against
+    // the vector width; then every byte pair (and pair plus continuations) at offsets around vector boundaries.
+    void
+    check_utf8() {
+
+        const std::uint8_t pieces[] = { 0x00, 0x41, 0x7f, 0x80, 0x8f, 0x90, 0x9f, 0xa0, 0xbf, 0xc0, 0xc1, 0xc2, 0xdf,
+                                        0xe0, 0xe1, 0xec, 0xed, 0xee, 0xef, 0xf0, 0xf1, 0xf3, 0xf4, 0xf5, 0xff };
+        std::mt19937_64 rng(43);
+        std::size_t valid = 0;
+        for (int round = 0; round < 100000; ++round) {
+            std::size_t n = rng() % 80;
+            std::string s;
+            while (s.size() < n) {
+                unsigned cp;
+                switch (rng() % 5) {
+                case 0: cp = rng() % 0x80; break;
+                case 1: cp = 0x80 + rng() % 0x780; break;
+                case 2: cp = 0x800 + rng() % 0xf800; break;
+                case 3: cp = 0x10000 + rng() % 0x100000; break;
+                default: cp = 'x';
+                }
+                if (cp >= 0xd800 && cp <= 0xdfff) cp = 'y';
+                if (cp < 0x80) {
+                    s += static_cast<char>(cp);
+                } else if (cp < 0x800) {
+                    s += { static_cast<char>(0xc0 | cp >> 6), static_cast<char>(0x80 | (cp & 63)) };
+                } else if (cp < 0x10000) {
+                    s += { static_cast<char>(0xe0 | cp >> 12), static_cast<char>(0x80 | ((cp >> 6) & 63)),
+                           static_cast<char>(0x80 | (cp & 63)) };
+                } else {
+                    s += { static_cast<char>(0xf0 | cp >> 18), static_cast<char>(0x80 | ((cp >> 12) & 63)),
+                           static_cast<char>(0x80 | ((cp >> 6) & 63)), static_cast<char>(0x80 | (cp & 63)) };
+                }
+            }
+            for (auto m = rng() % 3; m-- && !s.empty();) s[rng() % s.size()] = static_cast<char>(pieces[rng() % sizeof(pieces)]);
+            if (rng() % 4 == 0 && !s.empty()) s.resize(rng() % s.size());
+            if (rng() % 3 == 0) s = std::string(rng() % 70, 'q') + s;
+            auto expected = reference_utf8(s);
+            DTL_CHECK(encoding::utf8::valid(s) == expected);
+            valid += expected;
+        }
+        DTL_CHECK(valid > 10000 && valid < 90000);
+
+        for (unsigned a = 0; a < 256; ++a) {
+            for (unsigned b = 0; b < 256; ++b) {
+                for (std::size_t prefix : { 0, 14, 15, 30, 31 }) {
+                    std::string s(prefix, 'z');
+                    s += { static_cast<char>(a), static_cast<char>(b) };
+                    DTL_CHECK(encoding::utf8::valid(s) == reference_utf8(s));
+                    s += '\x80';
+                    DTL_CHECK(encoding::utf8::valid(s) == reference_utf8(s));
+                    s += '\x80';
+                    DTL_CHECK(encoding::utf8::valid(s) == reference_utf8(s));
+                }
+            }
+        }
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    check_round_trips();
+    check_utf8();
+
+}
@@ -0,0 +1,142 @@
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "check.hh"
+#include "futex.hh"
+
+using namespace dtl;
+using namespace std::chrono_literals;
+
+namespace {
+
+    using clock = std::chrono::steady_clock;
+
+    // Timeouts, value mismatches and bitset channels on the raw wrappers.
+    void
+    check_wrappers() {
+
+        futex::word w{0};
+        DTL_CHECK(!futex::wait(w, 0, 5ms));                    // timed out
+        DTL_CHECK(futex::wait(w, 1));                          // the value already differs
+        DTL_CHECK(!futex::wait_bitset(w, 0, 1, clock::now() + 5ms));
+
+        std::thread waker([&] {
+            std::this_thread::sleep_for(10ms);
+            w.store(1);
+            futex::wake_bitset(w, 2);
+        });
+        while (!w.load()) futex::wait_bitset(w, 0, 2);
+        waker.join();
+        DTL_CHECK(futex::wake(w) == 0);
+
+        if constexpr (futex::waitv_available) {
+            futex::word a{0}, b{0};
+            futex::waiter words[2] = { { &a, 0 }, { &b, 0 } };
+            std::thread other([&] {
+                std::this_thread::sleep_for(10ms);
+                b.store(1);
+                futex::wake(b);
+            });
+            auto woken = -1;
+            try {
+                woken = futex::waitv(words, 2);
+            } catch (const std::system_error & e) {
+                DTL_CHECK(e.code() == std::errc::function_not_supported);    // kernel before 5.16
+                other.join();
+                return;
+            }
+            other.join();
+            DTL_CHECK(woken == 1 || (woken == -1 && b.load() == 1));
+            b.store(0);
+            auto until = clock::now() + 5ms;
+            DTL_CHECK(futex::waitv(words, 2, &until) == -1);
+        }
+
+    }
+
+    // Parked threads all come back from unpark_all(); a failed validation or a deadline returns false.
+    void
+    check_parking() {
+
+        int address = 0;
+        std::atomic<bool> go{false};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back([&] {
+                while (!go.load()) futex::parking::park(&address, [&] { return !go.load(); });
+            });
+        }
+        std::this_thread::sleep_for(20ms);
+        go = true;
+        futex::parking::unpark_all(&address);
+        for (auto & t : threads) t.join();
+
+        DTL_CHECK(!futex::parking::park(&address, [] { return false; }));
+        auto start = clock::now();
+        DTL_CHECK(!futex::parking::park(&address, [] { return true; }, start + 10ms));
+        DTL_CHECK(clock::now() - start >= 10ms);
+        DTL_CHECK(!futex::parking::unpark_one(&address));
+
+    }
+
+    // Consumers sleeping on an event in front of a queue miss no item and no wakeup: the sum of what they pop is
+    // the sum of what was pushed.
+    void
+    check_event() {
+
+        constexpr long count = 200000;
+        futex::event e;
+        std::mutex m;
+        std::deque<long> queue;
+        auto pop = [&](long & out) {
+            std::lock_guard<std::mutex> g(m);
+            if (queue.empty()) return false;
+            out = queue.front();
+            queue.pop_front();
+            return true;
+        };
+
+        std::atomic<long> total{0};
+        std::vector<std::thread> consumers;
+        for (int k = 0; k < 3; ++k) {
+            consumers.emplace_back([&] {
+                long sum = 0;
+                for (;;) {
+                    long item;
+                    e.await([&] { return pop(item); });
+                    if (item < 0) break;
+                    sum += item;
+                }
+                total += sum;
+            });
+        }
+        auto push = [&](long item) {
+            {
+                std::lock_guard<std::mutex> g(m);
+                queue.push_back(item);
+            }
+            e.notify_one();
+        };
+        for (long i = 1; i <= count; ++i) push(i);
+        for (int k = 0; k < 3; ++k) push(-1);
+        for (auto & c : consumers) c.join();
+        DTL_CHECK(total == count * (count + 1) / 2);
+
+        auto k = e.prepare();
+        DTL_CHECK(!e.wait(k, clock::now() + 5ms));
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    check_wrappers();
+    check_parking();
+    check_event();
+
+}
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include "check.hh"
+#include "hash.hh"
+#include "hashtable.hh"
+
+using namespace dtl;
+
+namespace {
+
+    // Inverse of hash::mix(): each xorshift by 33 is its own inverse, and the multipliers are inverted mod 2^64.
+    std::uint64_t
+    unmix(
+        std::uint64_t h
+        ) {
+
+        auto xorshift = [](std::uint64_t x) { return x ^ (x >> 33); };
+        h = xorshift(h);
+        h *= 0x9cb4b2f8129337dbull;
+        h = xorshift(h);
+        h *= 0x4f74430c22a54005ull;
+        return xorshift(h);
+
+    }
+
+    // The reference vectors of the SipHash paper for SipHash-2-4 (key 00..0f, message 00..n-1), and CPython's
+    // str hashes under PYTHONHASHSEED=0 (SipHash-1-3 with a zero key) for SipHash-1-3.
+    void
+    check_vectors() {
+
+        hash::key k;
+        std::uint8_t bytes[16], message[64];
+        for (int i = 0; i < 16; ++i) bytes[i] = static_cast<std::uint8_t>(i);
+        for (int i = 0; i < 64; ++i) message[i] = static_cast<std::uint8_t>(i);
+        std::memcpy(&k, bytes, sizeof(k));
+        DTL_CHECK(hash::siphash24(k, message, 0) == 0x726fdb47dd0e0e31ull);
+        DTL_CHECK(hash::siphash24(k, message, 15) == 0xa129ca6149be45e5ull);
+
+        const hash::key zero{ 0, 0 };
+        DTL_CHECK(static_cast<std::int64_t>(hash::siphash13(zero, "a", 1)) == 4644417185603328019ll);
+        DTL_CHECK(static_cast<std::int64_t>(hash::siphash13(zero, "abc", 3)) == -4594863902769663758ll);
+        DTL_CHECK(static_cast<std::int64_t>(hash::siphash13(zero, "hello world", 11)) == -5642461784034726774ll);
+
+        DTL_CHECK(&hash::seed() == &hash::seed());
+        DTL_CHECK(hash::sip<std::string>{}("abc") == hash::siphash13(hash::seed(), "abc", 3));
+        const std::uint64_t five = 5;
+        DTL_CHECK(hash::aes<std::uint64_t>{}(five) == hash::aeshash(hash::seed(), &five, 8));
+        DTL_CHECK(hash::mix(unmix(0x0123456789abcdefull)) == 0x0123456789abcdefull);
+
+    }
+
+    // The batched overloads agree with the single-message ones at sizes around every block and lane boundary.
+    void
+    check_batches() {
+
+        std::mt19937_64 rng(1);
+        const hash::key k{ rng(), rng() };
+        std::vector<std::vector<std::uint8_t>> messages(37);
+        for (std::size_t size : { 0, 1, 7, 8, 13, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 128, 129, 1000 }) {
+            std::vector<const void *> pointers;
+            for (auto & m : messages) {
+                m.resize(size);
+                for (auto & c : m) c = static_cast<std::uint8_t>(rng());
+                pointers.push_back(m.data());
+            }
+            std::vector<std::uint64_t> sip13(messages.size()), sip24(messages.size()), aes(messages.size());
+            hash::siphash13(k, pointers.data(), size, sip13.data(), pointers.size());
+            hash::siphash24(k, pointers.data(), size, sip24.data(), pointers.size());
+            hash::aeshash(k, pointers.data(), size, aes.data(), pointers.size());
+            for (std::size_t i = 0; i < messages.size(); ++i) {
+                DTL_CHECK(sip13[i] == hash::siphash13(k, pointers[i], size));
+                DTL_CHECK(sip24[i] == hash::siphash24(k, pointers[i], size));
+                DTL_CHECK(aes[i] == hash::aeshash(k, pointers[i], size));
+            }
+        }
+
+        // Zero messages of different lengths hash apart, and one flipped bit changes about half of the output.
+        // (Without AES-NI aeshash is SipHash-1-3, so the families are checked apart.)
+        std::uint8_t zeros[80] = {};
+        using single = std::uint64_t (*)(const hash::key &, const void *, std::size_t) noexcept;
+        for (single h : { single(hash::siphash13), single(hash::siphash24), single(hash::aeshash) }) {
+            std::vector<std::uint64_t> hashes;
+            for (std::size_t n = 0; n <= 80; ++n) hashes.push_back(h(k, zeros, n));
+            std::sort(hashes.begin(), hashes.end());
+            DTL_CHECK(std::unique(hashes.begin(), hashes.end()) == hashes.end());
+        }
+        for (std::size_t bit = 0; bit < 8 * 64; ++bit) {
+            std::uint8_t m[64] = {};
+            auto before = hash::aeshash(k, m, 64);
+            m[bit / 8] ^= static_cast<std::uint8_t>(1 << (bit % 8));
+            auto changed = __builtin_popcountll(before ^ hash::aeshash(k, m, 64));
+            DTL_CHECK(changed >= 12 && changed <= 52);
+        }
+
+    }
+
+    // Keys chosen by inverting mix() so that std::hash followed by mix() leaves their low 16 bits zero: all of
+    // them land in one bucket of any table up to 2^16 buckets. Under the keyed hashes the attacker cannot invert,
+    // and the same keys spread like random ones.
+    void
+    check_collisions() {
+
+        constexpr std::size_t count = 1 << 16, buckets = 1 << 16;
+        std::vector<std::uint64_t> crafted;
+        for (std::uint64_t i = 0; i < count; ++i) crafted.push_back(unmix(i << 16));
+
+        auto fullest = [&](auto && h) {
+            std::vector<std::uint32_t> load(buckets);
+            std::uint32_t most = 0;
+            for (auto x : crafted) most = std::max(most, ++load[hash::mix(h(x)) & (buckets - 1)]);
+            return most;
+        };
+        DTL_CHECK(fullest(std::hash<std::uint64_t>{}) == count);
+        DTL_CHECK(fullest(hash::sip<std::uint64_t>{}) < 16);
+        DTL_CHECK((fullest(hash::sip<std::uint64_t, 2, 4>{}) < 16));
+        DTL_CHECK(fullest(hash::aes<std::uint64_t>{}) < 16);
+
+        // End to end: a table keyed with sip<> holds the crafted keys in short chains.
+        hashtable::table<std::uint64_t, std::uint64_t, hash::sip<std::uint64_t>> table;
+        for (std::size_t i = 0; i < 20000; ++i) table.insert(crafted[i], i);
+        for (std::size_t i = 0; i < 20000; ++i) DTL_CHECK(table.find(crafted[i]) == i);
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    check_vectors();
+    check_batches();
+    check_collisions();
+
+}
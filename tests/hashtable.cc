@@ -0,0 +1,154 @@
+#include <atomic>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "check.hh"
+#include "hashtable.hh"
+
+using namespace dtl;
+
+namespace {
+
+    // Random inserts, replacements and erasures against std::unordered_map, starting small enough that the
+    // table migrates several times along the way.
+    void
+    check_sequential() {
+
+        hashtable::table<std::uint64_t, std::uint64_t> t(16);
+        std::unordered_map<std::uint64_t, std::uint64_t> m;
+        const auto initial = t.buckets();
+
+        std::mt19937_64 rng(1);
+        for (std::uint64_t i = 0; i < 300000; ++i) {
+            auto k = rng() % 50000;
+            if (rng() % 3) {
+                DTL_CHECK(t.insert(k, i) == m.insert_or_assign(k, i).second);
+            } else {
+                DTL_CHECK(t.erase(k) == (m.erase(k) == 1));
+            }
+            if (i % 1000 == 0) {
+                auto q = rng() % 50000;
+                auto v = t.find(q);
+                auto at = m.find(q);
+                DTL_CHECK(v.has_value() == (at != m.end()));
+                DTL_CHECK(!v || *v == at->second);
+            }
+        }
+        for (auto & [k, v] : m) {
+            auto found = t.find(k);
+            DTL_CHECK(found && *found == v);
+        }
+        DTL_CHECK(t.buckets() > initial);
+        t.collect();
+
+    }
+
+    // Values whose copies fail on demand: every node made by insert() or by a migration copies one.
+    struct flaky {
+
+        inline static int countdown = -1;       // copies left before one throws; negative for never
+
+        std::uint64_t v;
+
+        explicit flaky(std::uint64_t v) : v(v) {}
+
+        flaky(
+            const flaky & other
+            ) : v(other.v) {
+
+            if (countdown >= 0 && countdown-- == 0) throw std::runtime_error("flaky copy");
+
+        }
+
+    }; // struct flaky
+
+    // A copy failing inside insert() or inside a migration leaves every bucket unlocked (a later write to it would
+    // spin forever otherwise) and no key duplicated or lost.
+    void
+    check_exception_safety() {
+
+        hashtable::table<std::uint64_t, flaky> t(16, 1);
+        std::unordered_map<std::uint64_t, std::uint64_t> m;
+        std::mt19937_64 rng(2);
+        int failures = 0;
+
+        for (std::uint64_t i = 0; i < 20000; ++i) {
+            auto k = rng() % 5000;
+            flaky::countdown = (rng() % 8 == 0) ? static_cast<int>(rng() % 6) : -1;
+            try {
+                if (t.insert(k, flaky(i))) m.emplace(k, i); else m[k] = i;
+            } catch (const std::runtime_error &) {
+                ++failures;
+                // The insert may have landed before a helping migration step threw.
+                flaky::countdown = -1;
+                auto found = t.find(k);
+                if (found && found->v == i) m[k] = i;
+            }
+        }
+        flaky::countdown = -1;
+        DTL_CHECK(failures > 0);
+
+        for (auto & [k, v] : m) {
+            auto found = t.find(k);
+            DTL_CHECK(found && found->v == v);
+        }
+        // Every bucket can still be locked: erase everything, then nothing is left.
+        for (std::uint64_t k = 0; k < 5000; ++k) DTL_CHECK(t.erase(k) == (m.count(k) == 1));
+        for (std::uint64_t k = 0; k < 5000; ++k) DTL_CHECK(!t.find(k));
+        t.collect();
+
+    }
+
+    // Writers churn odd keys through several migrations while readers look up even keys, which never change.
+    void
+    check_concurrent() {
+
+        hashtable::table<std::uint64_t, std::uint64_t> t(16);
+        for (std::uint64_t k = 0; k < 1000; ++k) t.insert(k * 2, k * 2);
+
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> writers, readers;
+        for (std::uint64_t w = 0; w < 3; ++w) {
+            writers.emplace_back([&, w] {
+                for (std::uint64_t k = 0; k < 100000; ++k) {
+                    auto x = (k * 3 + w) * 2 + 1;
+                    t.insert(x, x);
+                    if (k % 3 == 0) t.erase(x);
+                }
+            });
+        }
+        for (int r = 0; r < 2; ++r) {
+            readers.emplace_back([&, r] {
+                std::mt19937_64 rng(7 + r);
+                while (!stop.load(std::memory_order_relaxed)) {
+                    auto k = (rng() % 1000) * 2;
+                    auto v = t.find(k);
+                    DTL_CHECK(v && *v == k);
+                    auto odd = (rng() % 300000) * 2 + 1;
+                    auto w = t.find(odd);
+                    DTL_CHECK(!w || *w == odd);
+                    std::this_thread::yield();
+                }
+            });
+        }
+        for (auto & w : writers) w.join();
+        stop = true;
+        for (auto & r : readers) r.join();
+
+        DTL_CHECK(t.size() == 1000 + 3 * 100000 - 3 * 33334);
+        t.collect();
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    check_sequential();
+    check_exception_safety();
+    check_concurrent();
+
+}
@@ -0,0 +1,127 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "check.hh"
+#include "hazard.hh"
+
+using namespace dtl;
+
+namespace {
+
+    std::atomic<long> freed{0};
+
+    // Poisoned on destruction, so that a reader dereferencing freed memory sees a bad canary (freed memory that is
+    // reused keeps it bad as often as not, which over many reads is enough).
+    struct node {
+
+        constexpr static long alive = 0x5a5a5a5a;
+
+        long canary = alive;
+        long value;
+
+        explicit node(long value) : value(value) {}
+        ~node() { canary = 0; }
+
+    }; // struct node
+
+    void
+    destroy(
+        void * p
+        ) {
+
+        delete static_cast<node *>(p);
+        freed.fetch_add(1, std::memory_order_relaxed);
+
+    }
+
+    // A writer keeps replacing the current node while readers protect and dereference it: no reader ever sees a
+    // freed node or values going backwards, and every retired node is freed by the end.
+    void
+    check_concurrent() {
+
+        constexpr long count = 200000;
+        freed = 0;
+        {
+            hazard::domain<> d;
+            std::atomic<node *> current{new node(0)};
+            std::atomic<bool> stop{false};
+            std::vector<std::thread> readers;
+            for (int t = 0; t < 3; ++t) {
+                readers.emplace_back([&] {
+                    auto r = d.enroll();
+                    long last = 0;
+                    for (long n = 1; !stop.load(std::memory_order_relaxed); ++n) {
+                        auto * p = r.protect(0, current);
+                        DTL_CHECK(p->canary == node::alive && p->value >= last);
+                        last = p->value;
+                        r.clear(0);
+                        if (n % 256 == 0) std::this_thread::yield();
+                    }
+                });
+            }
+            {
+                auto w = d.enroll();
+                for (long i = 1; i <= count; ++i) {
+                    w.retire(current.exchange(new node(i)), destroy);
+                    DTL_CHECK(w.pending() < hazard::domain<>::minimum);      // scans keep the backlog bounded
+                    if (i % 512 == 0) std::this_thread::yield();
+                }
+                stop = true;
+                for (auto & r : readers) r.join();
+                w.flush();
+                DTL_CHECK(w.pending() == 0);
+            }
+            delete current.load();
+        }
+        DTL_CHECK(freed == count);
+
+    }
+
+    // A protected node survives a scan and is freed by the first scan after it is cleared; a record left with a
+    // backlog passes it to the next thread that enrolls.
+    void
+    check_protection() {
+
+        freed = 0;
+        hazard::domain<1> d;
+        std::atomic<node *> source{new node(1)};
+        auto reader = d.enroll();
+        auto * held = reader.protect(0, source);
+        DTL_CHECK(held == source.load());
+
+        {
+            auto writer = d.enroll();
+            source.store(nullptr);
+            writer.retire(held, destroy);
+            writer.flush();
+            DTL_CHECK(writer.pending() == 1 && freed == 0);
+            DTL_CHECK(held->canary == node::alive);
+        }
+
+        reader.clear(0);
+        auto next = d.enroll();                 // takes over the writer's record and its backlog
+        DTL_CHECK(next.pending() == 1);
+        next.flush();
+        DTL_CHECK(next.pending() == 0 && freed == 1);
+
+        // set() protects a pointer the caller validates itself.
+        auto * other = new node(2);
+        reader.set(0, other);
+        next.retire(other, destroy);
+        next.flush();
+        DTL_CHECK(freed == 1);
+        reader.clear();
+        next.flush();
+        DTL_CHECK(freed == 2);
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    check_concurrent();
+    check_protection();
+
+}
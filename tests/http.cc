@@ -0,0 +1,170 @@
+#include <sys/socket.h>
+#include <unistd.h>
+#include <random>
+#include <string>
+#include <thread>
+#include "check.hh"
+#include "http.hh"
+
+using namespace dtl;
+
+namespace {
+
+    // A browser request with a long cookie, so that targets and values cross several vectors.
+    const std::string browser =
+        "GET /wp-content/uploads/2010/03/hello-kitty-darth-vader-pink.jpg HTTP/1.1\r\n"
+        "Host: www.kittyhell.com\r\n"
+        "User-Agent: Mozilla/5.0 (Macintosh; U; Intel Mac OS X 10.6; ja-JP-mac; rv:1.9.2.3) Gecko/20100401 "
+        "Firefox/3.6.3 Pathtraq/0.9\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+        "Accept-Language: ja,en-us;q=0.7,en;q=0.3\r\n"
+        "Accept-Encoding: gzip,deflate\r\n"
+        "Accept-Charset: Shift_JIS,utf-8;q=0.7,*;q=0.7\r\n"
+        "Keep-Alive: 115\r\n"
+        "Connection: keep-alive\r\n"
+        "Cookie: wp_ozh_wsa_visits=2; wp_ozh_wsa_visit_lasttime=xxxxxxxxxx; "
+        "__utma=xxxxxxxxx.xxxxxxxxxx.xxxxxxxxxx.xxxxxxxxxx.xxxxxxxxxx.x; "
+        "__utmz=xxxxxxxxx.xxxxxxxxxx.x.x.utmccn=(referral)|utmcsr=reader.livedoor.com|utmcct=/reader/|utmcmd=referral\r\n"
+        "\r\n";
+
+    void
+    check_request() {
+
+        http::request r;
+        http::header h[64];
+        DTL_CHECK(http::parse_request(browser.data(), browser.size(), r, h, 64) == http::status::complete);
+        DTL_CHECK(r.method == "GET" && r.target.size() == 60 && r.minor_version == 1);
+        DTL_CHECK(r.headers == 9 && r.length == browser.size());
+        DTL_CHECK(h[0].name == "Host" && h[0].value == "www.kittyhell.com" && h[8].name == "Cookie");
+        DTL_CHECK(h[8].value.back() == 'l');
+
+        for (std::size_t n = 0; n < browser.size(); ++n) {
+            DTL_CHECK(http::parse_request(browser.data(), n, r, h, 64) == http::status::incomplete);
+        }
+        DTL_CHECK(http::parse_request(browser.data(), browser.size(), r, h, 8) == http::status::invalid);
+
+        // Bare LF, leading blank lines, whitespace around values and an empty value.
+        std::string lf = "\r\nPOST /x?y=1 HTTP/1.0\nA:  spaced \t\nB:\n\n";
+        DTL_CHECK(http::parse_request(lf.data(), lf.size(), r, h, 64) == http::status::complete);
+        DTL_CHECK(r.method == "POST" && r.target == "/x?y=1" && r.minor_version == 0);
+        DTL_CHECK(h[0].value == "spaced" && h[1].name == "B" && h[1].value.empty());
+
+        http::response response;
+        std::string reply = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+        DTL_CHECK(http::parse_response(reply.data(), reply.size(), response, h, 64) == http::status::complete);
+        DTL_CHECK(response.code == 404 && response.reason == "Not Found" && response.headers == 1);
+
+    }
+
+    void
+    check_invalid() {
+
+        http::request r;
+        http::header h[64];
+        auto invalid = [&](const std::string & s) {
+            return http::parse_request(s.data(), s.size(), r, h, 64) == http::status::invalid;
+        };
+        DTL_CHECK(invalid("GET / HTTP/1.1\r\nHo st: a\r\n\r\n"));
+        DTL_CHECK(invalid("GET  / HTTP/1.1\r\n\r\n"));
+        DTL_CHECK(invalid("GET / HTTP/2.0\r\n\r\n"));
+        DTL_CHECK(invalid("GET / HTTP/1.1\r\nA: b\x01" "c\r\n\r\n"));
+        DTL_CHECK(invalid("GET / HTTP/1.1\r\nA: b\r\n folded\r\n\r\n"));
+        DTL_CHECK(invalid("GET /\x7f HTTP/1.1\r\n\r\n"));
+        DTL_CHECK(invalid("GET / HTTP/1.1\r\n: empty\r\n\r\n"));
+
+        // Random corruption and truncation never read past the given length.
+        std::mt19937_64 rng(5);
+        for (int i = 0; i < 100000; ++i) {
+            auto b = browser;
+            for (int k = 0; k < 3; ++k) b[rng() % b.size()] = static_cast<char>(rng());
+            std::string cut(b.data(), rng() % (b.size() + 1));
+            if (http::parse_request(cut.data(), cut.size(), r, h, 64) != http::status::complete) continue;
+            DTL_CHECK(r.length <= cut.size() && r.headers <= 64);
+        }
+
+    }
+
+    // Pipelined requests, some with a body, written to a socket in random chunks: the reader hands out each head
+    // once, keeps the bytes after it, and the caller takes the body from rest() and, for the part not yet
+    // buffered, from the socket itself.
+    void
+    check_reader() {
+
+        int pair[2];
+        DTL_CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+        const std::string post = "POST /p HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello";
+        std::string all;
+        for (int i = 0; i < 50; ++i) all += (i % 2 ? browser : post);
+
+        std::thread writer([&] {
+            std::mt19937 rng(1);
+            for (std::size_t at = 0; at < all.size();) {
+                auto n = std::min<std::size_t>(1 + rng() % 700, all.size() - at);
+                DTL_CHECK(::write(pair[1], all.data() + at, n) == static_cast<ssize_t>(n));
+                at += n;
+            }
+            ::close(pair[1]);
+        });
+
+        raii::fd in(pair[0]);
+        http::reader<> reader;
+        int requests = 0;
+        for (;;) {
+            auto s = reader.read(in);
+            if (s == http::status::closed) break;
+            DTL_CHECK(s != http::status::invalid);
+            if (s != http::status::complete) continue;
+            ++requests;
+            if (reader.request().method == "POST") {
+                auto * length = reader.find("content-length");
+                DTL_CHECK(length && length->value == "5");
+                std::string body(reader.rest().substr(0, 5));
+                auto buffered = body.size();
+                while (body.size() < 5) {
+                    char more[5];
+                    auto n = ::read(in, more, 5 - body.size());
+                    DTL_CHECK(n > 0);
+                    body.append(more, static_cast<std::size_t>(n));
+                }
+                DTL_CHECK(body == "hello");
+                reader.consume(buffered);
+            } else {
+                DTL_CHECK(reader.find("HOST") && reader.find("cookie"));
+                reader.consume();
+            }
+        }
+        writer.join();
+        DTL_CHECK(requests == 50);
+
+    }
+
+    // Header names compare with only A-Z folded: '^' and '~' differ by the case bit but are distinct tokens.
+    void
+    check_find() {
+
+        int pair[2];
+        DTL_CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+        const std::string head = "GET / HTTP/1.1\r\nx~y: 1\r\nX-Up: 2\r\nz^: 3\r\n\r\n";
+        DTL_CHECK(::write(pair[1], head.data(), head.size()) == static_cast<ssize_t>(head.size()));
+        ::close(pair[1]);
+
+        raii::fd in(pair[0]);
+        http::reader<> reader;
+        DTL_CHECK(reader.read(in) == http::status::complete);
+        DTL_CHECK(!reader.find("x^y") && !reader.find("z~"));
+        DTL_CHECK(reader.find("X~Y") && reader.find("X~Y")->value == "1");
+        DTL_CHECK(reader.find("x-up") && reader.find("x-up")->value == "2" && reader.find("Z^")->value == "3");
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    check_request();
+    check_invalid();
+    check_reader();
+    check_find();
+
+}
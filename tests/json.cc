@@ -0,0 +1,149 @@
+#include <unistd.h>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "check.hh"
+#include "json.hh"
+
+using namespace dtl;
+
+namespace {
+
+    bool
+    rejected(
+        std::string_view text
+        ) {
+
+        try {
+            json::document::parse(text);
+            return false;
+        } catch (const std::system_error &) {
+            return true;
+        }
+
+    }
+
+    void
+    check_grammar() {
+
+        for (auto text : { "", " ", "[", "]", "{", "[1,]", "[,1]", "{\"a\"}", "{\"a\":}", "{\"a\":1,}", "{1:2}", "[1 2]",
+                           "\"abc", "tru", "truex", "[nul]", "[1]x", "{\"a\":1}}", "[\"a\"\"b\"]", "@", "[\"\\\"]" }) {
+            DTL_CHECK(rejected(text));
+        }
+        for (auto text : { "1", "\"x\"", "[]", "{}", " [ 1 , { \"a\" : [ ] } ] ", "null", "-0.5e+3", "[\"\\\\\"]",
+                           "{\"a\\\\\":\"b\\\"\"}" }) {
+            DTL_CHECK(!rejected(text));
+        }
+
+    }
+
+    // A string glued to the scalar before or after it is two values without a separator, wherever the block
+    // boundaries fall.
+    void
+    check_adjacent() {
+
+        for (auto text : { "[1\"abc\"]", "[\"abc\"1]", "[true\"x\"]", "{\"a\":1\"b\":2}", "{\"a\":null\"b\"}", "1\"a\"",
+                           "[\"a\"null]", "[-2\"\"]" }) {
+            DTL_CHECK(rejected(text));
+        }
+        for (std::size_t pad = 0; pad < 140; ++pad) {
+            std::string text = "[" + std::string(pad, ' ') + "123\"abc\"]";
+            DTL_CHECK(rejected(text));
+            text = "[" + std::string(pad, ' ') + "\"abc\"123]";
+            DTL_CHECK(rejected(text));
+            text = "[" + std::string(pad, ' ') + "123,\"abc\"]";
+            DTL_CHECK(!rejected(text));
+        }
+
+    }
+
+    void
+    check_values() {
+
+        auto d = json::document::parse(
+            "{\"k\\u00e9y\": {\"n\": [10, 2.5, -3, \"s\\ud83d\\ude00\", 012, 1x]}, \"b\": false, \"z\": null}");
+        auto root = d.root();
+        auto n = root["k\xc3\xa9y"]["n"];
+        DTL_CHECK(n.type() == json::kind::array && n.size() == 6);
+        DTL_CHECK(n[std::size_t(0)].get_int64() == 10 && *n[1].get_double() == 2.5 && *n[2].get_int64() == -3);
+        DTL_CHECK(!n[2].get_uint64());
+        DTL_CHECK(*n[3].get_string() == "s\xf0\x9f\x98\x80" && *n[3].get_raw_string() == "s\\ud83d\\ude00");
+        DTL_CHECK(!n[4].get_int64() && !n[5].get_int64());     // malformed numbers fail when read
+        DTL_CHECK(!n[6] && !n[3].get_int64());
+        DTL_CHECK(root["b"].get_bool() == false && root["z"].is_null() && root.size() == 3);
+        DTL_CHECK(!root["missing"] && !root["b"]["q"]);
+
+        std::vector<std::string> keys;
+        root.for_each_member([&](std::string_view key, json::value) { keys.emplace_back(key); });
+        DTL_CHECK(keys.size() == 3 && keys[0] == "k\\u00e9y" && keys[2] == "z");
+
+    }
+
+    // Runs of backslashes before a quote, at every offset around block boundaries.
+    void
+    check_escapes() {
+
+        for (std::size_t pad = 0; pad < 130; ++pad) {
+            for (std::size_t backslashes = 0; backslashes < 6; ++backslashes) {
+                auto text = "[\"" + std::string(pad, 'a') + std::string(backslashes, '\\')
+                          + (backslashes % 2 ? "\"\"]" : "\"]");
+                auto d = json::document::parse(text);
+                auto s = d.root()[std::size_t(0)].get_string();
+                DTL_CHECK(s && s->size() == pad + backslashes / 2 + backslashes % 2);
+            }
+        }
+
+    }
+
+    // A generated document of nested records, parsed from memory and loaded from a file, walked in full.
+    void
+    check_document() {
+
+        std::mt19937_64 rng(4);
+        std::string text = "[";
+        std::int64_t sum = 0;
+        std::size_t strings = 0;
+        for (int i = 0; i < 20000; ++i) {
+            auto v = static_cast<std::int64_t>(rng() % 2000000) - 1000000;
+            sum += v;
+            if (i) text += ",";
+            text += "{\"id\":" + std::to_string(v) + ",\"name\":\"n\\\"" + std::to_string(i) + "\",\"tags\":[\"x\",\"y\"],"
+                    "\"ok\":true,\"w\":0.25,\"none\":null}";
+            strings += 3;
+        }
+        text += "]";
+
+        char path[] = "/tmp/dtl-json-test-XXXXXX";
+        int handle = ::mkstemp(path);
+        DTL_CHECK(handle != -1 && ::write(handle, text.data(), text.size()) == static_cast<ssize_t>(text.size()));
+        ::close(handle);
+
+        for (int round = 0; round < 2; ++round) {
+            auto d = round ? json::document::load(path) : json::document::parse(text);
+            std::int64_t seen = 0;
+            std::size_t found = 0;
+            d.root().for_each([&](json::value record) {
+                seen += *record["id"].get_int64();
+                found += record["name"].get_string().has_value();
+                record["tags"].for_each([&](json::value tag) { found += tag.get_string()->size() == 1; });
+                DTL_CHECK(*record["ok"].get_bool() && *record["w"].get_double() == 0.25 && record["none"].is_null());
+            });
+            DTL_CHECK(seen == sum && found == strings && d.root().size() == 20000);
+        }
+        ::unlink(path);
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    check_grammar();
+    check_adjacent();
+    check_values();
+    check_escapes();
+    check_document();
+
+}
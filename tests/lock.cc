@@ -0,0 +1,153 @@
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include "check.hh"
+#include "lock.hh"
+
+using namespace dtl;
+
+namespace {
+
+    constexpr int threads = 6;
+    constexpr int rounds = 20000;
+
+    // Runs body(t, i) for `rounds` iterations on each of `threads` threads, yielding now and then so that holders
+    // are preempted inside their critical sections too.
+    template<typename Body>
+    void
+    hammer(
+        Body && body
+        ) {
+
+        std::vector<std::thread> running;
+        for (int t = 0; t < threads; ++t) {
+            running.emplace_back([&, t] {
+                for (int i = 0; i < rounds; ++i) {
+                    body(t, i);
+                    if (i % 64 == 0) std::this_thread::yield();
+                }
+            });
+        }
+        for (auto & r : running) r.join();
+
+    }
+
+    // Mutual exclusion: a plain (non-atomic) counter updated under the lock loses no increment.
+    void
+    check_ticket() {
+
+        lock::ticket l;
+        long counter = 0;
+        hammer([&](int, int) {
+            std::lock_guard<lock::ticket> g(l);
+            ++counter;
+        });
+        DTL_CHECK(counter == long(threads) * rounds);
+
+        DTL_CHECK(l.try_lock());
+        DTL_CHECK(!l.try_lock());
+        l.unlock();
+        DTL_CHECK(l.try_lock());
+        l.unlock();
+
+    }
+
+    void
+    check_mcs() {
+
+        lock::mcs l;
+        long counter = 0;
+        hammer([&](int, int) {
+            lock::mcs::guard g(l);
+            ++counter;
+        });
+        DTL_CHECK(counter == long(threads) * rounds);
+
+        lock::mcs::node a, b;
+        DTL_CHECK(l.try_lock(a));
+        DTL_CHECK(!l.try_lock(b));
+        l.unlock(a);
+        DTL_CHECK(l.try_lock(b));
+        l.unlock(b);
+
+    }
+
+    // Readers never see a writer's half-done update, whether they come in through the bias or through the
+    // underlying lock after a revocation; writers exclude one another.
+    void
+    check_rwlock() {
+
+        lock::rwlock l;
+        long a = 0, b = 0;
+        std::atomic<long> torn{0}, writes{0};
+        hammer([&](int t, int i) {
+            if (i % 50 == t) {
+                std::lock_guard<lock::rwlock> g(l);
+                ++a;
+                std::this_thread::yield();
+                ++b;
+                writes.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                std::shared_lock<lock::rwlock> g(l);
+                if (a != b) torn.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+        DTL_CHECK(torn == 0);
+        DTL_CHECK(a == b && a == writes);
+
+        DTL_CHECK(l.try_lock());
+        DTL_CHECK(!l.try_lock_shared());
+        l.unlock();
+        DTL_CHECK(l.try_lock_shared());
+        DTL_CHECK(l.try_lock_shared());
+        DTL_CHECK(!l.try_lock());
+        l.unlock_shared();
+        DTL_CHECK(!l.try_lock());
+        l.unlock_shared();
+        DTL_CHECK(l.try_lock());
+        l.unlock();
+
+    }
+
+    // More reading threads than indicator slots: threads sharing a slot still count their holds correctly, so a
+    // writer waits for all of them.
+    void
+    check_shared_slots() {
+
+        lock::rwlock l;
+        std::atomic<int> inside{0};
+        std::atomic<bool> stop{false}, overlap{false};
+        std::vector<std::thread> readers;
+        for (unsigned t = 0; t < 2 * std::thread::hardware_concurrency() + 3; ++t) {
+            readers.emplace_back([&] {
+                while (!stop.load(std::memory_order_relaxed)) {
+                    std::shared_lock<lock::rwlock> g(l);
+                    inside.fetch_add(1);
+                    std::this_thread::yield();
+                    inside.fetch_sub(1);
+                }
+            });
+        }
+        for (int i = 0; i < 2000; ++i) {
+            std::lock_guard<lock::rwlock> g(l);
+            if (inside.load()) overlap = true;
+        }
+        stop = true;
+        for (auto & r : readers) r.join();
+        DTL_CHECK(!overlap);
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    check_ticket();
+    check_mcs();
+    check_rwlock();
+    check_shared_slots();
+
+}
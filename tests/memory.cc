@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "memory.hh"
+#include "check.hh"
+
+using namespace dtl;
+
+namespace {
+
+    constexpr std::uint8_t canary = 0xAA;
+
+    // Every size up to a few hundred bytes, then random sizes up to past the 64 KiB mark, each at random source
+    // and destination misalignments; the bytes either side of the destination must be untouched.
+    void
+    check_routines() {
+
+        std::mt19937 rng(2);
+        std::vector<std::uint8_t> a(70000), b(70000), c(70000);
+        for (auto & x : a) x = static_cast<std::uint8_t>(rng());
+
+        for (int round = 0; round < 6000; ++round) {
+            std::size_t n = round < 1000 ? round % 300 : rng() % 66000;
+            std::size_t from = rng() % 64, to = rng() % 64;
+            auto untouched = [&] { return (!to || b[to - 1] == canary) && b[to + n] == canary; };
+
+            std::fill(b.begin(), b.end(), canary);
+            memory::copy(&b[to], &a[from], n);
+            DTL_CHECK(!std::memcmp(&b[to], &a[from], n));
+            DTL_CHECK(untouched());
+
+            std::fill(b.begin(), b.end(), canary);
+            memory::stream(&b[to], &a[from], n);
+            DTL_CHECK(!std::memcmp(&b[to], &a[from], n));
+            DTL_CHECK(untouched());
+
+            std::fill(b.begin(), b.end(), canary);
+            memory::zero(&b[to], n);
+            DTL_CHECK(std::all_of(&b[to], &b[to] + n, [](std::uint8_t x) { return !x; }));
+            DTL_CHECK(untouched());
+
+            std::memcpy(&c[to], &a[from], n);
+            bool flipped = n && rng() % 2;
+            if (flipped) c[to + rng() % n] ^= static_cast<std::uint8_t>(1u << (rng() % 8));
+            DTL_CHECK(memory::equal(&a[from], &c[to], n) == !flipped);
+
+            auto expected = std::memcmp(&a[from], &c[to], n), got = memory::compare(&a[from], &c[to], n);
+            DTL_CHECK((expected < 0) == (got < 0) && (expected > 0) == (got > 0));
+        }
+
+    }
+
+    void
+    check_region() {
+
+        std::vector<std::uint8_t> source(8192, 0x5A);
+        raii::mmap region(16384);
+        memory::stream(region, 4096, source.data(), source.size());
+        DTL_CHECK(!std::memcmp(static_cast<std::uint8_t *>(region.get()) + 4096, source.data(), source.size()));
+        DTL_CHECK_THROWS(memory::stream(region, 12288, source.data(), source.size()));
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    // Every dispatch tier the host supports, from the top down.
+    for (auto t = static_cast<int>(cpu::host().tier()); t >= 0; --t) {
+        cpu::force(static_cast<cpu::tier>(t));
+        check_routines();
+    }
+    cpu::force(cpu::host().tier());
+    check_region();
+
+}
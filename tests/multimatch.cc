@@ -0,0 +1,148 @@
+#include <unistd.h>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <string>
+#include "multimatch.hh"
+#include "check.hh"
+
+using namespace dtl;
+
+namespace {
+
+    using matches = std::set<std::pair<std::uint32_t, std::uint64_t>>;
+
+    // Per process: the vector and scalar builds of this test may run at once.
+    const std::string path = "/tmp/dtl-multimatch-test-" + std::to_string(::getpid());
+
+    std::vector<char>
+    read(
+        const char * file
+        ) {
+
+        std::ifstream in(file, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(in), {});
+
+    }
+
+    void
+    write(
+        const char * file,
+        const std::vector<char> & bytes
+        ) {
+
+        std::ofstream(file, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+
+    }
+
+    // Random pattern sets over small and large alphabets (the latter exercise the Teddy prefilter and the
+    // catch-all byte class), against a naive search, in block mode and streamed in random segments after a save
+    // and load round trip.
+    void
+    check_matches() {
+
+        std::mt19937 rng(1);
+        for (int round = 0; round < 300; ++round) {
+            int alphabet = 2 + rng() % (round % 3 == 0 ? 254 : 4);
+            int count = 1 + rng() % (round % 2 ? 5 : 200);
+            auto letter = [&] { return static_cast<char>('a' + rng() % alphabet); };
+
+            std::vector<std::string> patterns;
+            for (int i = 0; i < count; ++i) {
+                std::string p;
+                for (int n = 1 + rng() % 6; n; --n) p += letter();
+                patterns.push_back(p);
+            }
+            std::string text;
+            for (int n = rng() % 2000; n; --n) text += letter();
+
+            matches expected, block, streamed;
+            for (std::uint32_t id = 0; id < patterns.size(); ++id) {
+                auto & p = patterns[id];
+                for (std::size_t at = 0; at + p.size() <= text.size(); ++at) {
+                    if (!text.compare(at, p.size(), p)) expected.insert({ id, at + p.size() });
+                }
+            }
+
+            auto db = multimatch::database::compile(std::vector<std::string_view>(patterns.begin(), patterns.end()));
+            db.scan(text.data(), text.size(), [&](std::uint32_t id, std::uint64_t end) {
+                block.insert({ id, end });
+                return true;
+            });
+            DTL_CHECK(block == expected);
+
+            db.save(path.c_str());
+            auto loaded = multimatch::database::load(path.c_str());
+            DTL_CHECK(loaded.patterns() == patterns.size());
+            multimatch::stream s;
+            for (std::size_t at = 0; at < text.size(); ) {
+                auto n = std::min<std::size_t>(rng() % 50, text.size() - at);
+                loaded.scan(s, text.data() + at, n, [&](std::uint32_t id, std::uint64_t end) {
+                    streamed.insert({ id, end });
+                    return true;
+                });
+                at += n;
+            }
+            DTL_CHECK(streamed == expected);
+        }
+
+    }
+
+    // Damaged images must be rejected by load() rather than read out of bounds by scan().
+    void
+    check_validation() {
+
+        auto db = multimatch::database::compile({ "he", "she", "his", "hers" });
+        db.save(path.c_str());
+        const auto image = read(path.c_str());
+        DTL_CHECK(multimatch::database::load(path.c_str()));
+
+        multimatch::header h;
+        std::memcpy(&h, image.data(), sizeof(h));
+        const auto cells = std::size_t(h.states) * h.classes;
+        const auto transitions = sizeof(h), accept = transitions + 4 * cells, outputs = accept + 4 * (h.states + 1);
+
+        auto rejected = [&](std::size_t offset, std::uint32_t value) {
+            auto bytes = image;
+            std::memcpy(&bytes[offset], &value, sizeof(value));
+            write(path.c_str(), bytes);
+            DTL_CHECK_THROWS(multimatch::database::load(path.c_str()));
+        };
+
+        rejected(offsetof(multimatch::header, magic), 0);
+        rejected(offsetof(multimatch::header, states), h.states + 1);
+        rejected(transitions + 4 * 5, static_cast<std::uint32_t>(cells * 2));                  // past the table
+        rejected(transitions + 4 * 5, h.classes + 1);                                          // not a state start
+        rejected(transitions + 4 * 5, static_cast<std::uint32_t>(cells) | 0x80000000u);
+        rejected(accept, 1);
+        rejected(accept + 4 * h.states, h.outputs + 1);
+        rejected(accept + 4, h.outputs + 1);                                                   // not monotonic
+        rejected(outputs, h.patterns);
+
+        auto bytes = image;
+        bytes[offsetof(multimatch::header, classmap) + 'e'] = static_cast<char>(h.classes);
+        write(path.c_str(), bytes);
+        DTL_CHECK_THROWS(multimatch::database::load(path.c_str()));
+
+        bytes = image;
+        bytes.pop_back();
+        write(path.c_str(), bytes);
+        DTL_CHECK_THROWS(multimatch::database::load(path.c_str()));
+
+        write(path.c_str(), image);
+        DTL_CHECK(multimatch::database::load(path.c_str()));
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    check_matches();
+    check_validation();
+    ::unlink(path.c_str());
+
+}
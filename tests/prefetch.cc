@@ -0,0 +1,65 @@
+#include <vector>
+#include "prefetch.hh"
+#include "check.hh"
+
+using namespace dtl;
+
+namespace {
+
+    struct table {
+
+        std::vector<int> values;
+
+        void prefetch(int key) const { prefetch::read(&values[key]); }
+        int find(int key) const { return values[key]; }
+
+    };
+
+} // namespace
+
+int
+main() {
+
+    // group() runs each stage over the whole burst before the next.
+    std::vector<int> log;
+    prefetch::group(3, [&](std::size_t i) { log.push_back(i); }, [&](std::size_t i) { log.push_back(10 + i); });
+    DTL_CHECK((log == std::vector<int>{ 0, 1, 2, 10, 11, 12 }));
+
+    // pipeline<2>() runs stage k of key t - 2k at step t, later stages first.
+    log.clear();
+    prefetch::pipeline<2>(5,
+        [&](std::size_t i) { log.push_back(i); },
+        [&](std::size_t i) { log.push_back(100 + i); },
+        [&](std::size_t i) { log.push_back(200 + i); });
+    DTL_CHECK((log == std::vector<int>{ 0, 1, 100, 2, 101, 3, 200, 102, 4, 201, 103, 202, 104, 203, 204 }));
+
+    // amac() over chains of different lengths: node i links to i - 1 unless i is a multiple of 7.
+    std::vector<int> next(1000), steps(100, -1);
+    for (int i = 0; i < 1000; ++i) next[i] = (i % 7) ? i - 1 : -1;
+    struct walk { int key, at, steps; };
+    prefetch::amac<8, walk>(100,
+        [&](walk & w, std::size_t i) {
+            w = walk{ int(i), int(i) * 10, 0 };
+            prefetch::read(&next[w.at]);
+        },
+        [&](walk & w) {
+            if (next[w.at] < 0) {
+                steps[w.key] = w.steps;
+                return true;
+            }
+            w.at = next[w.at];
+            ++w.steps;
+            prefetch::read(&next[w.at]);
+            return false;
+        });
+    for (int i = 0; i < 100; ++i) DTL_CHECK(steps[i] == (i * 10) % 7);
+
+    // lookup() across several bursts and a partial one.
+    table t{ std::vector<int>(100) };
+    for (int i = 0; i < 100; ++i) t.values[i] = i * i;
+    std::vector<int> keys, results(37);
+    for (int i = 0; i < 37; ++i) keys.push_back((i * 31) % 100);
+    prefetch::lookup<16>(t, keys.data(), keys.size(), results.data());
+    for (int i = 0; i < 37; ++i) DTL_CHECK(results[i] == keys[i] * keys[i]);
+
+}
@@ -0,0 +1,181 @@
+#include <cmath>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "check.hh"
+#include "random.hh"
+
+using namespace dtl;
+
+namespace {
+
+    bool
+    near(
+        double seen,
+        double expected,
+        double tolerance
+        ) {
+
+        return std::fabs(seen / expected - 1) < tolerance;
+
+    }
+
+    // splitmix64 from zero and the first xoshiro256++ outputs of that state, both from the reference C code;
+    // O'Neill's pcg32 demo sequence for seed 42, stream 54.
+    void
+    check_sequences() {
+
+        random::xoshiro256pp x(0);
+        DTL_CHECK(x.state()[0] == 0xe220a8397b1dcdafull && x.state()[1] == 0x6e789e6aa1b965f4ull);
+        DTL_CHECK(x.state()[2] == 0x06c45d188009454full && x.state()[3] == 0xf88bb8a8724c81ecull);
+        DTL_CHECK(x() == 0x53175d61490b23dfull && x() == 0x61da6f3dc380d507ull && x() == 0x5c0fdf91ec9a7bfcull);
+
+        random::pcg32 p(42, 54);
+        for (std::uint32_t expected : { 0xa15c02b7u, 0x7b47f409u, 0xba1d3330u, 0x83d2f293u, 0xbfa4784bu, 0xcbed606eu }) {
+            DTL_CHECK(p() == expected);
+        }
+        random::pcg32 other(42, 55);
+        DTL_CHECK(other() != 0xa15c02b7u);
+
+        // jump() is linear in the state, as is a step, so the two commute.
+        random::xoshiro256pp a(5), b(5);
+        a.jump();
+        a();
+        b();
+        b.jump();
+        DTL_CHECK(a() == b());
+
+        // streams: lane i draws what the i-th jump of a scalar generator draws, fill() included.
+        random::streams<> s(7);
+        random::xoshiro256pp g(7);
+        constexpr auto W = random::streams<>::width;
+        std::vector<random::xoshiro256pp> lanes;
+        for (std::size_t i = 0; i < W; ++i, g.jump()) lanes.push_back(g);
+        for (int round = 0; round < 50; ++round) {
+            std::uint64_t out[W];
+            s.next().store(out);
+            for (std::size_t i = 0; i < W; ++i) DTL_CHECK(out[i] == lanes[i]());
+        }
+        std::vector<std::uint64_t> filled(2 * W + 1, 0);
+        s.fill(filled.data(), filled.size());
+        for (std::size_t i = 0; i < filled.size(); ++i) DTL_CHECK(filled[i] == lanes[i % W]());
+
+        // Usable with <random> distributions.
+        random::wyrand w(1);
+        std::uniform_int_distribution<int> dice(1, 6);
+        for (int i = 0; i < 1000; ++i) {
+            auto d = dice(w);
+            DTL_CHECK(d >= 1 && d <= 6);
+        }
+
+    }
+
+    // bounded(): in range for every generator width, and without the bias of a modulo: for a range of 2/3 of
+    // 2^32 (or 2^64), x % range puts half again as many draws in the lower half as in the upper.
+    void
+    check_bounded() {
+
+        random::wyrand g(3);
+        constexpr long draws = 1 << 21;
+        constexpr int range = 7;
+        std::vector<long> counts(range);
+        for (long i = 0; i < draws; ++i) ++counts[random::bounded(g, range)];
+        double chi = 0;
+        for (auto c : counts) chi += (c - draws / double(range)) * (c - draws / double(range)) / (draws / double(range));
+        DTL_CHECK(chi < 25);        // chi-square with 6 degrees of freedom, p < 0.001
+
+        const std::uint32_t r32 = 0xaaaaaaaau;
+        const std::uint64_t r64 = 0xaaaaaaaaaaaaaaaaull;
+        long low32 = 0, low64 = 0;
+        for (long i = 0; i < draws; ++i) {
+            low32 += random::bounded(g, r32) < r32 / 2;
+            low64 += random::bounded(g, r64) < r64 / 2;
+        }
+        DTL_CHECK(near(low32, draws / 2.0, 0.004) && near(low64, draws / 2.0, 0.004));
+
+        random::pcg32 p(1);
+        for (int i = 0; i < 10000; ++i) {
+            DTL_CHECK(random::bounded(p, 10) < 10 && random::bounded(p, std::uint64_t(1) << 40) < (std::uint64_t(1) << 40));
+            DTL_CHECK(random::bounded(g, 1) == 0 && random::bounded(p, std::uint8_t(3)) < 3);
+        }
+
+    }
+
+    // bernoulli: the sampled rate per draw, per scalar burst and per vector burst, and the edges of p.
+    void
+    check_bernoulli() {
+
+        random::xoshiro256pp g(9);
+        random::streams<> s(9);
+        constexpr long draws = 1 << 21;
+        for (std::uint64_t n : { 1, 2, 10, 100, 1000 }) {
+            auto b = random::bernoulli::one_in(n);
+            long single = 0, burst = 0, lanes = 0;
+            for (long i = 0; i < draws; ++i) single += b(g);
+            for (long i = 0; i < draws; i += 64) {
+                burst += __builtin_popcountll(b.burst(g, 64));
+                lanes += __builtin_popcountll(b.burst(s, 64));
+            }
+            auto expected = double(draws) / n;
+            DTL_CHECK(near(single, expected, 0.1) && near(burst, expected, 0.1) && near(lanes, expected, 0.1));
+        }
+        long quarter = 0;
+        for (long i = 0; i < draws; i += 64) quarter += __builtin_popcountll(random::bernoulli(0.25).burst(s, 64));
+        DTL_CHECK(near(quarter, draws / 4.0, 0.01));
+
+        DTL_CHECK(random::bernoulli(0.0).burst(g, 64) == 0 && random::bernoulli(-1.0).burst(s, 64) == 0);
+        DTL_CHECK(random::bernoulli(1.0).burst(g, 64) == ~0ull && random::bernoulli(2.0).burst(s, 64) == ~0ull);
+        DTL_CHECK(random::bernoulli(1.0).burst(s, 13) == (1ull << 13) - 1 && random::bernoulli(1.0).burst(g, 5) == 31);
+        for (std::size_t count = 0; count <= 64; ++count) {
+            auto tail = count == 64 ? 0 : ~0ull << count;
+            DTL_CHECK(!(random::bernoulli(0.5).burst(s, count) & tail) && !(random::bernoulli(0.5).burst(g, count) & tail));
+        }
+
+    }
+
+    // flows: the same key always gets the same answer, bursts agree with single keys, and the flows sampled at 1%
+    // are a subset of those sampled at 10%.
+    void
+    check_flows() {
+
+        const hash::key k{ 1, 2 };
+        random::flows low(0.01, k), high(0.1, k), other(0.1, { 3, 4 });
+        std::vector<std::uint64_t> keys(64);
+        std::vector<const void *> pointers(64);
+        long sampled_low = 0, sampled_high = 0, differ = 0;
+        constexpr std::uint64_t count = 1 << 18;
+        for (std::uint64_t base = 0; base < count; base += 64) {
+            for (std::size_t j = 0; j < 64; ++j) {
+                keys[j] = base + j;
+                pointers[j] = &keys[j];
+            }
+            auto a = low.burst(pointers.data(), 8, 64), b = high.burst(pointers.data(), 8, 64);
+            DTL_CHECK(!(a & ~b));
+            for (std::size_t j = 0; j < 64; ++j) {
+                DTL_CHECK(bool(a >> j & 1) == low(keys[j]) && bool(b >> j & 1) == high(keys[j]));
+                differ += high(keys[j]) != other(keys[j]);
+            }
+            sampled_low += __builtin_popcountll(a);
+            sampled_high += __builtin_popcountll(b);
+        }
+        DTL_CHECK(near(sampled_low, count / 100.0, 0.1) && near(sampled_high, count / 10.0, 0.05));
+        DTL_CHECK(differ > long(count / 10));        // another key samples other flows
+
+        random::flows half(0.5, k);
+        DTL_CHECK(half(std::string_view("abc")) == half(std::string("abc")));
+        DTL_CHECK(low.burst(pointers.data(), 8, 0) == 0 && (high.burst(pointers.data(), 8, 7) >> 7) == 0);
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    check_sequences();
+    check_bounded();
+    check_bernoulli();
+    check_flows();
+
+}
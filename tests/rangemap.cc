@@ -0,0 +1,116 @@
+#include <cstdint>
+#include <random>
+#include <system_error>
+#include <vector>
+#include <unistd.h>
+#include "check.hh"
+#include "rangemap.hh"
+
+using namespace dtl;
+
+namespace {
+
+    template<typename Map>
+    int
+    value_at(
+        const Map & m,
+        std::uint16_t key
+        ) {
+
+        auto found = m.find(key);
+        return found ? *found : -1;
+
+    }
+
+    // Random overlapping ranges over the whole 16-bit key space, checked key by key against a flat model: the
+    // compiled map (last range wins), the dynamic map under assign/erase, batched lookups, freezing the dynamic
+    // map and a save/load round trip.
+    void
+    check_random() {
+
+        char path[] = "/tmp/dtl-rangemap-XXXXXX";
+        int handle = ::mkstemp(path);
+        DTL_CHECK(handle != -1);
+        ::close(handle);
+
+        std::vector<std::uint16_t> keys(65536);
+        for (std::uint32_t k = 0; k < 65536; ++k) keys[k] = static_cast<std::uint16_t>(k);
+        std::vector<const int *> found(65536), dynamic_found(65536);
+
+        std::mt19937 rng(2);
+        for (int round = 0; round < 100; ++round) {
+            std::vector<rangemap::range<std::uint16_t, int>> ranges;
+            std::vector<int> model(65536, -1), dynamic_model(65536, -1);
+            rangemap::dynamic<std::uint16_t, int> d;
+
+            for (auto n = rng() % 50; n; --n) {
+                auto low = static_cast<std::uint16_t>(rng()), high = static_cast<std::uint16_t>(rng());
+                if (rng() % 4 == 0) high = static_cast<std::uint16_t>(low + rng() % 10);
+                if (rng() % 10 == 0) high = 65535;
+                if (low > high && rng() % 2) std::swap(low, high);     // leave some ranges empty
+                int value = static_cast<int>(rng() % 5);
+                ranges.push_back({ low, high, value });
+                for (std::uint32_t k = low; k <= high; ++k) model[k] = value;
+
+                if (rng() % 3 == 0) {
+                    if (low <= high) {
+                        d.erase(low, high);
+                        for (std::uint32_t k = low; k <= high; ++k) dynamic_model[k] = -1;
+                    }
+                } else {
+                    d.assign(low, high, value);
+                    for (std::uint32_t k = low; k <= high; ++k) dynamic_model[k] = value;
+                }
+            }
+
+            auto m = rangemap::map<std::uint16_t, int>::compile(ranges);
+            m.find(keys.data(), keys.size(), found.data());
+            d.find(keys.data(), keys.size(), dynamic_found.data());
+            for (std::uint32_t k = 0; k < 65536; ++k) {
+                auto key = static_cast<std::uint16_t>(k);
+                DTL_CHECK(value_at(m, key) == model[k]);
+                DTL_CHECK(found[k] == m.find(key));
+                DTL_CHECK(value_at(d, key) == dynamic_model[k]);
+                DTL_CHECK(dynamic_found[k] == d.find(key));
+            }
+
+            // Adjacent equal segments are merged the same way in both maps.
+            auto frozen = rangemap::map<std::uint16_t, int>::compile(d);
+            DTL_CHECK(frozen.segments() == d.segments());
+            for (std::uint32_t k = 0; k < 65536; k += 7) DTL_CHECK(value_at(frozen, std::uint16_t(k)) == dynamic_model[k]);
+
+            m.save(path);
+            auto loaded = rangemap::map<std::uint16_t, int>::load(path);
+            DTL_CHECK(loaded.size_bytes() == m.size_bytes());
+            for (std::uint32_t k = 0; k < 65536; k += 3) DTL_CHECK(value_at(loaded, std::uint16_t(k)) == model[k]);
+        }
+
+        // An image saved for other key or value types is refused.
+        DTL_CHECK_THROWS((rangemap::map<std::uint32_t, int>::load(path)));
+        DTL_CHECK_THROWS((rangemap::map<std::uint16_t, long>::load(path)));
+        ::unlink(path);
+
+    }
+
+    void
+    check_wide_keys() {
+
+        using key = unsigned __int128;
+        auto m = rangemap::map<key, std::uint64_t>::compile({ { 1, 5, 9 }, { key(1) << 100, ~key(0), 7 } });
+        DTL_CHECK(!m.find(0));
+        DTL_CHECK(*m.find(3) == 9);
+        DTL_CHECK(!m.find(6));
+        DTL_CHECK(*m.find(key(1) << 101) == 7);
+        DTL_CHECK(*m.find(~key(0)) == 7);
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    check_random();
+    check_wide_keys();
+
+}
@@ -0,0 +1,255 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "check.hh"
+#include "ring.hh"
+
+using namespace dtl;
+
+namespace {
+
+    struct packet {
+
+        std::uint64_t sequence;
+        std::uint64_t check;
+
+    }; // struct packet
+
+    using multicast = ring::multicast<packet>;
+
+    // Publishes `count` packets in batches of varying size, each carrying its own sequence.
+    void
+    produce(
+        multicast & r,
+        std::uint64_t count
+        ) {
+
+        for (std::uint64_t sent = 0; sent < count;) {
+            auto n = std::min<std::uint64_t>(1 + sent % 37, count - sent);
+            std::uint64_t first;
+            if (!r.try_claim(n, first)) {
+                std::this_thread::yield();
+                continue;
+            }
+            for (std::uint64_t k = 0; k < n; ++k) r[first + k] = { first + k, (first + k) * 3 };
+            r.publish(first + n);
+            sent += n;
+        }
+
+    }
+
+    // Every consumer sees every packet, in order, whatever its batch size.
+    void
+    check_broadcast() {
+
+        constexpr std::uint64_t count = 500000;
+        multicast r(1024, 4);
+        DTL_CHECK(r.capacity() == 1024);
+
+        std::vector<multicast::consumer> consumers;
+        for (int i = 0; i < 3; ++i) consumers.push_back(r.subscribe());
+        {
+            auto fourth = r.subscribe();
+            DTL_CHECK(fourth);
+            DTL_CHECK(!r.subscribe());              // every slot taken
+        }
+        DTL_CHECK(r.subscribe());                   // the fourth left again
+
+        std::vector<std::thread> threads;
+        for (std::uint64_t i = 0; i < 3; ++i) {
+            threads.emplace_back([&, i] {
+                auto & c = consumers[i];
+                std::uint64_t expected = 0;
+                while (expected < count) {
+                    auto n = c.poll([&](const packet & p, std::uint64_t sequence) {
+                        DTL_CHECK(p.sequence == expected && sequence == expected && p.check == expected * 3);
+                        ++expected;
+                    }, 1 + i * 7);
+                    if (!n) std::this_thread::yield();
+                }
+            });
+        }
+        produce(r, count);
+        for (auto & t : threads) t.join();
+
+    }
+
+    // Consumers joining and leaving while the producer runs start at the published cursor and never read a slot
+    // the producer has already reused: a joining consumer must be accounted for before the producer's next gate.
+    void
+    check_joining() {
+
+        constexpr std::uint64_t count = 300000;
+        multicast r(64, 2);
+        std::atomic<bool> done{false};
+
+        std::thread joiner([&] {
+            while (!done.load(std::memory_order_relaxed)) {
+                auto c = r.subscribe();
+                DTL_CHECK(c);
+                auto expected = c.sequence();
+                for (int round = 0; round < 20; ++round) {
+                    c.poll([&](const packet & p, std::uint64_t sequence) {
+                        DTL_CHECK(sequence == expected && p.sequence == expected && p.check == expected * 3);
+                        ++expected;
+                    }, 16);
+                    std::this_thread::yield();
+                }
+            }
+        });
+        produce(r, count);
+        done = true;
+        joiner.join();
+
+    }
+
+    // A file-backed ring shared with a forked consumer process.
+    void
+    check_processes() {
+
+        constexpr std::uint64_t count = 100000;
+        auto path = "/dev/shm/dtl-ring-test-" + std::to_string(::getpid());
+        auto r = multicast::create(path.c_str(), 256, 2);
+
+        int ready[2];
+        DTL_CHECK(::pipe(ready) == 0);
+        auto child = ::fork();
+        DTL_CHECK(child != -1);
+        if (!child) {
+            auto attached = multicast::attach(path.c_str());
+            auto c = attached.subscribe();
+            char byte = 1;
+            if (!c || ::write(ready[1], &byte, 1) != 1) ::_exit(2);
+            for (std::uint64_t expected = 0; expected < count;) {
+                auto n = c.poll([&](const packet & p, std::uint64_t) {
+                    if (p.sequence != expected++) ::_exit(1);
+                });
+                if (!n) std::this_thread::yield();
+            }
+            ::_exit(0);
+        }
+
+        char byte;
+        DTL_CHECK(::read(ready[0], &byte, 1) == 1);
+        produce(r, count);
+        int status;
+        DTL_CHECK(::waitpid(child, &status, 0) == child);
+        DTL_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        ::close(ready[0]);
+        ::close(ready[1]);
+
+        DTL_CHECK_THROWS(ring::multicast<std::uint32_t>::attach(path.c_str()));
+        ::unlink(path.c_str());
+
+        // Capacity 0 is refused when creating, and when attaching to a header that claims it (in a file of the
+        // size such a ring would have, one slot short of a ring of capacity 1).
+        DTL_CHECK_THROWS(multicast::create(path.c_str(), 0, 2));
+        ::unlink(path.c_str());
+        {
+            auto one = multicast::create(path.c_str(), 1, 2);
+        }
+        const std::uint64_t zero = 0;
+        int handle = ::open(path.c_str(), O_RDWR);
+        struct stat st;
+        DTL_CHECK(handle != -1 && ::fstat(handle, &st) == 0);
+        DTL_CHECK(::pwrite(handle, &zero, sizeof(zero), 16) == sizeof(zero));
+        DTL_CHECK(::ftruncate(handle, st.st_size - static_cast<off_t>(sizeof(packet))) == 0);
+        ::close(handle);
+        DTL_CHECK_THROWS(multicast::attach(path.c_str()));
+        ::unlink(path.c_str());
+
+    }
+
+    // Records of random lengths from 16 bytes to 4 KB through a 64 KB queue, so that many of them straddle the
+    // end of the buffer: each arrives whole, contiguous and in order, and aborted reservations never appear.
+    void
+    check_records() {
+
+        constexpr std::uint64_t count = 200000;
+        ring::records q(64 * 1024);
+        DTL_CHECK(q.capacity() == 64 * 1024);
+
+        std::thread consumer([&] {
+            std::mt19937 rng(1);
+            for (std::uint64_t expected = 0; expected < count;) {
+                auto n = q.read([&](const void * data, std::size_t length) {
+                    DTL_CHECK(length >= 16 && length <= 4096);
+                    std::uint64_t sequence;
+                    std::memcpy(&sequence, data, sizeof(sequence));
+                    DTL_CHECK(sequence == expected);
+                    auto * bytes = static_cast<const std::uint8_t *>(data);
+                    for (std::size_t i = 8; i < length; ++i) DTL_CHECK(bytes[i] == std::uint8_t(sequence + i));
+                    ++expected;
+                }, 1 + rng() % 64);
+                if (!n) std::this_thread::yield();
+            }
+        });
+
+        std::mt19937 rng(2);
+        std::uint64_t aborted = 0;
+        for (std::uint64_t sequence = 0; sequence < count;) {
+            std::size_t length = 16 + rng() % 4081;
+            auto * at = static_cast<std::uint8_t *>(q.reserve(4096));
+            if (!at) {
+                std::this_thread::yield();
+                continue;
+            }
+            if (rng() % 10 == 0) {
+                std::memset(at, 0xff, 4096);
+                q.abort();
+                ++aborted;
+                continue;
+            }
+            std::memcpy(at, &sequence, sizeof(sequence));
+            for (std::size_t i = 8; i < length; ++i) at[i] = std::uint8_t(sequence + i);
+            q.commit(length);
+            ++sequence;
+        }
+        consumer.join();
+        DTL_CHECK(aborted > 0);
+        DTL_CHECK(q.read([](const void *, std::size_t) {}) == 0);
+
+    }
+
+    // The largest record fills the whole buffer; anything larger is refused even when the queue is empty.
+    void
+    check_record_limits() {
+
+        ring::records q(4096);
+        DTL_CHECK(q.capacity() >= 4096);
+        DTL_CHECK(!q.reserve(q.max_record() + 1));
+
+        std::vector<std::uint8_t> payload(q.max_record());
+        for (std::size_t i = 0; i < payload.size(); ++i) payload[i] = std::uint8_t(i * 7);
+        for (int round = 0; round < 3; ++round) {
+            DTL_CHECK(q.push("x", 1));              // shift the start so that the big record wraps
+            DTL_CHECK(q.read([](const void *, std::size_t length) { DTL_CHECK(length == 1); }) == 1);
+            DTL_CHECK(q.push(payload.data(), payload.size()));
+            DTL_CHECK(!q.push("y", 1));
+            DTL_CHECK(q.read([&](const void * data, std::size_t length) {
+                DTL_CHECK(length == payload.size() && !std::memcmp(data, payload.data(), length));
+            }) == 1);
+        }
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    check_broadcast();
+    check_joining();
+    check_processes();
+    check_records();
+    check_record_limits();
+
+}
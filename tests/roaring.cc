@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <random>
+#include <set>
+#include <vector>
+#include <unistd.h>
+#include "check.hh"
+#include "roaring.hh"
+
+using namespace dtl;
+
+namespace {
+
+    template<typename Set>
+    std::vector<std::uint32_t>
+    members(
+        const Set & s
+        ) {
+
+        std::vector<std::uint32_t> out;
+        roaring::for_each(s, [&](std::uint32_t x) { out.push_back(x); });
+        return out;
+
+    }
+
+    // Serializes into 8-byte aligned storage, as view requires.
+    std::vector<std::uint64_t>
+    image(
+        const roaring::bitmap & b
+        ) {
+
+        std::vector<std::uint64_t> out((b.serialized_size() + 7) / 8);
+        b.serialize(out.data());
+        return out;
+
+    }
+
+    template<typename Set>
+    void
+    check_queries(
+        const Set & s,
+        const std::vector<std::uint32_t> & expected,
+        std::mt19937_64 & rng
+        ) {
+
+        DTL_CHECK(roaring::cardinality(s) == expected.size());
+        DTL_CHECK(members(s) == expected);
+        for (std::size_t i = 0; i < expected.size(); i += 1 + rng() % 50) {
+            DTL_CHECK(roaring::select(s, i) == expected[i]);
+            DTL_CHECK(roaring::rank(s, expected[i]) == i + 1);
+        }
+        for (int k = 0; k < 2000; ++k) {
+            auto x = static_cast<std::uint32_t>(rng());
+            auto below = std::upper_bound(expected.begin(), expected.end(), x) - expected.begin();
+            DTL_CHECK(roaring::rank(s, x) == std::uint64_t(below));
+            DTL_CHECK(roaring::contains(s, x) == std::binary_search(expected.begin(), expected.end(), x));
+        }
+
+    }
+
+    // Random sets over spans that give dense bitmap containers, sparse arrays and a long run, checked against
+    // std::set, owned and through a serialized view, before and after optimize().
+    void
+    check_random() {
+
+        std::mt19937_64 rng(1);
+        for (int round = 0; round < 30; ++round) {
+            roaring::bitmap a, b;
+            std::set<std::uint32_t> sa, sb;
+            std::uint32_t span = (round % 3 == 0) ? 70000 : (round % 3 == 1) ? 300000 : 1u << 31;
+            for (auto n = rng() % 20000; n; --n) {
+                auto x = static_cast<std::uint32_t>(rng() % span);
+                a.add(x);
+                sa.insert(x);
+            }
+            for (auto n = rng() % 20000; n; --n) {
+                auto x = static_cast<std::uint32_t>(rng() % span);
+                b.add(x);
+                sb.insert(x);
+            }
+            auto start = static_cast<std::uint32_t>(rng() % span);
+            for (auto x = start; x < start + 5000; ++x) {
+                a.add(x);
+                sa.insert(x);
+            }
+            for (int k = 0; k < 500; ++k) {
+                auto x = static_cast<std::uint32_t>(rng() % span);
+                a.remove(x);
+                sa.erase(x);
+            }
+            if (round & 1) {
+                a.optimize();
+                b.optimize();
+            }
+
+            const std::vector<std::uint32_t> va(sa.begin(), sa.end());
+            check_queries(a, va, rng);
+
+            std::vector<std::uint32_t> both, either;
+            std::set_intersection(sa.begin(), sa.end(), sb.begin(), sb.end(), std::back_inserter(both));
+            std::set_union(sa.begin(), sa.end(), sb.begin(), sb.end(), std::back_inserter(either));
+            check_queries(roaring::intersect(a, b), both, rng);
+            check_queries(roaring::unite(a, b), either, rng);
+
+            auto stored = image(a);
+            roaring::view v(stored.data(), a.serialized_size());
+            check_queries(v, va, rng);
+            DTL_CHECK(members(roaring::intersect(v, b)) == both);
+        }
+
+    }
+
+    // Rank and select at every position of one container of each kind, including block and run boundaries.
+    void
+    check_containers() {
+
+        std::mt19937_64 rng(2);
+        roaring::bitmap dense, runs, sparse;
+        std::vector<std::uint32_t> d, r, s;
+        for (std::uint32_t x = 0; x < 65536; ++x) {
+            if (rng() % 3 == 0) {
+                dense.add(x);
+                d.push_back(x);
+            }
+            if (x % 1000 < 300) {
+                runs.add(x);
+                r.push_back(x);
+            }
+            if (x % 17 == 0) {
+                sparse.add(x);
+                s.push_back(x);
+            }
+        }
+        runs.optimize();
+        DTL_CHECK(dense.container(0).kind == roaring::kind::bitmap);
+        DTL_CHECK(runs.container(0).kind == roaring::kind::run);
+        DTL_CHECK(sparse.container(0).kind == roaring::kind::array);
+
+        for (auto * set : { &dense, &runs, &sparse }) {
+            auto & expected = (set == &dense) ? d : (set == &runs) ? r : s;
+            for (std::size_t i = 0; i < expected.size(); ++i) DTL_CHECK(roaring::select(*set, i) == expected[i]);
+            std::size_t below = 0;
+            for (std::uint32_t x = 0; x < 65536; ++x) {
+                below += below < expected.size() && expected[below] == x;
+                DTL_CHECK(roaring::rank(*set, x) == below);
+            }
+        }
+
+        // Removing from a dense container keeps its block counts in step.
+        for (std::size_t k = 0; k < 1000; ++k) {
+            auto at = rng() % d.size();
+            dense.remove(d[at]);
+            d.erase(d.begin() + at);
+        }
+        for (std::size_t i = 0; i < d.size(); ++i) DTL_CHECK(roaring::select(dense, i) == d[i]);
+
+    }
+
+    // Images whose counts, order or rank index disagree with their payload are refused.
+    void
+    check_corruption() {
+
+        roaring::bitmap b;
+        for (std::uint32_t x = 0; x < 65536; x += 2) b.add(x);               // bitmap container, key 0
+        for (std::uint32_t x = 1 << 16; x < (1 << 16) + 10; ++x) b.add(x);  // array, key 1
+        for (std::uint32_t x = 2 << 16; x < (2 << 16) + 5000; ++x) b.add(x); // run, key 2
+        b.optimize();
+        DTL_CHECK(b.container(2).kind == roaring::kind::run);
+
+        const auto size = b.serialized_size();
+        const auto good = image(b);
+        roaring::view(good.data(), size);
+        DTL_CHECK_THROWS(roaring::view(good.data(), size - 1));
+
+        auto descriptors = [](std::vector<std::uint64_t> & data) {
+            return reinterpret_cast<roaring::_::descriptor *>(reinterpret_cast<roaring::_::header *>(data.data()) + 1);
+        };
+        auto bytes = [](std::vector<std::uint64_t> & data, std::size_t offset) {
+            return reinterpret_cast<std::uint16_t *>(reinterpret_cast<std::uint8_t *>(data.data()) + offset);
+        };
+
+        for (int corruption = 0; corruption < 7; ++corruption) {
+            auto bad = good;
+            auto * d = descriptors(bad);
+            switch (corruption) {
+            case 0: ++d[0].cardinality; break;                                        // bitmap popcount
+            case 1: --d[2].cardinality; break;                                        // run lengths
+            case 2: std::swap(bytes(bad, d[1].offset)[0], bytes(bad, d[1].offset)[1]); break; // array order
+            case 3: std::swap(d[0].key, d[1].key); break;                             // key order
+            case 4: ++d[1].before; break;                                             // container prefix
+            case 5: ++bytes(bad, d[0].offset + roaring::_::words * 8)[3]; break;      // block index
+            default: ++bytes(bad, d[2].offset + d[2].size * 2)[0]; break;             // run index
+            }
+            DTL_CHECK_THROWS(roaring::view(bad.data(), size));
+        }
+
+    }
+
+    void
+    check_file() {
+
+        roaring::bitmap b;
+        std::vector<std::uint32_t> expected;
+        for (std::uint32_t x = 0; x < 1000000; x += 7) {
+            b.add(x);
+            expected.push_back(x);
+        }
+        char path[] = "/tmp/dtl-roaring-XXXXXX";
+        int handle = ::mkstemp(path);
+        DTL_CHECK(handle != -1);
+        ::close(handle);
+        b.save(path);
+        auto v = roaring::view::load(path);
+        ::unlink(path);
+        std::mt19937_64 rng(3);
+        check_queries(v, expected, rng);
+
+    }
+
+    // Dense arrays with many matches per block exercise the rotation compare.
+    void
+    check_dense_intersection() {
+
+        roaring::bitmap x, y;
+        std::vector<std::uint32_t> expected;
+        for (std::uint32_t i = 0; i < 4000; ++i) {
+            if (i % 2 == 0) x.add(i);
+            if (i % 3 == 0) y.add(i);
+            if (i % 6 == 0) expected.push_back(i);
+        }
+        DTL_CHECK(members(roaring::intersect(x, y)) == expected);
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    check_random();
+    check_containers();
+    check_corruption();
+    check_file();
+    check_dense_intersection();
+
+}
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+#include "simd.hh"
+#include "check.hh"
+
+using namespace dtl;
+
+namespace {
+
+    std::mt19937_64 rng(3);
+
+    template<typename T>
+    T
+    draw() {
+
+        // Plenty of equal and extreme lanes, so that every comparison outcome shows up.
+        switch (rng() % 4) {
+        case 0: return std::numeric_limits<T>::min();
+        case 1: return std::numeric_limits<T>::max();
+        case 2: return static_cast<T>(rng() % 3);
+        default: return static_cast<T>(rng());
+        }
+
+    }
+
+    // Lane-wise operations and movemask() against per-lane scalar results, at one vector width.
+    template<typename T, std::size_t W>
+    void
+    check_lanes() {
+
+        using V = simd::vec<T, W>;
+        using U = std::make_unsigned_t<simd::_::lane_t<T>>;
+
+        for (int round = 0; round < 2000; ++round) {
+            T a[W], b[W], out[W];
+            for (std::size_t i = 0; i < W; ++i) {
+                a[i] = draw<T>();
+                b[i] = (rng() % 4) ? draw<T>() : a[i];
+            }
+            auto x = V::load(a), y = V::load(b);
+
+            std::uint64_t eq = 0, lt = 0, gt = 0;
+            for (std::size_t i = 0; i < W; ++i) {
+                eq |= std::uint64_t(a[i] == b[i]) << i;
+                lt |= std::uint64_t(a[i] < b[i]) << i;
+                gt |= std::uint64_t(a[i] > b[i]) << i;
+            }
+            DTL_CHECK(simd::movemask(simd::eq(x, y)) == eq);
+            DTL_CHECK(simd::movemask(simd::lt(x, y)) == lt);
+            DTL_CHECK(simd::movemask(simd::gt(x, y)) == gt);
+            DTL_CHECK(simd::any(simd::eq(x, y)) == (eq != 0));
+
+            (x + y).store(out);
+            for (std::size_t i = 0; i < W; ++i) DTL_CHECK(out[i] == static_cast<T>(a[i] + b[i]));
+            (x - y).store(out);
+            for (std::size_t i = 0; i < W; ++i) DTL_CHECK(out[i] == static_cast<T>(a[i] - b[i]));
+            (x ^ y).store(out);
+            for (std::size_t i = 0; i < W; ++i) DTL_CHECK(out[i] == static_cast<T>(a[i] ^ b[i]));
+
+            simd::blend(simd::lt(x, y), x, y).store(out);
+            for (std::size_t i = 0; i < W; ++i) DTL_CHECK(out[i] == std::min(a[i], b[i]));
+            simd::max(x, y).store(out);
+            for (std::size_t i = 0; i < W; ++i) DTL_CHECK(out[i] == std::max(a[i], b[i]));
+            if constexpr (std::is_signed<T>::value) {
+                simd::abs(x).store(out);
+                for (std::size_t i = 0; i < W; ++i) DTL_CHECK(out[i] == static_cast<T>(branchless::abs(a[i])));
+            }
+
+            U lanes[W];
+            for (auto & l : lanes) l = static_cast<U>(rng());
+            auto indices = simd::vec<U, W>::load(lanes);
+            simd::shuffle(x, indices).store(out);
+            for (std::size_t i = 0; i < W; ++i) DTL_CHECK(out[i] == a[indices[i] & (W - 1)]);
+        }
+
+    }
+
+    // Every width from one lane up to 64 bytes: vector widths beyond the target's are legal and lower to
+    // narrower instructions.
+    template<typename T>
+    void
+    check_widths() {
+
+        check_lanes<T, 1>();
+        check_lanes<T, 16 / sizeof(T)>();
+        check_lanes<T, 32 / sizeof(T)>();
+        check_lanes<T, 64 / sizeof(T)>();
+
+    }
+
+    template<typename T>
+    void
+    check_kernels() {
+
+        for (std::size_t n : { 0, 1, 7, 31, 64, 65, 1000 }) {
+            std::vector<T> a(n), b(n), out(n);
+            for (std::size_t i = 0; i < n; ++i) {
+                a[i] = draw<T>();
+                b[i] = draw<T>();
+            }
+            simd::min(a.data(), b.data(), out.data(), n);
+            for (std::size_t i = 0; i < n; ++i) DTL_CHECK(out[i] == std::min(a[i], b[i]));
+            simd::max(a.data(), b.data(), out.data(), n);
+            for (std::size_t i = 0; i < n; ++i) DTL_CHECK(out[i] == std::max(a[i], b[i]));
+            if constexpr (std::is_signed<T>::value) {
+                simd::abs(a.data(), out.data(), n);
+                for (std::size_t i = 0; i < n; ++i) DTL_CHECK(out[i] == static_cast<T>(branchless::abs(a[i])));
+            }
+        }
+
+    }
+
+    template<std::size_t W>
+    void
+    check_gather() {
+
+        std::int32_t base[256];
+        for (int i = 0; i < 256; ++i) base[i] = i * 3;
+        std::int32_t lanes[W];
+        for (std::size_t i = 0; i < W; ++i) lanes[i] = static_cast<std::int32_t>((i * 37) % 256);
+        auto indices = simd::vec<std::int32_t, W>::load(lanes);
+        auto g = simd::gather(base, indices);
+        for (std::size_t i = 0; i < W; ++i) DTL_CHECK(g[i] == base[indices[i]]);
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    check_widths<std::int8_t>();
+    check_widths<std::uint8_t>();
+    check_widths<std::int16_t>();
+    check_widths<std::uint16_t>();
+    check_widths<std::int32_t>();
+    check_widths<std::uint32_t>();
+    check_widths<std::int64_t>();
+    check_widths<std::uint64_t>();
+
+    check_kernels<std::int8_t>();
+    check_kernels<std::uint8_t>();
+    check_kernels<std::int16_t>();
+    check_kernels<std::uint16_t>();
+    check_kernels<std::int32_t>();
+    check_kernels<std::uint32_t>();
+    check_kernels<std::int64_t>();
+    check_kernels<std::uint64_t>();
+
+    check_gather<1>();
+    check_gather<4>();
+    check_gather<8>();
+    check_gather<16>();
+
+    // Float masks and blends.
+    float values[16] = { 1, 5, 2, 6, 3, 7, 4, 8, 1, 5, 2, 6, 3, 7, 4, 8 };
+    auto v = simd::vec<float, 16>::load(values);
+    auto low = simd::lt(v, simd::vec<float, 16>::broadcast(4.f));
+    DTL_CHECK(simd::movemask(low) == 0x1515);
+    auto kept = simd::blend(low, v, simd::vec<float, 16>::broadcast(0.f));
+    for (std::size_t i = 0; i < 16; ++i) DTL_CHECK(kept[i] == (values[i] < 4 ? values[i] : 0));
+    DTL_CHECK(simd::movemask(simd::eq(simd::vec<double, 4>::broadcast(1.0), simd::vec<double, 4>::broadcast(1.0))) == 15);
+
+    // The scalar backend is constexpr.
+    static_assert(simd::abs(simd::vec<int, 1>{ -5 }).v == 5);
+    static_assert((simd::vec<std::uint8_t, 1>{ 200 } + simd::vec<std::uint8_t, 1>{ 100 }).v == 44);
+    static_assert(simd::movemask(simd::lt(simd::vec<std::int16_t, 1>{ -1 }, simd::vec<std::int16_t, 1>{ 0 })) == 1);
+
+}
@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <tuple>
+#include "soa.hh"
+#include "check.hh"
+
+using namespace dtl;
+
+int
+main() {
+
+    using records = soa::table<std::uint32_t, std::uint16_t, double>;
+
+    records t;
+    for (std::uint32_t i = 0; i < 1000; ++i) t.push_back(i, static_cast<std::uint16_t>(i * 2), i * 0.5);
+    DTL_CHECK(t.size() == 1000 && t.capacity() >= 1000);
+    DTL_CHECK(reinterpret_cast<std::uintptr_t>(t.column<0>()) % soa::alignment == 0);
+    DTL_CHECK(reinterpret_cast<std::uintptr_t>(t.column<1>()) % soa::alignment == 0);
+    DTL_CHECK(reinterpret_cast<std::uintptr_t>(t.column<2>()) % soa::alignment == 0);
+
+    std::uint64_t sum = 0;
+    for (std::size_t i = 0; i < t.size(); ++i) sum += t.column<0>()[i];
+    DTL_CHECK(sum == 999 * 1000 / 2);
+
+    // Proxies: structured bindings refer into the columns, assignment scatters a tuple.
+    auto [a, b, d] = t[10];
+    a = 77;
+    DTL_CHECK(t.column<0>()[10] == 77 && b == 20 && d == 5.0);
+    t[11] = std::make_tuple(1u, std::uint16_t(2), 3.0);
+    std::tuple<std::uint32_t, std::uint16_t, double> copy = t[11];
+    DTL_CHECK(copy == std::make_tuple(1u, std::uint16_t(2), 3.0));
+
+    // Iterators.
+    DTL_CHECK(std::count_if(t.begin(), t.end(), [](auto r) { return r.template get<1>() > 100; }) == 949);
+    const auto & view = t;
+    auto found = std::find_if(view.begin(), view.end(), [](auto r) { return r.template get<0>() == 500; });
+    DTL_CHECK(found - view.begin() == 500);
+
+    // Growth keeps the contents and zero-fills new records.
+    t.resize(5000);
+    DTL_CHECK(t.size() == 5000 && t.column<0>()[999] == 999 && t.column<0>()[1500] == 0 && t.column<2>()[4999] == 0);
+    t.pop_back();
+    DTL_CHECK(t.size() == 4999);
+
+    // Moves leave the source empty and usable.
+    auto * column = t.column<0>();
+    records moved(std::move(t));
+    DTL_CHECK(moved.size() == 4999 && moved.column<0>() == column);
+    DTL_CHECK(t.size() == 0 && t.capacity() == 0 && t.empty() && t.begin() == t.end());
+    t.push_back(7, 8, 9.0);
+    DTL_CHECK(t.size() == 1 && t.column<0>()[0] == 7 && moved.column<0>()[0] == 0);
+
+    records assigned;
+    assigned.push_back(1, 2, 3.0);
+    assigned = std::move(moved);
+    DTL_CHECK(assigned.size() == 4999 && assigned.column<0>() == column && assigned.column<0>()[999] == 999);
+    DTL_CHECK(moved.size() == 0 && moved.capacity() == 0);
+    moved.push_back(4, 5, 6.0);
+    DTL_CHECK(std::get<0>(std::tuple<std::uint32_t, std::uint16_t, double>(moved[0])) == 4);
+
+    // Appending a copy of one of its own rows exactly at capacity, when the push moves the columns.
+    records rows;
+    for (std::uint32_t i = 0; i < 3; ++i) rows.push_back(i, std::uint16_t(i + 10), i + 0.25);
+    while (rows.size() < rows.capacity()) rows.push_back(0, 0, 0.0);
+    const auto full = rows.capacity();
+    const auto * before = rows.column<0>();
+    rows.push_back(rows.column<0>()[2], rows.column<1>()[2], rows.column<2>()[2]);
+    DTL_CHECK(rows.capacity() > full && rows.column<0>() != before && rows.size() == full + 1);
+    DTL_CHECK(rows.column<0>()[full] == 2 && rows.column<1>()[full] == 12 && rows.column<2>()[full] == 2.25);
+
+    t.clear();
+    DTL_CHECK(t.empty() && t.capacity() > 0);
+
+}
@@ -0,0 +1,211 @@
+#include <random>
+#include <string>
+#include <vector>
+#include "check.hh"
+#include "tls.hh"
+
+using namespace dtl;
+
+namespace {
+
+    using buffer = std::vector<std::uint8_t>;
+
+    void
+    put16(
+        buffer & out,
+        std::size_t v
+        ) {
+
+        out.push_back(static_cast<std::uint8_t>(v >> 8));
+        out.push_back(static_cast<std::uint8_t>(v));
+
+    }
+
+    void
+    put_extension(
+        buffer & out,
+        std::uint16_t type,
+        const buffer & body
+        ) {
+
+        put16(out, type);
+        put16(out, body.size());
+        out.insert(out.end(), body.begin(), body.end());
+
+    }
+
+    // A ClientHello handshake message with GREASE in the ciphers and extensions, SNI, groups, point formats,
+    // signature algorithms, ALPN "h2" and "http/1.1", TLS 1.3 and 1.2 versions, and `pad` bytes of padding.
+    buffer
+    client_hello(
+        const std::string & sni,
+        std::size_t pad = 0
+        ) {
+
+        buffer body;
+        put16(body, 0x0303);
+        for (int i = 0; i < 32; ++i) body.push_back(static_cast<std::uint8_t>(i));
+        body.push_back(0);
+        buffer ciphers = { 0x0a, 0x0a, 0x13, 0x01, 0x13, 0x02, 0xc0, 0x2f };
+        put16(body, ciphers.size());
+        body.insert(body.end(), ciphers.begin(), ciphers.end());
+        body.insert(body.end(), { 1, 0 });
+
+        buffer extensions, name;
+        put_extension(extensions, 0x2a2a, {});
+        put16(name, sni.size() + 3);
+        name.push_back(0);
+        put16(name, sni.size());
+        name.insert(name.end(), sni.begin(), sni.end());
+        put_extension(extensions, tls::extension::server_name, name);
+        put_extension(extensions, tls::extension::supported_groups, { 0, 4, 0, 0x1d, 0, 0x17 });
+        put_extension(extensions, tls::extension::ec_point_formats, { 1, 0 });
+        put_extension(extensions, tls::extension::signature_algorithms, { 0, 4, 4, 3, 8, 4 });
+        put_extension(extensions, tls::extension::alpn, { 0, 12, 2, 'h', '2', 8, 'h', 't', 't', 'p', '/', '1', '.', '1' });
+        put_extension(extensions, tls::extension::supported_versions, { 4, 0x03, 0x04, 0x03, 0x03 });
+        put_extension(extensions, 21, buffer(pad, 0));
+        put16(body, extensions.size());
+        body.insert(body.end(), extensions.begin(), extensions.end());
+
+        buffer message = { 1, static_cast<std::uint8_t>(body.size() >> 16), static_cast<std::uint8_t>(body.size() >> 8),
+                           static_cast<std::uint8_t>(body.size()) };
+        message.insert(message.end(), body.begin(), body.end());
+        return message;
+
+    }
+
+    // Wraps a handshake message into handshake records of at most `chunk` bytes each.
+    buffer
+    records(
+        const buffer & message,
+        std::size_t chunk
+        ) {
+
+        buffer stream;
+        for (std::size_t at = 0; at < message.size(); at += chunk) {
+            auto n = std::min(chunk, message.size() - at);
+            stream.insert(stream.end(), { 22, 3, 1 });
+            put16(stream, n);
+            stream.insert(stream.end(), message.begin() + at, message.begin() + at + n);
+        }
+        return stream;
+
+    }
+
+    void
+    check_hello() {
+
+        auto stream = records(client_hello("www.example.com"), 16384);
+        tls::hello h;
+        DTL_CHECK(tls::parse(stream.data(), stream.size(), h) == tls::status::complete);
+        DTL_CHECK(h.server_name == "www.example.com" && h.version() == 0x0304);
+
+        std::vector<std::string> alpn;
+        h.for_each_alpn([&](std::string_view protocol) { alpn.emplace_back(protocol); });
+        DTL_CHECK(alpn.size() == 2 && alpn[0] == "h2" && alpn[1] == "http/1.1");
+
+        char out[512];
+        h.ja3(out, sizeof(out));
+        DTL_CHECK(std::string(out) == "771,4865-4866-49199,0-10-11-13-16-43-21,29-23,0");
+        auto length = h.ja4(out, sizeof(out));
+        DTL_CHECK(std::string(out) == "t13d0307h2_1301,1302,c02f_000a,000b,000d,0015,002b_0403,0804");
+        char prefix[4];
+        DTL_CHECK(h.ja4(prefix, sizeof(prefix)) == length && std::string(prefix, 4) == "t13d");   // what fits
+
+        for (std::size_t n = 0; n < stream.size(); ++n) {
+            DTL_CHECK(tls::parse(stream.data(), n, h) == tls::status::incomplete);
+        }
+        const std::uint8_t get[] = { 'G', 'E', 'T', ' ' };
+        DTL_CHECK(tls::parse(get, sizeof(get), h) == tls::status::other);
+
+    }
+
+    // A large hello split over several records needs the assembler, whatever the segment size.
+    void
+    check_assembler() {
+
+        auto stream = records(client_hello("split.example.org", 5000), 1000);
+        tls::hello h;
+        DTL_CHECK(tls::parse(stream.data(), stream.size(), h) == tls::status::incomplete);
+
+        for (std::size_t segment : { 1, 7, 100, 1460 }) {
+            tls::assembler a;
+            auto result = tls::status::incomplete;
+            for (std::size_t at = 0; at < stream.size() && result == tls::status::incomplete; at += segment) {
+                result = a.feed(stream.data() + at, std::min(segment, stream.size() - at), h);
+            }
+            DTL_CHECK(result == tls::status::complete && h.server_name == "split.example.org");
+        }
+
+        tls::assembler a;
+        const std::uint8_t alert[] = { 21, 3, 3, 0, 2, 2, 40 };
+        DTL_CHECK(a.feed(alert, sizeof(alert), h) == tls::status::other);
+        DTL_CHECK(a.feed(stream.data(), stream.size(), h) == tls::status::invalid);
+
+    }
+
+    // Random corruption never reads outside the buffer, and whatever still parses can be fingerprinted.
+    void
+    check_corrupted() {
+
+        auto stream = records(client_hello("www.example.com"), 16384);
+        std::mt19937_64 rng(3);
+        char out[512];
+        for (int i = 0; i < 100000; ++i) {
+            auto b = stream;
+            for (int k = 0; k < 2; ++k) b[rng() % b.size()] = static_cast<std::uint8_t>(rng());
+            tls::hello h;
+            if (tls::parse(b.data(), b.size(), h) != tls::status::complete) continue;
+            DTL_CHECK(h.ja3(out, sizeof(out)) < sizeof(out) && h.ja4(out, sizeof(out)) < sizeof(out));
+            h.for_each_alpn([&](std::string_view protocol) { DTL_CHECK(protocol.size() < 256); });
+        }
+
+    }
+
+    // An Initial long header, then a hello carried in a CRYPTO frame after a PING, fingerprinted as QUIC.
+    void
+    check_quic() {
+
+        buffer packet = { 0xc3, 0, 0, 0, 1, 8, 1, 2, 3, 4, 5, 6, 7, 8, 0, 0, 0x40, 40 };
+        for (int i = 0; i < 40; ++i) packet.push_back(static_cast<std::uint8_t>(i));
+        auto initial = tls::quic::parse_initial(packet.data(), packet.size());
+        DTL_CHECK(initial && initial->version == 1 && initial->dcid.size == 8 && initial->scid.empty());
+        DTL_CHECK(initial->payload.size == 40 && initial->number_offset == 18);
+        for (std::size_t n = 0; n < packet.size(); ++n) DTL_CHECK(!tls::quic::parse_initial(packet.data(), n));
+        packet[0] = 0xd3;                                       // a 0-RTT packet
+        DTL_CHECK(!tls::quic::parse_initial(packet.data(), packet.size()));
+
+        auto message = client_hello("quic.example.net");
+        buffer frames = { 0x01, 0x06, 0x00 };
+        put16(frames, 0x4000 | message.size());
+        frames.insert(frames.end(), message.begin(), message.end());
+        frames.insert(frames.end(), 10, 0);                     // PADDING
+        buffer crypto;
+        DTL_CHECK(tls::quic::crypto(frames.data(), frames.size(), [&](std::uint64_t offset, tls::bytes b) {
+            DTL_CHECK(offset == 0);
+            crypto.assign(b.data, b.data + b.size);
+        }));
+        tls::hello h;
+        DTL_CHECK(tls::parse_handshake(crypto.data(), crypto.size(), h) == tls::status::complete);
+        DTL_CHECK(h.server_name == "quic.example.net");
+        h.quic = true;
+        char out[512];
+        h.ja4(out, sizeof(out));
+        DTL_CHECK(out[0] == 'q');
+
+        frames[0] = 0x1e;                                       // HANDSHAKE_DONE is not allowed in Initial packets
+        DTL_CHECK(!tls::quic::crypto(frames.data(), frames.size(), [](std::uint64_t, tls::bytes) {}));
+
+    }
+
+} // namespace
+
+int
+main() {
+
+    check_hello();
+    check_assembler();
+    check_corrupted();
+    check_quic();
+
+}
@@ -0,0 +1,731 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include "branch.hh"
+
+namespace dtl::tls {
+
+    // ClientHello extraction for L7 steering, bounds-checked and zero-copy:
+    //
+    //   parse()           - a ClientHello at the start of a TCP stream, i.e. inside one or more TLS records.
+    //   parse_handshake() - a bare handshake message, e.g. reassembled from QUIC CRYPTO frames.
+    //   assembler         - per-flow fallback for a ClientHello spread over several segments or records: it keeps
+    //                       only the handshake bytes, up to a bound, and hands them to parse_handshake().
+    //   quic::initial     - the long header of a QUIC Initial packet; the payload stays protected (the Initial
+    //                       keys derive from the DCID, and decryption is left to the caller), after which
+    //                       quic::crypto() walks the CRYPTO frames.
+    //
+    // Everything in a parsed hello points into the caller's buffer (or the assembler's); fingerprint inputs for
+    // JA3 and JA4 are exposed raw and as their canonical strings, leaving the hash to the caller.
+
+    enum class status {
+
+        complete,       // a ClientHello was parsed
+        incomplete,     // a prefix of one; more bytes are needed
+        invalid,        // malformed
+        other,          // well-formed, but not a ClientHello
+
+    }; // enum class dtl::tls::status
+
+    // A byte range inside the parsed buffer.
+    struct bytes {
+
+        const std::uint8_t * data = nullptr;
+        std::size_t size = 0;
+
+        inline std::string_view str() const noexcept { return { reinterpret_cast<const char *>(data), size }; }
+        inline bool empty() const noexcept { return !size; }
+
+    }; // struct dtl::tls::bytes
+
+    namespace extension {
+
+        constexpr static std::uint16_t server_name = 0;
+        constexpr static std::uint16_t supported_groups = 10;
+        constexpr static std::uint16_t ec_point_formats = 11;
+        constexpr static std::uint16_t signature_algorithms = 13;
+        constexpr static std::uint16_t alpn = 16;
+        constexpr static std::uint16_t supported_versions = 43;
+
+    } // namespace dtl::tls::extension
+
+    namespace _ {
+
+        inline static std::uint16_t
+        load16(
+            const std::uint8_t * p
+            ) noexcept {
+
+            return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+
+        } // _::load16()
+
+        inline static std::uint32_t
+        load24(
+            const std::uint8_t * p
+            ) noexcept {
+
+            return (std::uint32_t(p[0]) << 16) | (std::uint32_t(p[1]) << 8) | p[2];
+
+        } // _::load24()
+
+        // RFC 8701 reserved values, which fingerprints skip.
+        inline static bool
+        grease(
+            std::uint16_t v
+            ) noexcept {
+
+            return (v & 0x0f0f) == 0x0a0a && (v >> 8) == (v & 0xff);
+
+        } // _::grease()
+
+        // Reads length-prefixed fields off a range, failing once anything would overrun it.
+        class reader {
+
+            const std::uint8_t * at;
+            const std::uint8_t * end;
+
+        public:
+
+            inline
+            reader(
+                bytes range
+                ) noexcept
+                : at(range.data), end(range.data + range.size) {}
+
+            inline std::size_t left() const noexcept { return static_cast<std::size_t>(end - at); }
+
+            inline bool
+            take(
+                std::size_t n,
+                bytes & out
+                ) noexcept {
+
+                if (unlikely(n > left())) return false;
+                out = { at, n };
+                at += n;
+                return true;
+
+            } // reader::take()
+
+            inline bool
+            u8(
+                std::uint8_t & out
+                ) noexcept {
+
+                if (unlikely(!left())) return false;
+                out = *at++;
+                return true;
+
+            } // reader::u8()
+
+            inline bool
+            u16(
+                std::uint16_t & out
+                ) noexcept {
+
+                if (unlikely(left() < 2)) return false;
+                out = load16(at);
+                at += 2;
+                return true;
+
+            } // reader::u16()
+
+            // A vector with a Width-byte length prefix.
+            template<std::size_t Width>
+            inline bool
+            vector(
+                bytes & out
+                ) noexcept {
+
+                if (unlikely(left() < Width)) return false;
+                std::size_t n = Width == 1 ? at[0] : Width == 2 ? load16(at) : load24(at);
+                at += Width;
+                return take(n, out);
+
+            } // reader::vector()
+
+        }; // class dtl::tls::_::reader
+
+        // snprintf-style output: writes what fits, counts everything.
+        class writer {
+
+            char * out;
+            std::size_t capacity;
+            std::size_t length = 0;
+
+        public:
+
+            inline
+            writer(
+                char * out,
+                std::size_t capacity
+                ) noexcept
+                : out(out), capacity(capacity) {}
+
+            inline void
+            put(
+                char c
+                ) noexcept {
+
+                if (length < capacity) out[length] = c;
+                ++length;
+
+            } // writer::put()
+
+            inline void
+            decimal(
+                unsigned v
+                ) noexcept {
+
+                char digits[10];
+                int n = 0;
+                do digits[n++] = static_cast<char>('0' + v % 10); while (v /= 10);
+                while (n) put(digits[--n]);
+
+            } // writer::decimal()
+
+            inline void
+            hex4(
+                std::uint16_t v
+                ) noexcept {
+
+                constexpr static char table[] = "0123456789abcdef";
+                for (int shift = 12; shift >= 0; shift -= 4) put(table[(v >> shift) & 0xf]);
+
+            } // writer::hex4()
+
+            // Terminates if room is left; returns the full length, excluding the terminator.
+            inline std::size_t
+            finish() noexcept {
+
+                if (length < capacity) out[length] = 0;
+                return length;
+
+            } // writer::finish()
+
+        }; // class dtl::tls::_::writer
+
+        // Writes a list of 16-bit values from a raw vector, skipping GREASE.
+        inline static void
+        list(
+            writer & w,
+            bytes raw,
+            char separator,
+            bool hex
+            ) noexcept {
+
+            bool first = true;
+            for (std::size_t i = 0; i + 1 < raw.size; i += 2) {
+                auto v = load16(raw.data + i);
+                if (grease(v)) continue;
+                if (!first) w.put(separator);
+                first = false;
+                if (hex) w.hex4(v);
+                else w.decimal(v);
+            }
+
+        } // _::list()
+
+    } // namespace dtl::tls::_
+
+    struct hello {
+
+        std::uint16_t legacy_version = 0;
+        bytes random;
+        bytes session_id;
+        bytes cipher_suites;            // u16 each
+        bytes compression_methods;
+        bytes extensions;               // the whole extensions block, walked by for_each_extension()
+
+        // Contents of the extensions that matter for steering and fingerprints, without their length prefixes.
+        std::string_view server_name;   // first host_name entry; empty if absent
+        bytes alpn;                     // u8-length-prefixed protocol names
+        bytes supported_groups;         // u16 each
+        bytes ec_point_formats;         // u8 each
+        bytes signature_algorithms;     // u16 each
+        bytes supported_versions;       // u16 each
+
+        bool quic = false;              // set by the caller for hellos carried in QUIC, for JA4
+
+        // Visits extensions in wire order as visitor(type, bytes body).
+        template<typename Visitor>
+        inline void
+        for_each_extension(
+            Visitor && visitor
+            ) const {
+
+            for (std::size_t at = 0; at + 4 <= extensions.size; ) {
+                auto type = _::load16(extensions.data + at);
+                std::size_t n = _::load16(extensions.data + at + 2);
+                visitor(type, bytes{ extensions.data + at + 4, n });
+                at += 4 + n;
+            }
+
+        } // hello::for_each_extension() const
+
+        // Visits the offered ALPN protocol names in order as visitor(std::string_view).
+        template<typename Visitor>
+        inline void
+        for_each_alpn(
+            Visitor && visitor
+            ) const {
+
+            for (std::size_t at = 0; at < alpn.size; ) {
+                std::size_t n = alpn.data[at];
+                visitor(std::string_view(reinterpret_cast<const char *>(alpn.data + at + 1), n));
+                at += 1 + n;
+            }
+
+        } // hello::for_each_alpn() const
+
+        // Highest non-GREASE entry of supported_versions, or the legacy version.
+        inline std::uint16_t
+        version() const noexcept {
+
+            std::uint16_t best = 0;
+            for (std::size_t i = 0; i + 1 < supported_versions.size; i += 2) {
+                auto v = _::load16(supported_versions.data + i);
+                if (!_::grease(v)) best = std::max(best, v);
+            }
+            return best ? best : legacy_version;
+
+        } // hello::version() const
+
+        // The JA3 input string, "version,ciphers,extensions,groups,point formats", written like snprintf.
+        inline std::size_t
+        ja3(
+            char * out,
+            std::size_t capacity
+            ) const noexcept {
+
+            _::writer w(out, capacity);
+            w.decimal(legacy_version);
+            w.put(',');
+            _::list(w, cipher_suites, '-', false);
+            w.put(',');
+            bool first = true;
+            for_each_extension([&](std::uint16_t type, bytes) {
+                if (_::grease(type)) return;
+                if (!first) w.put('-');
+                first = false;
+                w.decimal(type);
+            });
+            w.put(',');
+            _::list(w, supported_groups, '-', false);
+            w.put(',');
+            for (std::size_t i = 0; i < ec_point_formats.size; ++i) {
+                if (i) w.put('-');
+                w.decimal(ec_point_formats.data[i]);
+            }
+            return w.finish();
+
+        } // hello::ja3() const
+
+        // The raw JA4 string (JA4_r): the readable prefix, then sorted ciphers, sorted extensions without SNI and
+        // ALPN, and signature algorithms in order, all in hex. JA4 proper hashes the last three sections.
+        inline std::size_t
+        ja4(
+            char * out,
+            std::size_t capacity
+            ) const noexcept {
+
+            std::uint16_t ciphers[512];
+            std::uint16_t types[512];
+            std::size_t cipher_count = 0, type_count = 0, all_types = 0;
+
+            for (std::size_t i = 0; i + 1 < cipher_suites.size && cipher_count < 512; i += 2) {
+                auto v = _::load16(cipher_suites.data + i);
+                if (!_::grease(v)) ciphers[cipher_count++] = v;
+            }
+            for_each_extension([&](std::uint16_t type, bytes) {
+                if (_::grease(type)) return;
+                ++all_types;
+                if (type != extension::server_name && type != extension::alpn && type_count < 512) types[type_count++] = type;
+            });
+            std::sort(ciphers, ciphers + cipher_count);
+            std::sort(types, types + type_count);
+
+            _::writer w(out, capacity);
+            w.put(quic ? 'q' : 't');
+            switch (version()) {
+            case 0x0304: w.put('1'); w.put('3'); break;
+            case 0x0303: w.put('1'); w.put('2'); break;
+            case 0x0302: w.put('1'); w.put('1'); break;
+            case 0x0301: w.put('1'); w.put('0'); break;
+            case 0x0300: w.put('s'); w.put('3'); break;
+            default: w.put('0'); w.put('0'); break;
+            }
+            w.put(server_name.empty() ? 'i' : 'd');
+            auto two = [&](std::size_t n) {
+                n = std::min<std::size_t>(n, 99);
+                w.put(static_cast<char>('0' + n / 10));
+                w.put(static_cast<char>('0' + n % 10));
+            };
+            two(cipher_count);
+            two(all_types);
+            std::string_view first;
+            if (alpn.size) first = std::string_view(reinterpret_cast<const char *>(alpn.data + 1), alpn.data[0]);
+            auto printable = [](char c) { return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); };
+            if (first.empty()) {
+                w.put('0');
+                w.put('0');
+            } else if (printable(first.front()) && printable(first.back())) {
+                w.put(first.front());
+                w.put(first.back());
+            } else {
+                constexpr static char table[] = "0123456789abcdef";
+                w.put(table[static_cast<std::uint8_t>(first.front()) >> 4]);
+                w.put(table[static_cast<std::uint8_t>(first.back()) & 0xf]);
+            }
+
+            w.put('_');
+            for (std::size_t i = 0; i < cipher_count; ++i) {
+                if (i) w.put(',');
+                w.hex4(ciphers[i]);
+            }
+            w.put('_');
+            for (std::size_t i = 0; i < type_count; ++i) {
+                if (i) w.put(',');
+                w.hex4(types[i]);
+            }
+            if (signature_algorithms.size) {
+                w.put('_');
+                _::list(w, signature_algorithms, ',', true);
+            }
+            return w.finish();
+
+        } // hello::ja4() const
+
+    }; // struct dtl::tls::hello
+
+    constexpr static std::uint8_t handshake_record = 22;
+    constexpr static std::uint8_t client_hello = 1;
+    constexpr static std::size_t record_header = 5;
+    constexpr static std::size_t handshake_header = 4;
+
+    // Parses one handshake message (type, 24-bit length, body) that must be entirely present.
+    inline static status
+    parse_handshake(
+        const void * message,
+        std::size_t length,
+        hello & out
+        ) noexcept {
+
+        auto * p = static_cast<const std::uint8_t *>(message);
+        if (unlikely(length < handshake_header)) return status::incomplete;
+        if (p[0] != client_hello) return status::other;
+        std::size_t body_length = _::load24(p + 1);
+        if (unlikely(length < handshake_header + body_length)) return status::incomplete;
+
+        out = hello{};
+        _::reader r(bytes{ p + handshake_header, body_length });
+        if (unlikely(!r.u16(out.legacy_version)
+                  || !r.take(32, out.random)
+                  || !r.vector<1>(out.session_id) || out.session_id.size > 32
+                  || !r.vector<2>(out.cipher_suites) || out.cipher_suites.size < 2 || (out.cipher_suites.size & 1)
+                  || !r.vector<1>(out.compression_methods) || !out.compression_methods.size)) {
+            return status::invalid;
+        }
+        if (!r.left()) return status::complete;
+        if (unlikely(!r.vector<2>(out.extensions))) return status::invalid;
+
+        _::reader e(out.extensions);
+        while (e.left()) {
+            std::uint16_t type;
+            bytes body;
+            if (unlikely(!e.u16(type) || !e.vector<2>(body))) return status::invalid;
+
+            _::reader b(body);
+            bytes inner;
+            switch (type) {
+            case extension::server_name: {
+                if (unlikely(!b.vector<2>(inner))) return status::invalid;
+                _::reader names(inner);
+                while (names.left()) {
+                    std::uint8_t kind;
+                    bytes name;
+                    if (unlikely(!names.u8(kind) || !names.vector<2>(name))) return status::invalid;
+                    if (kind == 0 && out.server_name.empty()) out.server_name = name.str();
+                }
+                break;
+            }
+            case extension::alpn: {
+                if (unlikely(!b.vector<2>(out.alpn))) return status::invalid;
+                _::reader names(out.alpn);
+                while (names.left()) {
+                    bytes name;
+                    if (unlikely(!names.vector<1>(name) || name.empty())) return status::invalid;
+                }
+                break;
+            }
+            case extension::supported_groups:
+                if (unlikely(!b.vector<2>(out.supported_groups) || (out.supported_groups.size & 1))) return status::invalid;
+                break;
+            case extension::ec_point_formats:
+                if (unlikely(!b.vector<1>(out.ec_point_formats))) return status::invalid;
+                break;
+            case extension::signature_algorithms:
+                if (unlikely(!b.vector<2>(out.signature_algorithms) || (out.signature_algorithms.size & 1))) {
+                    return status::invalid;
+                }
+                break;
+            case extension::supported_versions:
+                if (unlikely(!b.vector<1>(out.supported_versions) || (out.supported_versions.size & 1))) {
+                    return status::invalid;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+        return status::complete;
+
+    } // dtl::tls::parse_handshake()
+
+    // Parses the ClientHello at the start of a TLS stream when it lies within the first record, the common case;
+    // a hello continued in a later record is incomplete here and needs the assembler.
+    inline static status
+    parse(
+        const void * stream,
+        std::size_t length,
+        hello & out
+        ) noexcept {
+
+        auto * p = static_cast<const std::uint8_t *>(stream);
+        if (length < 1) return status::incomplete;
+        if (p[0] != handshake_record) return status::other;
+        if (length < 3) return status::incomplete;
+        if (unlikely(p[1] != 3)) return status::other;
+        if (length < record_header) return status::incomplete;
+
+        std::size_t fragment = _::load16(p + 3);
+        return parse_handshake(p + record_header, std::min(fragment, length - record_header), out);
+
+    } // dtl::tls::parse()
+
+    // Collects the handshake bytes of a ClientHello spread over segments and records. Feed the stream in order from
+    // its first byte; the hello returned on completion points into the assembler, which must outlive its use.
+    class assembler {
+
+        std::vector<std::uint8_t> message;
+        std::uint8_t header[record_header];
+        std::size_t header_have = 0;
+        std::size_t record_left = 0;
+        bool failed = false;
+
+    public:
+
+        // Upper bound on the buffered message: hellos with post-quantum key shares are a few KB.
+        constexpr static std::size_t limit = 1 << 16;
+
+        inline status
+        feed(
+            const void * segment,
+            std::size_t length,
+            hello & out
+            ) {
+
+            if (unlikely(failed)) return status::invalid;
+            auto * p = static_cast<const std::uint8_t *>(segment);
+
+            while (length) {
+                if (!record_left) {
+                    auto n = std::min(length, record_header - header_have);
+                    std::memcpy(header + header_have, p, n);
+                    header_have += n;
+                    p += n;
+                    length -= n;
+                    if (header_have < record_header) break;
+                    header_have = 0;
+                    if (header[0] != handshake_record || header[1] != 3) {
+                        failed = true;
+                        return header[0] == handshake_record ? status::invalid : status::other;
+                    }
+                    record_left = _::load16(header + 3);
+                    if (unlikely(!record_left)) {
+                        failed = true;
+                        return status::invalid;
+                    }
+                    continue;
+                }
+
+                auto n = std::min(length, record_left);
+                if (unlikely(message.size() + n > limit)) {
+                    failed = true;
+                    return status::invalid;
+                }
+                message.insert(message.end(), p, p + n);
+                p += n;
+                length -= n;
+                record_left -= n;
+
+                auto result = parse_handshake(message.data(), message.size(), out);
+                if (result != status::incomplete) {
+                    failed = result != status::complete;
+                    return result;
+                }
+            }
+            return status::incomplete;
+
+        } // assembler::feed()
+
+        inline void
+        reset() noexcept {
+
+            message.clear();
+            header_have = 0;
+            record_left = 0;
+            failed = false;
+
+        } // assembler::reset()
+
+    }; // class dtl::tls::assembler
+
+    namespace quic {
+
+        constexpr static std::uint32_t version_1 = 0x00000001;
+        constexpr static std::uint32_t version_2 = 0x6b3343cf;
+        constexpr static std::size_t max_cid = 20;
+
+        namespace _ {
+
+            // RFC 9000 variable-length integer.
+            inline static bool
+            varint(
+                const std::uint8_t *& at,
+                const std::uint8_t * end,
+                std::uint64_t & out
+                ) noexcept {
+
+                if (unlikely(at >= end)) return false;
+                std::size_t n = std::size_t(1) << (*at >> 6);
+                if (unlikely(static_cast<std::size_t>(end - at) < n)) return false;
+                out = *at & 0x3f;
+                for (std::size_t i = 1; i < n; ++i) out = (out << 8) | at[i];
+                at += n;
+                return true;
+
+            } // _::varint()
+
+        } // namespace dtl::tls::quic::_
+
+        struct initial {
+
+            std::uint32_t version;
+            bytes dcid;                 // the Initial keys derive from this
+            bytes scid;
+            bytes token;
+            std::size_t number_offset;  // start of the protected packet number, for header protection
+            bytes payload;              // packet number and protected payload, as given by the Length field
+
+        }; // struct dtl::tls::quic::initial
+
+        // Parses the long header of a QUIC v1 or v2 Initial packet (the first packet of a datagram). Header
+        // protection has not been removed, so the packet number length is not known yet.
+        inline static std::optional<initial>
+        parse_initial(
+            const void * datagram,
+            std::size_t length
+            ) noexcept {
+
+            auto * p = static_cast<const std::uint8_t *>(datagram);
+            auto * end = p + length;
+            if (unlikely(length < 7 || (p[0] & 0xc0) != 0xc0)) return std::nullopt;
+
+            initial out{};
+            out.version = (std::uint32_t(p[1]) << 24) | (std::uint32_t(p[2]) << 16) | (std::uint32_t(p[3]) << 8) | p[4];
+            auto type = (p[0] >> 4) & 3;
+            if (!((out.version == version_1 && type == 0) || (out.version == version_2 && type == 1))) return std::nullopt;
+
+            auto * at = p + 5;
+            auto cid = [&](bytes & field) {
+                if (unlikely(at >= end || *at > max_cid || static_cast<std::size_t>(end - at - 1) < *at)) return false;
+                field = { at + 1, *at };
+                at += 1 + *at;
+                return true;
+            };
+            if (unlikely(!cid(out.dcid) || !cid(out.scid))) return std::nullopt;
+
+            std::uint64_t n;
+            if (unlikely(!_::varint(at, end, n) || static_cast<std::uint64_t>(end - at) < n)) return std::nullopt;
+            out.token = { at, static_cast<std::size_t>(n) };
+            at += n;
+
+            if (unlikely(!_::varint(at, end, n) || static_cast<std::uint64_t>(end - at) < n || n < 20)) return std::nullopt;
+            out.number_offset = static_cast<std::size_t>(at - p);
+            out.payload = { at, static_cast<std::size_t>(n) };
+            return out;
+
+        } // dtl::tls::quic::parse_initial()
+
+        // Walks the frames of a decrypted Initial payload (after the packet number), calling
+        // visitor(offset, bytes) for each CRYPTO frame. Returns false on a malformed payload or a frame type not
+        // allowed in Initial packets. Concatenating the CRYPTO data by offset yields the handshake message for
+        // parse_handshake().
+        template<typename Visitor>
+        inline static bool
+        crypto(
+            const void * plaintext,
+            std::size_t length,
+            Visitor && visitor
+            ) {
+
+            auto * at = static_cast<const std::uint8_t *>(plaintext);
+            auto * end = at + length;
+            while (at < end) {
+                std::uint64_t type, a, b, c;
+                if (unlikely(!_::varint(at, end, type))) return false;
+                switch (type) {
+                case 0x00:  // PADDING
+                case 0x01:  // PING
+                    break;
+                case 0x02:  // ACK
+                case 0x03: {
+                    std::uint64_t ranges;
+                    if (unlikely(!_::varint(at, end, a) || !_::varint(at, end, b) || !_::varint(at, end, ranges)
+                              || !_::varint(at, end, c))) {
+                        return false;
+                    }
+                    for (std::uint64_t i = 0; i < ranges; ++i) {
+                        if (unlikely(!_::varint(at, end, a) || !_::varint(at, end, b))) return false;
+                    }
+                    if (type == 0x03) {
+                        for (int i = 0; i < 3; ++i) {
+                            if (unlikely(!_::varint(at, end, a))) return false;
+                        }
+                    }
+                    break;
+                }
+                case 0x06:  // CRYPTO
+                    if (unlikely(!_::varint(at, end, a) || !_::varint(at, end, b)
+                              || static_cast<std::uint64_t>(end - at) < b)) {
+                        return false;
+                    }
+                    visitor(a, bytes{ at, static_cast<std::size_t>(b) });
+                    at += b;
+                    break;
+                case 0x1c:  // CONNECTION_CLOSE
+                    if (unlikely(!_::varint(at, end, a) || !_::varint(at, end, b) || !_::varint(at, end, c)
+                              || static_cast<std::uint64_t>(end - at) < c)) {
+                        return false;
+                    }
+                    at += c;
+                    break;
+                default:
+                    return false;
+                }
+            }
+            return true;
+
+        } // dtl::tls::quic::crypto()
+
+    } // namespace dtl::tls::quic
+
+} // namespace dtl::tls